@@ -1,8 +1,17 @@
 #!/bin/bash
-if [ "$#" -ne 3 ]; then
-    echo "Error! need two paras"
-    echo "Usage: <port> <number>  <length>"
+if [ "$#" -lt 3 ]; then
+    echo "Error! need at least three paras"
+    echo "Usage: <port> <number> <length> [pipeline] [rate] [json]"
+    echo "  rate = 0 (default) runs closed loop, otherwise a fixed total request rate"
     exit 1
 fi
 
-../third_party/rust_echo_bench/target/release/echo_bench --address "127.0.0.1:$1" --number $2 --duration 30 --length $3
+# 由 cmake --build <build> --target loadgen_bench 生成
+LOADGEN=${LOADGEN:-../build/benchmark/loadgen_bench}
+
+ARGS="--address 127.0.0.1:$1 --connections $2 --duration 30 --length $3 --pipeline ${4:-1} --rate ${5:-0}"
+if [ -n "$6" ]; then
+    ARGS="$ARGS --json $6"
+fi
+
+$LOADGEN $ARGS
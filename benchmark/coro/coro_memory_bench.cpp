@@ -0,0 +1,224 @@
+#include "coro/io.h"
+#include "coro/task.h"
+#include "fd_manager.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <thread>
+#include <vector>
+
+/**
+ * 有栈协程(Fiber)与无栈协程(Task)的每连接内存对比:
+ * 1. parked: N个连接处理者各自挂起等待(只保存恢复所需的句柄), 对比纯协程开销, 可以直接跑到百万级;
+ * 2. socket: K个socketpair, 处理者阻塞在读(Fiber用hook的read, Task用AsyncRead), 包含epoll注册和1KB读缓冲,
+ *    K受fd上限限制, 结果按每连接内存折算到一百万连接
+ * 每种模型在单独的子进程中运行, 互不影响RSS基线
+ * 用法: coro_memory_bench [parked=1000000] [fiber_parked=100000] [sockets=8000]
+ *      fiber_parked默认较小: 一百万个Fiber需要约128GB虚拟地址空间和数GB常驻内存
+ */
+
+using namespace dag;
+
+static size_t s_page = sysconf(_SC_PAGESIZE);
+
+struct MemInfo {
+    size_t rss = 0;
+    size_t vsz = 0;
+};
+
+static MemInfo ReadMem() {
+    MemInfo m;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if(f) {
+        size_t vsz = 0;
+        size_t rss = 0;
+        if(fscanf(f, "%zu %zu", &vsz, &rss) == 2) {
+            m.vsz = vsz * s_page;
+            m.rss = rss * s_page;
+        }
+        fclose(f);
+    }
+    return m;
+}
+
+static void WaitFor(std::atomic<size_t>& v, size_t n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+static void Report(const char* model, const char* scenario, size_t n, const MemInfo& before, const MemInfo& after, double secs) {
+    double rss = (double)(after.rss - before.rss) / n;
+    double vsz = (double)(after.vsz - before.vsz) / n;
+    printf("%-6s %-7s %9zu conns  %8.0f B/conn RSS  %9.0f B/conn VSZ  %7.2f GB RSS @1M  setup %.2fs\n"
+           ,model, scenario, n, rss, vsz, rss * 1e6 / (1 << 30), secs);
+    fflush(stdout);
+}
+
+static double Since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * 挂起的连接: 保存恢复所需的句柄, 由主线程统一唤醒
+ */
+struct ParkLot {
+    std::mutex mutex;
+    std::vector<Fiber::ptr> fibers;
+    std::vector<std::coroutine_handle<>> handles;
+    std::atomic<size_t> parked{0};
+    std::atomic<size_t> finished{0};
+};
+
+static ParkLot s_lot;
+
+struct ParkAwaiter {
+    bool await_ready() noexcept { return false;}
+
+    void await_suspend(std::coroutine_handle<> h) {
+        std::lock_guard<std::mutex> lock(s_lot.mutex);
+        s_lot.handles.push_back(h);
+        ++s_lot.parked;
+    }
+
+    void await_resume() noexcept {}
+};
+
+static Task<void> ParkedTask() {
+    co_await ParkAwaiter{};
+    ++s_lot.finished;
+}
+
+static void RunParked(bool fiber, size_t n) {
+    IOManager iom(1, false, "mem");
+    s_lot.fibers.reserve(fiber ? n : 0);
+    s_lot.handles.reserve(fiber ? 0 : n);
+    MemInfo before = ReadMem();
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < n; ++i) {
+        if(fiber) {
+            iom.schedulerLock([]() {
+                {
+                    std::lock_guard<std::mutex> lock(s_lot.mutex);
+                    s_lot.fibers.push_back(Fiber::GetThis());
+                    ++s_lot.parked;
+                }
+                Fiber::GetThis()->yield();
+                ++s_lot.finished;
+            });
+        } else {
+            CoSpawn(ParkedTask(), &iom);
+        }
+    }
+    WaitFor(s_lot.parked, n);
+    double secs = Since(start);
+    Report(fiber ? "fiber" : "task", "parked", n, before, ReadMem(), secs);
+
+    for(auto& i : s_lot.fibers) {
+        iom.schedulerLock(i);
+    }
+    for(auto h : s_lot.handles) {
+        iom.schedulerLock([h]() { h.resume(); });
+    }
+    s_lot.fibers.clear();
+    WaitFor(s_lot.finished, n);
+}
+
+static Task<void> SocketTask(int fd, std::atomic<size_t>& started, std::atomic<size_t>& finished) {
+    char buf[1024];
+    ++started;
+    co_await AsyncRead(fd, buf, sizeof(buf));
+    CoClose(fd);
+    ++finished;
+}
+
+static void RunSockets(bool fiber, size_t n) {
+    IOManager iom(1, false, "mem");
+    std::vector<int> peers;
+    std::vector<int> fds;
+    for(size_t i = 0; i < n; ++i) {
+        int sv[2];
+        if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv)) {
+            perror("socketpair");
+            exit(1);
+        }
+        if(!fiber) {
+            fcntl(sv[0], F_SETFL, fcntl(sv[0], F_GETFL) | O_NONBLOCK);
+        }
+        fds.push_back(sv[0]);
+        peers.push_back(sv[1]);
+    }
+    std::atomic<size_t> started{0};
+    std::atomic<size_t> finished{0};
+    MemInfo before = ReadMem();
+    auto start = std::chrono::steady_clock::now();
+    for(int fd : fds) {
+        if(fiber) {
+            iom.schedulerLock([fd, &started, &finished]() {
+                // socketpair不经过hook, 登记到FdManager后hook的read才会挂起协程而不是阻塞线程
+                FdMgr::GetInstance()->get(fd, true);
+                char buf[1024];
+                ++started;
+                read(fd, buf, sizeof(buf));
+                close(fd);
+                ++finished;
+            });
+        } else {
+            CoSpawn(SocketTask(fd, started, finished), &iom);
+        }
+    }
+    WaitFor(started, n);
+    // 等最后一批处理者进入epoll等待
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    double secs = Since(start);
+    Report(fiber ? "fiber" : "task", "socket", n, before, ReadMem(), secs);
+
+    for(int fd : peers) {
+        close(fd);
+    }
+    WaitFor(finished, n);
+}
+
+/**
+ * @brief 在子进程中运行, 每个模型独立测量
+ */
+static void InChild(void (*fn)(bool, size_t), bool fiber, size_t n) {
+    pid_t pid = fork();
+    if(pid == 0) {
+        fn(fiber, n);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("%s run with %zu conns failed (status %d)\n", fiber ? "fiber" : "task", n, status);
+    }
+}
+
+int main(int argc, char** argv) {
+    DAG_LOG_ROOT()->setLoggerLevel(LogLevel::ERROR);
+    size_t parked = argc > 1 ? atol(argv[1]) : 1000000;
+    size_t fiber_parked = argc > 2 ? atol(argv[2]) : 100000;
+    size_t sockets = argc > 3 ? atol(argv[3]) : 8000;
+
+    rlimit rl;
+    getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+    size_t max_sockets = rl.rlim_cur > 200 ? (rl.rlim_cur - 100) / 2 : 0;
+    if(sockets > max_sockets) {
+        printf("fd limit %zu, sockets reduced to %zu\n", (size_t)rl.rlim_cur, max_sockets);
+        sockets = max_sockets;
+    }
+
+    InChild(RunParked, false, parked);
+    InChild(RunParked, true, fiber_parked);
+    InChild(RunSockets, false, sockets);
+    InChild(RunSockets, true, sockets);
+    return 0;
+}
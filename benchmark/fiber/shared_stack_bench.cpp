@@ -0,0 +1,247 @@
+#include "../micro/micro_bench.h"
+#include "fd_manager.h"
+#include "fiber.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <mutex>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * 独立栈与共享栈协程对比:
+ * 1. 内存: N个空闲协程挂起时的每协程RSS/VSZ
+ *    parked: 协程保存自身后直接yield, 独立栈默认只跑十万个(一百万个需要约128GB虚拟地址空间), 按每协程折算到一百万;
+ *    socket: K个socketpair, 协程阻塞在hook的read里, 包含epoll注册和1KB读缓冲
+ * 2. 切换代价: 单线程上K个协程轮流resume/yield, 每个协程在栈上占用depth字节后让出;
+ *    共享栈个数为1时每次切换都要拷出上一个协程的栈、拷回自己的栈, 个数不小于K时不需要拷贝
+ * 内存测试每种模式在单独的子进程中运行, 互不影响RSS基线
+ * 用法: shared_stack_bench [shared_parked=1000000] [private_parked=100000] [sockets=8000]
+ */
+
+using namespace dag;
+using namespace dag::bench;
+
+static size_t s_page = sysconf(_SC_PAGESIZE);
+
+struct MemInfo {
+    size_t rss = 0;
+    size_t vsz = 0;
+};
+
+static MemInfo ReadMem() {
+    MemInfo m;
+    FILE* f = fopen("/proc/self/statm", "r");
+    if(f) {
+        size_t vsz = 0;
+        size_t rss = 0;
+        if(fscanf(f, "%zu %zu", &vsz, &rss) == 2) {
+            m.vsz = vsz * s_page;
+            m.rss = rss * s_page;
+        }
+        fclose(f);
+    }
+    return m;
+}
+
+static void WaitFor(std::atomic<size_t>& v, size_t n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+static const char* StackName(Fiber::StackClass stack_class) {
+    return stack_class == Fiber::STACK_SHARED ? "shared" : "private";
+}
+
+static void Report(Fiber::StackClass stack_class, const char* scenario, size_t n
+                   ,const MemInfo& before, const MemInfo& after, double secs) {
+    double rss = (double)(after.rss - before.rss) / n;
+    double vsz = (double)(after.vsz - before.vsz) / n;
+    printf("%-7s %-7s %9zu fibers  %8.0f B/fiber RSS  %9.0f B/fiber VSZ  %7.2f GB RSS @1M  setup %.2fs\n"
+           ,StackName(stack_class), scenario, n, rss, vsz, rss * 1e6 / (1 << 30), secs);
+    fflush(stdout);
+}
+
+static double Since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static void RunParked(Fiber::StackClass stack_class, size_t n) {
+    IOManager iom(1, false, "mem");
+    std::mutex mutex;
+    std::vector<Fiber::ptr> fibers;
+    fibers.reserve(n);
+    std::atomic<size_t> parked{0};
+    std::atomic<size_t> finished{0};
+    MemInfo before = ReadMem();
+    auto start = std::chrono::steady_clock::now();
+    for(size_t i = 0; i < n; ++i) {
+        iom.schedulerLock([&]() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                fibers.push_back(Fiber::GetThis());
+                ++parked;
+            }
+            Fiber::GetThis()->yield();
+            ++finished;
+        }, -1, stack_class);
+    }
+    WaitFor(parked, n);
+    // 等最后一个协程真正让出
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    Report(stack_class, "parked", n, before, ReadMem(), Since(start));
+
+    for(auto& i : fibers) {
+        iom.schedulerLock(i);
+    }
+    fibers.clear();
+    WaitFor(finished, n);
+}
+
+static void RunSockets(Fiber::StackClass stack_class, size_t n) {
+    IOManager iom(1, false, "mem");
+    std::vector<int> peers;
+    std::vector<int> fds;
+    for(size_t i = 0; i < n; ++i) {
+        int sv[2];
+        if(socketpair(AF_UNIX, SOCK_STREAM, 0, sv)) {
+            perror("socketpair");
+            exit(1);
+        }
+        fds.push_back(sv[0]);
+        peers.push_back(sv[1]);
+    }
+    std::atomic<size_t> started{0};
+    std::atomic<size_t> finished{0};
+    MemInfo before = ReadMem();
+    auto start = std::chrono::steady_clock::now();
+    for(int fd : fds) {
+        iom.schedulerLock([fd, &started, &finished]() {
+            // socketpair不经过hook, 登记到FdManager后hook的read才会挂起协程而不是阻塞线程
+            FdMgr::GetInstance()->get(fd, true);
+            char buf[1024];
+            ++started;
+            read(fd, buf, sizeof(buf));
+            close(fd);
+            ++finished;
+        }, -1, stack_class);
+    }
+    WaitFor(started, n);
+    // 等最后一批协程进入epoll等待
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    Report(stack_class, "socket", n, before, ReadMem(), Since(start));
+
+    for(int fd : peers) {
+        close(fd);
+    }
+    WaitFor(finished, n);
+}
+
+/**
+ * @brief 在子进程中运行, 每种模式独立测量
+ */
+static void InChild(void (*fn)(Fiber::StackClass, size_t), Fiber::StackClass stack_class, size_t n) {
+    pid_t pid = fork();
+    if(pid == 0) {
+        fn(stack_class, n);
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if(!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        printf("%s run with %zu fibers failed (status %d)\n", StackName(stack_class), n, status);
+    }
+}
+
+/**
+ * @brief 在栈上占用约depth字节后让出
+ */
+static void __attribute__((noinline)) TouchAndYield(size_t depth) {
+    char* buf = (char*)alloca(depth);
+    memset(buf, 1, depth);
+    DoNotOptimize(buf);
+    Fiber::GetThisRaw()->yield();
+}
+
+/**
+ * @brief 在新线程上测量: 共享栈的个数在线程第一次使用共享栈时确定
+ * @param[in] stacks 共享栈个数, 0表示使用独立栈
+ */
+static void BenchSwitch(size_t fibers, size_t depth, size_t stacks) {
+    std::thread t([=]() {
+        Fiber::GetThis();
+        if(stacks) {
+            Fiber::SetSharedStackCount(stacks);
+        }
+        char name[96];
+        if(stacks) {
+            snprintf(name, sizeof(name), "switch fibers=%zu depth=%zu shared stacks=%zu", fibers, depth, stacks);
+        } else {
+            snprintf(name, sizeof(name), "switch fibers=%zu depth=%zu private", fibers, depth);
+        }
+        Run(name, 200000, [=](uint64_t n) -> uint64_t {
+            bool stop = false;
+            std::vector<Fiber::ptr> fs;
+            for(size_t i = 0; i < fibers; ++i) {
+                fs.push_back(std::make_shared<Fiber>([&stop, depth]() {
+                    while(!stop) {
+                        TouchAndYield(depth);
+                    }
+                }, 0, false, stacks > 0));
+            }
+            for(auto& f : fs) {
+                f->resume();
+            }
+            uint64_t start = NowNs();
+            for(uint64_t i = 0; i < n; ++i) {
+                fs[i % fibers]->resume();
+            }
+            uint64_t ns = NowNs() - start;
+            stop = true;
+            for(auto& f : fs) {
+                f->resume();
+            }
+            return ns;
+        }, 5);
+    });
+    t.join();
+}
+
+int main(int argc, char** argv) {
+    DAG_LOG_ROOT()->setLoggerLevel(LogLevel::ERROR);
+    size_t shared_parked = argc > 1 ? atol(argv[1]) : 1000000;
+    size_t private_parked = argc > 2 ? atol(argv[2]) : 100000;
+    size_t sockets = argc > 3 ? atol(argv[3]) : 8000;
+
+    rlimit rl;
+    getrlimit(RLIMIT_NOFILE, &rl);
+    rl.rlim_cur = rl.rlim_max;
+    setrlimit(RLIMIT_NOFILE, &rl);
+    size_t max_sockets = rl.rlim_cur > 200 ? (rl.rlim_cur - 100) / 2 : 0;
+    if(sockets > max_sockets) {
+        printf("fd limit %zu, sockets reduced to %zu\n", (size_t)rl.rlim_cur, max_sockets);
+        sockets = max_sockets;
+    }
+
+    InChild(RunParked, Fiber::STACK_SHARED, shared_parked);
+    InChild(RunParked, Fiber::STACK_DEFAULT, private_parked);
+    InChild(RunSockets, Fiber::STACK_SHARED, sockets);
+    InChild(RunSockets, Fiber::STACK_DEFAULT, sockets);
+
+    for(size_t depth : {256, 2048, 8192}) {
+        BenchSwitch(2, depth, 0);
+        BenchSwitch(2, depth, 1);
+        BenchSwitch(2, depth, 2);
+        BenchSwitch(16, depth, 0);
+        BenchSwitch(16, depth, 4);
+    }
+    return 0;
+}
@@ -0,0 +1,156 @@
+#include "http/http_server.h"
+#include "stream/buffered_stream.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * HTTP服务器压测: 进程内启动HttpServer, 再用内置的协程客户端以长连接(可选pipelining)压测
+ * 用法: http_server_bench [connections=64] [seconds=10] [pipeline=1] [threads=2]
+ */
+
+using namespace dag;
+
+static const char* s_addr = "127.0.0.1:8021";
+
+static std::atomic<bool> s_running{true};
+static std::mutex s_mutex;
+static std::vector<uint64_t> s_latencies;
+static uint64_t s_errors = 0;
+
+static uint64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 读取一个响应, 返回body长度, 失败返回-1
+ */
+static int ReadResponse(BufferedStream::ptr bs) {
+    std::string header;
+    if(bs->readUntil(header, "\r\n\r\n") <= 0) {
+        return -1;
+    }
+    size_t pos = header.find("content-length: ");
+    if(pos == std::string::npos) {
+        return -1;
+    }
+    int len = atoi(header.c_str() + pos + 16);
+    std::string body(len, '\0');
+    if(len > 0 && bs->readFixSize(&body[0], len) <= 0) {
+        return -1;
+    }
+    return len;
+}
+
+static void RunClient(int pipeline) {
+    auto addr = Address::LookupAnyIPAddress(s_addr);
+    Socket::ptr sock = Socket::CreateTCP(addr);
+    if(!sock->connect(addr)) {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        ++s_errors;
+        return;
+    }
+    BufferedStream::ptr bs(new BufferedStream(std::make_shared<SocketStream>(sock)));
+
+    static const std::string req = "GET /ping HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+    std::vector<uint64_t> lats;
+    lats.reserve(1 << 16);
+    uint64_t errors = 0;
+    while(s_running) {
+        uint64_t start = NowUs();
+        for(int i = 0; i < pipeline; ++i) {
+            bs->write(req.c_str(), req.size());
+        }
+        if(bs->flush() <= 0) {
+            ++errors;
+            break;
+        }
+        bool ok = true;
+        for(int i = 0; i < pipeline; ++i) {
+            if(ReadResponse(bs) < 0) {
+                ok = false;
+                break;
+            }
+            lats.push_back(NowUs() - start);
+        }
+        if(!ok) {
+            ++errors;
+            break;
+        }
+    }
+    bs->close();
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_latencies.insert(s_latencies.end(), lats.begin(), lats.end());
+    s_errors += errors;
+}
+
+int main(int argc, char** argv) {
+    int conns = argc > 1 ? atoi(argv[1]) : 64;
+    int seconds = argc > 2 ? atoi(argv[2]) : 10;
+    int pipeline = argc > 3 ? atoi(argv[3]) : 1;
+    int threads = argc > 4 ? atoi(argv[4]) : 2;
+
+    DAG_LOG_ROOT()->setLoggerLevel(LogLevel::ERROR);
+
+    std::unique_ptr<IOManager> server_iom(new IOManager(threads, false, "http_server"));
+    std::unique_ptr<IOManager> client_iom(new IOManager(threads, false, "http_client"));
+
+    http::HttpServer::ptr server(new http::HttpServer(true, server_iom.get()
+                                    ,server_iom.get(), server_iom.get()));
+    server->getServletDispatch()->addServlet("/ping", [](http::HttpRequest::ptr req
+                              ,http::HttpResponse::ptr rsp
+                              ,http::HttpSession::ptr session) {
+        rsp->setHeader("Content-Type", "text/plain");
+        rsp->setBody("pong");
+        return 0;
+    });
+
+    server_iom->schedulerLock([server]() {
+        Address::ptr addr = Address::LookupAnyIPAddress(s_addr);
+        if(!server->bind(addr)) {
+            std::cerr << "bind " << s_addr << " failed" << std::endl;
+            exit(1);
+        }
+        server->start();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    for(int i = 0; i < conns; ++i) {
+        client_iom->schedulerLock(std::bind(&RunClient, pipeline));
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    s_running = false;
+
+    client_iom.reset();
+    server->stop();
+    server_iom.reset();
+
+    std::sort(s_latencies.begin(), s_latencies.end());
+    auto pct = [](double p) -> uint64_t {
+        if(s_latencies.empty()) {
+            return 0;
+        }
+        size_t idx = std::min(s_latencies.size() - 1, (size_t)(p * s_latencies.size()));
+        return s_latencies[idx];
+    };
+    std::cout << "connections=" << conns << " pipeline=" << pipeline
+              << " threads=" << threads << " duration=" << seconds << "s" << std::endl;
+    std::cout << "requests=" << s_latencies.size()
+              << " errors=" << s_errors
+              << " req/s=" << (uint64_t)(s_latencies.size() / (double)seconds) << std::endl;
+    std::cout << "latency(us) p50=" << pct(0.50)
+              << " p90=" << pct(0.90)
+              << " p99=" << pct(0.99)
+              << " p999=" << pct(0.999)
+              << " max=" << (s_latencies.empty() ? 0 : s_latencies.back()) << std::endl;
+    return 0;
+}
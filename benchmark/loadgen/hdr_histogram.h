@@ -0,0 +1,117 @@
+#ifndef __DAG_BENCH_HDR_HISTOGRAM_H__
+#define __DAG_BENCH_HDR_HISTOGRAM_H__
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace dag {
+namespace bench {
+
+/**
+ * @brief HDR(高动态范围)直方图, 3位有效数字精度
+ * @details 小于2048的值每个值一个桶; 更大的值按2的幂分段, 每段1024个线性子桶,
+ *          因此任意值的相对误差不超过1/1024, 而桶数只随最大值对数增长;
+ *          record()使用原子计数, 多个线程可以直接并发记录
+ */
+class HdrHistogram {
+public:
+    /// 子桶位数, 2^11 = 2048
+    static const int SUB_BUCKET_BITS = 11;
+    static const uint64_t SUB_BUCKET_COUNT = 1ULL << SUB_BUCKET_BITS;
+    static const uint64_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+
+    /**
+     * @brief 构造函数
+     * @param[in] max_value 可记录的最大值, 超过的值按max_value记录
+     */
+    HdrHistogram(uint64_t max_value = 1ULL << 40)
+        :m_maxValue(max_value)
+        ,m_counts(Index(max_value) + 1) {
+        for(auto& c : m_counts) {
+            c = 0;
+        }
+    }
+
+    /**
+     * @brief 记录一个值
+     */
+    void record(uint64_t v) {
+        v = std::min(v, m_maxValue);
+        m_counts[Index(v)].fetch_add(1, std::memory_order_relaxed);
+        m_total.fetch_add(1, std::memory_order_relaxed);
+        m_sum.fetch_add(v, std::memory_order_relaxed);
+        uint64_t cur = m_min.load(std::memory_order_relaxed);
+        while(v < cur && !m_min.compare_exchange_weak(cur, v)) {
+        }
+        cur = m_max.load(std::memory_order_relaxed);
+        while(v > cur && !m_max.compare_exchange_weak(cur, v)) {
+        }
+    }
+
+    uint64_t count() const { return m_total;}
+    uint64_t min() const { return m_total ? m_min.load() : 0;}
+    uint64_t max() const { return m_max;}
+    double mean() const { return m_total ? (double)m_sum / m_total : 0;}
+
+    /**
+     * @brief 返回百分位数(桶内最大的等价值)
+     * @param[in] p 百分比, 如99.9
+     */
+    uint64_t percentile(double p) const {
+        uint64_t total = m_total;
+        if(total == 0) {
+            return 0;
+        }
+        uint64_t target = (uint64_t)std::ceil(p / 100.0 * total);
+        target = std::max<uint64_t>(1, std::min(target, total));
+        uint64_t acc = 0;
+        for(size_t i = 0; i < m_counts.size(); ++i) {
+            acc += m_counts[i].load(std::memory_order_relaxed);
+            if(acc >= target) {
+                return std::min(HighestEquivalent(i), max());
+            }
+        }
+        return max();
+    }
+
+    /**
+     * @brief 值对应的桶下标
+     */
+    static size_t Index(uint64_t v) {
+        if(v < SUB_BUCKET_COUNT) {
+            return v;
+        }
+        int msb = 63 - __builtin_clzll(v);
+        int shift = msb - (SUB_BUCKET_BITS - 1);
+        return SUB_BUCKET_COUNT + (shift - 1) * SUB_BUCKET_HALF
+                + ((v >> shift) - SUB_BUCKET_HALF);
+    }
+
+    /**
+     * @brief 桶内最大的值
+     */
+    static uint64_t HighestEquivalent(size_t idx) {
+        if(idx < SUB_BUCKET_COUNT) {
+            return idx;
+        }
+        uint64_t shift = (idx - SUB_BUCKET_COUNT) / SUB_BUCKET_HALF + 1;
+        uint64_t sub = (idx - SUB_BUCKET_COUNT) % SUB_BUCKET_HALF + SUB_BUCKET_HALF;
+        return (sub << shift) + (1ULL << shift) - 1;
+    }
+
+private:
+    uint64_t m_maxValue;
+    std::vector<std::atomic<uint64_t> > m_counts;
+    std::atomic<uint64_t> m_total{0};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_min{UINT64_MAX};
+    std::atomic<uint64_t> m_max{0};
+};
+
+}
+}
+
+#endif
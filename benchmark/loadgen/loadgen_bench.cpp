@@ -0,0 +1,400 @@
+#include "hdr_histogram.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "socket.h"
+#include "stream/socket_stream.h"
+#include "tcp_server.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fstream>
+#include <getopt.h>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+/**
+ * 回显负载生成器(bench.sh使用)
+ *  - 闭环: 每条连接发出pipeline个请求, 全部收到回显后再发下一批
+ *  - 开环(--rate>0): 按固定总速率发送, 不等待响应(最多pipeline个在途),
+ *    延迟从"计划发送时间"算起, 服务端变慢导致的排队也计入延迟(避免coordinated omission)
+ * 用法见 loadgen_bench --help
+ */
+
+using namespace dag;
+using namespace dag::bench;
+
+struct Options {
+    std::string address = "127.0.0.1:8000";
+    int connections = 50;
+    size_t payload = 512;
+    int pipeline = 1;
+    int duration = 10;
+    int warmup = 0;
+    uint64_t rate = 0;
+    int threads = 2;
+    std::string json;
+    bool server = false;
+};
+
+static Options s_opts;
+static std::atomic<bool> s_running{true};
+static std::atomic<bool> s_measuring{false};
+static std::atomic<uint64_t> s_requests{0};
+static std::atomic<uint64_t> s_responses{0};
+static std::atomic<uint64_t> s_errors{0};
+static std::atomic<int> s_alive{0};
+/// 延迟直方图(纳秒)
+static HdrHistogram s_latency;
+
+static uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+class EchoServer : public TcpServer {
+public:
+    EchoServer(IOManager* iom) :TcpServer(iom, iom, iom) {}
+protected:
+    void handleClient(Socket::ptr client) override {
+        char buf[16 * 1024];
+        while(true) {
+            int n = client->recv(buf, sizeof(buf));
+            if(n <= 0) {
+                break;
+            }
+            if(client->send(buf, n) <= 0) {
+                break;
+            }
+        }
+        client->close();
+    }
+};
+
+/**
+ * @brief 解析--address: ip:port, [ipv6]:port, unix:/path, unix:@abstract
+ */
+static Address::ptr ParseAddress(const std::string& str) {
+    if(str.compare(0, 5, "unix:") == 0) {
+        std::string path = str.substr(5);
+        if(!path.empty() && path[0] == '@') {
+            return UnixAddress::CreateAbstract(path.substr(1));
+        }
+        return path.empty() ? nullptr : std::make_shared<UnixAddress>(path);
+    }
+    return Address::LookupAnyIPAddress(str, AF_UNSPEC);
+}
+
+static SocketStream::ptr Connect(Address::ptr addr) {
+    Socket::ptr sock = Socket::CreateTCP(addr);
+    if(!sock->connect(addr, 3000)) {
+        ++s_errors;
+        return nullptr;
+    }
+    sock->setRecvTimeout(3000);
+    return std::make_shared<SocketStream>(sock);
+}
+
+static void Record(uint64_t start) {
+    if(s_measuring) {
+        ++s_responses;
+        s_latency.record(NowNs() - start);
+    }
+}
+
+/**
+ * @brief 闭环: 一批pipeline个请求一次写出, 每个响应的延迟从这批的发送时刻算起
+ */
+static void RunClosed(Address::ptr addr) {
+    SocketStream::ptr ss = Connect(addr);
+    if(ss) {
+        std::string out(s_opts.payload * s_opts.pipeline, 'x');
+        std::string in(s_opts.payload, '\0');
+        while(s_running) {
+            uint64_t start = NowNs();
+            if(ss->writeFixSize(out.c_str(), out.size()) <= 0) {
+                ++s_errors;
+                break;
+            }
+            if(s_measuring) {
+                s_requests += s_opts.pipeline;
+            }
+            bool ok = true;
+            for(int i = 0; i < s_opts.pipeline; ++i) {
+                if(ss->readFixSize(&in[0], in.size()) <= 0) {
+                    ok = false;
+                    break;
+                }
+                Record(start);
+            }
+            if(!ok) {
+                ++s_errors;
+                break;
+            }
+        }
+        ss->close();
+    }
+    --s_alive;
+}
+
+/**
+ * @brief 开环连接状态: 发送协程和接收协程共享
+ */
+struct OpenConn {
+    using ptr = std::shared_ptr<OpenConn>;
+    SocketStream::ptr ss;
+    std::mutex mutex;
+    /// 在途请求的计划发送时间
+    std::deque<uint64_t> inflight;
+    bool done = false;
+};
+
+static void RunOpenRecv(OpenConn::ptr conn) {
+    std::string in(s_opts.payload, '\0');
+    while(true) {
+        if(conn->ss->readFixSize(&in[0], in.size()) <= 0) {
+            break;
+        }
+        uint64_t start;
+        {
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            start = conn->inflight.front();
+            conn->inflight.pop_front();
+        }
+        Record(start);
+    }
+    std::lock_guard<std::mutex> lock(conn->mutex);
+    if(!conn->inflight.empty() && s_running) {
+        ++s_errors;
+    }
+    conn->done = true;
+}
+
+/**
+ * @brief 开环: 按固定间隔计算"到目前为止应该发出的请求数", 补发所有到期的请求
+ */
+static void RunOpenSend(Address::ptr addr, double interval_ns) {
+    SocketStream::ptr ss = Connect(addr);
+    if(!ss) {
+        --s_alive;
+        return;
+    }
+    OpenConn::ptr conn(new OpenConn);
+    conn->ss = ss;
+    IOManager::GetThis()->schedulerLock(std::bind(&RunOpenRecv, conn));
+
+    std::string out;
+    uint64_t begin = NowNs();
+    uint64_t sent = 0;
+    while(s_running) {
+        uint64_t now = NowNs();
+        uint64_t due = (uint64_t)((now - begin) / interval_ns) + 1;
+        size_t n = 0;
+        {
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            if(conn->done) {
+                break;
+            }
+            size_t room = s_opts.pipeline - std::min<size_t>(s_opts.pipeline, conn->inflight.size());
+            n = std::min<uint64_t>(due - sent, room);
+            for(size_t i = 0; i < n; ++i) {
+                conn->inflight.push_back(begin + (uint64_t)((sent + i) * interval_ns));
+            }
+        }
+        if(n > 0) {
+            out.assign(s_opts.payload * n, 'x');
+            if(ss->writeFixSize(out.c_str(), out.size()) <= 0) {
+                ++s_errors;
+                break;
+            }
+            sent += n;
+            if(s_measuring) {
+                s_requests += n;
+            }
+        }
+        uint64_t next = begin + (uint64_t)(sent * interval_ns);
+        now = NowNs();
+        // hook的usleep基于毫秒定时器, 到期的请求会在下一轮一起补发
+        usleep(next > now ? std::max<uint64_t>((next - now) / 1000, 1000) : 1000);
+    }
+    // 半关闭: 服务端回显完剩余数据后关闭连接, 接收协程随之退出
+    shutdown(ss->getSocket()->getSocket(), SHUT_WR);
+    while(true) {
+        {
+            std::lock_guard<std::mutex> lock(conn->mutex);
+            if(conn->done) {
+                break;
+            }
+        }
+        usleep(1000);
+    }
+    ss->close();
+    --s_alive;
+}
+
+static std::string ToJson(double seconds) {
+    std::stringstream ss;
+    auto us = [](uint64_t ns) { return ns / 1000.0;};
+    ss << "{\"address\":\"" << s_opts.address << "\""
+       << ",\"mode\":\"" << (s_opts.rate ? "open" : "closed") << "\""
+       << ",\"connections\":" << s_opts.connections
+       << ",\"payload\":" << s_opts.payload
+       << ",\"pipeline\":" << s_opts.pipeline
+       << ",\"rate\":" << s_opts.rate
+       << ",\"duration_s\":" << seconds
+       << ",\"requests\":" << s_requests
+       << ",\"responses\":" << s_responses
+       << ",\"errors\":" << s_errors
+       << ",\"throughput_rps\":" << (uint64_t)(s_responses / seconds)
+       << ",\"throughput_mbps\":" << s_responses * s_opts.payload / seconds / 1024 / 1024
+       << ",\"latency_us\":{"
+       << "\"min\":" << us(s_latency.min())
+       << ",\"mean\":" << s_latency.mean() / 1000
+       << ",\"p50\":" << us(s_latency.percentile(50))
+       << ",\"p90\":" << us(s_latency.percentile(90))
+       << ",\"p99\":" << us(s_latency.percentile(99))
+       << ",\"p999\":" << us(s_latency.percentile(99.9))
+       << ",\"p9999\":" << us(s_latency.percentile(99.99))
+       << ",\"max\":" << us(s_latency.max())
+       << "}}";
+    return ss.str();
+}
+
+static void Usage(const char* prog) {
+    std::cout << "Usage: " << prog << " [options]\n"
+              << "  -a, --address <addr>      echo server address: ip:port, [ipv6]:port, unix:/path\n"
+              << "                            or unix:@abstract (default 127.0.0.1:8000)\n"
+              << "  -c, --connections <n>     connections (default 50)\n"
+              << "  -l, --length <bytes>      payload size per request (default 512)\n"
+              << "  -p, --pipeline <n>        requests in flight per connection (default 1)\n"
+              << "  -t, --duration <sec>      measured duration (default 10)\n"
+              << "  -w, --warmup <sec>        warmup excluded from results (default 0)\n"
+              << "  -r, --rate <req/s>        open loop with fixed total rate, 0 = closed loop\n"
+              << "  -T, --threads <n>         client IOManager threads (default 2)\n"
+              << "  -j, --json <file|->       also write results as JSON\n"
+              << "  -s, --server              start an in-process echo server on --address\n";
+}
+
+int main(int argc, char** argv) {
+    static const option long_opts[] = {
+        {"address", required_argument, nullptr, 'a'},
+        {"connections", required_argument, nullptr, 'c'},
+        {"length", required_argument, nullptr, 'l'},
+        {"pipeline", required_argument, nullptr, 'p'},
+        {"duration", required_argument, nullptr, 't'},
+        {"warmup", required_argument, nullptr, 'w'},
+        {"rate", required_argument, nullptr, 'r'},
+        {"threads", required_argument, nullptr, 'T'},
+        {"json", required_argument, nullptr, 'j'},
+        {"server", no_argument, nullptr, 's'},
+        {"help", no_argument, nullptr, 'h'},
+        {nullptr, 0, nullptr, 0}
+    };
+    int c;
+    while((c = getopt_long(argc, argv, "a:c:l:p:t:w:r:T:j:sh", long_opts, nullptr)) != -1) {
+        switch(c) {
+            case 'a': s_opts.address = optarg; break;
+            case 'c': s_opts.connections = atoi(optarg); break;
+            case 'l': s_opts.payload = atoi(optarg); break;
+            case 'p': s_opts.pipeline = atoi(optarg); break;
+            case 't': s_opts.duration = atoi(optarg); break;
+            case 'w': s_opts.warmup = atoi(optarg); break;
+            case 'r': s_opts.rate = strtoull(optarg, nullptr, 10); break;
+            case 'T': s_opts.threads = atoi(optarg); break;
+            case 'j': s_opts.json = optarg; break;
+            case 's': s_opts.server = true; break;
+            default:
+                Usage(argv[0]);
+                return c == 'h' ? 0 : 1;
+        }
+    }
+    if(s_opts.connections <= 0 || s_opts.payload == 0 || s_opts.pipeline <= 0
+            || s_opts.duration <= 0 || s_opts.threads <= 0) {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    DAG_LOG_ROOT()->setLoggerLevel(LogLevel::FATAL);
+    DAG_LOG_NAME("system")->setLoggerLevel(LogLevel::FATAL);
+
+    Address::ptr addr = ParseAddress(s_opts.address);
+    if(!addr) {
+        std::cerr << "invalid address " << s_opts.address << std::endl;
+        return 1;
+    }
+
+    std::unique_ptr<IOManager> server_iom;
+    std::shared_ptr<EchoServer> server;
+    if(s_opts.server) {
+        server_iom.reset(new IOManager(s_opts.threads, false, "echo_server"));
+        server.reset(new EchoServer(server_iom.get()));
+        server_iom->schedulerLock([server, addr]() {
+            if(!server->bind(addr)) {
+                std::cerr << "bind " << s_opts.address << " failed" << std::endl;
+                exit(1);
+            }
+            server->start();
+        });
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    std::cout << "Benchmarking: " << s_opts.address << std::endl
+              << s_opts.connections << " clients, " << s_opts.payload << " bytes, pipeline "
+              << s_opts.pipeline << ", " << (s_opts.rate ? "open loop " + std::to_string(s_opts.rate) + " req/s"
+                                                         : std::string("closed loop"))
+              << ", " << s_opts.duration << " sec" << std::endl;
+
+    std::unique_ptr<IOManager> client_iom(new IOManager(s_opts.threads, false, "loadgen"));
+    s_alive = s_opts.connections;
+    double interval_ns = s_opts.rate ? 1e9 * s_opts.connections / s_opts.rate : 0;
+    for(int i = 0; i < s_opts.connections; ++i) {
+        if(s_opts.rate) {
+            client_iom->schedulerLock(std::bind(&RunOpenSend, addr, interval_ns));
+        } else {
+            client_iom->schedulerLock(std::bind(&RunClosed, addr));
+        }
+    }
+
+    std::this_thread::sleep_for(std::chrono::seconds(s_opts.warmup));
+    s_measuring = true;
+    uint64_t start = NowNs();
+    std::this_thread::sleep_for(std::chrono::seconds(s_opts.duration));
+    s_measuring = false;
+    double seconds = (NowNs() - start) / 1e9;
+    s_running = false;
+    while(s_alive > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    client_iom.reset();
+    if(server) {
+        server->stop();
+        server_iom.reset();
+    }
+
+    char buf[512];
+    snprintf(buf, sizeof(buf),
+             "Requests: %lu, Responses: %lu, Errors: %lu\n"
+             "Speed: %.0f request/sec, %.0f response/sec, %.2f MB/s\n"
+             "Latency(us): min %.1f, mean %.1f, p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, p99.99 %.1f, max %.1f\n",
+             (unsigned long)s_requests.load(), (unsigned long)s_responses.load(), (unsigned long)s_errors.load(),
+             s_requests / seconds, s_responses / seconds,
+             s_responses * s_opts.payload / seconds / 1024 / 1024,
+             s_latency.min() / 1000.0, s_latency.mean() / 1000.0,
+             s_latency.percentile(50) / 1000.0, s_latency.percentile(90) / 1000.0,
+             s_latency.percentile(99) / 1000.0, s_latency.percentile(99.9) / 1000.0,
+             s_latency.percentile(99.99) / 1000.0, s_latency.max() / 1000.0);
+    std::cout << buf;
+
+    if(!s_opts.json.empty()) {
+        std::string json = ToJson(seconds);
+        if(s_opts.json == "-") {
+            std::cout << json << std::endl;
+        } else {
+            std::ofstream ofs(s_opts.json);
+            ofs << json << std::endl;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,59 @@
+#ifndef __DAG_BENCH_MICRO_BENCH_H__
+#define __DAG_BENCH_MICRO_BENCH_H__
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace dag {
+namespace bench {
+
+/**
+ * @brief 阻止编译器把结果未被使用的计算优化掉
+ */
+template<class T>
+inline void DoNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+inline uint64_t NowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * @brief 运行一个微基准
+ * @details 先完整预热一轮, 再重复repeat轮, 每轮调用一次fn(iters)执行iters次操作;
+ *          输出每次操作耗时的中位数和最小值(中位数抗干扰, 最小值接近理想值)以及中位数对应的吞吐
+ * @param[in] name 名称
+ * @param[in] iters 每轮的操作次数
+ * @param[in] fn 执行iters次操作; 返回值为本轮实际计时的纳秒数, 返回0时使用整体耗时
+ * @param[in] repeat 重复轮数
+ */
+inline void Run(const std::string& name, uint64_t iters
+                ,const std::function<uint64_t(uint64_t)>& fn, int repeat = 7) {
+    fn(iters);
+    std::vector<double> samples;
+    for(int i = 0; i < repeat; ++i) {
+        uint64_t start = NowNs();
+        uint64_t ns = fn(iters);
+        if(ns == 0) {
+            ns = NowNs() - start;
+        }
+        samples.push_back((double)ns / iters);
+    }
+    std::sort(samples.begin(), samples.end());
+    double median = samples[samples.size() / 2];
+    printf("%-44s %10.1f ns/op  (min %8.1f)  %14.0f ops/s\n"
+           ,name.c_str(), median, samples.front(), median > 0 ? 1e9 / median : 0);
+    fflush(stdout);
+}
+
+}
+}
+
+#endif
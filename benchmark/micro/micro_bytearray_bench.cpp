@@ -0,0 +1,94 @@
+#include "micro_bench.h"
+#include "bytearray.h"
+#include <algorithm>
+#include <random>
+
+/**
+ * ByteArray微基准: varint编解码, 带varint长度前缀的字符串编解码
+ * 用法: micro_bytearray_bench
+ */
+
+using namespace dag;
+using namespace dag::bench;
+
+static void BenchString(size_t len) {
+    std::string s(len, 'x');
+    // 每轮约写入4MB: ByteArray扩容时从头遍历节点链表, 总量过大时耗时会按平方增长
+    const uint64_t n = std::min<uint64_t>(200000, 4 * 1024 * 1024 / len);
+    ByteArray::ptr ba(new ByteArray(4096));
+
+    Run("writeStringVint " + std::to_string(len) + "B", n, [&ba, &s](uint64_t n) -> uint64_t {
+        ba->clear();
+        uint64_t start = NowNs();
+        for(uint64_t i = 0; i < n; ++i) {
+            ba->writeStringVint(s);
+        }
+        return NowNs() - start;
+    });
+
+    Run("readStringVint " + std::to_string(len) + "B", n, [&ba](uint64_t n) -> uint64_t {
+        ba->setPosition(0);
+        uint64_t start = NowNs();
+        for(uint64_t i = 0; i < n; ++i) {
+            std::string v = ba->readStringVint();
+            DoNotOptimize(v);
+        }
+        return NowNs() - start;
+    });
+}
+
+int main() {
+    const uint64_t n = 1000000;
+    // 混合1~10字节的varint
+    std::vector<uint64_t> values(n);
+    std::mt19937_64 rng(42);
+    for(auto& v : values) {
+        v = rng() >> (rng() % 64);
+    }
+    ByteArray::ptr ba(new ByteArray(4096));
+
+    Run("writeUint64 varint (mixed width)", n, [&ba, &values](uint64_t n) -> uint64_t {
+        ba->clear();
+        uint64_t start = NowNs();
+        for(uint64_t i = 0; i < n; ++i) {
+            ba->writeUint64(values[i]);
+        }
+        return NowNs() - start;
+    });
+
+    Run("readUint64 varint (mixed width)", n, [&ba](uint64_t n) -> uint64_t {
+        ba->setPosition(0);
+        uint64_t start = NowNs();
+        uint64_t sum = 0;
+        for(uint64_t i = 0; i < n; ++i) {
+            sum += ba->readUint64();
+        }
+        DoNotOptimize(sum);
+        return NowNs() - start;
+    });
+
+    Run("writeFuint64 fixed", n, [&ba, &values](uint64_t n) -> uint64_t {
+        ba->clear();
+        uint64_t start = NowNs();
+        for(uint64_t i = 0; i < n; ++i) {
+            ba->writeFuint64(values[i]);
+        }
+        return NowNs() - start;
+    });
+
+    Run("readFuint64 fixed", n, [&ba](uint64_t n) -> uint64_t {
+        ba->setPosition(0);
+        uint64_t start = NowNs();
+        uint64_t sum = 0;
+        for(uint64_t i = 0; i < n; ++i) {
+            sum += ba->readFuint64();
+        }
+        DoNotOptimize(sum);
+        return NowNs() - start;
+    });
+
+    BenchString(16);
+    BenchString(1024);
+    BenchString(64 * 1024);
+    return 0;
+}
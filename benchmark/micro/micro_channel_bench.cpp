@@ -0,0 +1,134 @@
+#include "micro_bench.h"
+#include "channel.h"
+#include "fiber_mutex.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include <atomic>
+#include <deque>
+#include <thread>
+
+/**
+ * 通道基准:
+ * 1. 单线程trySend+tryRecv(无等待的快速路径), 有界与无界对比
+ * 2. P个生产者协程/C个消费者协程在W个工作线程上收发, 输出消息/秒;
+ *    与FiberMutex+FiberCondVar保护的deque实现的队列对比
+ * 用法: micro_channel_bench
+ */
+
+using namespace dag;
+using namespace dag::bench;
+
+/**
+ * 对照组: 互斥锁+条件变量的有界队列
+ */
+class LockedQueue {
+public:
+    explicit LockedQueue(size_t capacity) : m_capacity(capacity) {}
+
+    void send(int v) {
+        std::unique_lock<FiberMutex> lock(m_mutex);
+        while(m_queue.size() >= m_capacity) {
+            m_notFull.wait(m_mutex);
+        }
+        m_queue.push_back(v);
+        m_notEmpty.notify_one();
+    }
+
+    int recv() {
+        std::unique_lock<FiberMutex> lock(m_mutex);
+        while(m_queue.empty()) {
+            m_notEmpty.wait(m_mutex);
+        }
+        int v = m_queue.front();
+        m_queue.pop_front();
+        m_notFull.notify_one();
+        return v;
+    }
+
+private:
+    size_t m_capacity;
+    FiberMutex m_mutex;
+    FiberCondVar m_notEmpty;
+    FiberCondVar m_notFull;
+    std::deque<int> m_queue;
+};
+
+static void BenchTry(const char* name, size_t capacity) {
+    Channel<int> ch(capacity);
+    Run(name, 10000000, [&ch](uint64_t n) -> uint64_t {
+        int v = 0;
+        for(uint64_t i = 0; i < n; ++i) {
+            ch.trySend((int)i);
+            ch.tryRecv(v);
+            DoNotOptimize(v);
+        }
+        return 0;
+    });
+}
+
+/**
+ * @brief producers个生产者共发送n条消息, consumers个消费者接收, 计时到全部收完
+ */
+template <class Send, class Recv>
+static uint64_t Pump(IOManager& iom, uint64_t n, int producers, int consumers, Send send, Recv recv) {
+    std::atomic<int> done{0};
+    uint64_t per_producer = n / producers;
+    uint64_t total = per_producer * producers;
+    uint64_t start = NowNs();
+    for(int c = 0; c < consumers; ++c) {
+        uint64_t quota = total / consumers + (c < (int)(total % consumers) ? 1 : 0);
+        iom.schedulerLock([&done, quota, recv]() {
+            for(uint64_t i = 0; i < quota; ++i) {
+                DoNotOptimize(recv());
+            }
+            ++done;
+        });
+    }
+    for(int p = 0; p < producers; ++p) {
+        iom.schedulerLock([&done, per_producer, send]() {
+            for(uint64_t i = 0; i < per_producer; ++i) {
+                send((int)i);
+            }
+            ++done;
+        });
+    }
+    while(done < producers + consumers) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return NowNs() - start;
+}
+
+static void BenchPump(int producers, int consumers, int workers, size_t capacity, uint64_t iters) {
+    IOManager iom(workers, false, "micro");
+    char name[96];
+
+    Channel<int> ch(capacity);
+    snprintf(name, sizeof(name), "Channel(%zu) %dP/%dC workers=%d", capacity, producers, consumers, workers);
+    Run(name, iters, [&](uint64_t n) -> uint64_t {
+        return Pump(iom, n, producers, consumers
+                    ,[&ch](int v) { ch.send(v); }
+                    ,[&ch]() { int v = 0; ch.recv(v); return v; });
+    }, 5);
+
+    LockedQueue q(capacity);
+    snprintf(name, sizeof(name), "Mutex+CondVar(%zu) %dP/%dC workers=%d", capacity, producers, consumers, workers);
+    Run(name, iters, [&](uint64_t n) -> uint64_t {
+        return Pump(iom, n, producers, consumers
+                    ,[&q](int v) { q.send(v); }
+                    ,[&q]() { return q.recv(); });
+    }, 5);
+}
+
+int main() {
+    DAG_LOG_ROOT()->setLoggerLevel(LogLevel::ERROR);
+    BenchTry("Channel(1024) trySend+tryRecv", 1024);
+    BenchTry("Channel(unbounded) trySend+tryRecv", Channel<int>::UNBOUNDED);
+
+    for(int workers : {1, 2, 4}) {
+        BenchPump(1, 1, workers, 1024, 400000);
+        BenchPump(4, 4, workers, 1024, 400000);
+        // 容量为1时每条消息都要挂起/唤醒一次
+        BenchPump(1, 1, workers, 1, 20000);
+    }
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include "micro_bench.h"
+#include "fd_manager.h"
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+/**
+ * FdManager微基准: 查找已存在的FdCtx(hook的每次IO都会走这条路径), 单线程和多线程并发
+ * 用法: micro_fd_manager_bench
+ */
+
+using namespace dag;
+using namespace dag::bench;
+
+int main() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    FdMgr::GetInstance()->get(fds[0], true);
+
+    Run("FdManager::get hit", 5000000, [&fds](uint64_t n) -> uint64_t {
+        for(uint64_t i = 0; i < n; ++i) {
+            auto ctx = FdMgr::GetInstance()->get(fds[0]);
+            DoNotOptimize(ctx);
+        }
+        return 0;
+    });
+
+    Run("FdManager::get miss", 5000000, [](uint64_t n) -> uint64_t {
+        for(uint64_t i = 0; i < n; ++i) {
+            auto ctx = FdMgr::GetInstance()->get(100000);
+            DoNotOptimize(ctx);
+        }
+        return 0;
+    });
+
+    for(int threads : {2, 4}) {
+        char name[64];
+        snprintf(name, sizeof(name), "FdManager::get hit threads=%d", threads);
+        Run(name, 2000000, [&fds, threads](uint64_t n) -> uint64_t {
+            std::vector<std::thread> thrs;
+            for(int t = 0; t < threads; ++t) {
+                thrs.emplace_back([&fds, n]() {
+                    for(uint64_t i = 0; i < n; ++i) {
+                        auto ctx = FdMgr::GetInstance()->get(fds[0]);
+                        DoNotOptimize(ctx);
+                    }
+                });
+            }
+            for(auto& t : thrs) {
+                t.join();
+            }
+            return 0;
+        });
+    }
+    close(fds[0]);
+    close(fds[1]);
+    return 0;
+}
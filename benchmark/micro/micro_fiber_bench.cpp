@@ -0,0 +1,85 @@
+#include "micro_bench.h"
+#include "fiber.h"
+#include "stack_profiler.h"
+#include <memory>
+
+/**
+ * Fiber微基准: 创建/销毁, 创建并运行到结束(各栈大小档位, 开启栈剖析填充时), resume+yield往返
+ * 用法: micro_fiber_bench
+ */
+
+using namespace dag;
+using namespace dag::bench;
+
+int main() {
+    Fiber::GetThis();
+
+    Run("fiber create+destroy", 20000, [](uint64_t n) -> uint64_t {
+        for(uint64_t i = 0; i < n; ++i) {
+            Fiber::ptr f(new Fiber([](){}, 0, false));
+            DoNotOptimize(f);
+        }
+        return 0;
+    });
+
+    Run("fiber create+run+destroy", 20000, [](uint64_t n) -> uint64_t {
+        for(uint64_t i = 0; i < n; ++i) {
+            Fiber::ptr f(new Fiber([](){}, 0, false));
+            f->resume();
+        }
+        return 0;
+    });
+
+    for(int c = Fiber::STACK_SMALL; c < Fiber::STACK_CLASS_COUNT; ++c) {
+        size_t size = Fiber::GetStackClassSize((Fiber::StackClass)c);
+        std::string name = "fiber create+run+destroy stack=" + std::to_string(size / 1024) + "K";
+        Run(name, 20000, [size](uint64_t n) -> uint64_t {
+            for(uint64_t i = 0; i < n; ++i) {
+                Fiber::ptr f(new Fiber([](){}, size, false));
+                f->resume();
+            }
+            return 0;
+        });
+    }
+
+    StackProfiler::SetEnabled(true);
+    Run("fiber create+run+destroy (stack painted)", 20000, [](uint64_t n) -> uint64_t {
+        for(uint64_t i = 0; i < n; ++i) {
+            Fiber::ptr f(new Fiber([](){}, 0, false));
+            f->resume();
+        }
+        return 0;
+    });
+    StackProfiler::SetEnabled(false);
+
+    Run("fiber reset+run (stack reused)", 200000, [](uint64_t n) -> uint64_t {
+        Fiber::ptr f(new Fiber([](){}, 0, false));
+        f->resume();
+        uint64_t start = NowNs();
+        for(uint64_t i = 0; i < n; ++i) {
+            f->reset([](){});
+            f->resume();
+        }
+        return NowNs() - start;
+    });
+
+    Run("fiber resume+yield round trip", 1000000, [](uint64_t n) -> uint64_t {
+        bool stop = false;
+        Fiber* self = nullptr;
+        Fiber::ptr f(new Fiber([&stop, &self]() {
+            while(!stop) {
+                self->yield();
+            }
+        }, 0, false));
+        self = f.get();
+        uint64_t start = NowNs();
+        for(uint64_t i = 0; i < n; ++i) {
+            f->resume();
+        }
+        uint64_t ns = NowNs() - start;
+        stop = true;
+        f->resume();
+        return ns;
+    });
+    return 0;
+}
@@ -0,0 +1,90 @@
+#include "micro_bench.h"
+#include "fiber.h"
+#include "fiber_local.h"
+#include "logger.h"
+#include <mutex>
+#include <unordered_map>
+
+/**
+ * 协程局部变量访问开销:
+ * thread_local / FiberLocal / 以协程id为key、互斥锁保护的全局map(原来的替代做法)
+ * 用法: micro_fiber_local_bench
+ */
+
+using namespace dag;
+using namespace dag::bench;
+
+static thread_local uint64_t t_value = 0;
+static FiberLocal<uint64_t> s_value;
+static std::mutex s_map_mutex;
+static std::unordered_map<uint64_t, uint64_t> s_map;
+
+/**
+ * @brief 在用户协程中执行fn, 与实际使用场景一致
+ */
+static uint64_t RunInFiber(const std::function<void()>& fn) {
+    uint64_t ns = 0;
+    Fiber::ptr fiber = std::make_shared<Fiber>([&fn, &ns]() {
+        uint64_t start = NowNs();
+        fn();
+        ns = NowNs() - start;
+    }, 0, false);
+    fiber->resume();
+    return ns;
+}
+
+int main() {
+    DAG_LOG_ROOT()->setLoggerLevel(LogLevel::ERROR);
+    Fiber::GetThis();
+
+    Run("thread_local", 50000000, [](uint64_t n) -> uint64_t {
+        return RunInFiber([n]() {
+            for(uint64_t i = 0; i < n; ++i) {
+                t_value += i;
+                DoNotOptimize(t_value);
+            }
+        });
+    });
+
+    Run("FiberLocal", 50000000, [](uint64_t n) -> uint64_t {
+        return RunInFiber([n]() {
+            for(uint64_t i = 0; i < n; ++i) {
+                *s_value += i;
+                DoNotOptimize(*s_value);
+            }
+        });
+    });
+
+    Run("mutex + map[fiber id]", 5000000, [](uint64_t n) -> uint64_t {
+        return RunInFiber([n]() {
+            for(uint64_t i = 0; i < n; ++i) {
+                std::lock_guard<std::mutex> lock(s_map_mutex);
+                uint64_t& v = s_map[Fiber::GetFiberId()];
+                v += i;
+                DoNotOptimize(v);
+            }
+        });
+    });
+
+    // 首次访问: 构造+协程结束时销毁
+    FiberLocal<std::string> first;
+    Run("FiberLocal first access + destroy", 200000, [&first](uint64_t n) -> uint64_t {
+        uint64_t start = NowNs();
+        for(uint64_t i = 0; i < n; ++i) {
+            Fiber::ptr fiber = std::make_shared<Fiber>([&first]() {
+                DoNotOptimize(first->size());
+            }, 0, false);
+            fiber->resume();
+        }
+        return NowNs() - start;
+    });
+    Run("Fiber create+run (baseline)", 200000, [](uint64_t n) -> uint64_t {
+        uint64_t start = NowNs();
+        for(uint64_t i = 0; i < n; ++i) {
+            Fiber::ptr fiber = std::make_shared<Fiber>([]() {}, 0, false);
+            fiber->resume();
+        }
+        return NowNs() - start;
+    });
+    return 0;
+}
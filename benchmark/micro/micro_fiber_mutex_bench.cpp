@@ -0,0 +1,90 @@
+#include "micro_bench.h"
+#include "fiber_mutex.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include <atomic>
+#include <shared_mutex>
+#include <thread>
+
+/**
+ * 协程同步原语基准:
+ * 1. 无竞争的加锁/解锁(快速路径), 与std::mutex、SpinLock对比
+ * 2. 竞争: F个协程在W个工作线程上反复加锁递增计数, 与std::mutex对比
+ * 用法: micro_fiber_mutex_bench
+ */
+
+using namespace dag;
+using namespace dag::bench;
+
+template <class Mutex>
+static void BenchUncontended(const char* name) {
+    Mutex m;
+    Run(name, 10000000, [&m](uint64_t n) -> uint64_t {
+        for(uint64_t i = 0; i < n; ++i) {
+            m.lock();
+            m.unlock();
+        }
+        return 0;
+    });
+}
+
+template <class Mutex>
+static void BenchContended(const char* mutex_name, int fibers, int workers) {
+    IOManager iom(workers, false, "micro");
+    Mutex m;
+    uint64_t counter = 0;
+    char name[64];
+    snprintf(name, sizeof(name), "%s fibers=%d workers=%d", mutex_name, fibers, workers);
+    Run(name, 400000, [&iom, &m, &counter, fibers](uint64_t n) -> uint64_t {
+        std::atomic<int> done{0};
+        uint64_t per = n / fibers;
+        uint64_t start = NowNs();
+        for(int f = 0; f < fibers; ++f) {
+            iom.schedulerLock([&m, &counter, &done, per]() {
+                for(uint64_t i = 0; i < per; ++i) {
+                    std::lock_guard<Mutex> lock(m);
+                    ++counter;
+                }
+                ++done;
+            });
+        }
+        while(done < fibers) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        return NowNs() - start;
+    }, 5);
+}
+
+int main() {
+    DAG_LOG_ROOT()->setLoggerLevel(LogLevel::ERROR);
+    BenchUncontended<std::mutex>("std::mutex uncontended");
+    BenchUncontended<SpinLock>("SpinLock uncontended");
+    BenchUncontended<FiberMutex>("FiberMutex uncontended");
+    BenchUncontended<FiberRWLock>("FiberRWLock exclusive uncontended");
+
+    FiberRWLock rw;
+    Run("FiberRWLock shared uncontended", 10000000, [&rw](uint64_t n) -> uint64_t {
+        for(uint64_t i = 0; i < n; ++i) {
+            rw.lock_shared();
+            rw.unlock_shared();
+        }
+        return 0;
+    });
+
+    FiberSemaphore sem(1);
+    Run("FiberSemaphore wait+post uncontended", 10000000, [&sem](uint64_t n) -> uint64_t {
+        for(uint64_t i = 0; i < n; ++i) {
+            sem.wait();
+            sem.post();
+        }
+        return 0;
+    });
+
+    for(int workers : {1, 2, 4}) {
+        for(int fibers : {2, 16}) {
+            BenchContended<std::mutex>("std::mutex", fibers, workers);
+            BenchContended<FiberMutex>("FiberMutex", fibers, workers);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include "micro_bench.h"
+#include "fd_manager.h"
+#include "hook.h"
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * hook微基准: 数据已就绪的fd上hook后的read与原始read的对比(差值即hook快速路径的开销)
+ * 用法: micro_hook_bench
+ */
+
+using namespace dag;
+using namespace dag::bench;
+
+int main() {
+    int fds[2];
+    socketpair(AF_UNIX, SOCK_STREAM, 0, fds);
+    // 与hook后socket()创建的fd一样注册FdCtx, read才会走do_io
+    FdMgr::GetInstance()->get(fds[0], true);
+    set_hook_enable(true);
+
+    char c = 'x';
+    Run("raw write_f+read_f 1B", 1000000, [&fds, &c](uint64_t n) -> uint64_t {
+        for(uint64_t i = 0; i < n; ++i) {
+            write_f(fds[1], &c, 1);
+            read_f(fds[0], &c, 1);
+        }
+        return 0;
+    });
+
+    Run("raw write_f + hooked read 1B", 1000000, [&fds, &c](uint64_t n) -> uint64_t {
+        for(uint64_t i = 0; i < n; ++i) {
+            write_f(fds[1], &c, 1);
+            read(fds[0], &c, 1);
+        }
+        return 0;
+    });
+
+    set_hook_enable(false);
+    Run("raw write_f + read with hook disabled 1B", 1000000, [&fds, &c](uint64_t n) -> uint64_t {
+        for(uint64_t i = 0; i < n; ++i) {
+            write_f(fds[1], &c, 1);
+            read(fds[0], &c, 1);
+        }
+        return 0;
+    });
+    close(fds[0]);
+    close(fds[1]);
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "micro_bench.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include <atomic>
+#include <thread>
+
+/**
+ * 空闲策略基准: 外部线程每隔gap提交一个任务, 测量从提交到任务开始执行的平均延迟(ns/op即延迟),
+ * 分别在直接阻塞、自适应自旋、固定自旋三种策略下运行, 并输出自旋命中/阻塞次数和自旋耗费的CPU时间
+ * 用法: micro_idle_bench
+ */
+
+using namespace dag;
+using namespace dag::bench;
+
+static std::atomic<uint64_t> s_start{0};
+static std::atomic<uint64_t> s_latency{0};
+static std::atomic<uint64_t> s_done{0};
+
+static void Task() {
+    s_latency += NowNs() - s_start;
+    ++s_done;
+}
+
+static void Bench(const char* policy_name, const IOManager::IdlePolicy& policy, int gap_us) {
+    IOManager iom(1, false, "idle");
+    iom.setIdlePolicy(policy);
+    char name[64];
+    snprintf(name, sizeof(name), "%s gap=%dus", policy_name, gap_us);
+    Run(name, 500, [&iom, gap_us](uint64_t n) -> uint64_t {
+        s_latency = 0;
+        s_done = 0;
+        for(uint64_t i = 0; i < n; ++i) {
+            std::this_thread::sleep_for(std::chrono::microseconds(gap_us));
+            s_start = NowNs();
+            iom.schedulerLock(&Task);
+            while(s_done <= i) {
+                std::this_thread::yield();
+            }
+        }
+        return s_latency;
+    }, 5);
+    auto st = iom.getIdleStats().begin()->second;
+    printf("    spin_hits=%lu poll_hits=%lu parks=%lu spin_ms=%.1f budget_us=%.1f\n"
+           ,(unsigned long)st.spin_hits, (unsigned long)st.poll_hits, (unsigned long)st.parks
+           ,st.spin_ns / 1e6, st.spin_budget_ns / 1e3);
+}
+
+int main() {
+    DAG_LOG_ROOT()->setLoggerLevel(LogLevel::ERROR);
+    IOManager::IdlePolicy park;
+    IOManager::IdlePolicy adaptive;
+    adaptive.max_spin_us = 200;
+    adaptive.poll_count = 1;
+    IOManager::IdlePolicy fixed;
+    fixed.max_spin_us = 200;
+    fixed.adaptive = false;
+
+    for(int gap_us : {20, 100, 1000}) {
+        Bench("park", park, gap_us);
+        Bench("adaptive spin<=200us", adaptive, gap_us);
+        Bench("fixed spin 200us", fixed, gap_us);
+    }
+    return 0;
+}
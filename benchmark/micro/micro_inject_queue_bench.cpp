@@ -0,0 +1,151 @@
+#include "micro_bench.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "utils/mpmc_queue.h"
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+/**
+ * 跨线程投递的竞争基准, 生产者线程数1~32:
+ * 1. 队列本身: std::mutex+std::deque 与 MpmcQueue, 单个消费线程
+ * 2. 调度器: schedulerLock(全局锁+vector) 与 trySchedule(无锁环形队列, 满时让出CPU重试)
+ *    schedulerLock的积压越多出队越慢(见micro_scheduler_bench), 所以它的积压限制在s_window以内
+ * 用法: micro_inject_queue_bench
+ */
+
+using namespace dag;
+using namespace dag::bench;
+
+static const int s_producers[] = {1, 2, 4, 8, 16, 32};
+
+/**
+ * @brief 加锁队列, 作为对照
+ */
+class LockedQueue {
+public:
+    bool tryPush(uint64_t v) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_queue.push_back(v);
+        return true;
+    }
+    bool tryPop(uint64_t& v) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_queue.empty()) {
+            return false;
+        }
+        v = m_queue.front();
+        m_queue.pop_front();
+        return true;
+    }
+private:
+    std::mutex m_mutex;
+    std::deque<uint64_t> m_queue;
+};
+
+template <class Queue>
+static uint64_t QueueRound(Queue& q, int producers, uint64_t n) {
+    uint64_t per = n / producers;
+    uint64_t total = per * producers;
+    uint64_t start = NowNs();
+    std::vector<std::thread> thrs;
+    for(int p = 0; p < producers; ++p) {
+        thrs.emplace_back([&q, per]() {
+            for(uint64_t i = 0; i < per; ++i) {
+                while(!q.tryPush(i)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    uint64_t v = 0;
+    for(uint64_t got = 0; got < total;) {
+        if(q.tryPop(v)) {
+            ++got;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    for(auto& t : thrs) {
+        t.join();
+    }
+    return NowNs() - start;
+}
+
+static std::atomic<uint64_t> s_done{0};
+static std::atomic<uint64_t> s_posted{0};
+static std::atomic<uint64_t> s_rejected{0};
+static const uint64_t s_window = 64;
+
+static void Task() {
+    s_done.fetch_add(1, std::memory_order_relaxed);
+}
+
+static uint64_t ScheduleRound(IOManager& iom, int producers, uint64_t n, bool lock_free) {
+    s_done = 0;
+    s_posted = 0;
+    uint64_t per = n / producers;
+    uint64_t total = per * producers;
+    uint64_t start = NowNs();
+    std::vector<std::thread> thrs;
+    for(int p = 0; p < producers; ++p) {
+        thrs.emplace_back([&iom, per, lock_free]() {
+            for(uint64_t i = 0; i < per; ++i) {
+                if(lock_free) {
+                    while(!iom.trySchedule(&Task)) {
+                        s_rejected.fetch_add(1, std::memory_order_relaxed);
+                        std::this_thread::yield();
+                    }
+                    continue;
+                }
+                while(s_posted - s_done.load(std::memory_order_relaxed) >= s_window) {
+                    std::this_thread::sleep_for(std::chrono::microseconds(20));
+                }
+                ++s_posted;
+                iom.schedulerLock(&Task);
+            }
+        });
+    }
+    for(auto& t : thrs) {
+        t.join();
+    }
+    while(s_done.load(std::memory_order_relaxed) < total) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    return NowNs() - start;
+}
+
+int main() {
+    DAG_LOG_ROOT()->setLoggerLevel(LogLevel::ERROR);
+    char name[64];
+    for(int producers : s_producers) {
+        LockedQueue locked;
+        snprintf(name, sizeof(name), "mutex+deque producers=%d", producers);
+        Run(name, 400000, [&locked, producers](uint64_t n) {
+            return QueueRound(locked, producers, n);
+        }, 5);
+
+        MpmcQueue<uint64_t> mpmc(8192);
+        snprintf(name, sizeof(name), "MpmcQueue producers=%d", producers);
+        Run(name, 400000, [&mpmc, producers](uint64_t n) {
+            return QueueRound(mpmc, producers, n);
+        }, 5);
+    }
+
+    IOManager iom(2, false, "inject");
+    for(int producers : s_producers) {
+        snprintf(name, sizeof(name), "schedulerLock producers=%d", producers);
+        Run(name, 20000, [&iom, producers](uint64_t n) {
+            return ScheduleRound(iom, producers, n, false);
+        }, 5);
+
+        s_rejected = 0;
+        snprintf(name, sizeof(name), "trySchedule producers=%d", producers);
+        Run(name, 20000, [&iom, producers](uint64_t n) {
+            return ScheduleRound(iom, producers, n, true);
+        }, 5);
+        printf("    trySchedule rejected (queue full): %lu\n", (unsigned long)s_rejected.load());
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+#include "micro_bench.h"
+#include "logger.h"
+#include <ostream>
+
+/**
+ * Logger微基准: 使用不产生IO的输出地, 分别测量级别过滤、事件构造、格式化的开销
+ * 用法: micro_logger_bench
+ */
+
+using namespace dag;
+using namespace dag::bench;
+
+/**
+ * @brief 丢弃所有日志
+ */
+class NullLogAppender : public LogAppender {
+public:
+    NullLogAppender() : LogAppender(std::make_shared<LogFormatter>()) {}
+    void log(LogEvent::ptr event) override {
+        DoNotOptimize(event);
+    }
+};
+
+/**
+ * @brief 格式化后丢弃
+ */
+class FormatNullLogAppender : public LogAppender {
+public:
+    FormatNullLogAppender() : LogAppender(std::make_shared<LogFormatter>()), m_os(nullptr) {}
+    void log(LogEvent::ptr event) override {
+        formatter_->format(m_os, event);
+    }
+private:
+    /// 没有streambuf的ostream, 输出被直接丢弃
+    std::ostream m_os;
+};
+
+int main() {
+    Logger::ptr logger(new Logger("micro", LogLevel::INFO));
+    logger->addAppender(std::make_shared<NullLogAppender>());
+
+    Run("DAG_LOG_DEBUG filtered by level", 10000000, [&logger](uint64_t n) -> uint64_t {
+        for(uint64_t i = 0; i < n; ++i) {
+            DAG_LOG_DEBUG(logger) << "value=" << i;
+        }
+        return 0;
+    });
+
+    Run("DAG_LOG_INFO null appender", 500000, [&logger](uint64_t n) -> uint64_t {
+        for(uint64_t i = 0; i < n; ++i) {
+            DAG_LOG_INFO(logger) << "value=" << i;
+        }
+        return 0;
+    });
+
+    Logger::ptr fmt_logger(new Logger("micro_fmt", LogLevel::INFO));
+    fmt_logger->addAppender(std::make_shared<FormatNullLogAppender>());
+    Run("DAG_LOG_INFO format + discard", 200000, [&fmt_logger](uint64_t n) -> uint64_t {
+        for(uint64_t i = 0; i < n; ++i) {
+            DAG_LOG_INFO(fmt_logger) << "value=" << i;
+        }
+        return 0;
+    });
+    return 0;
+}
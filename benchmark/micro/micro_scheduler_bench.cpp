@@ -0,0 +1,107 @@
+#include "micro_bench.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include <atomic>
+#include <thread>
+
+/**
+ * 调度器微基准: P个外部线程并发schedulerLock空任务, W个工作线程取出执行,
+ * 计时从开始投递到全部任务执行完毕, 即入队+出队+创建协程运行的端到端开销;
+ * 任务队列是deque, 从队头出队不再搬移剩余的SchedulerTask; 生产者仍把积压限制在s_window以内,
+ * 测的是队列较短时的开销, 结果与改为deque之前可以直接比较
+ * 另测扇出场景: 一次提交256个任务, 逐个schedulerLock与一次scheduleBatch对比
+ * 用法: micro_scheduler_bench
+ */
+
+using namespace dag;
+using namespace dag::bench;
+
+static std::atomic<uint64_t> s_done{0};
+static std::atomic<uint64_t> s_posted{0};
+/// 允许的最大积压任务数
+static const uint64_t s_window = 64;
+
+static void Task() {
+    s_done.fetch_add(1, std::memory_order_relaxed);
+}
+
+static void Bench(int producers, int workers) {
+    IOManager iom(workers, false, "micro");
+    char name[64];
+    snprintf(name, sizeof(name), "schedulerLock producers=%d workers=%d", producers, workers);
+    Run(name, 20000, [&iom, producers](uint64_t n) -> uint64_t {
+        s_done = 0;
+        s_posted = 0;
+        uint64_t per = n / producers;
+        uint64_t total = per * producers;
+        uint64_t start = NowNs();
+        std::vector<std::thread> thrs;
+        for(int p = 0; p < producers; ++p) {
+            thrs.emplace_back([&iom, per]() {
+                for(uint64_t i = 0; i < per; ++i) {
+                    while(s_posted - s_done.load(std::memory_order_relaxed) >= s_window) {
+                        // 睡眠而不是yield自旋, 核数少时把CPU让给工作线程
+                        std::this_thread::sleep_for(std::chrono::microseconds(20));
+                    }
+                    ++s_posted;
+                    iom.schedulerLock(&Task);
+                }
+            });
+        }
+        for(auto& t : thrs) {
+            t.join();
+        }
+        while(s_done.load(std::memory_order_relaxed) < total) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        return NowNs() - start;
+    }, 5);
+}
+
+static void BenchFanout(int workers) {
+    IOManager iom(workers, false, "micro");
+    const uint64_t fanout = 256;
+    char name[64];
+    snprintf(name, sizeof(name), "fanout 256 schedulerLock loop workers=%d", workers);
+    Run(name, 200 * fanout, [&iom, fanout](uint64_t n) -> uint64_t {
+        s_done = 0;
+        uint64_t start = NowNs();
+        for(uint64_t i = 0; i < n; i += fanout) {
+            for(uint64_t j = 0; j < fanout; ++j) {
+                iom.schedulerLock(&Task);
+            }
+            while(s_done.load(std::memory_order_relaxed) < i + fanout) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+        return NowNs() - start;
+    }, 5);
+
+    snprintf(name, sizeof(name), "fanout 256 scheduleBatch workers=%d", workers);
+    Run(name, 200 * fanout, [&iom, fanout](uint64_t n) -> uint64_t {
+        s_done = 0;
+        std::vector<std::function<void()>> cbs;
+        uint64_t start = NowNs();
+        for(uint64_t i = 0; i < n; i += fanout) {
+            cbs.assign(fanout, &Task);
+            iom.scheduleBatch(cbs);
+            while(s_done.load(std::memory_order_relaxed) < i + fanout) {
+                std::this_thread::sleep_for(std::chrono::microseconds(50));
+            }
+        }
+        return NowNs() - start;
+    }, 5);
+}
+
+int main() {
+    DAG_LOG_ROOT()->setLoggerLevel(LogLevel::ERROR);
+    for(int workers : {1, 2, 4}) {
+        for(int producers : {1, 2, 4}) {
+            Bench(producers, workers);
+        }
+    }
+    for(int workers : {1, 2, 4}) {
+        BenchFanout(workers);
+    }
+    return 0;
+}
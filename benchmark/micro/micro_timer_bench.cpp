@@ -0,0 +1,73 @@
+#include "micro_bench.h"
+#include "timer.h"
+#include <random>
+
+/**
+ * TimerManager微基准: 添加/取消/到期收集
+ * 用法: micro_timer_bench
+ */
+
+using namespace dag;
+using namespace dag::bench;
+
+int main() {
+    const uint64_t n = 100000;
+    std::vector<uint64_t> delays(n);
+    std::mt19937_64 rng(42);
+    for(auto& d : delays) {
+        d = 1000 + rng() % 60000;
+    }
+
+    Run("timer add (random delay, 100k live)", n, [&delays](uint64_t n) -> uint64_t {
+        TimerManager tm;
+        std::vector<std::shared_ptr<Timer> > timers;
+        timers.reserve(n);
+        uint64_t start = NowNs();
+        for(uint64_t i = 0; i < n; ++i) {
+            timers.push_back(tm.addTimer(delays[i], [](){}));
+        }
+        return NowNs() - start;
+    });
+
+    Run("timer cancel (random order)", n, [&delays, &rng](uint64_t n) -> uint64_t {
+        TimerManager tm;
+        std::vector<std::shared_ptr<Timer> > timers;
+        timers.reserve(n);
+        for(uint64_t i = 0; i < n; ++i) {
+            timers.push_back(tm.addTimer(delays[i], [](){}));
+        }
+        std::shuffle(timers.begin(), timers.end(), rng);
+        uint64_t start = NowNs();
+        for(auto& t : timers) {
+            t->cancel();
+        }
+        return NowNs() - start;
+    });
+
+    Run("timer add+listExpiredCb", n, [](uint64_t n) -> uint64_t {
+        TimerManager tm;
+        for(uint64_t i = 0; i < n; ++i) {
+            tm.addTimer(0, [](){});
+        }
+        std::vector<std::function<void()> > cbs;
+        cbs.reserve(n);
+        tm.listExpiredCb(cbs);
+        DoNotOptimize(cbs.size());
+        return 0;
+    });
+
+    Run("timer getNextTimer (100k live)", 1000000, [&delays](uint64_t n) -> uint64_t {
+        TimerManager tm;
+        for(auto d : delays) {
+            tm.addTimer(d, [](){});
+        }
+        uint64_t start = NowNs();
+        uint64_t sum = 0;
+        for(uint64_t i = 0; i < n; ++i) {
+            sum += tm.getNextTimer();
+        }
+        DoNotOptimize(sum);
+        return NowNs() - start;
+    });
+    return 0;
+}
@@ -0,0 +1,153 @@
+#include "stream/socket_stream_pool.h"
+#include "tcp_server.h"
+#include "logger.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+/**
+ * 连接池压测: 进程内启动回显服务器, 多个协程循环"取连接 -> 一问一答 -> 释放",
+ * 分别测试每次新建连接和使用SocketStreamPool两种方式的请求数/秒
+ * 用法: socket_stream_pool_bench [fibers=16] [seconds=3] [payload=64] [threads=2]
+ */
+
+using namespace dag;
+
+static const char* s_addr = "127.0.0.1:8033";
+
+class EchoServer : public TcpServer {
+public:
+    EchoServer(IOManager* iom) :TcpServer(iom, iom, iom) {}
+protected:
+    void handleClient(Socket::ptr client) override {
+        char buf[4096];
+        while(true) {
+            int n = client->recv(buf, sizeof(buf));
+            if(n <= 0 || client->send(buf, n) <= 0) {
+                break;
+            }
+        }
+        client->close();
+    }
+};
+
+static std::atomic<bool> s_running{true};
+static std::atomic<uint64_t> s_requests{0};
+static std::atomic<uint64_t> s_errors{0};
+static std::atomic<int> s_fibers{0};
+
+static bool Echo(SocketStream::ptr ss, const std::string& req, std::string& rsp) {
+    return ss->writeFixSize(req.c_str(), req.size()) > 0
+        && ss->readFixSize(&rsp[0], rsp.size()) > 0;
+}
+
+static void RunNoPool(Address::ptr addr, size_t payload) {
+    std::string req(payload, 'x');
+    std::string rsp(payload, '\0');
+    while(s_running) {
+        Socket::ptr sock = Socket::CreateTCP(addr);
+        if(!sock->connect(addr, 3000)) {
+            ++s_errors;
+            continue;
+        }
+        SocketStream::ptr ss(new SocketStream(sock));
+        if(Echo(ss, req, rsp)) {
+            ++s_requests;
+        } else {
+            ++s_errors;
+        }
+    }
+    --s_fibers;
+}
+
+static void RunPool(SocketStreamPool::ptr pool, Address::ptr addr, size_t payload) {
+    std::string req(payload, 'x');
+    std::string rsp(payload, '\0');
+    while(s_running) {
+        SocketStream::ptr ss = pool->get(addr, 3000);
+        if(!ss) {
+            ++s_errors;
+            continue;
+        }
+        if(Echo(ss, req, rsp)) {
+            ++s_requests;
+        } else {
+            ss->close();
+            ++s_errors;
+        }
+    }
+    --s_fibers;
+}
+
+static void Report(const char* name, int seconds) {
+    std::cout << name << ": requests=" << s_requests
+              << " errors=" << s_errors
+              << " req/s=" << s_requests / seconds << std::endl;
+}
+
+int main(int argc, char** argv) {
+    int fibers = argc > 1 ? atoi(argv[1]) : 16;
+    int seconds = argc > 2 ? atoi(argv[2]) : 3;
+    size_t payload = argc > 3 ? atoi(argv[3]) : 64;
+    int threads = argc > 4 ? atoi(argv[4]) : 2;
+
+    DAG_LOG_ROOT()->setLoggerLevel(LogLevel::FATAL);
+    DAG_LOG_NAME("system")->setLoggerLevel(LogLevel::FATAL);
+
+    std::unique_ptr<IOManager> server_iom(new IOManager(threads, false, "echo_server"));
+    std::unique_ptr<IOManager> client_iom(new IOManager(threads, false, "pool_client"));
+    std::shared_ptr<EchoServer> server(new EchoServer(server_iom.get()));
+    Address::ptr addr = Address::LookupAnyIPAddress(s_addr);
+    server_iom->schedulerLock([server, addr]() {
+        if(!server->bind(addr)) {
+            std::cerr << "bind " << s_addr << " failed" << std::endl;
+            exit(1);
+        }
+        server->start();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    std::cout << "fibers=" << fibers << " payload=" << payload
+              << " threads=" << threads << " duration=" << seconds << "s" << std::endl;
+
+    // 1. 每个请求新建连接
+    s_fibers = fibers;
+    for(int i = 0; i < fibers; ++i) {
+        client_iom->schedulerLock(std::bind(&RunNoPool, addr, payload));
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    s_running = false;
+    while(s_fibers > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    Report("no pool", seconds);
+
+    // 2. 连接池
+    s_running = true;
+    s_requests = 0;
+    s_errors = 0;
+    s_fibers = fibers;
+    SocketStreamPool::ptr pool(new SocketStreamPool(client_iom.get(), fibers, 0, fibers));
+    pool->start();
+    for(int i = 0; i < fibers; ++i) {
+        client_iom->schedulerLock(std::bind(&RunPool, pool, addr, payload));
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    s_running = false;
+    while(s_fibers > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    Report("pool", seconds);
+    std::cout << "pool created=" << pool->getCreatedCount()
+              << " reused=" << pool->getReusedCount() << std::endl;
+
+    client_iom->schedulerLock([pool]() {
+        pool->stop();
+    });
+    client_iom.reset();
+    server->stop();
+    server_iom.reset();
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include "rpc/rpc_server.h"
+#include "rpc/rpc_client.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * RPC压测: 进程内启动RpcServer, 客户端在每条连接上用多个协程并发调用echo(多路复用)
+ * 用法: rpc_bench [connections=4] [fibers_per_conn=32] [payload=64] [seconds=10] [threads=2]
+ */
+
+using namespace dag;
+using namespace dag::rpc;
+
+static const char* s_addr = "127.0.0.1:8031";
+
+static std::atomic<bool> s_running{true};
+static std::atomic<int> s_clients{0};
+static std::mutex s_mutex;
+static std::vector<uint64_t> s_latencies;
+static uint64_t s_errors = 0;
+
+static uint64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void RunCaller(RpcClient::ptr client, size_t payload) {
+    std::string req(payload, 'x');
+    std::string rsp;
+    std::vector<uint64_t> lats;
+    lats.reserve(1 << 16);
+    uint64_t errors = 0;
+    while(s_running) {
+        uint64_t start = NowUs();
+        if(client->call("echo", req, rsp, 1000) != RpcStatus::OK
+                || rsp.size() != payload) {
+            ++errors;
+            break;
+        }
+        lats.push_back(NowUs() - start);
+    }
+
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_latencies.insert(s_latencies.end(), lats.begin(), lats.end());
+    s_errors += errors;
+    --s_clients;
+}
+
+int main(int argc, char** argv) {
+    int conns = argc > 1 ? atoi(argv[1]) : 4;
+    int fibers = argc > 2 ? atoi(argv[2]) : 32;
+    size_t payload = argc > 3 ? atoi(argv[3]) : 64;
+    int seconds = argc > 4 ? atoi(argv[4]) : 10;
+    int threads = argc > 5 ? atoi(argv[5]) : 2;
+
+    DAG_LOG_ROOT()->setLoggerLevel(LogLevel::ERROR);
+
+    std::unique_ptr<IOManager> server_iom(new IOManager(threads, false, "rpc_server"));
+    std::unique_ptr<IOManager> client_iom(new IOManager(threads, false, "rpc_client"));
+
+    RpcServer::ptr server(new RpcServer(server_iom.get(), server_iom.get(), server_iom.get()));
+    server->registerMethod("echo", [](const std::string& req, std::string& rsp) {
+        rsp = req;
+        return true;
+    });
+    server_iom->schedulerLock([server]() {
+        Address::ptr addr = Address::LookupAnyIPAddress(s_addr);
+        if(!server->bind(addr)) {
+            std::cerr << "bind " << s_addr << " failed" << std::endl;
+            exit(1);
+        }
+        server->start();
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    std::vector<RpcClient::ptr> clients;
+    for(int i = 0; i < conns; ++i) {
+        RpcClient::ptr client(new RpcClient(client_iom.get()));
+        clients.push_back(client);
+        client_iom->schedulerLock([client, fibers, payload]() {
+            if(!client->connect(Address::LookupAnyIPAddress(s_addr))) {
+                std::lock_guard<std::mutex> lock(s_mutex);
+                ++s_errors;
+                return;
+            }
+            for(int j = 0; j < fibers; ++j) {
+                ++s_clients;
+                IOManager::GetThis()->schedulerLock(std::bind(&RunCaller, client, payload));
+            }
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    s_running = false;
+    while(s_clients > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    for(auto& c : clients) {
+        c->close();
+    }
+    clients.clear();
+
+    client_iom.reset();
+    server->stop();
+    server_iom.reset();
+
+    std::sort(s_latencies.begin(), s_latencies.end());
+    auto pct = [](double p) -> uint64_t {
+        if(s_latencies.empty()) {
+            return 0;
+        }
+        size_t idx = std::min(s_latencies.size() - 1, (size_t)(p * s_latencies.size()));
+        return s_latencies[idx];
+    };
+    std::cout << "connections=" << conns << " fibers_per_conn=" << fibers
+              << " payload=" << payload << " threads=" << threads
+              << " duration=" << seconds << "s" << std::endl;
+    std::cout << "calls=" << s_latencies.size()
+              << " errors=" << s_errors
+              << " calls/s=" << (uint64_t)(s_latencies.size() / (double)seconds) << std::endl;
+    std::cout << "latency(us) p50=" << pct(0.50)
+              << " p90=" << pct(0.90)
+              << " p99=" << pct(0.99)
+              << " p999=" << pct(0.999)
+              << " max=" << (s_latencies.empty() ? 0 : s_latencies.back()) << std::endl;
+    return 0;
+}
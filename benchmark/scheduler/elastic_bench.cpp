@@ -0,0 +1,95 @@
+#include "hook.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+#include <unistd.h>
+
+/**
+ * 突发负载下固定线程数与弹性线程池的对比:
+ * 每个周期先突发burst个任务(每个阻塞线程block_ms毫秒, 模拟没有被hook的阻塞调用), 再空闲idle_ms毫秒,
+ * 统计任务排队时间的分位数(取自getElasticStats的直方图, 为桶的上界)和平均工作线程数
+ * 用法: elastic_bench [rounds=5] [burst=64] [block_ms=5] [idle_ms=1000] [max_threads=8]
+ */
+
+using namespace dag;
+
+static uint64_t Percentile(const Scheduler::ElasticStats& stats, double p) {
+    uint64_t total = 0;
+    for(auto i : stats.wait_buckets) {
+        total += i;
+    }
+    uint64_t seen = 0;
+    for(size_t i = 0; i < Scheduler::WAIT_BUCKETS; ++i) {
+        seen += stats.wait_buckets[i];
+        if(seen >= p * total) {
+            return i ? 1ull << i : 1;
+        }
+    }
+    return ~0ull;
+}
+
+static void RunMode(const char* mode, size_t threads, bool elastic, size_t max_threads
+                    ,int rounds, int burst, uint64_t block_ms, uint64_t idle_ms) {
+    IOManager iom(threads, false, "elastic");
+    Scheduler::ElasticPolicy policy;
+    policy.min_threads = threads;
+    policy.max_threads = elastic ? max_threads : threads;
+    policy.cooldown_ms = idle_ms / 4;
+    // 固定线程数时也开启, 只为记录排队时间
+    iom.setElastic(policy);
+
+    std::atomic<int> done{0};
+    uint64_t thread_ms = 0;
+    uint64_t samples = 0;
+    auto start = std::chrono::steady_clock::now();
+    for(int r = 0; r < rounds; ++r) {
+        for(int i = 0; i < burst; ++i) {
+            iom.schedulerLock([&done, block_ms]() {
+                set_hook_enable(false);
+                usleep(block_ms * 1000);
+                set_hook_enable(true);
+                ++done;
+            });
+        }
+        uint64_t end = (r + 1) * burst;
+        uint64_t idle_start = 0;
+        while(true) {
+            thread_ms += iom.getWorkerCount();
+            ++samples;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            if((uint64_t)done >= end && !idle_start) {
+                idle_start = samples;
+            }
+            if(idle_start && samples - idle_start >= idle_ms) {
+                break;
+            }
+        }
+    }
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    Scheduler::ElasticStats stats = iom.getElasticStats();
+    printf("%-14s wait p50 <%7lu us  p99 <%7lu us  avg threads %5.2f  scale up/down %3lu/%3lu  %.1fs\n"
+           ,mode, Percentile(stats, 0.5), Percentile(stats, 0.99), (double)thread_ms / samples
+           ,stats.scale_ups, stats.scale_downs, secs);
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    DAG_LOG_ROOT()->setLoggerLevel(LogLevel::ERROR);
+    int rounds = argc > 1 ? atoi(argv[1]) : 5;
+    int burst = argc > 2 ? atoi(argv[2]) : 64;
+    uint64_t block_ms = argc > 3 ? atol(argv[3]) : 5;
+    uint64_t idle_ms = argc > 4 ? atol(argv[4]) : 1000;
+    size_t max_threads = argc > 5 ? atol(argv[5]) : 8;
+
+    RunMode("fixed 1", 1, false, max_threads, rounds, burst, block_ms, idle_ms);
+    char name[32];
+    snprintf(name, sizeof(name), "fixed %zu", max_threads);
+    RunMode(name, max_threads, false, max_threads, rounds, burst, block_ms, idle_ms);
+    snprintf(name, sizeof(name), "elastic 1..%zu", max_threads);
+    RunMode(name, 1, true, max_threads, rounds, burst, block_ms, idle_ms);
+    return 0;
+}
@@ -0,0 +1,110 @@
+#include "../micro/micro_bench.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "watchdog.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * 协作式抢占:
+ * 1. maybe_yield在时间片未用完时的单次开销(在调度器协程里调用, 不让出)
+ * 2. 计算循环占满工作线程时短任务的调度延迟: compute个协程各跑ms毫秒的计算循环,
+ *    期间每2ms提交一个短任务, 统计从提交到开始执行的延迟;
+ *    none: 计算循环不调用maybe_yield, 短任务要等到某个计算协程结束
+ *    slice=N: 计算循环每轮迭代调用maybe_yield, 时间片N毫秒
+ * 用法: preempt_bench [compute=4] [ms=200] [workers=1]
+ */
+
+using namespace dag;
+using namespace dag::bench;
+
+static void BenchCheckCost() {
+    IOManager iom(1, false, "cost");
+    set_time_slice_ms(1000);
+    std::atomic<int> done{0};
+    iom.schedulerLock([&]() {
+        Run("maybe_yield (slice not expired)", 10000000, [](uint64_t n) -> uint64_t {
+            uint64_t yields = 0;
+            for(uint64_t i = 0; i < n; ++i) {
+                yields += maybe_yield();
+            }
+            DoNotOptimize(yields);
+            return 0;
+        }, 5);
+        ++done;
+    });
+    while(done == 0) {
+        usleep(1000);
+    }
+}
+
+static void BenchLatency(const char* mode, uint64_t slice_ms, bool preempt, int compute, uint64_t ms, int workers) {
+    IOManager iom(workers, false, "preempt");
+    iom.setWatchdog(10 * ms);
+    set_time_slice_ms(slice_ms);
+    std::atomic<int> running{compute};
+    for(int c = 0; c < compute; ++c) {
+        iom.schedulerLock([&, preempt]() {
+            uint64_t start = NowNs();
+            uint64_t x = 0;
+            while(NowNs() - start < ms * 1000000) {
+                for(int i = 0; i < 100; ++i) {
+                    x = x * 31 + i;
+                }
+                if(preempt) {
+                    maybe_yield();
+                }
+            }
+            DoNotOptimize(x);
+            --running;
+        });
+    }
+
+    std::mutex mutex;
+    std::vector<uint64_t> us;
+    std::atomic<int> pending{0};
+    while(running > 0) {
+        uint64_t submit = NowNs();
+        ++pending;
+        iom.schedulerLock([&, submit]() {
+            std::lock_guard<std::mutex> lock(mutex);
+            us.push_back((NowNs() - submit) / 1000);
+            --pending;
+        });
+        usleep(2000);
+    }
+    while(pending > 0) {
+        usleep(1000);
+    }
+    uint64_t yields = 0;
+    uint64_t max_run = 0;
+    for(auto& i : iom.getWatchdogStats()) {
+        yields += i.second.yields;
+        max_run = std::max(max_run, i.second.max_run_ms);
+    }
+    std::sort(us.begin(), us.end());
+    auto pct = [&us](double p) { return us[std::min(us.size() - 1, (size_t)(p * us.size()))];};
+    printf("%-9s %5zu samples  p50 %8lu us  p99 %8lu us  max %8lu us  yields %6lu  longest run %4lu ms\n"
+           ,mode, us.size(), pct(0.5), pct(0.99), us.back(), yields, max_run);
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    DAG_LOG_ROOT()->setLoggerLevel(LogLevel::ERROR);
+    int compute = argc > 1 ? atoi(argv[1]) : 4;
+    uint64_t ms = argc > 2 ? atol(argv[2]) : 200;
+    int workers = argc > 3 ? atoi(argv[3]) : 1;
+
+    BenchCheckCost();
+    printf("compute=%d x %lums workers=%d\n", compute, ms, workers);
+    BenchLatency("none", 10, false, compute, ms, workers);
+    BenchLatency("slice=10", 10, true, compute, ms, workers);
+    BenchLatency("slice=2", 2, true, compute, ms, workers);
+    set_time_slice_ms(10);
+    return 0;
+}
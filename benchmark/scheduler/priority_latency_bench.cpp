@@ -0,0 +1,131 @@
+#include "ioscheduler.h"
+#include "logger.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+/**
+ * 饱和后台负载下高优先级任务的调度延迟:
+ * 后台负载为load个不断重新调度自己的回调, 每个忙等work_us微秒, 任务队列始终积压;
+ * 探针每2ms提交一次:
+ *   callback: 从提交回调到它开始执行的延迟;
+ *   timer:    协程hook的usleep(1ms)到期后到它恢复执行的延迟(减去1ms), 即IO/定时器事件唤醒的协程的延迟
+ * 模式:
+ *   fifo:        探针和负载都是普通优先级, 等同于只有一个队列
+ *   priority:    探针高优先级, 负载后台优先级
+ *   no-busypoll: 同priority, 但关闭忙碌时的事件轮询, 定时器只能等线程空闲时处理
+ *   aging:       负载高优先级, 探针后台优先级, 观察老化保证的等待上限
+ * 用法: priority_latency_bench [seconds=2] [workers=2] [load=2000] [work_us=100]
+ */
+
+using namespace dag;
+
+static uint64_t NowUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void BusyUs(uint64_t us) {
+    uint64_t start = NowUs();
+    while(NowUs() - start < us) {
+    }
+}
+
+struct Samples {
+    std::mutex mutex;
+    std::vector<uint64_t> us;
+
+    void add(uint64_t v) {
+        std::lock_guard<std::mutex> lock(mutex);
+        us.push_back(v);
+    }
+
+    void print(const char* mode, const char* probe) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(us.empty()) {
+            printf("%-12s %-9s no samples\n", mode, probe);
+            return;
+        }
+        std::sort(us.begin(), us.end());
+        auto pct = [this](double p) { return us[std::min(us.size() - 1, (size_t)(p * us.size()))];};
+        printf("%-12s %-9s %6zu samples  p50 %8lu us  p99 %8lu us  max %8lu us\n"
+               ,mode, probe, us.size(), pct(0.5), pct(0.99), us.back());
+        fflush(stdout);
+    }
+};
+
+static void RunMode(const char* mode, Fiber::Priority load_prio, Fiber::Priority probe_prio, bool busy_poll
+                    ,int seconds, int workers, int load, uint64_t work_us) {
+    IOManager iom(workers, false, "prio");
+    if(!busy_poll) {
+        iom.setBusyPollInterval(0);
+    }
+    std::atomic<bool> stop{false};
+    std::atomic<int> running{0};
+    std::function<void()> bulk = [&]() {
+        BusyUs(work_us);
+        if(!stop) {
+            iom.schedulerLock(bulk, -1, Fiber::STACK_DEFAULT, load_prio);
+        } else {
+            --running;
+        }
+    };
+    running = load;
+    for(int i = 0; i < load; ++i) {
+        iom.schedulerLock(bulk, -1, Fiber::STACK_DEFAULT, load_prio);
+    }
+
+    Samples callback;
+    Samples timer;
+    std::atomic<int> timer_done{0};
+    iom.schedulerLock([&]() {
+        while(!stop) {
+            uint64_t start = NowUs();
+            usleep(1000);
+            uint64_t elapsed = NowUs() - start;
+            timer.add(elapsed > 1000 ? elapsed - 1000 : 0);
+            usleep(1000);
+        }
+        ++timer_done;
+    }, -1, Fiber::STACK_DEFAULT, probe_prio);
+
+    std::atomic<int> pending{0};
+    uint64_t end = NowUs() + seconds * 1000000ull;
+    while(NowUs() < end) {
+        uint64_t submit = NowUs();
+        ++pending;
+        iom.schedulerLock([&callback, &pending, submit]() {
+            callback.add(NowUs() - submit);
+            --pending;
+        }, -1, Fiber::STACK_DEFAULT, probe_prio);
+        usleep(2000);
+    }
+    stop = true;
+    while(running > 0 || pending > 0 || timer_done == 0) {
+        usleep(1000);
+    }
+    callback.print(mode, "callback");
+    timer.print(mode, "timer");
+}
+
+int main(int argc, char** argv) {
+    DAG_LOG_ROOT()->setLoggerLevel(LogLevel::ERROR);
+    int seconds = argc > 1 ? atoi(argv[1]) : 2;
+    int workers = argc > 2 ? atoi(argv[2]) : 2;
+    int load = argc > 3 ? atoi(argv[3]) : 2000;
+    uint64_t work_us = argc > 4 ? atol(argv[4]) : 100;
+    printf("workers=%d load=%d work=%luus, backlog ~%lu ms of work\n"
+           ,workers, load, work_us, load * work_us / 1000 / workers);
+
+    RunMode("fifo", Fiber::PRIORITY_NORMAL, Fiber::PRIORITY_NORMAL, true, seconds, workers, load, work_us);
+    RunMode("priority", Fiber::PRIORITY_BACKGROUND, Fiber::PRIORITY_HIGH, true, seconds, workers, load, work_us);
+    RunMode("no-busypoll", Fiber::PRIORITY_BACKGROUND, Fiber::PRIORITY_HIGH, false, seconds, workers, load, work_us);
+    RunMode("aging", Fiber::PRIORITY_HIGH, Fiber::PRIORITY_BACKGROUND, true, seconds, workers, load, work_us);
+    return 0;
+}
@@ -0,0 +1,197 @@
+#include "address.h"
+#include "ioscheduler.h"
+#include "socket.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <string.h>
+#include <thread>
+#include <vector>
+
+/**
+ * 回环UDP小包收发速率(packets/s), 对比三种方式:
+ * single:  每个数据报一次sendto/recvfrom
+ * batched: sendmmsg/recvmmsg每次系统调用收发batch个数据报
+ * gso:     发送端UDP_SEGMENT一次发出batch个数据报, 接收端UDP_GRO合并后一次收下, 按分段大小折算成数据报数
+ * 单个工作线程上一个发送协程、一个接收协程: 发送方每发出一轮(window个数据报)主动让出, 接收方读到EAGAIN时挂起,
+ * 统计发送和接收(丢包即两者之差, 通常来自接收缓冲区溢出)
+ * 用法: udp_pps_bench [seconds=3] [size=64] [batch=32] [window=256]
+ */
+
+using namespace dag;
+
+static void WaitFor(std::atomic<int>& v, int n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+enum Mode {
+    SINGLE,
+    BATCHED,
+    GSO
+};
+
+static const char* ModeName(Mode mode) {
+    switch(mode) {
+        case SINGLE: return "single";
+        case BATCHED: return "batched";
+        case GSO: return "gso+gro";
+    }
+    return "unknown";
+}
+
+/**
+ * @brief 重新入队后让出, 让同一线程上的接收协程运行
+ */
+static void Yield() {
+    Fiber* fiber = Fiber::GetThisRaw();
+    Scheduler::GetThis()->schedulerLock(fiber->shared_from_this());
+    fiber->yield();
+}
+
+static void Send(Mode mode, Socket::ptr sock, Address::ptr to, size_t size, size_t batch, size_t window
+                 ,const std::atomic<bool>& stop, uint64_t& sent, uint64_t& calls) {
+    // GSO时一条消息携带batch个分段
+    size_t msg_size = mode == GSO ? size * batch : size;
+    size_t msg_count = mode == GSO ? 1 : batch;
+    std::vector<char> buf(msg_size * msg_count, 'x');
+    std::vector<iovec> iovs(msg_count);
+    std::vector<mmsghdr> msgs(msg_count);
+    memset(msgs.data(), 0, sizeof(mmsghdr) * msg_count);
+    for(size_t i = 0; i < msg_count; ++i) {
+        iovs[i].iov_base = &buf[i * msg_size];
+        iovs[i].iov_len = msg_size;
+        msgs[i].msg_hdr.msg_iov = &iovs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+        msgs[i].msg_hdr.msg_name = to->getAddr();
+        msgs[i].msg_hdr.msg_namelen = to->getAddrLen();
+    }
+    while(!stop) {
+        for(size_t n = 0; n < window; ) {
+            if(mode == SINGLE) {
+                if(sock->sendTo(&buf[0], size, to) != (int)size) {
+                    return;
+                }
+                ++n;
+            } else {
+                int rt = sock->sendToMany(msgs.data(), msg_count);
+                if(rt <= 0) {
+                    return;
+                }
+                n += mode == GSO ? batch : rt;
+            }
+            ++calls;
+        }
+        sent += window;
+        Yield();
+    }
+}
+
+static void Recv(Mode mode, Socket::ptr sock, size_t size, size_t batch, uint64_t& received, uint64_t& calls) {
+    size_t msg_size = mode == GSO ? size * batch : size;
+    size_t msg_count = mode == SINGLE ? 1 : batch;
+    std::vector<char> buf(msg_size * msg_count);
+    std::vector<char> control(Socket::UDP_GRO_CONTROL_LEN * msg_count);
+    std::vector<iovec> iovs(msg_count);
+    std::vector<mmsghdr> msgs(msg_count);
+    Address::ptr from(new IPv4Address);
+    while(true) {
+        if(mode == SINGLE) {
+            if(sock->recvFrom(&buf[0], msg_size, from) <= 0) {
+                return;
+            }
+            ++received;
+            ++calls;
+            continue;
+        }
+        memset(msgs.data(), 0, sizeof(mmsghdr) * msg_count);
+        for(size_t i = 0; i < msg_count; ++i) {
+            iovs[i].iov_base = &buf[i * msg_size];
+            iovs[i].iov_len = msg_size;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_control = &control[i * Socket::UDP_GRO_CONTROL_LEN];
+            msgs[i].msg_hdr.msg_controllen = Socket::UDP_GRO_CONTROL_LEN;
+        }
+        int n = sock->recvFromMany(msgs.data(), msg_count);
+        if(n <= 0) {
+            return;
+        }
+        ++calls;
+        for(int i = 0; i < n; ++i) {
+            size_t seg = Socket::GetUdpGroSegment(msgs[i].msg_hdr);
+            received += seg ? (msgs[i].msg_len + seg - 1) / seg : 1;
+        }
+    }
+}
+
+static void RunMode(Mode mode, int seconds, size_t size, size_t batch, size_t window) {
+    IOManager iom(1, false, "udp_pps");
+    std::atomic<int> done{0};
+    std::atomic<bool> stop{false};
+    Socket::ptr rx;
+    Socket::ptr tx;
+    Address::ptr rx_addr;
+    bool supported = true;
+    // 在iom中创建, fd才会由FdMgr设置为非阻塞并在IO时挂起协程
+    iom.schedulerLock([&]() {
+        Address::ptr addr = IPv4Address::Create("127.0.0.1", 0);
+        rx = Socket::CreateUDP(addr);
+        tx = Socket::CreateUDP(addr);
+        rx->bind(addr);
+        tx->bind(addr);
+        rx_addr = rx->getLocalAddress();
+        rx->setOption(SOL_SOCKET, SO_RCVBUF, 4 << 20);
+        // 停止发送后接收方最多再等这么久就结束
+        rx->setRecvTimeout(200);
+        if(mode == GSO) {
+            supported = tx->setUdpSegment(size) && rx->setUdpGro(true);
+        }
+        ++done;
+    });
+    WaitFor(done, 1);
+    if(!supported) {
+        printf("%-8s skipped: UDP_SEGMENT/UDP_GRO not supported\n", ModeName(mode));
+        return;
+    }
+
+    uint64_t sent = 0, send_calls = 0, received = 0, recv_calls = 0;
+    iom.schedulerLock([&]() {
+        Recv(mode, rx, size, batch, received, recv_calls);
+        ++done;
+    });
+    auto start = std::chrono::steady_clock::now();
+    iom.schedulerLock([&]() {
+        Send(mode, tx, rx_addr, size, batch, window, stop, sent, send_calls);
+        ++done;
+    });
+    std::this_thread::sleep_for(std::chrono::seconds(seconds));
+    stop = true;
+    WaitFor(done, 3);
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-8s sent %10.0f pps  recv %10.0f pps  lost %5.2f%%  send calls %9lu  recv calls %9lu\n"
+           ,ModeName(mode), sent / secs, received / secs, sent ? 100.0 * (sent - std::min(sent, received)) / sent : 0.0
+           ,send_calls, recv_calls);
+    fflush(stdout);
+    iom.schedulerLock([&]() {
+        rx->close();
+        tx->close();
+        ++done;
+    });
+    WaitFor(done, 4);
+}
+
+int main(int argc, char** argv) {
+    int seconds = argc > 1 ? atoi(argv[1]) : 3;
+    size_t size = argc > 2 ? atoi(argv[2]) : 64;
+    size_t batch = argc > 3 ? atoi(argv[3]) : 32;
+    size_t window = argc > 4 ? atoi(argv[4]) : 256;
+    // 每轮发送整数批
+    window = std::max(window / batch, (size_t)1) * batch;
+    printf("udp loopback: %d s, %zu byte datagrams, batch %zu, window %zu\n", seconds, size, batch, window);
+    RunMode(SINGLE, seconds, size, batch, window);
+    RunMode(BATCHED, seconds, size, batch, window);
+    RunMode(GSO, seconds, size, batch, window);
+    return 0;
+}
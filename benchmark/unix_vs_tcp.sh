@@ -0,0 +1,17 @@
+#!/bin/bash
+# 同样的回显负载分别跑在TCP回环和Unix域socket上, 服务端在loadgen进程内
+if [ "$#" -lt 2 ]; then
+    echo "Usage: <number> <length> [pipeline] [duration]"
+    exit 1
+fi
+
+# 由 cmake --build <build> --target loadgen_bench 生成
+LOADGEN=${LOADGEN:-../build/benchmark/loadgen_bench}
+
+ARGS="--server --connections $1 --length $2 --pipeline ${3:-1} --duration ${4:-10} --warmup 1"
+
+for ADDR in 127.0.0.1:18000 "[::1]:18000" unix:/tmp/dag_loadgen.sock unix:@dag_loadgen; do
+    echo "=== $ADDR"
+    $LOADGEN --address "$ADDR" $ARGS
+done
+rm -f /tmp/dag_loadgen.sock
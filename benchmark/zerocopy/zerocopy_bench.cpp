@@ -0,0 +1,133 @@
+#include "address.h"
+#include "bytearray.h"
+#include "ioscheduler.h"
+#include "socket.h"
+#include "stream/socket_stream.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <sys/resource.h>
+#include <thread>
+#include <unistd.h>
+
+/**
+ * 大块TCP发送的拷贝与零拷贝(MSG_ZEROCOPY)对比:
+ * 发送方和接收方各用一个单线程IOManager, 发送方用SocketStream反复发出同一个chunk大小的ByteArray共total_mb兆字节,
+ * 统计吞吐、发送线程的CPU时间(含处理完成通知), 以及零拷贝统计中内核确认没有拷贝/退回拷贝的字节数
+ * 注意: 回环上内核在交付给本机socket时总会拷贝(完成通知带SO_EE_CODE_ZEROCOPY_COPIED), 省下的CPU要在真实网卡上才能看到
+ * 用法: zerocopy_bench [total_mb=1024] [chunk_kb=1024] [host=127.0.0.1] [port=0]
+ *       port非0时连接到外部的接收端(如另一台机器上的 nc -l port > /dev/null), 不启动本地接收方
+ */
+
+using namespace dag;
+
+static void WaitFor(std::atomic<int>& v, int n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+static double ThreadCpuMs() {
+    rusage usage;
+    getrusage(RUSAGE_THREAD, &usage);
+    return usage.ru_utime.tv_sec * 1e3 + usage.ru_utime.tv_usec / 1e3
+         + usage.ru_stime.tv_sec * 1e3 + usage.ru_stime.tv_usec / 1e3;
+}
+
+struct Result {
+    double secs = 0;
+    double cpu_ms = 0;
+    Socket::ZeroCopyStats stats;
+    bool ok = false;
+};
+
+static Result RunMode(bool zerocopy, size_t total, size_t chunk, Address::ptr remote) {
+    Result result;
+    IOManager receiver(1, false, "zc_recv");
+    IOManager sender(1, false, "zc_send");
+    std::atomic<int> done{0};
+    std::atomic<int> ready{0};
+    int expect = 1;
+    Address::ptr target = remote;
+    Socket::ptr server;
+    if(!target) {
+        receiver.schedulerLock([&]() {
+            Address::ptr addr = IPv4Address::Create("127.0.0.1", 0);
+            server = Socket::CreateTCP(addr);
+            server->bind(addr);
+            server->listen();
+            target = server->getLocalAddress();
+            ++ready;
+            Socket::ptr client = server->accept();
+            std::vector<char> buf(256 * 1024);
+            while(client && client->recv(&buf[0], buf.size()) > 0);
+            server->close();
+            ++done;
+        });
+        WaitFor(ready, 1);
+        expect = 2;
+    }
+
+    sender.schedulerLock([&]() {
+        Socket::ptr sock = Socket::CreateTCP(target);
+        if(!sock->connect(target, 3000) || (zerocopy && !sock->setZeroCopy(true))) {
+            sock->close();
+            ++done;
+            return;
+        }
+        SocketStream stream(sock, false);
+        ByteArray::ptr ba(new ByteArray(64 * 1024));
+        std::string data(chunk, 'z');
+        ba->write(&data[0], data.size());
+
+        auto start = std::chrono::steady_clock::now();
+        double cpu_start = ThreadCpuMs();
+        result.ok = true;
+        for(size_t sent = 0; sent < total && result.ok; sent += chunk) {
+            ba->setPosition(0);
+            result.ok = stream.writeFixSize(ba, chunk) == (int)chunk;
+        }
+        // 等最后的完成通知, 处理通知的开销也算在发送方
+        while(sock->getZeroCopyStats().pending_sends) {
+            usleep(100);
+        }
+        result.cpu_ms = ThreadCpuMs() - cpu_start;
+        result.secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        result.stats = sock->getZeroCopyStats();
+        sock->close();
+        ++done;
+    });
+    WaitFor(done, expect);
+    return result;
+}
+
+int main(int argc, char** argv) {
+    size_t total_mb = argc > 1 ? atoi(argv[1]) : 1024;
+    size_t chunk_kb = argc > 2 ? atoi(argv[2]) : 1024;
+    const char* host = argc > 3 ? argv[3] : "127.0.0.1";
+    int port = argc > 4 ? atoi(argv[4]) : 0;
+    size_t total = total_mb << 20;
+    size_t chunk = chunk_kb << 10;
+    Address::ptr remote = port ? IPv4Address::Create(host, port) : nullptr;
+    printf("tcp send %zu MB in %zu KB writes to %s\n", total_mb, chunk_kb, remote ? remote->toString().c_str() : "loopback");
+
+    Result copy = RunMode(false, total, chunk, remote);
+    Result zc = RunMode(true, total, chunk, remote);
+    const char* names[] = {"copy", "zerocopy"};
+    Result* results[] = {&copy, &zc};
+    for(int i = 0; i < 2; ++i) {
+        Result& r = *results[i];
+        if(!r.ok) {
+            printf("%-9s failed (connect failed or SO_ZEROCOPY not supported)\n", names[i]);
+            continue;
+        }
+        printf("%-9s %8.1f MB/s  sender cpu %8.1f ms (%6.1f ms/GB)  zerocopy %6zu MB  deferred copy %6zu MB  copied %4zu MB  notifications %lu\n"
+               ,names[i], total_mb / r.secs, r.cpu_ms, r.cpu_ms * 1024 / total_mb
+               ,(size_t)(r.stats.zerocopy_bytes >> 20), (size_t)(r.stats.deferred_copy_bytes >> 20)
+               ,(size_t)(r.stats.copied_bytes >> 20), r.stats.notifications);
+    }
+    if(copy.ok && zc.ok && copy.cpu_ms > 0) {
+        printf("sender cpu saved by zerocopy: %.1f%%\n", 100.0 * (copy.cpu_ms - zc.cpu_ms) / copy.cpu_ms);
+    }
+    return 0;
+}
@@ -5,7 +5,10 @@
 
 #include "utils/endian.h"
 #include "address.h"
+#include "hook.h"
+#include "ioscheduler.h"
 #include "logger.h"
+#include "resolver.h"
 
 namespace dag {
 
@@ -17,6 +20,18 @@ static T CreateMask(uint32_t bits) {
     return (1 << (sizeof(T) * 8 - bits)) - 1;
 }
 
+static bool IsNumber(const char* s) {
+    if(!*s) {
+        return false;
+    }
+    for(; *s; ++s) {
+        if(!isdigit((unsigned char)*s)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 template<class T>
 static uint32_t CountBytes(T value) {
     uint32_t result = 0;
@@ -94,6 +109,16 @@ bool Address::Lookup(std::vector<Address::ptr>& result, const std::string& host,
     if(node.empty()) {
         node = host;
     }
+
+    // IO协程中由Resolver通过hook的UDP查询, 不阻塞工作线程; 服务名需要getaddrinfo查/etc/services
+    if((family == AF_INET || family == AF_INET6 || family == AF_UNSPEC)
+            && IOManager::GetThis() && is_hook_enable() && Resolver::IsLookupEnabled()
+            && (!service || IsNumber(service))) {
+        uint16_t port = service ? (uint16_t)atoi(service) : 0;
+        ResolverMgr::GetInstance()->lookup(result, node, family, port);
+        return !result.empty();
+    }
+
     int error = getaddrinfo(node.c_str(), service, &hints, &results);
     if(error) {
         #if DEBUG
@@ -131,6 +156,9 @@ bool Address::GetInterfaceAddresses(std::multimap<std::string
         for(next = results; next; next = next->ifa_next) {
             Address::ptr addr;
             uint32_t prefix_len = ~0u;
+            if(!next->ifa_addr) {
+                continue;
+            }
             if(family != AF_UNSPEC && family != next->ifa_addr->sa_family) {
                 continue;
             }
@@ -142,6 +170,16 @@ bool Address::GetInterfaceAddresses(std::multimap<std::string
                         prefix_len = CountBytes(netmask);
                     }
                     break;
+                case AF_INET6:
+                    {
+                        addr = Create(next->ifa_addr, sizeof(sockaddr_in6));
+                        in6_addr& netmask = ((sockaddr_in6*)next->ifa_netmask)->sin6_addr;
+                        prefix_len = 0;
+                        for(int i = 0; i < 16; ++i) {
+                            prefix_len += CountBytes(netmask.s6_addr[i]);
+                        }
+                    }
+                    break;
                 default:
                     break;
             }
@@ -169,6 +207,9 @@ bool Address::GetInterfaceAddresses(std::vector<std::pair<Address::ptr, uint32_t
         if(family == AF_INET || family == AF_UNSPEC) {
             result.push_back(std::make_pair(Address::ptr(new IPv4Address()), 0u));
         }
+        if(family == AF_INET6 || family == AF_UNSPEC) {
+            result.push_back(std::make_pair(Address::ptr(new IPv6Address()), 0u));
+        }
         return true;
     }
 
@@ -206,6 +247,12 @@ Address::ptr Address::Create(const sockaddr* addr, socklen_t addrlen) {
         case AF_INET:
             result.reset(new IPv4Address(*(const sockaddr_in*)addr));
             break;
+        case AF_INET6:
+            result.reset(new IPv6Address(*(const sockaddr_in6*)addr));
+            break;
+        case AF_UNIX:
+            result.reset(new UnixAddress(*(const sockaddr_un*)addr, addrlen));
+            break;
         default:
             result.reset(new UnknownAddress(*addr));
             break;
@@ -354,9 +401,180 @@ void IPv4Address::setPort(uint16_t v) {
 
 
 
+IPv6Address::ptr IPv6Address::Create(const char* address, uint16_t port) {
+    IPv6Address::ptr rt(new IPv6Address);
+    rt->m_addr.sin6_port = byteswapOnLittleEndian(port);
+    int result = inet_pton(AF_INET6, address, &rt->m_addr.sin6_addr);
+    if(result <= 0) {
+        #if DEBUG
+        DAG_LOG_DEBUG(g_logger) << "IPv6Address::Create(" << address << ", "
+                << port << ") rt=" << result << " errno=" << errno
+                << " errstr=" << strerror(errno);
+        #endif
+        return nullptr;
+    }
+    return rt;
+}
+
+IPv6Address::IPv6Address() {
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_addr.sin6_family = AF_INET6;
+}
+
+IPv6Address::IPv6Address(const sockaddr_in6& address) {
+    m_addr = address;
+}
+
+IPv6Address::IPv6Address(const uint8_t address[16], uint16_t port) {
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_addr.sin6_family = AF_INET6;
+    m_addr.sin6_port = byteswapOnLittleEndian(port);
+    memcpy(&m_addr.sin6_addr.s6_addr, address, 16);
+}
+
+sockaddr* IPv6Address::getAddr() {
+    return (sockaddr*)&m_addr;
+}
+
+const sockaddr* IPv6Address::getAddr() const {
+    return (sockaddr*)&m_addr;
+}
+
+socklen_t IPv6Address::getAddrLen() const {
+    return sizeof(m_addr);
+}
+
+std::ostream& IPv6Address::insert(std::ostream& os) const {
+    char buf[INET6_ADDRSTRLEN] = {0};
+    inet_ntop(AF_INET6, &m_addr.sin6_addr, buf, sizeof(buf));
+    os << "[" << buf << "]:" << byteswapOnLittleEndian(m_addr.sin6_port);
+    return os;
+}
+
+IPAddress::ptr IPv6Address::broadcastAddress(uint32_t prefix_len) {
+    if(prefix_len > 128) {
+        return nullptr;
+    }
+
+    sockaddr_in6 baddr(m_addr);
+    if(prefix_len < 128) {
+        baddr.sin6_addr.s6_addr[prefix_len / 8] |= CreateMask<uint8_t>(prefix_len % 8);
+    }
+    for(uint32_t i = prefix_len / 8 + 1; i < 16; ++i) {
+        baddr.sin6_addr.s6_addr[i] = 0xff;
+    }
+    return IPv6Address::ptr(new IPv6Address(baddr));
+}
+
+IPAddress::ptr IPv6Address::networdAddress(uint32_t prefix_len) {
+    if(prefix_len > 128) {
+        return nullptr;
+    }
+
+    sockaddr_in6 baddr(m_addr);
+    if(prefix_len < 128) {
+        baddr.sin6_addr.s6_addr[prefix_len / 8] &= ~CreateMask<uint8_t>(prefix_len % 8);
+    }
+    for(uint32_t i = prefix_len / 8 + 1; i < 16; ++i) {
+        baddr.sin6_addr.s6_addr[i] = 0x00;
+    }
+    return IPv6Address::ptr(new IPv6Address(baddr));
+}
+
+IPAddress::ptr IPv6Address::subnetMask(uint32_t prefix_len) {
+    if(prefix_len > 128) {
+        return nullptr;
+    }
+
+    sockaddr_in6 subnet;
+    memset(&subnet, 0, sizeof(subnet));
+    subnet.sin6_family = AF_INET6;
+    for(uint32_t i = 0; i < prefix_len / 8; ++i) {
+        subnet.sin6_addr.s6_addr[i] = 0xff;
+    }
+    if(prefix_len < 128) {
+        subnet.sin6_addr.s6_addr[prefix_len / 8] = ~CreateMask<uint8_t>(prefix_len % 8);
+    }
+    return IPv6Address::ptr(new IPv6Address(subnet));
+}
+
+uint32_t IPv6Address::getPort() const {
+    return byteswapOnLittleEndian(m_addr.sin6_port);
+}
+
+void IPv6Address::setPort(uint16_t v) {
+    m_addr.sin6_port = byteswapOnLittleEndian(v);
+}
+
 static const size_t MAX_PATH_LEN = sizeof(((sockaddr_un*)0)->sun_path) - 1;
 
+UnixAddress::ptr UnixAddress::CreateAbstract(const std::string& name) {
+    if(name.size() > MAX_PATH_LEN) {
+        return nullptr;
+    }
+    return UnixAddress::ptr(new UnixAddress(std::string(1, '\0') + name));
+}
+
+UnixAddress::UnixAddress() {
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_addr.sun_family = AF_UNIX;
+    m_length = sizeof(m_addr);
+}
+
+UnixAddress::UnixAddress(const std::string& path) {
+    memset(&m_addr, 0, sizeof(m_addr));
+    m_addr.sun_family = AF_UNIX;
+    // 文件路径带上结尾的'\0'; 抽象地址的长度就是名字的长度, 不带结尾
+    size_t len = std::min(path.size(), MAX_PATH_LEN);
+    memcpy(m_addr.sun_path, path.data(), len);
+    m_length = offsetof(sockaddr_un, sun_path) + len;
+    if(path.empty() || path[0] != '\0') {
+        ++m_length;
+    }
+}
+
+UnixAddress::UnixAddress(const sockaddr_un& address, socklen_t len) {
+    m_addr = address;
+    m_length = std::min<socklen_t>(len, sizeof(m_addr));
+}
+
+sockaddr* UnixAddress::getAddr() {
+    return (sockaddr*)&m_addr;
+}
+
+const sockaddr* UnixAddress::getAddr() const {
+    return (sockaddr*)&m_addr;
+}
+
+socklen_t UnixAddress::getAddrLen() const {
+    return m_length;
+}
+
+void UnixAddress::setAddrLen(socklen_t v) {
+    m_length = std::min<socklen_t>(v, sizeof(m_addr));
+}
+
+bool UnixAddress::isAbstract() const {
+    return m_length > offsetof(sockaddr_un, sun_path) + 1 && m_addr.sun_path[0] == '\0';
+}
 
+std::string UnixAddress::getPath() const {
+    if(m_length <= offsetof(sockaddr_un, sun_path)) {
+        // 未绑定的socket
+        return "";
+    }
+    if(isAbstract()) {
+        return std::string(m_addr.sun_path, m_length - offsetof(sockaddr_un, sun_path));
+    }
+    return std::string(m_addr.sun_path, strnlen(m_addr.sun_path, m_length - offsetof(sockaddr_un, sun_path)));
+}
+
+std::ostream& UnixAddress::insert(std::ostream& os) const {
+    if(isAbstract()) {
+        return os << "@" << getPath().substr(1);
+    }
+    return os << getPath();
+}
 
 UnknownAddress::UnknownAddress(int family) {
     memset(&m_addr, 0, sizeof(m_addr));
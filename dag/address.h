@@ -33,6 +33,8 @@ public:
 
     /**
      * @brief 通过host地址返回对应条件的所有Address
+     * @details 在IOManager的协程中端口为数字时交给Resolver, 只挂起当前协程; 否则调用getaddrinfo;
+     *          nsswitch.conf配置了files、dns以外的来源或Resolver::SetLookupEnabled(false)时总是调用getaddrinfo
      * @param[out] result 保存满足条件的Address
      * @param[in] host 域名,服务器名等.举例: www.dag.top[:80] (方括号为可选内容)
      * @param[in] family 协议族(AF_INT, AF_INT6, AF_UNIX)
@@ -270,6 +272,119 @@ private:
 
 
 
+/**
+ * @brief IPv6地址
+ */
+class IPv6Address : public IPAddress {
+public:
+    typedef std::shared_ptr<IPv6Address> ptr;
+
+    /**
+     * @brief 通过IPv6地址字符串创建IPv6Address
+     * @param[in] address IPv6地址字符串,如: fe80::1, ::ffff:192.168.1.1
+     * @param[in] port 端口号
+     * @return 返回IPv6Address,失败返回nullptr
+     */
+    static IPv6Address::ptr Create(const char* address, uint16_t port = 0);
+
+    /**
+     * @brief 构造未指定地址(::)
+     */
+    IPv6Address();
+
+    /**
+     * @brief 通过sockaddr_in6构造IPv6Address
+     * @param[in] address sockaddr_in6结构体
+     */
+    IPv6Address(const sockaddr_in6& address);
+
+    /**
+     * @brief 通过网络字节序的二进制地址构造IPv6Address
+     * @param[in] address 16字节的地址
+     * @param[in] port 端口号
+     */
+    IPv6Address(const uint8_t address[16], uint16_t port = 0);
+
+    const sockaddr* getAddr() const override;
+    sockaddr* getAddr() override;
+    socklen_t getAddrLen() const override;
+
+    /**
+     * @brief 可读性输出地址, 格式为[地址]:端口
+     */
+    std::ostream& insert(std::ostream& os) const override;
+
+    IPAddress::ptr broadcastAddress(uint32_t prefix_len) override;
+    IPAddress::ptr networdAddress(uint32_t prefix_len) override;
+    IPAddress::ptr subnetMask(uint32_t prefix_len) override;
+    uint32_t getPort() const override;
+    void setPort(uint16_t v) override;
+
+private:
+    sockaddr_in6 m_addr;
+};
+
+/**
+ * @brief Unix域socket地址
+ * @details 路径以'\0'开头时为Linux的抽象命名空间地址, 不在文件系统中创建文件, 随最后一个socket关闭而消失;
+ *          抽象地址的名字可以包含任意字节, 地址长度决定名字的结尾, 因此要保留实际长度
+ */
+class UnixAddress : public Address {
+public:
+    typedef std::shared_ptr<UnixAddress> ptr;
+
+    /**
+     * @brief 创建抽象命名空间地址
+     * @param[in] name 名字, 不含开头的'\0'
+     * @return 名字过长时返回nullptr
+     */
+    static UnixAddress::ptr CreateAbstract(const std::string& name);
+
+    /**
+     * @brief 构造空地址, 用于getsockname/accept等接收地址
+     */
+    UnixAddress();
+
+    /**
+     * @brief 通过路径构造
+     * @param[in] path 文件路径, 以'\0'开头时为抽象地址; 超过sun_path长度时截断
+     */
+    UnixAddress(const std::string& path);
+
+    /**
+     * @brief 通过sockaddr_un和实际长度构造
+     */
+    UnixAddress(const sockaddr_un& address, socklen_t len);
+
+    const sockaddr* getAddr() const override;
+    sockaddr* getAddr() override;
+    socklen_t getAddrLen() const override;
+
+    /**
+     * @brief 设置地址长度, getsockname等填写地址后调用
+     */
+    void setAddrLen(socklen_t v);
+
+    /**
+     * @brief 返回路径, 抽象地址以'\0'开头
+     */
+    std::string getPath() const;
+
+    /**
+     * @brief 是否为抽象命名空间地址
+     */
+    bool isAbstract() const;
+
+    /**
+     * @brief 可读性输出地址, 抽象地址输出为@名字
+     */
+    std::ostream& insert(std::ostream& os) const override;
+
+private:
+    sockaddr_un m_addr;
+    socklen_t m_length;
+};
+
 /**
  * @brief 未知地址
  */
@@ -0,0 +1,129 @@
+#include "blocking.h"
+#include <algorithm>
+#include <errno.h>
+#include "fiber.h"
+#include "scheduler.h"
+#include "utils/util.h"
+
+namespace dag {
+
+BlockingPool::BlockingPool(size_t max_threads, const std::string& name)
+    : m_name(name)
+    , m_maxThreads(std::max<size_t>(max_threads, 1)) {
+}
+
+BlockingPool::~BlockingPool() {
+    std::vector<std::shared_ptr<Thread>> threads;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        threads.swap(m_threads);
+    }
+    m_cond.notify_all();
+    for(auto& i : threads) {
+        i->join();
+    }
+}
+
+void BlockingPool::setMaxThreads(size_t n) {
+    m_maxThreads = std::max<size_t>(n, 1);
+}
+
+void BlockingPool::Record(std::atomic<uint64_t>* buckets, uint64_t us) {
+    size_t bucket = us ? 64 - __builtin_clzll(us) : 0;
+    buckets[std::min(bucket, LATENCY_BUCKETS - 1)].fetch_add(1, std::memory_order_relaxed);
+}
+
+void BlockingPool::run(const std::function<void()>& fn) {
+    Scheduler* scheduler = Scheduler::GetThis();
+    Fiber* fiber = Fiber::GetThisRaw();
+    if(!scheduler || !fiber || !fiber->isRunInScheduler() || fiber->isSharedStack()) {
+        // 池线程里嵌套调用、或普通线程调用, 本来就可以阻塞;
+        // 共享栈协程让出后栈上的内容被拷走, 共享栈由下一个协程使用, fn捕获的引用和调用方的缓冲区都会失效
+        ++m_inlineCalls;
+        fn();
+        return;
+    }
+
+    std::shared_ptr<JobState> state = std::make_shared<JobState>();
+    state->fn = fn;
+    Job job;
+    job.state = state;
+    job.fiber = fiber->shared_from_this();
+    job.scheduler = scheduler;
+    job.enqueue_us = getElapseUs();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_jobs.push_back(std::move(job));
+        // 被唤醒的空闲线程取走任务时才减少m_idle, 按排队数和空闲数比较, 连续提交时不会少建线程
+        if(m_jobs.size() > m_idle && m_threads.size() < m_maxThreads && !m_stopping) {
+            m_threads.emplace_back(new Thread(std::bind(&BlockingPool::work, this)
+                                              ,m_name + "_" + std::to_string(m_threads.size())));
+        }
+    }
+    m_cond.notify_one();
+    ++m_calls;
+    // 池线程执行完后重新调度本协程; 它在本线程让出、释放协程锁之后才会被恢复
+    fiber->yield();
+
+    errno = state->error_no;
+    if(state->error) {
+        std::rethrow_exception(state->error);
+    }
+}
+
+void BlockingPool::work() {
+    while(true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            ++m_idle;
+            m_cond.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+            --m_idle;
+            if(m_jobs.empty()) {
+                break;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+            ++m_running;
+            m_maxRunning = std::max(m_maxRunning, m_running);
+        }
+
+        uint64_t start = getElapseUs();
+        Record(m_waitBuckets, start - job.enqueue_us);
+        errno = 0;
+        try {
+            job.state->fn();
+        } catch(...) {
+            job.state->error = std::current_exception();
+        }
+        job.state->error_no = errno;
+        Record(m_runBuckets, getElapseUs() - start);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_running;
+        }
+        // 结果已写入state; 先放掉池线程的引用, fn的副本随调用方一起析构
+        job.state.reset();
+        job.scheduler->schedulerLock(std::move(job.fiber));
+    }
+}
+
+BlockingPool::Stats BlockingPool::getStats() {
+    Stats stats;
+    stats.calls = m_calls;
+    stats.inline_calls = m_inlineCalls;
+    for(size_t i = 0; i < LATENCY_BUCKETS; ++i) {
+        stats.wait_buckets[i] = m_waitBuckets[i].load(std::memory_order_relaxed);
+        stats.run_buckets[i] = m_runBuckets[i].load(std::memory_order_relaxed);
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    stats.threads = m_threads.size();
+    stats.queued = m_jobs.size();
+    stats.running = m_running;
+    stats.max_running = m_maxRunning;
+    return stats;
+}
+
+}
@@ -0,0 +1,161 @@
+#ifndef __DAG_BLOCKING_H__
+#define __DAG_BLOCKING_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "thread.h"
+#include "utils/singleton.h"
+
+namespace dag {
+
+class Fiber;
+class Scheduler;
+
+/**
+ * @brief 阻塞调用池
+ * @details hook只能让socket的IO挂起协程, 磁盘文件的读写、fsync、getaddrinfo、open等调用仍会阻塞整个工作线程
+ *          和线程上的所有协程; 把这些调用交给独立的线程池执行, 发起调用的协程挂起, 完成后重新调度回原来的调度器;
+ *          线程按需创建, 不超过上限(即同时执行的阻塞调用数的上限), 超出的调用排队等待, 线程创建后不回收
+ * @attention 挂起等待的协程不计入调度器的任务数, 调度器要在这些调用返回之后才能停止;
+ *            共享栈协程挂起后栈上的变量被换出, 池线程无法访问, 这些协程的调用直接在当前线程执行
+ */
+class BlockingPool {
+public:
+    /// 延迟直方图的桶数: <1us, <2us, <4us, ..., 更长
+    static const size_t LATENCY_BUCKETS = 24;
+
+    /**
+     * @brief 统计
+     */
+    struct Stats {
+        // 交给池执行的调用数
+        uint64_t calls = 0;
+        // 不在调度器的协程中或在共享栈协程中、直接在调用线程上执行的调用数
+        uint64_t inline_calls = 0;
+        // 当前线程数
+        size_t threads = 0;
+        // 正在排队、正在执行的调用数
+        size_t queued = 0;
+        size_t running = 0;
+        // 同时执行的最大调用数
+        size_t max_running = 0;
+        // 排队时间和执行时间直方图, buckets[i]为在[2^(i-1), 2^i)微秒之间的调用数, 最后一个桶为更长
+        uint64_t wait_buckets[LATENCY_BUCKETS] = {0};
+        uint64_t run_buckets[LATENCY_BUCKETS] = {0};
+    };
+
+    /**
+     * @param[in] max_threads 线程数上限
+     * @param[in] name 线程名前缀
+     */
+    explicit BlockingPool(size_t max_threads = 16, const std::string& name = "blocking");
+
+    /**
+     * @brief 等排队的调用执行完, 停止所有线程
+     */
+    ~BlockingPool();
+
+    /**
+     * @brief 设置线程数上限, 调小时已创建的线程不会退出
+     */
+    void setMaxThreads(size_t n);
+
+    size_t getMaxThreads() const {return m_maxThreads;}
+
+    /**
+     * @brief 在池中执行fn, 当前协程挂起直到执行完毕
+     * @details fn中设置的errno和抛出的异常带回调用方; 不在调度器的协程中或在共享栈协程中调用时直接在当前线程执行
+     */
+    void run(const std::function<void()>& fn);
+
+    /**
+     * @brief 在池中执行fn并返回它的结果
+     */
+    template<class F>
+    auto call(F&& fn) -> decltype(fn()) {
+        using R = decltype(fn());
+        if constexpr (std::is_void<R>::value) {
+            run(std::function<void()>(std::forward<F>(fn)));
+        } else {
+            std::optional<R> result;
+            run([&result, &fn]() { result.emplace(fn()); });
+            return std::move(*result);
+        }
+    }
+
+    Stats getStats();
+
+    BlockingPool(const BlockingPool&) = delete;
+    BlockingPool& operator=(const BlockingPool&) = delete;
+
+private:
+    /**
+     * @brief 调用和它的结果, 放在堆上由调用方和池线程共享, 池线程不访问挂起协程的栈
+     */
+    struct JobState {
+        std::function<void()> fn;
+        int error_no = 0;
+        std::exception_ptr error;
+    };
+
+    /**
+     * @brief 一次阻塞调用
+     */
+    struct Job {
+        std::shared_ptr<JobState> state;
+        std::shared_ptr<Fiber> fiber;
+        Scheduler* scheduler = nullptr;
+        uint64_t enqueue_us = 0;
+    };
+
+    /**
+     * @brief 池线程的主循环
+     */
+    void work();
+
+    static void Record(std::atomic<uint64_t>* buckets, uint64_t us);
+
+private:
+    std::string m_name;
+    std::atomic<size_t> m_maxThreads;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    std::deque<Job> m_jobs;
+    std::vector<std::shared_ptr<Thread>> m_threads;
+    // 等待任务的线程数
+    size_t m_idle = 0;
+    size_t m_running = 0;
+    size_t m_maxRunning = 0;
+    bool m_stopping = false;
+    std::atomic<uint64_t> m_calls = {0};
+    std::atomic<uint64_t> m_inlineCalls = {0};
+    std::atomic<uint64_t> m_waitBuckets[LATENCY_BUCKETS] = {};
+    std::atomic<uint64_t> m_runBuckets[LATENCY_BUCKETS] = {};
+};
+
+using BlockingPoolMgr = Singleton<BlockingPool>;
+
+/**
+ * @brief 在全局阻塞调用池中执行fn, 当前协程挂起直到完成, 返回fn的结果
+ * @details 例如 int fd = dag::blocking([&]() { return ::open(path, O_RDONLY); });
+ *          errno和异常带回调用方; 不在调度器的协程中调用时直接执行
+ */
+template<class F>
+auto blocking(F&& fn) -> decltype(fn()) {
+    return BlockingPoolMgr::GetInstance()->call(std::forward<F>(fn));
+}
+
+}
+
+#endif
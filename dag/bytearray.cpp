@@ -41,11 +41,38 @@ ByteArray::ByteArray(size_t base_size)
 }
 
 ByteArray::~ByteArray() {
-    Node* tmp = m_root;
-    while(tmp) {
-        m_cur = tmp;
-        tmp = tmp->next;
-        delete m_cur;
+    releaseNodes(m_root);
+}
+
+ByteArray::PinnedNodes::~PinnedNodes() {
+    for(Node* tmp : chains) {
+        while(tmp) {
+            Node* next = tmp->next;
+            delete tmp;
+            tmp = next;
+        }
+    }
+}
+
+std::shared_ptr<void> ByteArray::pin() {
+    std::shared_ptr<PinnedNodes> pinned = m_pinned.lock();
+    if(!pinned) {
+        pinned = std::make_shared<PinnedNodes>();
+        m_pinned = pinned;
+    }
+    return pinned;
+}
+
+void ByteArray::releaseNodes(Node* node) {
+    if(std::shared_ptr<PinnedNodes> pinned = m_pinned.lock()) {
+        pinned->chains.push_back(node);
+        m_pinned.reset();
+        return;
+    }
+    while(node) {
+        Node* next = node->next;
+        delete node;
+        node = next;
     }
 }
 
@@ -333,11 +360,12 @@ std::string ByteArray::readStringVint() {
 void ByteArray::clear() {
     m_position = m_size = 0;
     m_capacity = m_baseSize;
-    Node* tmp = m_root->next;
-    while(tmp) {
-        m_cur = tmp;
-        tmp = tmp->next;
-        delete m_cur;
+    if(m_pinned.lock()) {
+        // 已发出的数据可能还在根节点里, 连同根节点一起交出去, 换一个新的根节点
+        releaseNodes(m_root);
+        m_root = new Node(m_baseSize);
+    } else {
+        releaseNodes(m_root->next);
     }
     m_cur = m_root;
     m_root->next = NULL;
@@ -552,6 +552,15 @@ public:
      */
     size_t getSize() const {return m_size;}
 
+    /**
+     * @brief 钉住当前的内存块
+     * @details 返回的句柄存活期间, clear()和析构不再释放已有的内存块, 而是转交给句柄, 最后一个句柄释放时才删除;
+     *          用于零拷贝发送: 内核确认发送完成前, getReadBuffers返回的内存必须一直有效
+     * @attention 只保证内存不被释放, 句柄存活期间不要setPosition回到已发送的位置覆盖写
+     * @return 句柄, 下一次clear()之前多次调用返回同一个
+     */
+    std::shared_ptr<void> pin();
+
 private:
     /**
      * @brief 扩容ByteArray,使其可以容纳至少size个新数据
@@ -564,6 +573,20 @@ private:
      */
     size_t getCapacity() const { return m_capacity - m_position;}
 
+    /**
+     * @brief 被钉住的内存块链表, 随句柄一起释放
+     */
+    struct PinnedNodes {
+        ~PinnedNodes();
+
+        std::vector<Node*> chains;
+    };
+
+    /**
+     * @brief 释放从node开始的内存块链表, 被钉住时转交给句柄
+     */
+    void releaseNodes(Node* node);
+
 private:
     /// 内存块的基准大小
     size_t m_baseSize;
@@ -579,6 +602,8 @@ private:
     Node* m_root;
     /// 当前操作的内存块指针
     Node* m_cur;
+    /// pin()返回的句柄
+    std::weak_ptr<PinnedNodes> m_pinned;
 };
 
 }
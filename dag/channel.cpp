@@ -0,0 +1,201 @@
+#include "channel.h"
+#include "utils/util.h"
+
+namespace dag {
+
+ChannelWaiter::ChannelWaiter() {
+    Fiber::ptr self = Fiber::GetThis();
+    if(Scheduler::GetThis() && self->isRunInScheduler()) {
+        m_fiber = self;
+        m_scheduler = Scheduler::GetThis();
+    }
+}
+
+bool ChannelWaiter::wake(int index) {
+    int expected = NOT_FIRED;
+    if(!m_fired.compare_exchange_strong(expected, index)) {
+        return false;
+    }
+    if(m_fiber) {
+        // 唤醒方可能在park的yield之前就重新调度了协程, 调度器resume前会等协程的m_mutex, 不会重复执行
+        m_scheduler->schedulerLock(m_fiber);
+    } else {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+        }
+        m_cond.notify_one();
+    }
+    return true;
+}
+
+int ChannelWaiter::park(int64_t timeout_ms) {
+    if(m_fiber) {
+        std::shared_ptr<Timer> timer;
+        IOManager* iom = IOManager::GetThis();
+        if(timeout_ms >= 0 && iom) {
+            std::weak_ptr<ChannelWaiter> weak = shared_from_this();
+            timer = iom->addTimer(timeout_ms, [weak]() {
+                ChannelWaiter::ptr waiter = weak.lock();
+                if(waiter) {
+                    waiter->wake(TIMEOUT);
+                }
+            });
+        }
+        Fiber::GetThis()->yield();
+        if(timer) {
+            timer->cancel();
+        }
+        return m_fired;
+    }
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    auto fired = [this]() { return m_fired.load() != NOT_FIRED; };
+    if(timeout_ms < 0) {
+        m_cond.wait(lock, fired);
+    } else if(!m_cond.wait_for(lock, std::chrono::milliseconds(timeout_ms), fired)) {
+        lock.unlock();
+        // 与通道的唤醒竞争, 输了就以通道的下标为准
+        wake(TIMEOUT);
+    }
+    return m_fired;
+}
+
+int ChannelWaiter::cancel() {
+    int expected = NOT_FIRED;
+    if(m_fired.compare_exchange_strong(expected, TIMEOUT)) {
+        return TIMEOUT;
+    }
+    return park(-1);
+}
+
+void ChannelBase::close() {
+    m_closed = true;
+    std::lock_guard<SpinLock> lock(m_guard);
+    for(WaiterList* list : {&m_recvWaiters, &m_sendWaiters}) {
+        for(auto& i : *list) {
+            i.first->wake(i.second);
+        }
+        list->clear();
+    }
+    m_recvWaiting = 0;
+    m_sendWaiting = 0;
+}
+
+bool ChannelBase::addWaiter(const ChannelWaiter::ptr& waiter, bool recv, int index) {
+    std::lock_guard<SpinLock> lock(m_guard);
+    std::atomic<int>& waiting = recv ? m_recvWaiting : m_sendWaiting;
+    // 先登记再检查状态, 与收发方先改队列再检查等待者个数配对
+    waiting.fetch_add(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(recv ? readyForRecv() : readyForSend()) {
+        waiting.fetch_sub(1);
+        return false;
+    }
+    (recv ? m_recvWaiters : m_sendWaiters).emplace_back(waiter, index);
+    return true;
+}
+
+void ChannelBase::removeWaiter(const ChannelWaiter::ptr& waiter, bool recv) {
+    std::lock_guard<SpinLock> lock(m_guard);
+    WaiterList& list = recv ? m_recvWaiters : m_sendWaiters;
+    for(auto it = list.begin(); it != list.end(); ++it) {
+        if(it->first == waiter) {
+            list.erase(it);
+            (recv ? m_recvWaiting : m_sendWaiting).fetch_sub(1);
+            return;
+        }
+    }
+}
+
+void ChannelBase::wakeOneSlow(bool recv) {
+    std::lock_guard<SpinLock> lock(m_guard);
+    WaiterList& list = recv ? m_recvWaiters : m_sendWaiters;
+    std::atomic<int>& waiting = recv ? m_recvWaiting : m_sendWaiting;
+    while(!list.empty()) {
+        std::pair<ChannelWaiter::ptr, int> w = std::move(list.front());
+        list.pop_front();
+        waiting.fetch_sub(1);
+        if(w.first->wake(w.second)) {
+            return;
+        }
+    }
+}
+
+int Selector::tryOnce() {
+    static thread_local uint32_t s_seed = 2463534242u;
+    size_t n = m_cases.size();
+    if(n == 0) {
+        return TIMEOUT;
+    }
+    s_seed ^= s_seed << 13;
+    s_seed ^= s_seed >> 17;
+    s_seed ^= s_seed << 5;
+    size_t start = s_seed % n;
+    for(size_t k = 0; k < n; ++k) {
+        size_t i = (start + k) % n;
+        Result r = m_cases[i].action();
+        if(r != NOT_READY) {
+            m_cases[i].ok = (r == DONE);
+            return (int)i;
+        }
+    }
+    return TIMEOUT;
+}
+
+int Selector::select(int64_t timeout_ms) {
+    uint64_t deadline = timeout_ms > 0 ? getElapseMs() + timeout_ms : 0;
+    while(true) {
+        int index = tryOnce();
+        if(index != TIMEOUT || timeout_ms == 0) {
+            return index;
+        }
+        int64_t wait_ms = -1;
+        if(timeout_ms > 0) {
+            uint64_t now = getElapseMs();
+            if(now >= deadline) {
+                return TIMEOUT;
+            }
+            wait_ms = deadline - now;
+        }
+
+        ChannelWaiter::ptr waiter = std::make_shared<ChannelWaiter>();
+        size_t registered = 0;
+        for(; registered < m_cases.size(); ++registered) {
+            Case& c = m_cases[registered];
+            if(!c.channel->addWaiter(waiter, c.is_recv, registered)) {
+                break;
+            }
+        }
+        int fired = registered == m_cases.size() ? waiter->park(wait_ms) : waiter->cancel();
+        for(size_t i = 0; i < registered; ++i) {
+            m_cases[i].channel->removeWaiter(waiter, m_cases[i].is_recv);
+        }
+        if(fired == ChannelWaiter::TIMEOUT) {
+            if(registered == m_cases.size()) {
+                return TIMEOUT;
+            }
+            // 注册时发现有就绪的通道, 重试
+            continue;
+        }
+
+        index = tryOnce();
+        if(index != fired) {
+            // 唤醒本分支的通道状态没有被消耗, 转交给该通道的下一个等待者
+            m_cases[fired].channel->wakeOne(m_cases[fired].is_recv);
+        }
+        if(index != TIMEOUT) {
+            return index;
+        }
+    }
+}
+
+Channel<uint64_t>::ptr NewTimerChannel(uint64_t ms, IOManager* iom) {
+    Channel<uint64_t>::ptr ch = std::make_shared<Channel<uint64_t>>(2);
+    iom->addTimer(ms, [ch]() {
+        ch->trySend(getElapseMs());
+        ch->close();
+    });
+    return ch;
+}
+
+}
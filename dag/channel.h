@@ -0,0 +1,430 @@
+#ifndef __DAG_CHANNEL_H__
+#define __DAG_CHANNEL_H__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "fiber.h"
+#include "ioscheduler.h"
+#include "utils/mpmc_queue.h"
+#include "utils/mutex.h"
+#include "utils/noncopyable.h"
+#include "utils/util.h"
+
+namespace dag {
+
+/**
+ * @brief 通道的等待者, 一次性: 可以同时挂在多个通道上(select), 只会被其中一个唤醒一次
+ */
+class ChannelWaiter : public std::enable_shared_from_this<ChannelWaiter> {
+public:
+    using ptr = std::shared_ptr<ChannelWaiter>;
+
+    /// park()超时返回的下标
+    static const int TIMEOUT = -1;
+
+    ChannelWaiter();
+
+    /**
+     * @brief 以下标index唤醒, 只有第一次调用生效
+     * @return 是否由本次调用唤醒
+     */
+    bool wake(int index);
+
+    /**
+     * @brief 挂起当前协程/线程直到被唤醒或超时
+     * @param[in] timeout_ms 超时时间(毫秒), -1表示不超时; 协程中使用超时需要运行在IOManager上
+     * @return 唤醒时的下标, 超时返回TIMEOUT
+     */
+    int park(int64_t timeout_ms);
+
+    /**
+     * @brief 放弃等待(注册到一半发现有通道就绪时使用)
+     * @details 已经被某个通道唤醒时, 要把这次唤醒消耗掉, 否则协程会被多调度一次
+     * @return 放弃成功返回TIMEOUT, 否则返回唤醒时的下标
+     */
+    int cancel();
+
+private:
+    // 唤醒下标, NOT_FIRED表示尚未唤醒
+    static const int NOT_FIRED = -2;
+    std::atomic<int> m_fired{NOT_FIRED};
+    // 协程等待者
+    Fiber::ptr m_fiber;
+    Scheduler* m_scheduler = nullptr;
+    // 线程等待者
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+};
+
+/**
+ * @brief 通道公共部分: 关闭状态和收/发两个等待者列表, 与元素类型无关
+ */
+class ChannelBase : public NonCopyable {
+public:
+    virtual ~ChannelBase() {}
+
+    /**
+     * @brief 关闭通道: 之后发送失败, 接收方取完剩余元素后失败, 唤醒所有等待者
+     */
+    void close();
+
+    bool isClosed() const { return m_closed;}
+
+    /**
+     * @brief 是否可以不等待地接收(有元素或已关闭)
+     */
+    virtual bool readyForRecv() const = 0;
+
+    /**
+     * @brief 是否可以不等待地发送(未满或已关闭)
+     */
+    virtual bool readyForSend() const = 0;
+
+    /**
+     * @brief 注册等待者
+     * @param[in] recv true等待可接收, false等待可发送
+     * @param[in] index 唤醒时传给waiter的下标
+     * @return 通道已经就绪时不注册, 返回false
+     */
+    bool addWaiter(const ChannelWaiter::ptr& waiter, bool recv, int index);
+
+    /**
+     * @brief 注销等待者(可能已经被唤醒移除)
+     */
+    void removeWaiter(const ChannelWaiter::ptr& waiter, bool recv);
+
+    /**
+     * @brief 唤醒一个等待者, 跳过已经被其他通道唤醒的
+     * @details 收发后调用; 先做一次seq_cst栅栏, 与addWaiter先登记再检查状态配对.
+     *          被唤醒的select最终没有在本通道上完成操作时也要调用, 把唤醒转交给下一个等待者
+     */
+    void wakeOne(bool recv) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if((recv ? m_recvWaiting : m_sendWaiting).load(std::memory_order_relaxed) > 0) {
+            wakeOneSlow(recv);
+        }
+    }
+
+private:
+    void wakeOneSlow(bool recv);
+
+private:
+    using WaiterList = std::list<std::pair<ChannelWaiter::ptr, int>>;
+    std::atomic<bool> m_closed{false};
+    SpinLock m_guard;
+    WaiterList m_recvWaiters;
+    WaiterList m_sendWaiters;
+    std::atomic<int> m_recvWaiting{0};
+    std::atomic<int> m_sendWaiting{0};
+};
+
+/**
+ * @brief 协程间传递T的通道
+ * @details 有界通道用无锁环形队列(MpmcQueue)存放元素, 收发在不满/不空时只做环形队列上的原子操作,
+ *          只有需要等待或唤醒时才进入等待者列表的锁; 环形队列大小向上取整到2的幂,
+ *          另用一个计数限制元素个数, 通道容量与构造时指定的完全一致;
+ *          无界通道用自旋锁保护的deque, 发送从不等待;
+ *          send/recv在协程中挂起协程而不阻塞线程, 在调度器之外的线程中调用时阻塞线程
+ * @tparam T 元素类型, 需要可默认构造和移动
+ */
+template <class T>
+class Channel : public ChannelBase {
+public:
+    using ptr = std::shared_ptr<Channel>;
+
+    /// 无界通道的容量
+    static const size_t UNBOUNDED = 0;
+
+    /**
+     * @brief 构造函数
+     * @param[in] capacity 容量, UNBOUNDED表示无界
+     */
+    explicit Channel(size_t capacity = UNBOUNDED)
+        : m_capacity(capacity) {
+        if(capacity != UNBOUNDED) {
+            size_t n = 2;
+            while(n < capacity) {
+                n <<= 1;
+            }
+            m_ring.reset(new MpmcQueue<T>(n));
+        }
+    }
+
+    /**
+     * @brief 不等待地发送
+     * @return 已满或已关闭时返回false, v不被移走
+     */
+    template <class U>
+    bool trySend(U&& v) {
+        if(isClosed()) {
+            return false;
+        }
+        if(m_ring) {
+            // 先占一个名额, 计数不超过容量时环形队列一定有空槽(除非有接收方正在取走旧槽位的元素)
+            size_t n = m_count.load(std::memory_order_relaxed);
+            do {
+                if(n >= m_capacity) {
+                    return false;
+                }
+            } while(!m_count.compare_exchange_weak(n, n + 1, std::memory_order_relaxed));
+            if(!m_ring->tryPush(std::forward<U>(v))) {
+                m_count.fetch_sub(1, std::memory_order_relaxed);
+                return false;
+            }
+        } else {
+            std::lock_guard<SpinLock> lock(m_queueGuard);
+            m_queue.push_back(std::forward<U>(v));
+            m_queueSize.store(m_queue.size(), std::memory_order_relaxed);
+        }
+        wakeOne(true);
+        return true;
+    }
+
+    /**
+     * @brief 不等待地接收
+     * @return 没有元素时返回false
+     */
+    bool tryRecv(T& v) {
+        if(m_ring) {
+            if(!m_ring->tryPop(v)) {
+                return false;
+            }
+            // 槽位已经释放后才归还名额
+            m_count.fetch_sub(1, std::memory_order_relaxed);
+        } else {
+            std::lock_guard<SpinLock> lock(m_queueGuard);
+            if(m_queue.empty()) {
+                return false;
+            }
+            v = std::move(m_queue.front());
+            m_queue.pop_front();
+            m_queueSize.store(m_queue.size(), std::memory_order_relaxed);
+        }
+        wakeOne(false);
+        return true;
+    }
+
+    /**
+     * @brief 发送, 满时挂起直到有空位
+     * @param[in] timeout_ms 超时时间(毫秒), -1表示不超时
+     * @return 已关闭或超时返回false
+     */
+    template <class U>
+    bool send(U&& v, int64_t timeout_ms = -1) {
+        uint64_t deadline = timeout_ms > 0 ? getElapseMs() + timeout_ms : 0;
+        while(true) {
+            if(isClosed()) {
+                return false;
+            }
+            if(trySend(std::forward<U>(v))) {
+                return true;
+            }
+            int64_t wait_ms = remainingMs(deadline, timeout_ms);
+            if(wait_ms == 0 || !waitReady(false, wait_ms)) {
+                return false;
+            }
+        }
+    }
+
+    /**
+     * @brief 接收, 空时挂起直到有元素
+     * @param[in] timeout_ms 超时时间(毫秒), -1表示不超时
+     * @return 已关闭且没有剩余元素, 或超时时返回false
+     */
+    bool recv(T& v, int64_t timeout_ms = -1) {
+        uint64_t deadline = timeout_ms > 0 ? getElapseMs() + timeout_ms : 0;
+        while(true) {
+            if(tryRecv(v)) {
+                return true;
+            }
+            if(isClosed()) {
+                // 关闭前发送的元素要取完
+                return tryRecv(v);
+            }
+            int64_t wait_ms = remainingMs(deadline, timeout_ms);
+            if(wait_ms == 0 || !waitReady(true, wait_ms)) {
+                return false;
+            }
+        }
+    }
+
+    /**
+     * @brief 当前元素个数(近似值)
+     */
+    size_t size() const {
+        return m_ring ? m_count.load(std::memory_order_relaxed) : m_queueSize.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 容量, 无界通道返回UNBOUNDED
+     */
+    size_t capacity() const { return m_capacity;}
+
+    bool readyForRecv() const override {
+        if(m_ring) {
+            return m_ring->canPop() || isClosed();
+        }
+        return m_queueSize.load(std::memory_order_relaxed) > 0 || isClosed();
+    }
+
+    bool readyForSend() const override {
+        if(m_ring) {
+            return (m_count.load(std::memory_order_relaxed) < m_capacity && m_ring->canPush()) || isClosed();
+        }
+        return true;
+    }
+
+private:
+    /**
+     * @brief 距截止时间的剩余毫秒数, 被唤醒后没抢到元素重新等待时不能再从头计时
+     * @return timeout_ms为-1时返回-1, 已经超时返回0
+     */
+    static int64_t remainingMs(uint64_t deadline, int64_t timeout_ms) {
+        if(timeout_ms <= 0) {
+            return timeout_ms;
+        }
+        uint64_t now = getElapseMs();
+        return now >= deadline ? 0 : deadline - now;
+    }
+
+    /**
+     * @brief 等待通道可收/可发
+     * @return 超时返回false
+     */
+    bool waitReady(bool recv, int64_t timeout_ms) {
+        ChannelWaiter::ptr waiter = std::make_shared<ChannelWaiter>();
+        if(!addWaiter(waiter, recv, 0)) {
+            return true;
+        }
+        int fired = waiter->park(timeout_ms);
+        removeWaiter(waiter, recv);
+        return fired != ChannelWaiter::TIMEOUT;
+    }
+
+private:
+    // 容量
+    size_t m_capacity;
+    // 有界通道的环形队列
+    std::unique_ptr<MpmcQueue<T>> m_ring;
+    // 有界通道已占用的名额(含正在入队/出队的元素)
+    std::atomic<size_t> m_count{0};
+    // 无界通道的队列
+    SpinLock m_queueGuard;
+    std::deque<T> m_queue;
+    std::atomic<size_t> m_queueSize{0};
+};
+
+/**
+ * @brief 在多个通道的收发操作中等待第一个可以完成的
+ * @details 用法:
+ *          Selector sel;
+ *          int a = sel.recv(ch1, v1);
+ *          int b = sel.send(ch2, x);
+ *          int i = sel.select(100);   // i == a / b / Selector::TIMEOUT
+ *          已关闭的通道也算就绪, 这时isOk(i)为false;
+ *          多个分支同时就绪时从随机位置开始选择, 避免总是偏向前面的分支
+ */
+class Selector : public NonCopyable {
+public:
+    /// select()超时的返回值
+    static const int TIMEOUT = -1;
+
+    /**
+     * @brief 添加接收分支, 完成时元素写入out
+     * @return 分支下标
+     */
+    template <class T>
+    int recv(const typename Channel<T>::ptr& ch, T& out) {
+        Channel<T>* c = ch.get();
+        return addCase(ch, true, [c, &out]() {
+            if(c->tryRecv(out)) {
+                return DONE;
+            }
+            if(c->isClosed()) {
+                return c->tryRecv(out) ? DONE : CLOSED;
+            }
+            return NOT_READY;
+        });
+    }
+
+    /**
+     * @brief 添加发送分支, 发送v的一份拷贝
+     * @return 分支下标
+     */
+    template <class T>
+    int send(const typename Channel<T>::ptr& ch, const T& v) {
+        Channel<T>* c = ch.get();
+        return addCase(ch, false, [c, v]() {
+            if(c->isClosed()) {
+                return CLOSED;
+            }
+            return c->trySend(v) ? DONE : NOT_READY;
+        });
+    }
+
+    /**
+     * @brief 等待并完成其中一个分支
+     * @param[in] timeout_ms 超时时间(毫秒), -1表示不超时, 0表示只检查一次
+     * @return 完成的分支下标, 超时返回TIMEOUT
+     */
+    int select(int64_t timeout_ms = -1);
+
+    /**
+     * @brief 分支是否正常完成, 因通道关闭而返回时为false
+     */
+    bool isOk(int index) const { return m_cases[index].ok;}
+
+    /**
+     * @brief 清空所有分支以便复用
+     */
+    void clear() { m_cases.clear();}
+
+private:
+    enum Result {
+        NOT_READY,
+        DONE,
+        CLOSED
+    };
+
+    struct Case {
+        std::shared_ptr<ChannelBase> channel;
+        bool is_recv;
+        std::function<Result()> action;
+        bool ok = false;
+    };
+
+    int addCase(std::shared_ptr<ChannelBase> ch, bool is_recv, std::function<Result()> action) {
+        Case c;
+        c.channel = std::move(ch);
+        c.is_recv = is_recv;
+        c.action = std::move(action);
+        m_cases.push_back(std::move(c));
+        return (int)m_cases.size() - 1;
+    }
+
+    /**
+     * @brief 从随机位置开始尝试一轮
+     * @return 完成的分支下标, 都没有就绪返回TIMEOUT
+     */
+    int tryOnce();
+
+private:
+    std::vector<Case> m_cases;
+};
+
+/**
+ * @brief 创建一个定时器通道: ms毫秒后收到一个值(getElapseMs()), 随后关闭, 可与其他通道一起select
+ * @param[in] ms 定时时间(毫秒)
+ * @param[in] iom 运行定时器的调度器
+ */
+Channel<uint64_t>::ptr NewTimerChannel(uint64_t ms, IOManager* iom = IOManager::GetThis());
+
+}
+
+#endif
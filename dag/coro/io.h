@@ -0,0 +1,223 @@
+#ifndef __DAG_CORO_IO_H__
+#define __DAG_CORO_IO_H__
+
+#include <atomic>
+#include <errno.h>
+#include <memory>
+#include <sys/socket.h>
+#include "coro/task.h"
+#include "hook.h"
+#include "ioscheduler.h"
+
+namespace dag {
+
+/**
+ * @brief 等待fd上的读/写事件, 结果为0或错误码(ETIMEDOUT表示超时)
+ * @details 与hook中do_io的流程相同: 注册事件后挂起, 由事件回调恢复; 超时由条件定时器取消事件来唤醒.
+ *          协程在await_suspend返回之前就可能在其他工作线程上恢复, 因此注册事件之后不再访问awaiter
+ */
+class EventAwaiter {
+public:
+    EventAwaiter(int fd, IOManager::Event event, int64_t timeout_ms)
+        : m_fd(fd)
+        , m_event(event)
+        , m_timeoutMs(timeout_ms) {
+    }
+
+    bool await_ready() const noexcept { return false;}
+
+    bool await_suspend(std::coroutine_handle<> h) {
+        IOManager* iom = IOManager::GetThis();
+        if(!iom) {
+            m_error = EINVAL;
+            return false;
+        }
+        m_state = std::make_shared<State>();
+        std::shared_ptr<State> state = m_state;
+        int fd = m_fd;
+        IOManager::Event event = m_event;
+        if(m_timeoutMs >= 0) {
+            std::weak_ptr<State> weak(state);
+            m_timer = iom->addConditionTimer(m_timeoutMs, [weak, fd, event, iom]() {
+                std::shared_ptr<State> s = weak.lock();
+                if(!s) {
+                    return;
+                }
+                s->error = ETIMEDOUT;
+                iom->cancelEvent(fd, event);
+            }, weak);
+        }
+        std::shared_ptr<Timer> timer = m_timer;
+        if(iom->addEvent(fd, event, [h]() { h.resume(); })) {
+            if(timer) {
+                timer->cancel();
+            }
+            // 没有挂起, await_resume返回m_error
+            m_state.reset();
+            m_error = EINVAL;
+            return false;
+        }
+        // 定时器在addEvent之前触发时cancelEvent取消不到, 这里补一次
+        if(state->error.load() == ETIMEDOUT) {
+            iom->cancelEvent(fd, event);
+        }
+        return true;
+    }
+
+    int await_resume() {
+        if(m_timer) {
+            m_timer->cancel();
+        }
+        return m_state ? m_state->error.load() : m_error;
+    }
+
+private:
+    struct State {
+        std::atomic<int> error{0};
+    };
+
+    int m_fd;
+    IOManager::Event m_event;
+    int64_t m_timeoutMs;
+    int m_error = 0;
+    std::shared_ptr<State> m_state;
+    std::shared_ptr<Timer> m_timer;
+};
+
+/**
+ * @brief 等待fd可读/可写
+ * @param[in] timeout_ms 超时时间(毫秒), -1表示不超时
+ */
+inline EventAwaiter WaitEvent(int fd, IOManager::Event event, int64_t timeout_ms = -1) {
+    return EventAwaiter(fd, event, timeout_ms);
+}
+
+/**
+ * @brief 挂起当前协程ms毫秒, 由IOManager的定时器恢复
+ */
+inline auto SleepFor(uint64_t ms) {
+    struct Awaiter {
+        uint64_t ms;
+
+        bool await_ready() noexcept { return false;}
+
+        void await_suspend(std::coroutine_handle<> h) {
+            IOManager::GetThis()->addTimer(ms, [h]() { h.resume(); });
+        }
+
+        void await_resume() noexcept {}
+    };
+    return Awaiter{ms};
+}
+
+/**
+ * @brief 创建非阻塞socket, 供下面的协程IO函数使用
+ */
+inline int CoSocket(int domain, int type, int protocol = 0) {
+    return socket_f(domain, type | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol);
+}
+
+/**
+ * @brief 关闭fd, 先取消并触发其上等待的事件, 等待的协程恢复后会得到EBADF
+ */
+inline int CoClose(int fd) {
+    IOManager* iom = IOManager::GetThis();
+    if(iom) {
+        iom->cancelAll(fd);
+    }
+    return close_f(fd);
+}
+
+/**
+ * @brief 协程版read, fd需为非阻塞
+ * @param[in] timeout_ms 每次等待的超时时间(毫秒), -1表示不超时
+ * @return 同read, 超时返回-1且errno为ETIMEDOUT
+ */
+inline Task<ssize_t> AsyncRead(int fd, void* buf, size_t len, int64_t timeout_ms = -1) {
+    while(true) {
+        ssize_t n = read_f(fd, buf, len);
+        if(n >= 0 || (errno != EAGAIN && errno != EINTR)) {
+            co_return n;
+        }
+        if(errno == EINTR) {
+            continue;
+        }
+        int error = co_await WaitEvent(fd, IOManager::READ, timeout_ms);
+        if(error) {
+            errno = error;
+            co_return -1;
+        }
+    }
+}
+
+/**
+ * @brief 协程版write, fd需为非阻塞; 可能只写出一部分
+ * @return 同write, 超时返回-1且errno为ETIMEDOUT
+ */
+inline Task<ssize_t> AsyncWrite(int fd, const void* buf, size_t len, int64_t timeout_ms = -1) {
+    while(true) {
+        ssize_t n = write_f(fd, buf, len);
+        if(n >= 0 || (errno != EAGAIN && errno != EINTR)) {
+            co_return n;
+        }
+        if(errno == EINTR) {
+            continue;
+        }
+        int error = co_await WaitEvent(fd, IOManager::WRITE, timeout_ms);
+        if(error) {
+            errno = error;
+            co_return -1;
+        }
+    }
+}
+
+/**
+ * @brief 协程版accept, 返回的连接是非阻塞的
+ * @return 新连接的fd, 失败返回-1
+ */
+inline Task<int> AsyncAccept(int fd, sockaddr* addr = nullptr, socklen_t* addrlen = nullptr
+                             ,int64_t timeout_ms = -1) {
+    while(true) {
+        int client = ::accept4(fd, addr, addrlen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if(client >= 0 || (errno != EAGAIN && errno != EINTR)) {
+            co_return client;
+        }
+        if(errno == EINTR) {
+            continue;
+        }
+        int error = co_await WaitEvent(fd, IOManager::READ, timeout_ms);
+        if(error) {
+            errno = error;
+            co_return -1;
+        }
+    }
+}
+
+/**
+ * @brief 协程版connect, fd需为非阻塞
+ * @return 成功返回0, 失败返回-1并设置errno
+ */
+inline Task<int> AsyncConnect(int fd, const sockaddr* addr, socklen_t addrlen, int64_t timeout_ms = -1) {
+    if(connect_f(fd, addr, addrlen) == 0) {
+        co_return 0;
+    }
+    if(errno != EINPROGRESS) {
+        co_return -1;
+    }
+    int error = co_await WaitEvent(fd, IOManager::WRITE, timeout_ms);
+    if(!error) {
+        socklen_t len = sizeof(error);
+        if(getsockopt_f(fd, SOL_SOCKET, SO_ERROR, &error, &len) == -1) {
+            co_return -1;
+        }
+    }
+    if(error) {
+        errno = error;
+        co_return -1;
+    }
+    co_return 0;
+}
+
+}
+
+#endif
@@ -0,0 +1,234 @@
+#ifndef __DAG_CORO_TASK_H__
+#define __DAG_CORO_TASK_H__
+
+#if !defined(__cpp_impl_coroutine)
+#error "dag/coro requires C++20 coroutines, compile with -std=c++20"
+#endif
+
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <optional>
+#include <utility>
+#include "ioscheduler.h"
+
+namespace dag {
+
+template <class T = void>
+class Task;
+
+namespace detail {
+
+/**
+ * @brief Task的promise公共部分: 惰性启动, 结束时对称转移回等待者
+ */
+struct TaskPromiseBase {
+    struct FinalAwaiter {
+        bool await_ready() noexcept { return false;}
+
+        template <class Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept {
+            std::coroutine_handle<> continuation = h.promise().continuation;
+            return continuation ? continuation : std::noop_coroutine();
+        }
+
+        void await_resume() noexcept {}
+    };
+
+    std::suspend_always initial_suspend() noexcept { return {};}
+
+    FinalAwaiter final_suspend() noexcept { return {};}
+
+    void unhandled_exception() { exception = std::current_exception();}
+
+    // co_await本Task的协程, 本Task结束时恢复它
+    std::coroutine_handle<> continuation;
+    std::exception_ptr exception;
+};
+
+template <class T>
+struct TaskPromise : public TaskPromiseBase {
+    Task<T> get_return_object() noexcept;
+
+    template <class U>
+    void return_value(U&& v) { value.emplace(std::forward<U>(v));}
+
+    T result() {
+        if(exception) {
+            std::rethrow_exception(exception);
+        }
+        return std::move(*value);
+    }
+
+    std::optional<T> value;
+};
+
+template <>
+struct TaskPromise<void> : public TaskPromiseBase {
+    Task<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+
+    void result() {
+        if(exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+};
+
+}
+
+/**
+ * @brief 无栈协程任务
+ * @details 惰性启动: 创建时不执行, 被co_await时才开始运行, 结束后直接恢复co_await它的协程;
+ *          协程帧只保存跨越挂起点的局部变量, 不需要独立的协程栈;
+ *          挂起后由IOManager的事件或定时器回调恢复, 与Fiber共用同一个IOManager
+ * @tparam T 返回值类型
+ */
+template <class T>
+class Task {
+public:
+    using promise_type = detail::TaskPromise<T>;
+    using handle_type = std::coroutine_handle<promise_type>;
+
+    Task() = default;
+
+    explicit Task(handle_type h) : m_handle(h) {}
+
+    Task(Task&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+
+    Task& operator=(Task&& other) noexcept {
+        if(this != &other) {
+            if(m_handle) {
+                m_handle.destroy();
+            }
+            m_handle = std::exchange(other.m_handle, nullptr);
+        }
+        return *this;
+    }
+
+    Task(const Task&) = delete;
+    Task& operator=(const Task&) = delete;
+
+    ~Task() {
+        if(m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    bool valid() const { return (bool)m_handle;}
+
+    auto operator co_await() && noexcept {
+        struct Awaiter {
+            handle_type handle;
+
+            bool await_ready() noexcept { return !handle || handle.done();}
+
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<> caller) noexcept {
+                handle.promise().continuation = caller;
+                return handle;
+            }
+
+            T await_resume() { return handle.promise().result();}
+        };
+        return Awaiter{m_handle};
+    }
+
+private:
+    handle_type m_handle;
+};
+
+namespace detail {
+
+template <class T>
+inline Task<T> TaskPromise<T>::get_return_object() noexcept {
+    return Task<T>(std::coroutine_handle<TaskPromise<T>>::from_promise(*this));
+}
+
+inline Task<void> TaskPromise<void>::get_return_object() noexcept {
+    return Task<void>(std::coroutine_handle<TaskPromise<void>>::from_promise(*this));
+}
+
+/**
+ * @brief 分离运行的协程, 结束时自动销毁协程帧
+ */
+struct DetachedTask {
+    struct promise_type {
+        DetachedTask get_return_object() noexcept {
+            return DetachedTask{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {};}
+
+        std::suspend_never final_suspend() noexcept { return {};}
+
+        void return_void() noexcept {}
+
+        // 与std::thread一致, 分离任务中未捕获的异常终止进程
+        void unhandled_exception() noexcept { std::terminate();}
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+inline DetachedTask RunDetached(Task<void> task) {
+    co_await std::move(task);
+}
+
+template <class T>
+inline Task<void> FulfillPromise(Task<T> task, std::promise<T>& promise) {
+    try {
+        if constexpr(std::is_void_v<T>) {
+            co_await std::move(task);
+            promise.set_value();
+        } else {
+            promise.set_value(co_await std::move(task));
+        }
+    } catch(...) {
+        promise.set_exception(std::current_exception());
+    }
+}
+
+}
+
+/**
+ * @brief 在调度器上分离运行一个协程任务
+ * @param[in] task 任务, 结束后协程帧自动释放
+ * @param[in] scheduler 调度器, 默认为当前线程所在的调度器
+ */
+inline void CoSpawn(Task<void> task, Scheduler* scheduler = Scheduler::GetThis()) {
+    std::coroutine_handle<> h = detail::RunDetached(std::move(task)).handle;
+    scheduler->schedulerLock([h]() { h.resume(); });
+}
+
+/**
+ * @brief 在调度器上运行协程任务, 阻塞当前线程直到完成, 返回其结果或重新抛出其异常
+ * @attention 不能在该调度器的工作线程中调用, 否则可能死锁
+ */
+template <class T>
+inline T BlockOn(Task<T> task, Scheduler* scheduler) {
+    std::promise<T> promise;
+    std::future<T> future = promise.get_future();
+    CoSpawn(detail::FulfillPromise(std::move(task), promise), scheduler);
+    return future.get();
+}
+
+/**
+ * @brief 让出执行权, 由当前调度器重新调度后继续
+ */
+inline auto CoYield() {
+    struct Awaiter {
+        bool await_ready() noexcept { return false;}
+
+        void await_suspend(std::coroutine_handle<> h) {
+            Scheduler::GetThis()->schedulerLock([h]() { h.resume(); });
+        }
+
+        void await_resume() noexcept {}
+    };
+    return Awaiter{};
+}
+
+}
+
+#endif
@@ -1,7 +1,11 @@
  #include "logger.h"
 #include "fiber.h"
+#include "stack_profiler.h"
+#include "utils/util.h"
+#include <algorithm>
 #include <atomic>
 #include <iostream>
+#include <string.h>
 
 #include <assert.h>
 
@@ -19,6 +23,74 @@ static thread_local Fiber* t_scheduler_fiber = nullptr;
 static std::atomic<uint64_t> s_fiber_id{0};
 // 协程计数器
 static std::atomic<uint64_t> s_fiber_count{0};  
+// 各档位的栈大小
+static std::atomic<size_t> s_stack_class_size[Fiber::STACK_CLASS_COUNT] = {
+    {128000}, {32 * 1024}, {64 * 1024}, {1024 * 1024}, {128000}
+};
+// 每个线程的共享栈个数
+static std::atomic<size_t> s_shared_stack_count{4};
+
+/**
+ * @brief 共享栈, 同一线程上的共享栈协程轮流使用
+ */
+struct SharedStack {
+    char* mem = nullptr;
+    size_t size = 0;
+    // 栈上保存着现场的协程, 其他协程要使用时先把它的栈拷走
+    Fiber* occupant = nullptr;
+};
+
+/**
+ * @brief 线程的共享栈, 第一次使用时按当时的个数和大小创建, 线程退出时释放
+ */
+struct SharedStackPool {
+    std::vector<SharedStack> stacks;
+    size_t next = 0;
+    // 绑定到本线程、尚未结束的共享栈协程数
+    size_t pinned = 0;
+
+    SharedStack* acquire()
+    {
+        if(stacks.empty())
+        {
+            size_t count = std::max<size_t>(s_shared_stack_count, 1);
+            size_t size = s_stack_class_size[Fiber::STACK_SHARED];
+            stacks.resize(count);
+            for(auto& i : stacks)
+            {
+                i.mem = (char*)malloc(size);
+                i.size = size;
+            }
+        }
+        SharedStack* s = &stacks[next];
+        next = (next + 1) % stacks.size();
+        return s;
+    }
+
+    ~SharedStackPool()
+    {
+        for(auto& i : stacks)
+        {
+            free(i.mem);
+        }
+    }
+};
+
+static thread_local SharedStackPool t_shared_stacks;
+
+/**
+ * @brief 挂起协程上下文中保存的栈指针, 其下方的内容已经无用
+ */
+static char* SavedStackPointer(const ucontext_t& ctx)
+{
+#if defined(__x86_64__)
+    return (char*)ctx.uc_mcontext.gregs[REG_RSP];
+#elif defined(__aarch64__)
+    return (char*)ctx.uc_mcontext.sp;
+#else
+#error "shared stack fibers need the saved stack pointer of this architecture"
+#endif
+}
 
 
 /**
@@ -92,15 +164,23 @@ Fiber::Fiber() {
 * @param[] cb 协程入口函数
 * @param[] stacksize 栈大小，默认为128k
 */
-Fiber::Fiber(std::function<void()> cb, size_t stacksize,bool run_in_scheduler)
+Fiber::Fiber(std::function<void()> cb, size_t stacksize,bool run_in_scheduler, bool shared_stack)
     : m_cb(cb)
     , m_runInScheduler(run_in_scheduler)
+    , m_useSharedStack(shared_stack)
 {
     m_state = READY;
 
-    //分配协程栈空间
-    m_stacksize = stacksize ? stacksize : 128000;
-    m_stack = malloc(m_stacksize);
+    //分配协程栈空间, 共享栈协程在第一次resume时才分配共享栈
+    if(m_useSharedStack)
+    {
+        m_stacksize = s_stack_class_size[STACK_SHARED];
+    }
+    else
+    {
+        m_stacksize = stacksize ? stacksize : 128000;
+        m_stack = malloc(m_stacksize);
+    }
 
     if(getcontext(&m_ctx))
     {
@@ -109,9 +189,18 @@ Fiber::Fiber(std::function<void()> cb, size_t stacksize,bool run_in_scheduler)
     }
 
     m_ctx.uc_link = nullptr;
-    m_ctx.uc_stack.ss_sp = m_stack;
-    m_ctx.uc_stack.ss_size = m_stacksize;
-    makecontext(&m_ctx,&Fiber::MainFunc,0);
+    paintStack();
+    if(m_useSharedStack)
+    {
+        // makecontext会写栈顶, 要等占用共享栈、保存完上一个占用者之后再做
+        m_needMakeContext = true;
+    }
+    else
+    {
+        m_ctx.uc_stack.ss_sp = m_stack;
+        m_ctx.uc_stack.ss_size = m_stacksize;
+        makecontext(&m_ctx,&Fiber::MainFunc,0);
+    }
 
     m_id = s_fiber_id++;
     ++s_fiber_count;
@@ -125,11 +214,13 @@ Fiber::Fiber(std::function<void()> cb, size_t stacksize,bool run_in_scheduler)
 */
 Fiber::~Fiber()
 {
+    clearLocals();
     --s_fiber_count;
     if(m_stack)
     {
         free(m_stack);
     }
+    free(m_savedStack);
      #if DEBUG
     DAG_LOG_DEBUG(g_logger) << "Fiber::~Fiber id=" << m_id
                             << " total=" << s_fiber_count;
@@ -141,10 +232,13 @@ Fiber::~Fiber()
 */
 void Fiber::reset(std::function<void()> cb)
 {
-    assert(m_stack != nullptr && m_state == TERM);
+    assert((m_stack != nullptr || m_useSharedStack) && m_state == TERM);
 
+    clearLocals();
     m_state = READY;
     m_cb = cb;
+    m_deadline = 0;
+    m_siteName = nullptr;
 
     if(getcontext(&m_ctx))
     {
@@ -153,6 +247,15 @@ void Fiber::reset(std::function<void()> cb)
     }
 
     m_ctx.uc_link = nullptr;
+    paintStack();
+    if(m_useSharedStack)
+    {
+        // 结束时已经让出了共享栈, 重新运行时可以在任意线程上重新分配
+        m_sharedStack = nullptr;
+        m_pinnedThread = -1;
+        m_needMakeContext = true;
+        return;
+    }
     m_ctx.uc_stack.ss_sp = m_stack;
     m_ctx.uc_stack.ss_size = m_stacksize;
     makecontext(&m_ctx, &Fiber::MainFunc, 0);
@@ -166,6 +269,11 @@ void Fiber::resume()
 {
     assert(m_state==READY);
 
+    if(m_useSharedStack)
+    {
+        switchInSharedStack();
+    }
+
     m_state = RUNNING;
 
     if(m_runInScheduler)
@@ -233,7 +341,24 @@ void Fiber::MainFunc()
 
     curr->m_cb();
     curr->m_cb = nullptr;
+    // 在协程自己的栈上销毁局部变量, 析构函数里仍可以使用FiberLocal
+    curr->clearLocals();
+    if(curr->m_painted)
+    {
+        curr->m_stackUsed = StackProfiler::Measure(curr->m_stack, curr->m_stacksize);
+        StackProfiler::Record(curr->m_site, curr->m_siteName, curr->m_stacksize, curr->m_stackUsed);
+    }
     curr->m_state = TERM;
+    if(curr->m_sharedStack)
+    {
+        // 结束后栈内容不再需要, 下一个使用者不必保存
+        curr->m_sharedStack->occupant = nullptr;
+        --t_shared_stacks.pinned;
+        free(curr->m_savedStack);
+        curr->m_savedStack = nullptr;
+        curr->m_savedSize = 0;
+        curr->m_savedCapacity = 0;
+    }
 
     //运行完毕 -> 让出执行权力
     auto raw_ptr = curr.get();
@@ -241,6 +366,169 @@ void Fiber::MainFunc()
     raw_ptr->yield();
 }
 
+size_t Fiber::GetStackClassSize(StackClass stack_class)
+{
+    if(stack_class < 0 || stack_class >= STACK_CLASS_COUNT)
+    {
+        stack_class = STACK_DEFAULT;
+    }
+    return s_stack_class_size[stack_class];
+}
+
+void Fiber::SetStackClassSize(StackClass stack_class, size_t size)
+{
+    if(stack_class >= 0 && stack_class < STACK_CLASS_COUNT && size > 0)
+    {
+        s_stack_class_size[stack_class] = size;
+    }
+}
+
+void Fiber::paintStack()
+{
+    m_site = m_cb ? &m_cb.target_type() : nullptr;
+    // 共享栈上还有其他协程的现场, 不能填充
+    m_painted = m_stack && StackProfiler::IsEnabled();
+    m_stackUsed = 0;
+    if(m_painted)
+    {
+        StackProfiler::Paint(m_stack, m_stacksize);
+    }
+}
+
+bool Fiber::isDeadlineExpired() const
+{
+    return m_deadline && getElapseMs() >= m_deadline;
+}
+
+void Fiber::SetSharedStackCount(size_t count)
+{
+    if(count > 0)
+    {
+        s_shared_stack_count = count;
+    }
+}
+
+size_t Fiber::GetSharedStackCount()
+{
+    return s_shared_stack_count;
+}
+
+size_t Fiber::GetPinnedFiberCount()
+{
+    return t_shared_stacks.pinned;
+}
+
+void Fiber::switchInSharedStack()
+{
+    if(!m_sharedStack)
+    {
+        m_sharedStack = t_shared_stacks.acquire();
+        m_pinnedThread = (int)getThreadId();
+        ++t_shared_stacks.pinned;
+    }
+    assert(m_pinnedThread == (int)getThreadId());
+
+    SharedStack* s = m_sharedStack;
+    if(s->occupant == this)
+    {
+        return;
+    }
+    // 占用者正在运行说明是在共享栈协程里resume另一个共享栈协程, 会覆盖正在使用的栈
+    assert(!s->occupant || s->occupant->m_state != RUNNING);
+    if(s->occupant)
+    {
+        s->occupant->saveSharedStack();
+    }
+    s->occupant = this;
+
+    if(m_needMakeContext)
+    {
+        m_needMakeContext = false;
+        m_ctx.uc_stack.ss_sp = s->mem;
+        m_ctx.uc_stack.ss_size = s->size;
+        makecontext(&m_ctx, &Fiber::MainFunc, 0);
+    }
+    else if(m_savedSize)
+    {
+        memcpy(s->mem + s->size - m_savedSize, m_savedStack, m_savedSize);
+    }
+}
+
+void Fiber::saveSharedStack()
+{
+    char* top = m_sharedStack->mem + m_sharedStack->size;
+    char* sp = SavedStackPointer(m_ctx);
+    if(sp < m_sharedStack->mem || sp > top)
+    {
+        sp = m_sharedStack->mem;
+    }
+    size_t used = top - sp;
+    // 缓冲区按需分配; 曾经很深的栈变浅后缩小, 保持空闲协程的内存与实际用量一致
+    if(used > m_savedCapacity || used < m_savedCapacity / 4)
+    {
+        free(m_savedStack);
+        m_savedStack = (char*)malloc(used);
+        m_savedCapacity = used;
+    }
+    memcpy(m_savedStack, sp, used);
+    m_savedSize = used;
+}
+
+/**
+* @brief 返回当前协程的裸指针
+*/
+Fiber* Fiber::GetThisRaw()
+{
+    return t_fiber;
+}
+
+void Fiber::setLocal(size_t index, uint64_t key, void* value, void (*destroy)(void*))
+{
+    if(index >= m_locals.size())
+    {
+        m_locals.resize(index + 1);
+    }
+    LocalSlot old = m_locals[index];
+    m_locals[index].key = key;
+    m_locals[index].value = value;
+    m_locals[index].destroy = destroy;
+    if(old.value)
+    {
+        old.destroy(old.value);
+    }
+}
+
+void Fiber::eraseLocal(size_t index, uint64_t key)
+{
+    if(index >= m_locals.size() || m_locals[index].key != key || !m_locals[index].value)
+    {
+        return;
+    }
+    LocalSlot old = m_locals[index];
+    m_locals[index] = LocalSlot();
+    old.destroy(old.value);
+}
+
+/**
+* @brief 销毁协程局部变量
+* @details 析构函数可能又设置了新的局部变量, 最多重复几轮, 与pthread key的析构规则一致
+*/
+void Fiber::clearLocals()
+{
+    for(int round = 0; round < 4 && !m_locals.empty(); ++round)
+    {
+        std::vector<LocalSlot> locals;
+        locals.swap(m_locals);
+        for(auto& i : locals)
+        {
+            if(i.value)
+            {
+                i.destroy(i.value);
+            }
+        }
+    }
+}
+
 /**
 * @brief 设置调度协程(默认为主协程)
 */
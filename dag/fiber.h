@@ -1,13 +1,18 @@
 #ifndef _COROUTINE_H_
 #define _COROUTINE_H_
 
+#include <atomic>
 #include <memory>
 #include <functional>
 #include <mutex>
+#include <typeinfo>
+#include <vector>
 #include <ucontext.h>
 
 namespace dag{
 
+struct SharedStack;
+
 class Fiber : public std::enable_shared_from_this<Fiber>{
 public:
     typedef std::shared_ptr<Fiber> ptr;
@@ -19,12 +24,51 @@ public:
         TERM
     };
 
+    /**
+     * @brief 栈大小档位, 调度回调任务时按档位选择协程栈大小, 各档位大小可用SetStackClassSize调整
+    */
+    enum StackClass {
+        // 128000字节, 与不指定栈大小时相同
+        STACK_DEFAULT = 0,
+        // 32KB, 适合大量只做简单收发的空闲连接
+        STACK_SMALL,
+        // 64KB
+        STACK_MEDIUM,
+        // 1MB, 适合递归较深或栈上有大缓冲区的任务
+        STACK_LARGE,
+        // 共享栈: 运行在线程的共享栈上, 让出后只保留实际用到的部分, 档位大小即共享栈大小(默认128000字节)
+        STACK_SHARED,
+        STACK_CLASS_COUNT
+    };
+
+    /**
+     * @brief 调度优先级, 调度器为每个优先级维护单独的任务队列, 高优先级先执行
+    */
+    enum Priority {
+        // 延迟敏感的任务, 如健康检查、控制面RPC
+        PRIORITY_HIGH = 0,
+        PRIORITY_NORMAL,
+        // 批量传输等吞吐型任务
+        PRIORITY_BACKGROUND,
+        PRIORITY_COUNT
+    };
+
 private:
     // 仅由GetThis()调用 -> 创建主协程
     Fiber();
 
 public:
-    Fiber(std::function<void()> cv, size_t stacksize = 0,bool run_in_scheduler = true);
+    /**
+     * @brief 构造函数
+     * @param[in] stacksize 独立栈大小, 0表示128000字节; 共享栈协程忽略此参数
+     * @param[in] shared_stack 是否运行在共享栈上
+     * @details 共享栈协程第一次resume时从当前线程的共享栈中轮流分配一个, 之后绑定在该线程上,
+     *          同一共享栈的另一个协程要运行时, 才把本协程已用的栈拷贝到按需分配的堆缓冲区, 恢复时再拷贝回来;
+     *          空闲时每个协程只占用实际用到的栈, 代价是切换时的拷贝
+     * @attention 共享栈协程不能在另一个共享栈协程中resume; 栈上变量的地址不能交给同线程的其他协程使用,
+     *            因为本协程让出后该地址上可能是别的协程的栈
+     */
+    Fiber(std::function<void()> cv, size_t stacksize = 0,bool run_in_scheduler = true, bool shared_stack = false);
 
     ~Fiber();
 
@@ -38,6 +82,93 @@ public:
 
     State getState() const {return m_state;}
 
+    /**
+     * @brief 是否是由调度器调度的协程(主协程和use_caller的调度协程返回false)
+    */
+    bool isRunInScheduler() const {return m_runInScheduler;}
+
+    /**
+     * @brief 协程栈大小, 主协程返回0
+    */
+    size_t getStackSize() const {return m_stacksize;}
+
+    /**
+     * @brief 最近一次运行结束时测得的栈使用高水位(字节), 未开启StackProfiler时为0
+    */
+    size_t getStackUsed() const {return m_stackUsed;}
+
+    /**
+     * @brief 设置StackProfiler统计用的调用点名称, 为空时按入口函数的类型统计; reset时清空
+     * @param[in] site 须为字符串字面量等静态存储期的字符串, 统计中只保存指针
+    */
+    void setSite(const char* site) {m_siteName = site;}
+
+    const char* getSite() const {return m_siteName;}
+
+    /**
+     * @brief 调度优先级, 协程被重新调度(如IO事件就绪、定时器到期、锁被释放)时进入对应的队列
+    */
+    Priority getPriority() const {return m_priority;}
+
+    /**
+     * @brief 设置调度优先级, 在协程内调用时从下一次被调度起生效
+    */
+    void setPriority(Priority priority) {m_priority = priority;}
+
+    /**
+     * @brief 截止时间(与getElapseMs()同一时钟的毫秒数), 0表示没有
+     * @details 设置后协程在同一优先级内按截止时间先后调度(EDF); 过了截止时间, 协程中hook的socket IO
+     *          立即以ETIMEDOUT失败, 等待中的IO最多等到截止时间; reset时清除
+    */
+    uint64_t getDeadline() const {return m_deadline;}
+
+    void setDeadline(uint64_t deadline_ms) {m_deadline = deadline_ms;}
+
+    /**
+     * @brief 是否设置了截止时间且已经过期
+    */
+    bool isDeadlineExpired() const;
+
+    /**
+     * @brief 是否运行在共享栈上
+    */
+    bool isSharedStack() const {return m_useSharedStack;}
+
+    /**
+     * @brief 共享栈协程绑定的线程id, 还未运行过或不是共享栈协程时返回-1
+     * @details 调度器把协程任务发往这个线程, 保证协程恢复到原来的栈地址上
+    */
+    int getPinnedThread() const {return m_pinnedThread.load(std::memory_order_relaxed);}
+
+    /**
+     * @brief 共享栈协程让出共享栈时保存在堆上的栈大小(字节)
+    */
+    size_t getSavedStackSize() const {return m_savedSize;}
+
+    /**
+     * @brief 读取协程局部变量槽位(供FiberLocal使用)
+     * @param[in] index 槽位下标
+     * @param[in] key 槽位所属FiberLocal的唯一key, 与槽位中记录的不一致说明是已销毁的FiberLocal留下的旧值
+     * @return 未设置时返回nullptr
+    */
+    void* getLocal(size_t index, uint64_t key) const {
+        if(index < m_locals.size() && m_locals[index].key == key) {
+            return m_locals[index].value;
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief 设置协程局部变量槽位, 槽位中的旧值会先被销毁
+     * @param[in] destroy 协程结束或reset时用于销毁value
+    */
+    void setLocal(size_t index, uint64_t key, void* value, void (*destroy)(void*));
+
+    /**
+     * @brief 销毁并清空一个槽位, key不一致时不处理
+    */
+    void eraseLocal(size_t index, uint64_t key);
+
 public:
     //设置当前正在运行的协程,即设置线程局部变量t_fiber的值
     static void SetThis(Fiber* f);
@@ -70,7 +201,62 @@ public:
      * @brief 设置调度协程(默认为主协程)
     */
     static void SetSchedulerFiber(Fiber* f);
+
+    /**
+     * @brief 返回当前线程正在执行的协程的裸指针, 不增加引用计数; 线程还没有协程时返回nullptr
+    */
+    static Fiber* GetThisRaw();
+
+    /**
+     * @brief 档位对应的栈大小
+    */
+    static size_t GetStackClassSize(StackClass stack_class);
+
+    /**
+     * @brief 调整档位对应的栈大小, 只影响之后创建的协程
+    */
+    static void SetStackClassSize(StackClass stack_class, size_t size);
+
+    /**
+     * @brief 每个线程的共享栈个数, 默认4
+     * @details 个数越多, 交替运行的共享栈协程越少需要拷贝栈, 但每个线程多占一份共享栈; 只影响之后第一次使用共享栈的线程
+    */
+    static void SetSharedStackCount(size_t count);
+
+    static size_t GetSharedStackCount();
+
+    /**
+     * @brief 当前线程上已绑定、尚未结束的共享栈协程数
+     * @details 这些协程的栈现场保存在本线程的共享栈上, 只能回到本线程恢复, 线程不能在它们结束前退出
+    */
+    static size_t GetPinnedFiberCount();
 private:
+    /**
+     * @brief 共享栈协程resume前占用共享栈: 保存上一个占用者的栈, 恢复自己的栈
+    */
+    void switchInSharedStack();
+
+    /**
+     * @brief 把已用的共享栈拷贝到堆缓冲区
+    */
+    void saveSharedStack();
+
+    /**
+     * @brief 开启了StackProfiler时用特征值填充栈, 结束时据此测量高水位
+    */
+    void paintStack();
+    /**
+     * @brief 销毁全部协程局部变量, 协程结束、reset和析构时调用
+    */
+    void clearLocals();
+
+private:
+    struct LocalSlot {
+        uint64_t key = 0;
+        void* value = nullptr;
+        void (*destroy)(void*) = nullptr;
+    };
+
     // 协程id 
     uint64_t m_id        = 0;
     // 协程栈大小
@@ -84,7 +270,33 @@ private:
     // 协程入口函数
     std::function<void()> m_cb;
     // 本协程是否参与调度器调度
-    bool m_runInScheduler;
+    bool m_runInScheduler = false;
+    // 调度优先级
+    Priority m_priority = PRIORITY_NORMAL;
+    // 截止时间(毫秒), 0表示没有
+    uint64_t m_deadline = 0;
+    // 协程局部变量, 下标由FiberLocal分配
+    std::vector<LocalSlot> m_locals;
+    // 入口函数的类型, 作为StackProfiler统计的调用点(每个lambda表达式是不同的类型)
+    const std::type_info* m_site = nullptr;
+    // 显式指定的调用点名称, 优先于m_site; 绑定同一签名不同函数的bind表达式类型相同, 需要靠它区分
+    const char* m_siteName = nullptr;
+    // 栈是否已填充特征值
+    bool m_painted = false;
+    // 栈使用高水位
+    uint32_t m_stackUsed = 0;
+    // 是否运行在共享栈上
+    bool m_useSharedStack = false;
+    // 下次resume前是否需要在共享栈上makecontext(新建或reset后还没运行)
+    bool m_needMakeContext = false;
+    // 分配到的共享栈
+    SharedStack* m_sharedStack = nullptr;
+    // 让出共享栈时保存的栈内容
+    char* m_savedStack = nullptr;
+    size_t m_savedSize = 0;
+    size_t m_savedCapacity = 0;
+    // 共享栈协程绑定的线程
+    std::atomic<int> m_pinnedThread{-1};
 public:
     std::mutex m_mutex;
 };
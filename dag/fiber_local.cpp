@@ -0,0 +1,52 @@
+#include "fiber_local.h"
+#include <atomic>
+#include <mutex>
+#include <vector>
+
+namespace dag {
+
+namespace {
+
+struct SlotRegistry {
+    std::mutex mutex;
+    // 已释放可复用的槽位下标
+    std::vector<size_t> free_slots;
+    size_t count = 0;
+};
+
+/**
+ * @brief 不析构的全局槽位表, 全局FiberLocal在其他编译单元中析构时仍可使用
+ */
+SlotRegistry& GetSlotRegistry() {
+    static SlotRegistry* s_registry = new SlotRegistry;
+    return *s_registry;
+}
+
+}
+
+static std::atomic<uint64_t> s_slot_key{1};
+
+FiberLocalBase::FiberLocalBase()
+    : m_key(s_slot_key++) {
+    SlotRegistry& registry = GetSlotRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    if(!registry.free_slots.empty()) {
+        m_index = registry.free_slots.back();
+        registry.free_slots.pop_back();
+    } else {
+        m_index = registry.count++;
+    }
+}
+
+FiberLocalBase::~FiberLocalBase() {
+    SlotRegistry& registry = GetSlotRegistry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.free_slots.push_back(m_index);
+}
+
+void FiberLocalBase::store(void* value, void (*destroy)(void*)) {
+    // 线程还没有协程时创建主协程
+    Fiber::GetThis()->setLocal(m_index, m_key, value, destroy);
+}
+
+}
@@ -0,0 +1,104 @@
+#ifndef __DAG_FIBER_LOCAL_H__
+#define __DAG_FIBER_LOCAL_H__
+
+#include <memory>
+#include "fiber.h"
+#include "utils/noncopyable.h"
+
+namespace dag {
+
+/**
+ * @brief FiberLocal中与类型无关的部分: 槽位下标和key的分配
+ * @details 下标在FiberLocal销毁后复用, key全局唯一且不复用, 用来区分同一下标上新旧FiberLocal的值
+ */
+class FiberLocalBase : public NonCopyable {
+public:
+    FiberLocalBase();
+    ~FiberLocalBase();
+
+protected:
+    /**
+     * @brief 在当前协程(没有协程时为线程的主协程)上保存value
+     */
+    void store(void* value, void (*destroy)(void*));
+
+protected:
+    size_t m_index;
+    uint64_t m_key;
+};
+
+/**
+ * @brief 协程局部变量, 协程间隔离的thread_local
+ * @details 值保存在协程对象自己的槽位数组中, 访问只需读当前协程指针和槽位, 没有查表和加锁;
+ *          每个协程第一次访问时构造, 协程结束、reset或析构时销毁;
+ *          不在协程中的线程访问的是该线程主协程上的值, 相当于thread_local
+ * @attention FiberLocal对象销毁后, 各协程中已构造的值会在协程结束时才被销毁
+ * @tparam T 值类型
+ */
+template <class T>
+class FiberLocal : public FiberLocalBase {
+public:
+    FiberLocal() {}
+
+    /**
+     * @brief 每个协程的初始值为init的拷贝
+     */
+    explicit FiberLocal(const T& init)
+        : m_init(new T(init)) {
+    }
+
+    /**
+     * @brief 当前协程的值, 第一次访问时构造
+     */
+    T& get() {
+        Fiber* fiber = Fiber::GetThisRaw();
+        if(fiber) {
+            void* value = fiber->getLocal(m_index, m_key);
+            if(value) {
+                return *static_cast<T*>(value);
+            }
+        }
+        T* value = m_init ? new T(*m_init) : new T();
+        store(value, &Destroy);
+        return *value;
+    }
+
+    T& operator*() { return get();}
+
+    T* operator->() { return &get();}
+
+    FiberLocal& operator=(const T& v) {
+        get() = v;
+        return *this;
+    }
+
+    /**
+     * @brief 当前协程是否已经构造了值
+     */
+    bool has() const {
+        Fiber* fiber = Fiber::GetThisRaw();
+        return fiber && fiber->getLocal(m_index, m_key);
+    }
+
+    /**
+     * @brief 销毁当前协程的值, 下次访问时重新构造
+     */
+    void reset() {
+        Fiber* fiber = Fiber::GetThisRaw();
+        if(fiber) {
+            fiber->eraseLocal(m_index, m_key);
+        }
+    }
+
+private:
+    static void Destroy(void* value) {
+        delete static_cast<T*>(value);
+    }
+
+private:
+    std::unique_ptr<T> m_init;
+};
+
+}
+
+#endif
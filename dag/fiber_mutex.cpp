@@ -0,0 +1,176 @@
+#include "fiber_mutex.h"
+
+namespace dag {
+
+void FiberWaitQueue::wait(std::unique_lock<SpinLock>& guard) {
+    Waiter waiter;
+    Fiber::ptr self = Fiber::GetThis();
+    bool in_fiber = Scheduler::GetThis() && self->isRunInScheduler();
+    if(in_fiber) {
+        waiter.fiber = self;
+        waiter.scheduler = Scheduler::GetThis();
+    } else {
+        waiter.sem = std::make_shared<Semaphore>();
+    }
+    std::shared_ptr<Semaphore> sem = waiter.sem;
+    m_waiters.push_back(std::move(waiter));
+    guard.unlock();
+
+    if(in_fiber) {
+        // 唤醒方可能在yield之前就重新调度了本协程, 调度器resume前会等本协程的m_mutex, 不会重复执行
+        self.reset();
+        Fiber::GetThis()->yield();
+    } else {
+        sem->wait();
+    }
+}
+
+bool FiberWaitQueue::notifyOne() {
+    if(m_waiters.empty()) {
+        return false;
+    }
+    Waiter waiter = std::move(m_waiters.front());
+    m_waiters.pop_front();
+    Wake(waiter);
+    return true;
+}
+
+size_t FiberWaitQueue::notifyAll() {
+    size_t n = m_waiters.size();
+    while(!m_waiters.empty()) {
+        Waiter waiter = std::move(m_waiters.front());
+        m_waiters.pop_front();
+        Wake(waiter);
+    }
+    return n;
+}
+
+void FiberWaitQueue::Wake(Waiter& waiter) {
+    if(waiter.fiber) {
+        waiter.scheduler->schedulerLock(waiter.fiber);
+    } else {
+        waiter.sem->signal();
+    }
+}
+
+void FiberMutex::lockSlow() {
+    std::unique_lock<SpinLock> guard(m_guard);
+    while(true) {
+        // 标记为有等待者后再入队, 持锁者解锁时看到CONTENDED就会来唤醒
+        if(m_state.exchange(CONTENDED, std::memory_order_acquire) == UNLOCKED) {
+            return;
+        }
+        m_waiters.wait(guard);
+        guard.lock();
+    }
+}
+
+void FiberMutex::unlockSlow() {
+    std::unique_lock<SpinLock> guard(m_guard);
+    m_waiters.notifyOne();
+}
+
+void FiberCondVar::wait(FiberMutex& mutex) {
+    // 持有guard期间释放mutex并入队, notify要拿到guard才能出队, 不会错过这之间的通知
+    std::unique_lock<SpinLock> guard(m_guard);
+    mutex.unlock();
+    m_waiters.wait(guard);
+    mutex.lock();
+}
+
+void FiberCondVar::notify_one() {
+    std::unique_lock<SpinLock> guard(m_guard);
+    m_waiters.notifyOne();
+}
+
+void FiberCondVar::notify_all() {
+    std::unique_lock<SpinLock> guard(m_guard);
+    m_waiters.notifyAll();
+}
+
+bool FiberSemaphore::tryWait() {
+    int64_t c = m_count.load(std::memory_order_relaxed);
+    while(c > 0) {
+        if(m_count.compare_exchange_weak(c, c - 1, std::memory_order_acquire)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void FiberSemaphore::waitSlow() {
+    std::unique_lock<SpinLock> guard(m_guard);
+    // post先把计数加回来了, 但发现队列为空, 把唤醒留在了m_wakeups里
+    if(m_wakeups > 0) {
+        --m_wakeups;
+        return;
+    }
+    m_waiters.wait(guard);
+}
+
+void FiberSemaphore::postSlow() {
+    std::unique_lock<SpinLock> guard(m_guard);
+    if(!m_waiters.notifyOne()) {
+        ++m_wakeups;
+    }
+}
+
+bool FiberRWLock::try_lock_shared() {
+    int s = m_state.load(std::memory_order_relaxed);
+    while(s >= 0 && m_waiting.load(std::memory_order_relaxed) == 0) {
+        if(m_state.compare_exchange_weak(s, s + 1, std::memory_order_acquire)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool FiberRWLock::try_lock() {
+    int expected = 0;
+    return m_state.compare_exchange_strong(expected, WRITER, std::memory_order_acquire);
+}
+
+void FiberRWLock::lockSharedSlow() {
+    std::unique_lock<SpinLock> guard(m_guard);
+    while(true) {
+        // 先登记等待再检查状态, 与释放方先改状态再检查m_waiting配对
+        ++m_waiting;
+        int s = m_state.load();
+        while(s >= 0 && m_writers == 0) {
+            if(m_state.compare_exchange_weak(s, s + 1, std::memory_order_acquire)) {
+                --m_waiting;
+                return;
+            }
+        }
+        m_readers.wait(guard);
+        guard.lock();
+        --m_waiting;
+    }
+}
+
+void FiberRWLock::lockSlow() {
+    std::unique_lock<SpinLock> guard(m_guard);
+    ++m_writers;
+    while(true) {
+        ++m_waiting;
+        int expected = 0;
+        if(m_state.compare_exchange_strong(expected, WRITER, std::memory_order_acquire)) {
+            --m_waiting;
+            --m_writers;
+            return;
+        }
+        m_writerQueue.wait(guard);
+        guard.lock();
+        --m_waiting;
+    }
+}
+
+void FiberRWLock::wakeSlow() {
+    std::unique_lock<SpinLock> guard(m_guard);
+    // 写者优先; 被唤醒的一方重新竞争, 失败会再次排队
+    if(!m_writerQueue.notifyOne()) {
+        m_readers.notifyAll();
+    }
+}
+
+}
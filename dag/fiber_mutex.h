@@ -0,0 +1,245 @@
+#ifndef __DAG_FIBER_MUTEX_H__
+#define __DAG_FIBER_MUTEX_H__
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include "fiber.h"
+#include "scheduler.h"
+#include "thread.h"
+#include "utils/mutex.h"
+#include "utils/noncopyable.h"
+
+namespace dag {
+
+/**
+ * @brief 协程等待队列, 协程同步原语的公共部分
+ * @details 在协程中等待时记录当前协程和调度器后yield, 唤醒时通过原调度器重新调度该协程,
+ *          不阻塞所在的线程; 不在协程调度器中(如主线程)调用时退化为阻塞线程的信号量;
+ *          所有操作都要求调用方持有传入的guard
+ */
+class FiberWaitQueue : public NonCopyable {
+public:
+    /**
+     * @brief 挂起当前协程/线程直到被notify
+     * @param[in] guard 调用方已持有的锁, 入队后释放, 返回时不再持有
+     */
+    void wait(std::unique_lock<SpinLock>& guard);
+
+    /**
+     * @brief 唤醒最早等待的一个
+     * @return 是否有被唤醒的等待者
+     */
+    bool notifyOne();
+
+    /**
+     * @brief 唤醒所有等待者
+     * @return 被唤醒的个数
+     */
+    size_t notifyAll();
+
+    /**
+     * @brief 是否没有等待者
+     */
+    bool empty() const { return m_waiters.empty();}
+
+    /**
+     * @brief 等待者个数
+     */
+    size_t size() const { return m_waiters.size();}
+
+private:
+    struct Waiter {
+        // 协程等待者
+        Fiber::ptr fiber;
+        Scheduler* scheduler = nullptr;
+        // 线程等待者
+        std::shared_ptr<Semaphore> sem;
+    };
+
+    static void Wake(Waiter& waiter);
+
+private:
+    std::deque<Waiter> m_waiters;
+};
+
+/**
+ * @brief 协程互斥锁
+ * @details 无竞争时加锁/解锁各只有一次原子操作; 有竞争时等待的协程挂起让出线程,
+ *          解锁时唤醒一个等待者重新竞争; 可配合std::lock_guard/std::unique_lock使用
+ * @attention 持锁期间可以进行hook的IO或yield, 不会阻塞同线程的其他协程
+ */
+class FiberMutex : public NonCopyable {
+public:
+    void lock() {
+        int expected = UNLOCKED;
+        if(m_state.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire)) {
+            return;
+        }
+        lockSlow();
+    }
+
+    bool try_lock() {
+        int expected = UNLOCKED;
+        return m_state.compare_exchange_strong(expected, LOCKED, std::memory_order_acquire);
+    }
+
+    void unlock() {
+        if(m_state.exchange(UNLOCKED, std::memory_order_release) == LOCKED) {
+            return;
+        }
+        unlockSlow();
+    }
+
+private:
+    void lockSlow();
+    void unlockSlow();
+
+private:
+    enum {
+        UNLOCKED = 0,
+        LOCKED = 1,
+        // 已加锁且可能有等待者, 解锁时需要唤醒
+        CONTENDED = 2
+    };
+    std::atomic<int> m_state{UNLOCKED};
+    SpinLock m_guard;
+    FiberWaitQueue m_waiters;
+};
+
+/**
+ * @brief 协程条件变量, 配合FiberMutex使用
+ */
+class FiberCondVar : public NonCopyable {
+public:
+    /**
+     * @brief 释放mutex并挂起, 被唤醒后重新加锁再返回
+     * @attention 可能被虚假唤醒, 调用方应在循环中检查条件
+     */
+    void wait(FiberMutex& mutex);
+
+    template <class Predicate>
+    void wait(FiberMutex& mutex, Predicate pred) {
+        while(!pred()) {
+            wait(mutex);
+        }
+    }
+
+    void notify_one();
+
+    void notify_all();
+
+private:
+    SpinLock m_guard;
+    FiberWaitQueue m_waiters;
+};
+
+/**
+ * @brief 协程计数信号量
+ * @details 计数为正时wait只有一次原子减; 计数为负时其绝对值是等待者个数, post需要唤醒一个
+ */
+class FiberSemaphore : public NonCopyable {
+public:
+    explicit FiberSemaphore(int64_t count = 0) : m_count(count) {}
+
+    void wait() {
+        if(m_count.fetch_sub(1, std::memory_order_acquire) > 0) {
+            return;
+        }
+        waitSlow();
+    }
+
+    /**
+     * @brief 计数为正时减一并返回true, 否则不等待直接返回false
+     */
+    bool tryWait();
+
+    void post() {
+        if(m_count.fetch_add(1, std::memory_order_release) >= 0) {
+            return;
+        }
+        postSlow();
+    }
+
+    /**
+     * @brief 当前计数, 为负时表示等待者个数
+     */
+    int64_t getCount() const { return m_count;}
+
+private:
+    void waitSlow();
+    void postSlow();
+
+private:
+    std::atomic<int64_t> m_count;
+    SpinLock m_guard;
+    // post时等待者还没来得及入队, 留给它的唤醒
+    size_t m_wakeups = 0;
+    FiberWaitQueue m_waiters;
+};
+
+/**
+ * @brief 协程读写锁, 写优先
+ * @details 无竞争时加读锁/写锁各一次CAS; 有写者等待时新的读者也排队, 避免写者饿死;
+ *          写锁释放时优先唤醒一个写者, 没有写者时唤醒全部读者;
+ *          接口与std::shared_mutex一致, 可配合std::shared_lock/std::unique_lock使用
+ */
+class FiberRWLock : public NonCopyable {
+public:
+    void lock_shared() {
+        int s = m_state.load(std::memory_order_relaxed);
+        if(s >= 0 && m_waiting.load(std::memory_order_relaxed) == 0
+                && m_state.compare_exchange_strong(s, s + 1, std::memory_order_acquire)) {
+            return;
+        }
+        lockSharedSlow();
+    }
+
+    void unlock_shared() {
+        // 改状态与读m_waiting都用seq_cst, 与等待方先登记再读状态配对
+        if(m_state.fetch_sub(1) == 1 && m_waiting > 0) {
+            wakeSlow();
+        }
+    }
+
+    void lock() {
+        int expected = 0;
+        if(m_state.compare_exchange_strong(expected, WRITER, std::memory_order_acquire)) {
+            return;
+        }
+        lockSlow();
+    }
+
+    void unlock() {
+        m_state.store(0);
+        if(m_waiting > 0) {
+            wakeSlow();
+        }
+    }
+
+    bool try_lock_shared();
+
+    bool try_lock();
+
+private:
+    void lockSharedSlow();
+    void lockSlow();
+    void wakeSlow();
+
+private:
+    // 写锁被持有的状态值; 否则为持有读锁的个数
+    static const int WRITER = -1;
+    std::atomic<int> m_state{0};
+    // 排队中的读者+写者个数, 释放锁时据此判断是否需要唤醒
+    std::atomic<int> m_waiting{0};
+    // 排队中的写者个数, 大于0时新的读者不走快速路径
+    int m_writers = 0;
+    SpinLock m_guard;
+    FiberWaitQueue m_readers;
+    FiberWaitQueue m_writerQueue;
+};
+
+}
+
+#endif
@@ -1,14 +1,18 @@
 #include <iostream>
+#include <atomic>
 #include <cerrno>
 #include <dlfcn.h>
 #include <cstdarg>
 #include <string.h>
+#include <sys/stat.h>
 
 
 #include "hook.h"
+#include "blocking.h"
 #include "ioscheduler.h"
 #include "fd_manager.h"
 #include "logger.h"
+#include "utils/util.h"
 
 // apply XX to all functions
 #define HOOK_FUN(XX) \
@@ -23,21 +27,28 @@
     XX(recv) \
     XX(recvfrom) \
     XX(recvmsg) \
+    XX(recvmmsg) \
     XX(write) \
     XX(writev) \
     XX(send) \
     XX(sendto) \
     XX(sendmsg) \
+    XX(sendmmsg) \
     XX(close) \
     XX(fcntl) \
     XX(getsockopt) \
-    XX(setsockopt) 
+    XX(setsockopt) \
+    XX(fsync) \
+    XX(fdatasync) 
 
 namespace dag{
 
 // if this thread is using hooked function 
 static thread_local bool t_hook_enable = false;
 
+// 普通文件的IO是否交给阻塞调用池
+static std::atomic<bool> s_file_io_offload{false};
+
 bool is_hook_enable()
 {
     return t_hook_enable;
@@ -48,6 +59,16 @@ void set_hook_enable(bool flag)
     t_hook_enable = flag;
 }
 
+bool is_file_io_offload()
+{
+    return s_file_io_offload;
+}
+
+void set_file_io_offload(bool flag)
+{
+    s_file_io_offload = flag;
+}
+
 void hook_init()
 {
 	static bool is_inited = false;
@@ -82,6 +103,48 @@ struct timer_info
     int cancelled = 0;
 };
 
+/**
+ * @brief 按当前协程的截止时间收紧等待时间
+ * @param[in,out] timeout 等待时间(毫秒), -1表示不超时
+ * @return 已过截止时间返回true
+ */
+static bool apply_deadline(uint64_t& timeout)
+{
+    dag::Fiber* fiber = dag::Fiber::GetThisRaw();
+    uint64_t deadline = fiber ? fiber->getDeadline() : 0;
+    if(!deadline)
+    {
+        return false;
+    }
+    uint64_t now = dag::getElapseMs();
+    if(now >= deadline)
+    {
+        return true;
+    }
+    timeout = std::min(timeout, deadline - now);
+    return false;
+}
+
+/**
+ * @brief 是否把fd上的IO交给阻塞调用池: 开启了普通文件IO卸载、当前在调度器的非共享栈协程中、fd是普通文件
+ * @details 共享栈协程挂起时栈被换出, 调用方栈上的缓冲区不能交给池线程读写
+ */
+static bool offload_file_io(int fd)
+{
+    if(!dag::is_file_io_offload())
+    {
+        return false;
+    }
+    dag::Fiber* fiber = dag::Fiber::GetThisRaw();
+    if(!fiber || !fiber->isRunInScheduler() || fiber->isSharedStack() || !dag::Scheduler::GetThis())
+    {
+        return false;
+    }
+    // 管道、eventfd等仍直接调用
+    struct stat statbuf;
+    return fstat(fd, &statbuf) == 0 && S_ISREG(statbuf.st_mode);
+}
+
 template<typename OriginFun, typename... Args>
 static ssize_t do_io(int fd, OriginFun fun, const char* hook_fun_name, uint32_t event, int timeout_so, Args&&... args) 
 {
@@ -91,18 +154,30 @@ static ssize_t do_io(int fd, OriginFun fun, const char* hook_fun_name, uint32_t
     }
 
     std::shared_ptr<dag::FdCtx> ctx = dag::FdMgr::GetInstance()->get(fd);
-    if(!ctx) 
+    if(ctx && ctx->isClosed()) 
     {
+        errno = EBADF;
+        return -1;
+    }
+
+    if(!ctx || !ctx->isSocket())
+    {
+        if(offload_file_io(fd))
+        {
+            return dag::blocking([&]() { return fun(fd, args...); });
+        }
         return fun(fd, std::forward<Args>(args)...);
     }
 
-    if(ctx->isClosed()) 
+    // 请求已过截止时间, 不再做IO
+    dag::Fiber* fiber = dag::Fiber::GetThisRaw();
+    if(fiber && fiber->isDeadlineExpired())
     {
-        errno = EBADF;
+        errno = ETIMEDOUT;
         return -1;
     }
 
-    if(!ctx->isSocket() || ctx->getUserNonblock()) 
+    if(ctx->getUserNonblock())
     {
         return fun(fd, std::forward<Args>(args)...);
     }
@@ -129,10 +204,18 @@ retry:
         std::shared_ptr<dag::Timer> timer;
         std::weak_ptr<timer_info> winfo(tinfo);
 
+        // 最多等到协程的截止时间
+        uint64_t wait = timeout;
+        if(apply_deadline(wait))
+        {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+
         // 1. 如果设置了超时时间 -> 添加条件定时器，用于在超时后取消该操作
-        if(timeout != (uint64_t)-1) 
+        if(wait != (uint64_t)-1) 
         {
-            timer = iom->addConditionTimer(timeout, [winfo, fd, iom, event]()
+            timer = iom->addConditionTimer(wait, [winfo, fd, iom, event]()
             {
                 auto t = winfo.lock();
                 if(!t || t->cancelled) 
@@ -270,6 +353,12 @@ int connect_with_timeout(int fd, const struct sockaddr* addr, socklen_t addrlen,
         return connect_f(fd, addr, addrlen);
     }
 
+    if(apply_deadline(timeout_ms))
+    {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+
     if(ctx->getUserNonblock()) 
     {
 
@@ -389,6 +478,11 @@ ssize_t recvmsg(int sockfd, struct msghdr *msg, int flags)
 	return do_io(sockfd, recvmsg_f, "recvmsg", dag::IOManager::READ, SO_RCVTIMEO, msg, flags);	
 }
 
+int recvmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags, struct timespec *timeout)
+{
+	return do_io(sockfd, recvmmsg_f, "recvmmsg", dag::IOManager::READ, SO_RCVTIMEO, msgvec, vlen, flags, timeout);
+}
+
 ssize_t write(int fd, const void *buf, size_t count)
 {
 	return do_io(fd, write_f, "write", dag::IOManager::WRITE, SO_SNDTIMEO, buf, count);	
@@ -414,6 +508,11 @@ ssize_t sendmsg(int sockfd, const struct msghdr *msg, int flags)
 	return do_io(sockfd, sendmsg_f, "sendmsg", dag::IOManager::WRITE, SO_SNDTIMEO, msg, flags);	
 }
 
+int sendmmsg(int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+	return do_io(sockfd, sendmmsg_f, "sendmmsg", dag::IOManager::WRITE, SO_SNDTIMEO, msgvec, vlen, flags);
+}
+
 int close(int fd)
 {
 	if(!dag::t_hook_enable)
@@ -435,6 +534,24 @@ int close(int fd)
 	return close_f(fd);
 }
 
+int fsync(int fd)
+{
+	if(dag::t_hook_enable && dag::is_file_io_offload())
+	{
+		return dag::blocking([fd]() { return fsync_f(fd); });
+	}
+	return fsync_f(fd);
+}
+
+int fdatasync(int fd)
+{
+	if(dag::t_hook_enable && dag::is_file_io_offload())
+	{
+		return dag::blocking([fd]() { return fdatasync_f(fd); });
+	}
+	return fdatasync_f(fd);
+}
+
 int fcntl(int fd, int cmd, ... /* arg */ )
 {
     va_list va; 
@@ -21,6 +21,17 @@ bool is_hook_enable();
 */
 void set_hook_enable(bool flag);
 
+/**
+* @brief 普通文件的IO是否交给阻塞调用池, 全局设置
+*/
+bool is_file_io_offload();
+
+/**
+* @brief 开启后调度器协程中对普通文件的read/write/readv/writev以及fsync/fdatasync在阻塞调用池中执行,
+*        协程挂起而不是阻塞工作线程; 每次读写多一次fstat判断fd类型
+*/
+void set_file_io_offload(bool flag);
+
 }
 
 #ifdef __cplusplus
@@ -62,6 +73,9 @@ extern "C"
 	typedef ssize_t (*recvmsg_fun) (int sockfd, struct msghdr *msg, int flags);
 	extern recvmsg_fun recvmsg_f;
 
+	typedef int (*recvmmsg_fun) (int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags, struct timespec *timeout);
+	extern recvmmsg_fun recvmmsg_f;
+
 	typedef ssize_t (*write_fun) (int fd, const void *buf, size_t count);
 	extern write_fun write_f;
 
@@ -77,6 +91,9 @@ extern "C"
 	typedef ssize_t (*sendmsg_fun) (int sockfd, const struct msghdr *msg, int flags);
 	extern sendmsg_fun sendmsg_f;
 
+	typedef int (*sendmmsg_fun) (int sockfd, struct mmsghdr *msgvec, unsigned int vlen, int flags);
+	extern sendmmsg_fun sendmmsg_f;
+
 	typedef int (*close_fun) (int fd);
 	extern close_fun close_f;
 
@@ -92,6 +109,12 @@ extern "C"
     typedef int (*setsockopt_fun) (int sockfd, int level, int optname, const void *optval, socklen_t optlen);
     extern setsockopt_fun setsockopt_f;
 
+    typedef int (*fsync_fun) (int fd);
+    extern fsync_fun fsync_f;
+
+    typedef int (*fdatasync_fun) (int fd);
+    extern fdatasync_fun fdatasync_f;
+
     extern int connect_with_timeout(int fd, const struct sockaddr* addr,socklen_t addrlen, uint64_t timeout_ms);
 #ifdef __cplusplus
 }
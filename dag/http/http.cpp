@@ -0,0 +1,208 @@
+#include "http.h"
+#include <sstream>
+
+namespace dag {
+namespace http {
+
+HttpMethod StringToHttpMethod(const std::string& m) {
+#define XX(name) \
+    if(m == #name) { \
+        return HttpMethod::name; \
+    }
+    XX(GET);
+    XX(POST);
+    XX(HEAD);
+    XX(PUT);
+    XX(DELETE);
+    XX(OPTIONS);
+    XX(PATCH);
+    XX(CONNECT);
+    XX(TRACE);
+#undef XX
+    return HttpMethod::INVALID_METHOD;
+}
+
+const char* HttpMethodToString(HttpMethod m) {
+    switch(m) {
+#define XX(name) \
+        case HttpMethod::name: \
+            return #name;
+        XX(DELETE);
+        XX(GET);
+        XX(HEAD);
+        XX(POST);
+        XX(PUT);
+        XX(CONNECT);
+        XX(OPTIONS);
+        XX(TRACE);
+        XX(PATCH);
+#undef XX
+        default:
+            return "<unknown>";
+    }
+}
+
+const char* HttpStatusToString(HttpStatus s) {
+    switch(s) {
+#define XX(code, name, desc) \
+        case HttpStatus::name: \
+            return desc;
+        XX(100, CONTINUE,                        "Continue");
+        XX(200, OK,                              "OK");
+        XX(201, CREATED,                         "Created");
+        XX(202, ACCEPTED,                        "Accepted");
+        XX(204, NO_CONTENT,                      "No Content");
+        XX(301, MOVED_PERMANENTLY,               "Moved Permanently");
+        XX(302, FOUND,                           "Found");
+        XX(304, NOT_MODIFIED,                    "Not Modified");
+        XX(400, BAD_REQUEST,                     "Bad Request");
+        XX(401, UNAUTHORIZED,                    "Unauthorized");
+        XX(403, FORBIDDEN,                       "Forbidden");
+        XX(404, NOT_FOUND,                       "Not Found");
+        XX(405, METHOD_NOT_ALLOWED,              "Method Not Allowed");
+        XX(408, REQUEST_TIMEOUT,                 "Request Timeout");
+        XX(413, PAYLOAD_TOO_LARGE,               "Payload Too Large");
+        XX(414, URI_TOO_LONG,                    "URI Too Long");
+        XX(431, REQUEST_HEADER_FIELDS_TOO_LARGE, "Request Header Fields Too Large");
+        XX(500, INTERNAL_SERVER_ERROR,           "Internal Server Error");
+        XX(501, NOT_IMPLEMENTED,                 "Not Implemented");
+        XX(502, BAD_GATEWAY,                     "Bad Gateway");
+        XX(503, SERVICE_UNAVAILABLE,             "Service Unavailable");
+        XX(504, GATEWAY_TIMEOUT,                 "Gateway Timeout");
+        XX(505, HTTP_VERSION_NOT_SUPPORTED,      "HTTP Version Not Supported");
+#undef XX
+        default:
+            return "<unknown>";
+    }
+}
+
+HttpRequest::HttpRequest(uint8_t version, bool close)
+    :m_method(HttpMethod::GET)
+    ,m_version(version)
+    ,m_close(close)
+    ,m_path("/") {
+}
+
+std::string HttpRequest::getHeader(const std::string& key, const std::string& def) const {
+    auto it = m_headers.find(key);
+    return it == m_headers.end() ? def : it->second;
+}
+
+void HttpRequest::setHeader(const std::string& key, const std::string& val) {
+    m_headers[key] = val;
+}
+
+void HttpRequest::delHeader(const std::string& key) {
+    m_headers.erase(key);
+}
+
+bool HttpRequest::hasHeader(const std::string& key, std::string* val) const {
+    auto it = m_headers.find(key);
+    if(it == m_headers.end()) {
+        return false;
+    }
+    if(val) {
+        *val = it->second;
+    }
+    return true;
+}
+
+std::ostream& HttpRequest::dump(std::ostream& os) const {
+    os << HttpMethodToString(m_method) << " "
+       << m_path
+       << (m_query.empty() ? "" : "?")
+       << m_query
+       << (m_fragment.empty() ? "" : "#")
+       << m_fragment
+       << " HTTP/"
+       << ((uint32_t)(m_version >> 4))
+       << "."
+       << ((uint32_t)(m_version & 0x0F))
+       << "\r\n";
+    os << "connection: " << (m_close ? "close" : "keep-alive") << "\r\n";
+    for(auto& i : m_headers) {
+        if(strcasecmp(i.first.c_str(), "connection") == 0
+                || strcasecmp(i.first.c_str(), "content-length") == 0
+                || strcasecmp(i.first.c_str(), "transfer-encoding") == 0) {
+            continue;
+        }
+        os << i.first << ": " << i.second << "\r\n";
+    }
+    if(!m_body.empty()) {
+        os << "content-length: " << m_body.size() << "\r\n\r\n"
+           << m_body;
+    } else {
+        os << "\r\n";
+    }
+    return os;
+}
+
+std::string HttpRequest::toString() const {
+    std::stringstream ss;
+    dump(ss);
+    return ss.str();
+}
+
+HttpResponse::HttpResponse(uint8_t version, bool close)
+    :m_status(HttpStatus::OK)
+    ,m_version(version)
+    ,m_close(close) {
+}
+
+std::string HttpResponse::getHeader(const std::string& key, const std::string& def) const {
+    auto it = m_headers.find(key);
+    return it == m_headers.end() ? def : it->second;
+}
+
+void HttpResponse::setHeader(const std::string& key, const std::string& val) {
+    m_headers[key] = val;
+}
+
+void HttpResponse::delHeader(const std::string& key) {
+    m_headers.erase(key);
+}
+
+std::string HttpResponse::headerToString() const {
+    std::string s;
+    s.reserve(128 + m_headers.size() * 32);
+    s.append("HTTP/");
+    s.push_back('0' + (m_version >> 4));
+    s.push_back('.');
+    s.push_back('0' + (m_version & 0x0F));
+    s.push_back(' ');
+    s.append(std::to_string((uint32_t)m_status));
+    s.push_back(' ');
+    s.append(m_reason.empty() ? HttpStatusToString(m_status) : m_reason);
+    s.append("\r\n");
+    for(auto& i : m_headers) {
+        if(strcasecmp(i.first.c_str(), "connection") == 0
+                || strcasecmp(i.first.c_str(), "content-length") == 0) {
+            continue;
+        }
+        s.append(i.first).append(": ").append(i.second).append("\r\n");
+    }
+    s.append("connection: ").append(m_close ? "close" : "keep-alive").append("\r\n");
+    s.append("content-length: ").append(std::to_string(m_body.size())).append("\r\n\r\n");
+    return s;
+}
+
+std::ostream& HttpResponse::dump(std::ostream& os) const {
+    return os << headerToString() << m_body;
+}
+
+std::string HttpResponse::toString() const {
+    std::stringstream ss;
+    dump(ss);
+    return ss.str();
+}
+
+std::ostream& operator<<(std::ostream& os, const HttpRequest& req) {
+    return req.dump(os);
+}
+
+std::ostream& operator<<(std::ostream& os, const HttpResponse& rsp) {
+    return rsp.dump(os);
+}
+
+}
+}
@@ -0,0 +1,238 @@
+#ifndef __DAG_HTTP_HTTP_H__
+#define __DAG_HTTP_HTTP_H__
+
+#include <map>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <strings.h>
+
+namespace dag {
+namespace http {
+
+/**
+ * @brief HTTP方法
+ */
+enum class HttpMethod {
+    DELETE,
+    GET,
+    HEAD,
+    POST,
+    PUT,
+    CONNECT,
+    OPTIONS,
+    TRACE,
+    PATCH,
+    INVALID_METHOD
+};
+
+/**
+ * @brief HTTP状态码
+ */
+enum class HttpStatus {
+    CONTINUE                        = 100,
+    OK                              = 200,
+    CREATED                         = 201,
+    ACCEPTED                        = 202,
+    NO_CONTENT                      = 204,
+    MOVED_PERMANENTLY               = 301,
+    FOUND                           = 302,
+    NOT_MODIFIED                    = 304,
+    BAD_REQUEST                     = 400,
+    UNAUTHORIZED                    = 401,
+    FORBIDDEN                       = 403,
+    NOT_FOUND                       = 404,
+    METHOD_NOT_ALLOWED              = 405,
+    REQUEST_TIMEOUT                 = 408,
+    PAYLOAD_TOO_LARGE               = 413,
+    URI_TOO_LONG                    = 414,
+    REQUEST_HEADER_FIELDS_TOO_LARGE = 431,
+    INTERNAL_SERVER_ERROR           = 500,
+    NOT_IMPLEMENTED                 = 501,
+    BAD_GATEWAY                     = 502,
+    SERVICE_UNAVAILABLE             = 503,
+    GATEWAY_TIMEOUT                 = 504,
+    HTTP_VERSION_NOT_SUPPORTED      = 505,
+};
+
+/**
+ * @brief 将字符串转换为HTTP方法
+ * @return 无法识别时返回HttpMethod::INVALID_METHOD
+ */
+HttpMethod StringToHttpMethod(const std::string& m);
+
+/**
+ * @brief 将HTTP方法转换为字符串
+ */
+const char* HttpMethodToString(HttpMethod m);
+
+/**
+ * @brief 返回HTTP状态码对应的原因短语
+ */
+const char* HttpStatusToString(HttpStatus s);
+
+/**
+ * @brief 忽略大小写比较的仿函数, HTTP头部字段名不区分大小写
+ */
+struct CaseInsensitiveLess {
+    bool operator()(const std::string& lhs, const std::string& rhs) const {
+        return strcasecmp(lhs.c_str(), rhs.c_str()) < 0;
+    }
+};
+
+/**
+ * @brief HTTP请求
+ */
+class HttpRequest {
+public:
+    using ptr = std::shared_ptr<HttpRequest>;
+    using MapType = std::map<std::string, std::string, CaseInsensitiveLess>;
+
+    /**
+     * @brief 构造函数
+     * @param[in] version 版本, 0x11表示HTTP/1.1
+     * @param[in] close 是否短连接
+     */
+    HttpRequest(uint8_t version = 0x11, bool close = false);
+
+    HttpMethod getMethod() const { return m_method;}
+    uint8_t getVersion() const { return m_version;}
+    const std::string& getPath() const { return m_path;}
+    const std::string& getQuery() const { return m_query;}
+    const std::string& getFragment() const { return m_fragment;}
+    const std::string& getBody() const { return m_body;}
+    const MapType& getHeaders() const { return m_headers;}
+    bool isClose() const { return m_close;}
+    bool isChunked() const { return m_chunked;}
+
+    void setMethod(HttpMethod v) { m_method = v;}
+    void setVersion(uint8_t v) { m_version = v;}
+    void setPath(const std::string& v) { m_path = v;}
+    void setQuery(const std::string& v) { m_query = v;}
+    void setFragment(const std::string& v) { m_fragment = v;}
+    void setBody(const std::string& v) { m_body = v;}
+    void setClose(bool v) { m_close = v;}
+    void setChunked(bool v) { m_chunked = v;}
+
+    /**
+     * @brief 返回body的可写引用, 供解析器追加数据
+     */
+    std::string& getBodyRef() { return m_body;}
+
+    /**
+     * @brief 获取HTTP头部字段
+     * @param[in] key 字段名
+     * @param[in] def 不存在时返回的默认值
+     */
+    std::string getHeader(const std::string& key, const std::string& def = "") const;
+
+    /**
+     * @brief 设置HTTP头部字段
+     */
+    void setHeader(const std::string& key, const std::string& val);
+
+    /**
+     * @brief 删除HTTP头部字段
+     */
+    void delHeader(const std::string& key);
+
+    /**
+     * @brief 判断HTTP头部字段是否存在
+     * @param[out] val 存在时返回字段值, 可为nullptr
+     */
+    bool hasHeader(const std::string& key, std::string* val = nullptr) const;
+
+    /**
+     * @brief 将请求序列化输出到流中
+     */
+    std::ostream& dump(std::ostream& os) const;
+
+    /**
+     * @brief 将请求序列化为字符串
+     */
+    std::string toString() const;
+
+private:
+    /// HTTP方法
+    HttpMethod m_method;
+    /// HTTP版本
+    uint8_t m_version;
+    /// 是否短连接
+    bool m_close;
+    /// 请求体是否使用chunked编码
+    bool m_chunked = false;
+    /// 请求路径
+    std::string m_path;
+    /// 请求参数
+    std::string m_query;
+    /// 请求fragment
+    std::string m_fragment;
+    /// 请求消息体
+    std::string m_body;
+    /// 请求头部
+    MapType m_headers;
+};
+
+/**
+ * @brief HTTP响应
+ */
+class HttpResponse {
+public:
+    using ptr = std::shared_ptr<HttpResponse>;
+    using MapType = std::map<std::string, std::string, CaseInsensitiveLess>;
+
+    HttpResponse(uint8_t version = 0x11, bool close = false);
+
+    HttpStatus getStatus() const { return m_status;}
+    uint8_t getVersion() const { return m_version;}
+    const std::string& getBody() const { return m_body;}
+    const std::string& getReason() const { return m_reason;}
+    const MapType& getHeaders() const { return m_headers;}
+    bool isClose() const { return m_close;}
+
+    void setStatus(HttpStatus v) { m_status = v;}
+    void setVersion(uint8_t v) { m_version = v;}
+    void setBody(const std::string& v) { m_body = v;}
+    void setReason(const std::string& v) { m_reason = v;}
+    void setClose(bool v) { m_close = v;}
+
+    std::string getHeader(const std::string& key, const std::string& def = "") const;
+    void setHeader(const std::string& key, const std::string& val);
+    void delHeader(const std::string& key);
+
+    /**
+     * @brief 序列化状态行和头部(包含结尾的空行), 不包含body
+     * @details 发送时状态行/头部和body作为两个iovec一起交给writev, body不需要拷贝
+     */
+    std::string headerToString() const;
+
+    /**
+     * @brief 将完整响应序列化输出到流中
+     */
+    std::ostream& dump(std::ostream& os) const;
+
+    std::string toString() const;
+
+private:
+    /// 响应状态
+    HttpStatus m_status;
+    /// 版本
+    uint8_t m_version;
+    /// 是否短连接
+    bool m_close;
+    /// 响应消息体
+    std::string m_body;
+    /// 响应原因
+    std::string m_reason;
+    /// 响应头部
+    MapType m_headers;
+};
+
+std::ostream& operator<<(std::ostream& os, const HttpRequest& req);
+
+std::ostream& operator<<(std::ostream& os, const HttpResponse& rsp);
+
+}
+}
+
+#endif
@@ -0,0 +1,372 @@
+#include "http_parser.h"
+#include <cstring>
+#include <cstdint>
+#include <vector>
+
+namespace dag {
+namespace http {
+
+uint64_t HttpRequestParser::s_maxHeaderSize = 8 * 1024;
+uint64_t HttpRequestParser::s_maxBodySize = 64 * 1024 * 1024;
+
+/// chunk大小行的最大长度(包含扩展)
+static const size_t MAX_CHUNK_LINE = 1024;
+
+static std::string_view TrimSpace(std::string_view s, size_t begin, size_t end) {
+    while(begin < end && (s[begin] == ' ' || s[begin] == '\t')) {
+        ++begin;
+    }
+    while(end > begin && (s[end - 1] == ' ' || s[end - 1] == '\t')) {
+        --end;
+    }
+    return s.substr(begin, end - begin);
+}
+
+static std::string_view TrimCR(std::string_view s) {
+    if(!s.empty() && s.back() == '\r') {
+        s.remove_suffix(1);
+    }
+    return s;
+}
+
+/**
+ * @brief 解析Content-Length或chunk大小
+ * @details 只接受数字, 不接受符号、空白和0x前缀; 超出uint64_t时取UINT64_MAX, 由调用方按过大处理
+ * @return 为空或含有非数字字符时返回false
+ */
+static bool ParseSize(std::string_view s, int base, uint64_t& value) {
+    if(s.empty()) {
+        return false;
+    }
+    value = 0;
+    for(char c : s) {
+        int digit;
+        if(c >= '0' && c <= '9') {
+            digit = c - '0';
+        } else if(base == 16 && c >= 'a' && c <= 'f') {
+            digit = c - 'a' + 10;
+        } else if(base == 16 && c >= 'A' && c <= 'F') {
+            digit = c - 'A' + 10;
+        } else {
+            return false;
+        }
+        if(value > (UINT64_MAX - digit) / base) {
+            value = UINT64_MAX;
+        } else {
+            value = value * base + digit;
+        }
+    }
+    return true;
+}
+
+HttpRequestParser::HttpRequestParser() {
+    reset();
+}
+
+void HttpRequestParser::reset() {
+    m_state = METHOD;
+    m_data.reset(new HttpRequest);
+    m_token.clear();
+    m_headerSize = 0;
+    m_remaining = 0;
+    m_errorStatus = HttpStatus::OK;
+}
+
+void HttpRequestParser::setError(HttpStatus status) {
+    m_state = ERROR;
+    m_errorStatus = status;
+}
+
+bool HttpRequestParser::scanToken(const char*& p, const char* end, char delim, std::string_view& token) {
+    const char* hit = (const char*)memchr(p, delim, end - p);
+    if(!hit) {
+        m_token.append(p, end - p);
+        p = end;
+        return false;
+    }
+    if(m_token.empty()) {
+        token = std::string_view(p, hit - p);
+    } else {
+        m_token.append(p, hit - p);
+        token = m_token;
+    }
+    p = hit + 1;
+    return true;
+}
+
+size_t HttpRequestParser::execute(const char* data, size_t len) {
+    const char* p = data;
+    const char* end = data + len;
+
+    std::string_view token;
+    while(p < end && m_state != DONE && m_state != ERROR) {
+        const char* before = p;
+        switch(m_state) {
+            case METHOD:
+                if(scanToken(p, end, ' ', token)) {
+                    HttpMethod m = StringToHttpMethod(std::string(token));
+                    if(m == HttpMethod::INVALID_METHOD) {
+                        setError(HttpStatus::NOT_IMPLEMENTED);
+                        break;
+                    }
+                    m_data->setMethod(m);
+                    m_token.clear();
+                    m_state = URI;
+                }
+                break;
+            case URI:
+                if(scanToken(p, end, ' ', token)) {
+                    onUri(token);
+                }
+                break;
+            case VERSION:
+                if(scanToken(p, end, '\n', token)) {
+                    onVersion(token);
+                }
+                break;
+            case HEADER:
+                if(scanToken(p, end, '\n', token)) {
+                    onHeaderLine(token);
+                }
+                break;
+            case BODY:
+                {
+                    size_t n = std::min<uint64_t>(m_remaining, end - p);
+                    m_data->getBodyRef().append(p, n);
+                    p += n;
+                    m_remaining -= n;
+                    if(m_remaining == 0) {
+                        m_state = DONE;
+                    }
+                }
+                break;
+            case CHUNK_SIZE:
+                if(scanToken(p, end, '\n', token)) {
+                    onChunkSize(token);
+                } else if(m_token.size() > MAX_CHUNK_LINE) {
+                    setError(HttpStatus::BAD_REQUEST);
+                }
+                break;
+            case CHUNK_DATA:
+                {
+                    size_t n = std::min<uint64_t>(m_remaining, end - p);
+                    m_data->getBodyRef().append(p, n);
+                    p += n;
+                    m_remaining -= n;
+                    if(m_remaining == 0) {
+                        m_state = CHUNK_DATA_END;
+                    }
+                }
+                break;
+            case CHUNK_DATA_END:
+                if(scanToken(p, end, '\n', token)) {
+                    if(!(token.empty() || token == "\r")) {
+                        setError(HttpStatus::BAD_REQUEST);
+                        break;
+                    }
+                    m_token.clear();
+                    m_state = CHUNK_SIZE;
+                } else if(m_token.size() > 1) {
+                    setError(HttpStatus::BAD_REQUEST);
+                }
+                break;
+            case CHUNK_TRAILER:
+                if(scanToken(p, end, '\n', token)) {
+                    // trailer中的字段忽略, 空行表示请求结束
+                    if(TrimCR(token).empty()) {
+                        m_state = DONE;
+                    }
+                    m_token.clear();
+                } else if(m_token.size() > MAX_CHUNK_LINE) {
+                    setError(HttpStatus::BAD_REQUEST);
+                }
+                break;
+            default:
+                break;
+        }
+
+        if(m_headerSize != (uint64_t)-1) {
+            m_headerSize += p - before;
+            if(m_headerSize > s_maxHeaderSize && m_state != ERROR
+                    && m_state <= HEADER) {
+                setError(m_state == URI ? HttpStatus::URI_TOO_LONG
+                                        : HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE);
+            }
+        }
+    }
+    return p - data;
+}
+
+size_t HttpRequestParser::execute(ByteArray::ptr ba) {
+    std::vector<iovec> iovs;
+    ba->getReadBuffers(iovs, ba->getReadSize());
+    size_t total = 0;
+    for(auto& iov : iovs) {
+        size_t n = execute((const char*)iov.iov_base, iov.iov_len);
+        total += n;
+        if(n < iov.iov_len || m_state == DONE || m_state == ERROR) {
+            break;
+        }
+    }
+    ba->setPosition(ba->getPosition() + total);
+    return total;
+}
+
+void HttpRequestParser::onUri(std::string_view uri) {
+    if(uri.empty()) {
+        setError(HttpStatus::BAD_REQUEST);
+        return;
+    }
+
+    size_t begin = 0;
+    // absolute-form: http://host[:port]/path
+    if(uri[0] != '/' && uri != "*") {
+        size_t scheme = uri.find("://");
+        if(scheme == std::string_view::npos) {
+            setError(HttpStatus::BAD_REQUEST);
+            return;
+        }
+        size_t slash = uri.find('/', scheme + 3);
+        if(!m_data->hasHeader("host")) {
+            m_data->setHeader("host", std::string(uri.substr(scheme + 3,
+                        slash == std::string_view::npos ? std::string_view::npos : slash - scheme - 3)));
+        }
+        if(slash == std::string_view::npos) {
+            m_data->setPath("/");
+            m_token.clear();
+            m_state = VERSION;
+            return;
+        }
+        begin = slash;
+    }
+
+    size_t fragment = uri.find('#', begin);
+    size_t query = uri.find('?', begin);
+    if(query != std::string_view::npos && fragment != std::string_view::npos && query > fragment) {
+        query = std::string_view::npos;
+    }
+    size_t path_end = std::min(query, fragment);
+    m_data->setPath(std::string(uri.substr(begin, path_end == std::string_view::npos ? std::string_view::npos : path_end - begin)));
+    if(query != std::string_view::npos) {
+        m_data->setQuery(std::string(uri.substr(query + 1,
+                    fragment == std::string_view::npos ? std::string_view::npos : fragment - query - 1)));
+    }
+    if(fragment != std::string_view::npos) {
+        m_data->setFragment(std::string(uri.substr(fragment + 1)));
+    }
+    m_token.clear();
+    m_state = VERSION;
+}
+
+void HttpRequestParser::onVersion(std::string_view version) {
+    version = TrimCR(version);
+    if(version == "HTTP/1.1") {
+        m_data->setVersion(0x11);
+    } else if(version == "HTTP/1.0") {
+        m_data->setVersion(0x10);
+    } else if(version.compare(0, 5, "HTTP/") == 0) {
+        setError(HttpStatus::HTTP_VERSION_NOT_SUPPORTED);
+        return;
+    } else {
+        setError(HttpStatus::BAD_REQUEST);
+        return;
+    }
+    m_token.clear();
+    m_state = HEADER;
+}
+
+void HttpRequestParser::onHeaderLine(std::string_view line) {
+    line = TrimCR(line);
+    if(line.empty()) {
+        onHeadersComplete();
+        return;
+    }
+
+    size_t colon = line.find(':');
+    if(colon == std::string_view::npos || colon == 0) {
+        setError(HttpStatus::BAD_REQUEST);
+        return;
+    }
+    std::string key(TrimSpace(line, 0, colon));
+    std::string val(TrimSpace(line, colon + 1, line.size()));
+    std::string old;
+    if(m_data->hasHeader(key, &old)) {
+        // 重复字段按RFC7230合并为逗号分隔的列表
+        val = old + ", " + val;
+    }
+    m_data->setHeader(key, val);
+    m_token.clear();
+}
+
+void HttpRequestParser::onHeadersComplete() {
+    m_token.clear();
+    // 头部结束 -> 后续的请求体不计入头部长度
+    m_headerSize = (uint64_t)-1;
+
+    std::string conn = m_data->getHeader("connection");
+    if(m_data->getVersion() == 0x11) {
+        m_data->setClose(strcasecmp(conn.c_str(), "close") == 0);
+    } else {
+        m_data->setClose(strcasecmp(conn.c_str(), "keep-alive") != 0);
+    }
+
+    std::string te;
+    if(m_data->hasHeader("transfer-encoding", &te)) {
+        if(!strcasestr(te.c_str(), "chunked")) {
+            setError(HttpStatus::NOT_IMPLEMENTED);
+            return;
+        }
+        m_data->setChunked(true);
+        m_state = CHUNK_SIZE;
+        return;
+    }
+
+    std::string cl;
+    if(m_data->hasHeader("content-length", &cl)) {
+        uint64_t len = 0;
+        if(!ParseSize(cl, 10, len)) {
+            setError(HttpStatus::BAD_REQUEST);
+            return;
+        }
+        if(len > s_maxBodySize) {
+            setError(HttpStatus::PAYLOAD_TOO_LARGE);
+            return;
+        }
+        if(len == 0) {
+            m_state = DONE;
+            return;
+        }
+        m_data->getBodyRef().reserve(len);
+        m_remaining = len;
+        m_state = BODY;
+        return;
+    }
+    m_state = DONE;
+}
+
+void HttpRequestParser::onChunkSize(std::string_view line) {
+    line = TrimCR(line);
+    // 忽略chunk扩展: 1a;name=value
+    size_t semi = line.find(';');
+    std::string_view hex = TrimSpace(line, 0, semi == std::string_view::npos ? line.size() : semi);
+    uint64_t size = 0;
+    if(!ParseSize(hex, 16, size)) {
+        setError(HttpStatus::BAD_REQUEST);
+        return;
+    }
+    m_token.clear();
+    if(size == 0) {
+        m_state = CHUNK_TRAILER;
+        return;
+    }
+    // 已收到的请求体不超过s_maxBodySize, 相减不会回绕
+    if(size > s_maxBodySize - m_data->getBody().size()) {
+        setError(HttpStatus::PAYLOAD_TOO_LARGE);
+        return;
+    }
+    m_remaining = size;
+    m_state = CHUNK_DATA;
+}
+
+}
+}
@@ -0,0 +1,150 @@
+#ifndef __DAG_HTTP_PARSER_H__
+#define __DAG_HTTP_PARSER_H__
+
+#include <string_view>
+#include "http.h"
+#include "bytearray.h"
+
+namespace dag {
+namespace http {
+
+/**
+ * @brief HTTP/1.1请求解析器
+ * @details 增量式状态机: 数据可以按任意边界分多次喂入，execute返回本次消费的字节数。
+ *          解析完一个请求后立即停止，剩余字节保留在调用方缓冲中，作为下一个(pipelining)请求的开头。
+ *          对ByteArray的解析直接遍历其内存块(getReadBuffers)，不会把数据拼接成连续内存;
+ *          请求行和头部的token直接以string_view引用内存块中的数据, 只有跨越内存块或跨越两次execute的token
+ *          才拼接到m_token中, 数据只在存入HttpRequest时拷贝一次。
+ *          请求体支持Content-Length和chunked两种传输方式
+ */
+class HttpRequestParser {
+public:
+    using ptr = std::shared_ptr<HttpRequestParser>;
+
+    /**
+     * @brief 解析状态
+     */
+    enum State {
+        /// 解析方法
+        METHOD,
+        /// 解析URI
+        URI,
+        /// 解析版本号
+        VERSION,
+        /// 解析头部行
+        HEADER,
+        /// 解析Content-Length请求体
+        BODY,
+        /// 解析chunk大小行
+        CHUNK_SIZE,
+        /// 解析chunk数据
+        CHUNK_DATA,
+        /// 解析chunk数据后的CRLF
+        CHUNK_DATA_END,
+        /// 解析chunked结尾的trailer
+        CHUNK_TRAILER,
+        /// 解析完成
+        DONE,
+        /// 解析出错
+        ERROR
+    };
+
+    /**
+     * @brief 构造函数
+     */
+    HttpRequestParser();
+
+    /**
+     * @brief 解析一段数据
+     * @param[in] data 数据
+     * @param[in] len 数据长度
+     * @return 本次消费的字节数, 解析完成或出错后不再消费
+     */
+    size_t execute(const char* data, size_t len);
+
+    /**
+     * @brief 从ba的当前位置开始解析, 并把ba的位置向后移动消费的字节数
+     * @return 本次消费的字节数
+     */
+    size_t execute(ByteArray::ptr ba);
+
+    /**
+     * @brief 是否已经解析出一个完整的请求
+     */
+    bool isFinished() const { return m_state == DONE;}
+
+    /**
+     * @brief 是否出错
+     */
+    bool hasError() const { return m_state == ERROR;}
+
+    /**
+     * @brief 出错时应该返回给客户端的状态码
+     */
+    HttpStatus getErrorStatus() const { return m_errorStatus;}
+
+    /**
+     * @brief 返回解析到的请求
+     */
+    HttpRequest::ptr getData() const { return m_data;}
+
+    /**
+     * @brief 重置状态以解析下一个请求
+     */
+    void reset();
+
+    /**
+     * @brief 请求行+头部的最大长度
+     */
+    static uint64_t GetMaxHeaderSize() { return s_maxHeaderSize;}
+    static void SetMaxHeaderSize(uint64_t v) { s_maxHeaderSize = v;}
+
+    /**
+     * @brief 请求体的最大长度
+     */
+    static uint64_t GetMaxBodySize() { return s_maxBodySize;}
+    static void SetMaxBodySize(uint64_t v) { s_maxBodySize = v;}
+
+private:
+    /**
+     * @brief 在[p, end)中查找delim, 取出之前的token(不含delim)
+     * @details 之前没有未完成的token时token直接引用[p, delim), 否则拼接到m_token后引用m_token;
+     *          没有找到delim时把[p, end)追加到m_token等待后续数据
+     * @param[out] token 找到delim时为完整的token, 在下一次scanToken或m_token.clear()之前有效
+     * @return 找到delim时返回true, p指向delim之后
+     */
+    bool scanToken(const char*& p, const char* end, char delim, std::string_view& token);
+
+    /**
+     * @brief 进入错误状态
+     */
+    void setError(HttpStatus status);
+
+    void onUri(std::string_view uri);
+    void onVersion(std::string_view version);
+    void onHeaderLine(std::string_view line);
+    void onHeadersComplete();
+    void onChunkSize(std::string_view line);
+
+private:
+    /// 当前状态
+    State m_state;
+    /// 当前正在解析的请求
+    HttpRequest::ptr m_data;
+    /// 跨越内存块或多次execute的未完成token
+    std::string m_token;
+    /// 请求行和头部已消费的字节数
+    uint64_t m_headerSize;
+    /// 请求体(或当前chunk)剩余的字节数
+    uint64_t m_remaining;
+    /// 出错时的状态码
+    HttpStatus m_errorStatus;
+
+    static uint64_t s_maxHeaderSize;
+    static uint64_t s_maxBodySize;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,63 @@
+#include "http_server.h"
+#include "logger.h"
+#include <cstring>
+
+namespace dag {
+namespace http {
+
+static dag::Logger::ptr g_logger = DAG_LOG_NAME("system");
+
+HttpServer::HttpServer(bool keepalive
+               ,dag::IOManager* worker
+               ,dag::IOManager* io_worker
+               ,dag::IOManager* accept_worker)
+    :TcpServer(worker, io_worker, accept_worker)
+    ,m_isKeepalive(keepalive) {
+    m_dispatch.reset(new ServletDispatch);
+    m_type = "http";
+}
+
+void HttpServer::handleClient(Socket::ptr client) {
+    #if DEBUG
+    DAG_LOG_DEBUG(g_logger) << "handleClient " << *client;
+    #endif
+    HttpSession::ptr session(new HttpSession(client));
+    while(true) {
+        HttpRequest::ptr req = session->recvRequest();
+        if(!req) {
+            if(session->getParserError() != HttpStatus::OK) {
+                HttpResponse::ptr rsp(new HttpResponse(0x11, true));
+                rsp->setStatus(session->getParserError());
+                rsp->setHeader("Server", getName());
+                session->sendResponse(rsp);
+            }
+            #if DEBUG
+            DAG_LOG_DEBUG(g_logger) << "recv http request fail, errno="
+                << errno << " errstr=" << strerror(errno)
+                << " client:" << *client;
+            #endif
+            break;
+        }
+
+        HttpResponse::ptr rsp(new HttpResponse(req->getVersion()
+                            ,req->isClose() || !m_isKeepalive));
+        rsp->setHeader("Server", getName());
+        m_dispatch->handle(req, rsp, session);
+        session->queueResponse(rsp);
+
+        // 缓冲中还有pipelining的请求 -> 继续处理, 最后一起发送
+        if(rsp->isClose() || !session->hasBufferedRequest()) {
+            if(session->flush() < 0) {
+                break;
+            }
+        }
+        if(rsp->isClose()) {
+            break;
+        }
+    }
+    session->flush();
+    session->close();
+}
+
+}
+}
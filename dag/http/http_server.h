@@ -0,0 +1,61 @@
+#ifndef __DAG_HTTP_SERVER_H__
+#define __DAG_HTTP_SERVER_H__
+
+#include "tcp_server.h"
+#include "http_session.h"
+#include "servlet.h"
+
+namespace dag {
+namespace http {
+
+/**
+ * @brief HTTP/1.1服务器
+ * @details 每个连接由一个协程处理: 循环接收请求 -> 路由分发 -> 排队响应;
+ *          客户端pipelining发来的请求全部处理完(缓冲中没有剩余数据)后才flush,
+ *          这样一批请求的响应只需要一次writev
+ */
+class HttpServer : public TcpServer {
+public:
+    using ptr = std::shared_ptr<HttpServer>;
+
+    /**
+     * @brief 构造函数
+     * @param[in] keepalive 是否支持长连接
+     * @param[in] worker 工作调度器
+     * @param[in] io_worker 处理连接的调度器
+     * @param[in] accept_worker 接收连接的调度器
+     */
+    HttpServer(bool keepalive = true
+               ,dag::IOManager* worker = dag::IOManager::GetThis()
+               ,dag::IOManager* io_worker = dag::IOManager::GetThis()
+               ,dag::IOManager* accept_worker = dag::IOManager::GetThis());
+
+    /**
+     * @brief 获取ServletDispatch
+     */
+    ServletDispatch::ptr getServletDispatch() const { return m_dispatch;}
+
+    /**
+     * @brief 设置ServletDispatch
+     */
+    void setServletDispatch(ServletDispatch::ptr v) { m_dispatch = v;}
+
+    /**
+     * @brief 是否支持长连接
+     */
+    bool isKeepalive() const { return m_isKeepalive;}
+
+protected:
+    virtual void handleClient(Socket::ptr client) override;
+
+private:
+    /// 是否支持长连接
+    bool m_isKeepalive;
+    /// Servlet分发器
+    ServletDispatch::ptr m_dispatch;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,98 @@
+#include "http_session.h"
+#include <limits.h>
+#include <sys/uio.h>
+
+namespace dag {
+namespace http {
+
+/// 每次从socket读取的字节数
+static const size_t READ_BUFFER_SIZE = 4096;
+
+HttpSession::HttpSession(Socket::ptr sock, bool owner)
+    : BufferedStream(std::make_shared<SocketStream>(sock, owner), READ_BUFFER_SIZE, READ_BUFFER_SIZE)
+    , m_sockStream(std::static_pointer_cast<SocketStream>(getStream()))
+    , m_parserError(HttpStatus::OK)
+{
+
+}
+
+HttpRequest::ptr HttpSession::recvRequest() {
+    const ByteArray::ptr& buf = getReadBuffer();
+    m_parser.reset();
+    m_parserError = HttpStatus::OK;
+    while(true) {
+        if(buf->getReadSize()) {
+            m_parser.execute(buf);
+            if(m_parser.isFinished()) {
+                return m_parser.getData();
+            }
+            if(m_parser.hasError()) {
+                m_parserError = m_parser.getErrorStatus();
+                return nullptr;
+            }
+        }
+        int rt = fill();
+        if(rt <= 0) {
+            return nullptr;
+        }
+    }
+}
+
+void HttpSession::queueResponse(HttpResponse::ptr rsp) {
+    m_pending.push_back(rsp);
+}
+
+int HttpSession::sendResponse(HttpResponse::ptr rsp) {
+    queueResponse(rsp);
+    return flush();
+}
+
+int HttpSession::flush() {
+    int buffered = BufferedStream::flush();
+    if(buffered < 0 || m_pending.empty()) {
+        return buffered;
+    }
+
+    // 头部字符串必须在发送完成前保持有效
+    std::vector<std::string> headers;
+    headers.reserve(m_pending.size());
+    std::vector<iovec> iovs;
+    iovs.reserve(m_pending.size() * 2);
+    size_t total = 0;
+    for(auto& rsp : m_pending) {
+        headers.push_back(rsp->headerToString());
+        iovs.push_back({(void*)headers.back().data(), headers.back().size()});
+        total += headers.back().size();
+        if(!rsp->getBody().empty()) {
+            iovs.push_back({(void*)rsp->getBody().data(), rsp->getBody().size()});
+            total += rsp->getBody().size();
+        }
+    }
+
+    size_t idx = 0;
+    size_t left = total;
+    int rt = total;
+    while(left > 0) {
+        size_t cnt = std::min<size_t>(iovs.size() - idx, IOV_MAX);
+        int n = getSocket()->send(&iovs[idx], cnt);
+        if(n <= 0) {
+            rt = n;
+            break;
+        }
+        left -= n;
+        // 处理部分写: 跳过已经完整发送的iovec, 调整第一个未发完的iovec
+        while(idx < iovs.size() && (size_t)n >= iovs[idx].iov_len) {
+            n -= iovs[idx].iov_len;
+            ++idx;
+        }
+        if(n > 0) {
+            iovs[idx].iov_base = (char*)iovs[idx].iov_base + n;
+            iovs[idx].iov_len -= n;
+        }
+    }
+    m_pending.clear();
+    return rt;
+}
+
+}
+}
@@ -0,0 +1,86 @@
+#ifndef __DAG_HTTP_SESSION_H__
+#define __DAG_HTTP_SESSION_H__
+
+#include <vector>
+#include "stream/buffered_stream.h"
+#include "stream/socket_stream.h"
+#include "http.h"
+#include "http_parser.h"
+
+namespace dag {
+namespace http {
+
+/**
+ * @brief 服务端的HTTP连接
+ * @details 建立在BufferedStream之上: 连接上收到的数据保存在其读缓冲中由解析器增量解析，
+ *          一次读到的多个(pipelining)请求依次解析，剩余字节留给下一个请求;
+ *          响应先排队，flush时把所有响应的头部和body作为iovec一次writev发出
+ */
+class HttpSession : public BufferedStream {
+public:
+    using ptr = std::shared_ptr<HttpSession>;
+
+    /**
+     * @brief 构造函数
+     * @param[in] sock 客户端连接
+     * @param[in] owner 是否托管sock
+     */
+    HttpSession(Socket::ptr sock, bool owner = true);
+
+    /**
+     * @brief 接收一个HTTP请求
+     * @return 成功返回请求, 连接关闭或出错返回nullptr
+     * @note 解析出错时可以通过getParserError()拿到应该返回的状态码
+     */
+    HttpRequest::ptr recvRequest();
+
+    /**
+     * @brief 将响应加入发送队列, 调用flush()后才真正发送
+     */
+    void queueResponse(HttpResponse::ptr rsp);
+
+    /**
+     * @brief 立即发送一个响应(包括之前排队的响应)
+     * @return >0 发送的字节数, <=0 出错
+     */
+    int sendResponse(HttpResponse::ptr rsp);
+
+    /**
+     * @brief 通过一次(或少数几次)writev发送所有排队的响应
+     * @details 先发出通过write()写入写缓冲的数据
+     * @return >=0 发送的字节数, <0 出错
+     */
+    int flush();
+
+    /**
+     * @brief 缓冲中是否还有未解析的数据(即客户端pipelining发来的后续请求)
+     */
+    bool hasBufferedRequest() const { return getReadBufferedSize() > 0;}
+
+    /**
+     * @brief 返回客户端连接
+     */
+    Socket::ptr getSocket() const { return m_sockStream->getSocket();}
+
+    std::string getRemoteAddressString() { return m_sockStream->getRemoteAddressString();}
+
+    /**
+     * @brief 最近一次解析失败对应的状态码, 没有出错时为HttpStatus::OK
+     */
+    HttpStatus getParserError() const { return m_parserError;}
+
+private:
+    /// 被装饰的socket流
+    SocketStream::ptr m_sockStream;
+    /// 请求解析器
+    HttpRequestParser m_parser;
+    /// 等待发送的响应
+    std::vector<HttpResponse::ptr> m_pending;
+    /// 最近一次解析错误
+    HttpStatus m_parserError;
+};
+
+}
+}
+
+#endif
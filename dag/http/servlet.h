@@ -0,0 +1,183 @@
+#ifndef __DAG_HTTP_SERVLET_H__
+#define __DAG_HTTP_SERVLET_H__
+
+#include <functional>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "http.h"
+#include "http_session.h"
+
+namespace dag {
+namespace http {
+
+/**
+ * @brief Servlet基类, 处理一个HTTP请求
+ */
+class Servlet {
+public:
+    using ptr = std::shared_ptr<Servlet>;
+
+    /**
+     * @brief 构造函数
+     * @param[in] name 名称
+     */
+    Servlet(const std::string& name)
+        :m_name(name) {}
+
+    virtual ~Servlet() {}
+
+    /**
+     * @brief 处理请求
+     * @param[in] request HTTP请求
+     * @param[out] response HTTP响应
+     * @param[in] session HTTP连接
+     * @return 是否处理成功
+     */
+    virtual int32_t handle(HttpRequest::ptr request
+                   , HttpResponse::ptr response
+                   , HttpSession::ptr session) = 0;
+
+    /**
+     * @brief 返回Servlet名称
+     */
+    const std::string& getName() const { return m_name;}
+
+protected:
+    /// 名称
+    std::string m_name;
+};
+
+/**
+ * @brief 函数式Servlet
+ */
+class FunctionServlet : public Servlet {
+public:
+    using ptr = std::shared_ptr<FunctionServlet>;
+    /// 函数回调类型定义
+    using callback = std::function<int32_t (HttpRequest::ptr request
+                   , HttpResponse::ptr response
+                   , HttpSession::ptr session)>;
+
+    /**
+     * @brief 构造函数
+     * @param[in] cb 回调函数
+     */
+    FunctionServlet(callback cb);
+
+    virtual int32_t handle(HttpRequest::ptr request
+                   , HttpResponse::ptr response
+                   , HttpSession::ptr session) override;
+
+private:
+    /// 回调函数
+    callback m_cb;
+};
+
+/**
+ * @brief 路由未命中时返回404的Servlet
+ */
+class NotFoundServlet : public Servlet {
+public:
+    using ptr = std::shared_ptr<NotFoundServlet>;
+
+    NotFoundServlet(const std::string& name);
+
+    virtual int32_t handle(HttpRequest::ptr request
+                   , HttpResponse::ptr response
+                   , HttpSession::ptr session) override;
+
+private:
+    std::string m_name;
+    std::string m_content;
+};
+
+/**
+ * @brief Servlet分发器(路由表)
+ * @details 先按精确路径查找, 再按添加顺序匹配通配(fnmatch)路径, 都未命中时使用默认Servlet
+ */
+class ServletDispatch : public Servlet {
+public:
+    using ptr = std::shared_ptr<ServletDispatch>;
+
+    ServletDispatch();
+
+    virtual int32_t handle(HttpRequest::ptr request
+                   , HttpResponse::ptr response
+                   , HttpSession::ptr session) override;
+
+    /**
+     * @brief 添加精确匹配的servlet
+     * @param[in] uri uri
+     * @param[in] slt serlvet
+     */
+    void addServlet(const std::string& uri, Servlet::ptr slt);
+
+    /**
+     * @brief 添加精确匹配的回调servlet
+     */
+    void addServlet(const std::string& uri, FunctionServlet::callback cb);
+
+    /**
+     * @brief 添加通配servlet
+     * @param[in] uri uri模糊匹配, 如 /dag/\*
+     */
+    void addGlobServlet(const std::string& uri, Servlet::ptr slt);
+
+    /**
+     * @brief 添加通配的回调servlet
+     */
+    void addGlobServlet(const std::string& uri, FunctionServlet::callback cb);
+
+    /**
+     * @brief 删除精确匹配的servlet
+     */
+    void delServlet(const std::string& uri);
+
+    /**
+     * @brief 删除通配servlet
+     */
+    void delGlobServlet(const std::string& uri);
+
+    /**
+     * @brief 返回默认servlet
+     */
+    Servlet::ptr getDefault() const { return m_default;}
+
+    /**
+     * @brief 设置默认servlet
+     */
+    void setDefault(Servlet::ptr v) { m_default = v;}
+
+    /**
+     * @brief 通过uri获取精确匹配的servlet
+     */
+    Servlet::ptr getServlet(const std::string& uri);
+
+    /**
+     * @brief 通过uri获取通配servlet
+     */
+    Servlet::ptr getGlobServlet(const std::string& uri);
+
+    /**
+     * @brief 通过uri获取servlet, 优先精确匹配, 其次通配, 最后返回默认
+     */
+    Servlet::ptr getMatchedServlet(const std::string& uri);
+
+private:
+    /// 读写互斥量, 路由表读多写少
+    std::shared_mutex m_mutex;
+    /// 精确匹配servlet uri -> servlet
+    std::unordered_map<std::string, Servlet::ptr> m_datas;
+    /// 通配servlet uri(/dag/*) -> servlet
+    std::vector<std::pair<std::string, Servlet::ptr> > m_globs;
+    /// 默认servlet, 所有路径都没匹配到时使用
+    Servlet::ptr m_default;
+};
+
+}
+}
+
+#endif
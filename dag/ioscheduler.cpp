@@ -5,6 +5,8 @@
 #include <stdexcept>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sched.h>
+#include <time.h>
 
 #include "ioscheduler.h"
 #include "scheduler.h"
@@ -18,6 +20,23 @@
 namespace dag
 {
 
+static uint64_t NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// 自旋等待时提示CPU降低功耗并让出流水线
+static inline void CpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
 static dag::Logger::ptr g_logger = DAG_LOG_ROOT();
 
 IOManager* IOManager::GetThis()
@@ -43,6 +62,20 @@ IOManager::FdContext::EventContext& IOManager::FdContext::getEventContext(Event
 
 IOManager::IOManager(size_t threads, bool use_caller, const std::string &name)
     : Scheduler(threads, use_caller, name)
+{
+    init();
+}
+
+IOManager::IOManager(size_t threads, bool use_caller, const std::string &name
+                     ,const std::vector<int> &cpus, bool one_per_worker)
+    : Scheduler(threads, use_caller, name)
+{
+    // 亲和性必须在start()创建工作线程之前设置
+    setCpuAffinity(cpus, one_per_worker);
+    init();
+}
+
+void IOManager::init()
 {
     //create epoll fd
     m_epfd = epoll_create(5000);
@@ -132,7 +165,8 @@ int IOManager::addEvent(int fd, Event event, std::function<void()> cb)
         DAG_ASSERT(!(fd_ctx->events & event));
     }
 
-    int op = fd_ctx->events ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
+    // 设置了错误事件处理函数时fd一直在epoll中
+    int op = fd_ctx->events || fd_ctx->error.cb ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
     epoll_event epevent;
     epevent.events =  EPOLLET | fd_ctx->events | event;
     epevent.data.ptr = fd_ctx;
@@ -190,7 +224,7 @@ bool IOManager::delEvent(int fd, Event event)
     }
 
     Event new_events = (Event)(fd_ctx->events & ~event);
-    int op =  new_events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+    int op =  new_events || fd_ctx->error.cb ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
     epoll_event epevent;
     epevent.events = EPOLLET | new_events;
     epevent.data.ptr = fd_ctx;
@@ -231,7 +265,7 @@ bool IOManager::cancelEvent(int fd,Event event)
     }
 
     Event new_events = (Event)(fd_ctx->events & ~event);
-    int op = new_events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+    int op = new_events || fd_ctx->error.cb ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
     epoll_event epevent;
     epevent.events = new_events | EPOLLET;
     epevent.data.ptr = fd_ctx;
@@ -271,7 +305,7 @@ bool IOManager::cancelAll(int fd)
     }
 
     std::lock_guard<std::mutex> lock(fd_ctx->mutex);
-    if (!fd_ctx->events) {
+    if (!fd_ctx->events && !fd_ctx->error.cb) {
         return false;
     }
 
@@ -294,6 +328,7 @@ bool IOManager::cancelAll(int fd)
         #endif
         return false;
     }
+    fd_ctx->resetEventContext(fd_ctx->error);
     
     if (fd_ctx->events & READ) {
         fd_ctx->triggerEvent(READ);
@@ -309,9 +344,61 @@ bool IOManager::cancelAll(int fd)
     return true;
 }
 
+int IOManager::setErrorHandler(int fd, std::function<void()> cb)
+{
+    FdContext* fd_ctx = nullptr;
+
+    std::shared_lock<std::shared_mutex> read_lock(m_mutex);
+    if ((int)m_fdContexts.size() > fd)
+    {
+        fd_ctx = m_fdContexts[fd];
+        read_lock.unlock();
+    }
+    else
+    {
+        read_lock.unlock();
+        std::unique_lock<std::shared_mutex> write_lock(m_mutex);
+        contextResize(fd * 1.5);
+        fd_ctx = m_fdContexts[fd];
+    }
+
+    std::lock_guard<std::mutex> lock(fd_ctx->mutex);
+    bool registered = fd_ctx->events || fd_ctx->error.cb;
+    // 只有读写事件也没有时才需要加入或移出epoll, 否则只替换处理函数
+    if (registered != (fd_ctx->events || cb))
+    {
+        int op = cb ? EPOLL_CTL_ADD : EPOLL_CTL_DEL;
+        epoll_event epevent;
+        epevent.events = EPOLLET;
+        epevent.data.ptr = fd_ctx;
+        int rt = epoll_ctl(m_epfd, op, fd, &epevent);
+        if (rt)
+        {
+            #if DEBUG
+            DAG_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", "
+                << op << ", " << fd << ", " << (EPOLL_EVENTS)epevent.events << "):"
+                << rt << " (" << errno << ") (" << strerror(errno) << ")";
+            #endif
+            return -1;
+        }
+    }
+
+    if (cb)
+    {
+        Scheduler* scheduler = Scheduler::GetThis();
+        fd_ctx->error.scheduler = scheduler ? scheduler : this;
+        fd_ctx->error.cb.swap(cb);
+    }
+    else
+    {
+        fd_ctx->resetEventContext(fd_ctx->error);
+    }
+    return 0;
+}
+
 void IOManager::tickle() {
-    // no idle threads
-    if (!hasIdleThreads())
+    // 没有阻塞在epoll_wait的线程, 自旋/轮询中的线程自己会看到新任务
+    if (m_parkedThreadCount == 0)
     {
         return;
     }
@@ -335,6 +422,15 @@ void IOManager::idle()
     std::unique_ptr<epoll_event[],void(*)(epoll_event*)> events(new epoll_event[MAX_EVENTS],[](epoll_event* ep) {
         delete[] ep;
     });
+
+    std::shared_ptr<IdleCounters> counters = std::make_shared<IdleCounters>();
+    {
+        std::lock_guard<std::mutex> lock(m_idleMutex);
+        m_idleCounters[getThreadId()] = counters;
+    }
+    // 自适应的自旋预算和空闲间隔的滑动平均
+    uint64_t spin_budget_ns = 0;
+    uint64_t avg_gap_ns = 0;
     
     while (true)
     {
@@ -343,105 +439,206 @@ void IOManager::idle()
         if(stopping())
         {
             // if(debug) std::cout << "name = " << getName() << " idle exits in thread: " << getThreadId() << std::endl;
+            // stop()的多次tickle可能被先醒来的线程一次读完, 退出前接力唤醒下一个仍阻塞的线程
+            tickle();
+            break;
+        }
+        // 弹性模式下本线程被选中退出
+        if(retiring())
+        {
             break;
         }
 
-        //blocked at epoll_wait
+        uint64_t idle_start = NowNs();
+        uint64_t max_spin_ns = m_maxSpinUs * 1000;
+        uint64_t spin_ns = m_adaptiveSpin ? std::min(spin_budget_ns, max_spin_ns) : max_spin_ns;
+        bool woken = false;
         int rt = 0;
-        while(true)
+
+        // 1 自旋: 只读原子计数, 不进内核; 每轮让出一次CPU, 核数少时不至于饿死生产者
+        if (spin_ns > 0)
         {
-            static const uint64_t MAX_TIMEOUT = 5000;
-            uint64_t next_timeout = getNextTimer(); //最近要到期的定时器
-            next_timeout = std::min(next_timeout,MAX_TIMEOUT); //限制最大等待时间
-            rt = epoll_wait(m_epfd,events.get(),MAX_EVENTS,(int)next_timeout);
-            if (rt < 0 && errno == EINTR)
+            while (true)
             {
-                continue;
+                if (hasPendingTasks())
+                {
+                    woken = true;
+                    counters->spin_hits++;
+                    break;
+                }
+                if (NowNs() - idle_start >= spin_ns)
+                {
+                    break;
+                }
+                for (int i = 0; i < 64; ++i)
+                {
+                    CpuRelax();
+                }
+                sched_yield();
+            }
+            counters->spin_ns += NowNs() - idle_start;
+        }
+
+        // 2 以0超时轮询epoll
+        for (uint32_t i = 0, n = m_pollCount; !woken && i < n; ++i)
+        {
+            rt = epoll_wait(m_epfd, events.get(), MAX_EVENTS, 0);
+            if (rt < 0)
+            {
+                rt = 0;
             }
-            else
+            if (rt > 0 || hasPendingTasks() || getNextTimer() == 0)
             {
+                woken = true;
+                counters->poll_hits++;
                 break;
             }
-        };
+            sched_yield();
+        }
 
-            std::vector<std::function<void()>> cbs;
-            listExpiredCb(cbs);
-            
-            if(!cbs.empty())
+        // 3 阻塞在epoll_wait
+        // 先登记为阻塞再检查任务, 与tickle先入队再检查阻塞线程数配对, 避免漏掉唤醒
+        if (!woken)
+        {
+            m_parkedThreadCount++;
+            if (!hasPendingTasks() && !stopping())
             {
-                for(const auto& cb : cbs)
+                counters->parks++;
+                while(true)
                 {
-                    schedulerLock(cb);
-                }
-                cbs.clear();
+                    static const uint64_t MAX_TIMEOUT = 5000;
+                    uint64_t next_timeout = getNextTimer(); //最近要到期的定时器
+                    next_timeout = std::min(next_timeout,MAX_TIMEOUT); //限制最大等待时间
+                    rt = epoll_wait(m_epfd,events.get(),MAX_EVENTS,(int)next_timeout);
+                    if (rt < 0 && errno == EINTR)
+                    {
+                        continue;
+                    }
+                    else
+                    {
+                        break;
+                    }
+                };
             }
+            m_parkedThreadCount--;
+        }
 
-            for (int i = 0;i < rt;++i)
-            {
-                epoll_event& event = events[i];
+        // 根据空闲间隔调整自旋预算: 间隔普遍短于上限时自旋到两倍平均间隔, 否则不自旋直接阻塞
+        uint64_t gap_ns = NowNs() - idle_start;
+        avg_gap_ns = avg_gap_ns ? avg_gap_ns - avg_gap_ns / 8 + gap_ns / 8 : gap_ns;
+        spin_budget_ns = avg_gap_ns <= max_spin_ns ? std::min(avg_gap_ns * 2, max_spin_ns) : 0;
+        counters->spin_budget_ns = spin_budget_ns;
+        counters->avg_gap_ns = avg_gap_ns;
 
-                if (event.data.fd == m_tickleFds[0])
-                {
-                    uint8_t dummy[256];
+        dispatchEvents(events.get(), rt);
+        Fiber::GetThis()->yield();
+    } // end while(true)
+}
 
-                    while (read(m_tickleFds[0], dummy, sizeof(dummy)) > 0);
-                    continue;
-                }
+void IOManager::dispatchEvents(epoll_event* events, int rt)
+{
+    std::vector<std::function<void()>> cbs;
+    listExpiredCb(cbs);
 
-                FdContext* fd_ctx = (FdContext *)event.data.ptr;
-                std::lock_guard<std::mutex> lock(fd_ctx->mutex);
+    if(!cbs.empty())
+    {
+        for(const auto& cb : cbs)
+        {
+            schedulerLock(cb);
+        }
+        cbs.clear();
+    }
 
-                if (event.events & (EPOLLERR | EPOLLHUP))
-                {
-                    event.events |= (EPOLLIN | EPOLLOUT) & fd_ctx->events;
-                }
+    for (int i = 0;i < rt;++i)
+    {
+        epoll_event& event = events[i];
 
-                int real_events = NONE;
-                if (event.events & EPOLLIN)
-                {
-                    real_events |= READ;
-                }
-                if (event.events & EPOLLOUT)
-                {
-                    real_events |= WRITE;
-                }
-                if ((fd_ctx->events & real_events) == NONE)
-                {
-                    continue;
-                }
+        if (event.data.fd == m_tickleFds[0])
+        {
+            uint8_t dummy[256];
 
-                int left_events = (fd_ctx->events & ~real_events);
-                int op = left_events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
-                event.events = EPOLLET | left_events;
-
-                int rt2 = epoll_ctl(m_epfd, op, fd_ctx->fd, &event);
-                // if (rt2)
-                // {
-                //     std::cerr << "idle::epoll_ctl failed: " << strerror(errno) << std::endl;
-                //     continue;
-                // }
-                if(rt2) {
-                    #if DEBUG
-                    DAG_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", "
-                        << op << ", " << fd_ctx->fd << ", " << (EPOLL_EVENTS)event.events << "):"
-                        << rt2 << " (" << errno << ") (" << strerror(errno) << ")";
-                    #endif
-                    continue;
-                }
+            while (read(m_tickleFds[0], dummy, sizeof(dummy)) > 0);
+            continue;
+        }
 
-                if (real_events & READ)
-                {
-                    fd_ctx->triggerEvent(READ);
-                    --m_pendingEvenCount;
-                }
-                if (real_events & WRITE)
-                {
-                    fd_ctx->triggerEvent(WRITE);
-                    --m_pendingEvenCount;
-                }
-            } //end for
-            Fiber::GetThis()->yield();
-    } // end while(true)
+        FdContext* fd_ctx = (FdContext *)event.data.ptr;
+        std::lock_guard<std::mutex> lock(fd_ctx->mutex);
+
+        // 错误事件处理函数常驻, 不需要修改epoll注册
+        if ((event.events & EPOLLERR) && fd_ctx->error.cb)
+        {
+            fd_ctx->error.scheduler->schedulerLock(fd_ctx->error.cb);
+        }
+
+        if (event.events & (EPOLLERR | EPOLLHUP))
+        {
+            event.events |= (EPOLLIN | EPOLLOUT) & fd_ctx->events;
+        }
+
+        int real_events = NONE;
+        if (event.events & EPOLLIN)
+        {
+            real_events |= READ;
+        }
+        if (event.events & EPOLLOUT)
+        {
+            real_events |= WRITE;
+        }
+        if ((fd_ctx->events & real_events) == NONE)
+        {
+            continue;
+        }
+
+        int left_events = (fd_ctx->events & ~real_events);
+        int op = left_events || fd_ctx->error.cb ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
+        event.events = EPOLLET | left_events;
+
+        int rt2 = epoll_ctl(m_epfd, op, fd_ctx->fd, &event);
+        // if (rt2)
+        // {
+        //     std::cerr << "idle::epoll_ctl failed: " << strerror(errno) << std::endl;
+        //     continue;
+        // }
+        if(rt2) {
+            #if DEBUG
+            DAG_LOG_ERROR(g_logger) << "epoll_ctl(" << m_epfd << ", "
+                << op << ", " << fd_ctx->fd << ", " << (EPOLL_EVENTS)event.events << "):"
+                << rt2 << " (" << errno << ") (" << strerror(errno) << ")";
+            #endif
+            continue;
+        }
+
+        if (real_events & READ)
+        {
+            fd_ctx->triggerEvent(READ);
+            --m_pendingEvenCount;
+        }
+        if (real_events & WRITE)
+        {
+            fd_ctx->triggerEvent(WRITE);
+            --m_pendingEvenCount;
+        }
+    }
+}
+
+void IOManager::pollWhileBusy()
+{
+    uint64_t interval_ns = m_busyPollUs * 1000;
+    if (interval_ns == 0)
+    {
+        return;
+    }
+    uint64_t now = NowNs();
+    uint64_t last = m_lastBusyPollNs.load(std::memory_order_relaxed);
+    // 同一时刻只需要一个线程去轮询
+    if (now - last < interval_ns || !m_lastBusyPollNs.compare_exchange_strong(last, now))
+    {
+        return;
+    }
+    static const int MAX_EVENTS = 64;
+    epoll_event events[MAX_EVENTS];
+    int rt = epoll_wait(m_epfd, events, MAX_EVENTS, 0);
+    dispatchEvents(events, rt < 0 ? 0 : rt);
 }
 
 IOManager::~IOManager()
@@ -471,6 +668,39 @@ void IOManager::contextResize(size_t size)
     }
 }
 
+void IOManager::setIdlePolicy(const IdlePolicy& policy)
+{
+    m_maxSpinUs = policy.max_spin_us;
+    m_pollCount = policy.poll_count;
+    m_adaptiveSpin = policy.adaptive;
+}
+
+IOManager::IdlePolicy IOManager::getIdlePolicy() const
+{
+    IdlePolicy policy;
+    policy.max_spin_us = m_maxSpinUs;
+    policy.poll_count = m_pollCount;
+    policy.adaptive = m_adaptiveSpin;
+    return policy;
+}
+
+std::map<int, IOManager::IdleStats> IOManager::getIdleStats()
+{
+    std::map<int, IdleStats> stats;
+    std::lock_guard<std::mutex> lock(m_idleMutex);
+    for (auto& i : m_idleCounters)
+    {
+        IdleStats& st = stats[i.first];
+        st.spin_hits = i.second->spin_hits;
+        st.poll_hits = i.second->poll_hits;
+        st.parks = i.second->parks;
+        st.spin_ns = i.second->spin_ns;
+        st.spin_budget_ns = i.second->spin_budget_ns;
+        st.avg_gap_ns = i.second->avg_gap_ns;
+    }
+    return stats;
+}
+
 void IOManager::onTimerInsertedAtFront()
 {
     tickle();
@@ -1,6 +1,9 @@
 #ifndef _IO_MANAGE_H_
 #define _IO_MANAGE_H_
 
+#include <map>
+#include <shared_mutex>
+#include <sys/epoll.h>
 #include "scheduler.h"
 #include "timer.h"
 
@@ -43,6 +46,8 @@ private:
         EventContext read;
         // 写事件上下文
         EventContext write;
+        // 错误事件(EPOLLERR)上下文, 只用cb, 触发后不删除
+        EventContext error;
         // 事件关联的句柄
         int fd = 0;
         // 该fd添加了那些事件的回掉函数,或者说该fd关心那些事件
@@ -80,6 +85,17 @@ public:
     */
     IOManager(size_t threads = 1, bool use_caller = true, const std::string &name = "IOManager");
 
+    /**
+    * @brief 构造函数, 工作线程按cpus绑核
+    * @param[in] threads 线程数量
+    * @param[in] use_caller 是否将当前线程也作为调度线程
+    * @param[in] name 调度器的名称
+    * @param[in] cpus CPU编号列表, 为空表示全部在线CPU
+    * @param[in] one_per_worker 是否每个工作线程只绑定一个核, 见Scheduler::setCpuAffinity
+    */
+    IOManager(size_t threads, bool use_caller, const std::string &name
+              ,const std::vector<int> &cpus, bool one_per_worker = true);
+
     ~IOManager();
 
     /**
@@ -113,8 +129,77 @@ public:
      */
     bool cancelAll(int fd);
 
+    /**
+     * @brief 设置fd的错误事件处理函数
+     * @details fd上出现EPOLLERR(如错误队列中有MSG_ZEROCOPY的完成通知)时, 在设置时所在的调度器上执行cb;
+     *          与读写事件不同, 触发后不删除, 一直有效到设置为空或cancelAll; 不计入待处理事件数, 不会阻止调度器停止
+     * @param[in] fd socket句柄
+     * @param[in] cb 处理函数, 为空表示删除
+     * @return 成功返回0,失败返回 -1
+     */
+    int setErrorHandler(int fd, std::function<void()> cb);
+
     static IOManager* GetThis();
 
+    /**
+    * @brief 空闲策略
+    * @details 工作线程没有任务时依次: 自旋检查任务队列 -> 以0超时轮询epoll -> 阻塞在epoll_wait;
+    *          只有阻塞的线程才需要tickle写pipe唤醒, 自旋/轮询期间到达的任务不产生系统调用;
+    *          默认不自旋也不轮询, 与直接阻塞在epoll_wait相同
+    */
+    struct IdlePolicy
+    {
+        // 自旋时间上限(微秒), 0表示不自旋
+        uint64_t max_spin_us = 0;
+        // 阻塞前以0超时调用epoll_wait的次数
+        uint32_t poll_count = 0;
+        // 是否根据观察到的任务到达间隔调整自旋时间, 否则每次都自旋max_spin_us
+        bool adaptive = true;
+    };
+
+    /**
+    * @brief 单个工作线程的空闲统计
+    */
+    struct IdleStats
+    {
+        // 自旋期间等到任务的次数
+        uint64_t spin_hits = 0;
+        // 0超时轮询等到任务或IO事件的次数
+        uint64_t poll_hits = 0;
+        // 阻塞在epoll_wait的次数
+        uint64_t parks = 0;
+        // 累计自旋时间(纳秒)
+        uint64_t spin_ns = 0;
+        // 当前自旋预算(纳秒)
+        uint64_t spin_budget_ns = 0;
+        // 空闲间隔的滑动平均(纳秒)
+        uint64_t avg_gap_ns = 0;
+    };
+
+    /**
+    * @brief 设置空闲策略, 工作线程下一次进入空闲时生效
+    */
+    void setIdlePolicy(const IdlePolicy& policy);
+
+    /**
+    * @brief 返回当前空闲策略
+    */
+    IdlePolicy getIdlePolicy() const;
+
+    /**
+    * @brief 返回各工作线程的空闲统计, key为线程id
+    */
+    std::map<int, IdleStats> getIdleStats();
+
+    /**
+    * @brief 设置忙碌时轮询IO事件和定时器的间隔(微秒), 默认1000, 0表示只在idle中处理
+    * @details 任务队列一直不空时工作线程不会进入idle, 就绪的IO事件和到期的定时器得不到处理,
+    *          等待它们的高优先级协程也就进不了队列; 开启后最多每个间隔由一个工作线程以0超时轮询一次
+    */
+    void setBusyPollInterval(uint64_t us) {m_busyPollUs = us;}
+
+    uint64_t getBusyPollInterval() const {return m_busyPollUs;}
+
 protected:
     /**
     * @brief 通知调度器有任务要调度
@@ -135,9 +220,38 @@ protected:
     */
     void idle() override;
 
+    void pollWhileBusy() override;
+
     void onTimerInsertedAtFront() override;
 
     void contextResize(size_t size);
+
+    /**
+    * @brief 创建epoll和tickle管道并启动工作线程
+    */
+    void init();
+
+private:
+    /**
+    * @brief 把到期的定时器回调和epoll返回的就绪事件放入调度队列
+    * @param[in] events epoll_wait返回的事件
+    * @param[in] rt 事件个数
+    */
+    void dispatchEvents(epoll_event* events, int rt);
+
+private:
+    /**
+    * @brief 空闲统计计数器, 工作线程写, getIdleStats读
+    */
+    struct IdleCounters
+    {
+        std::atomic<uint64_t> spin_hits = {0};
+        std::atomic<uint64_t> poll_hits = {0};
+        std::atomic<uint64_t> parks = {0};
+        std::atomic<uint64_t> spin_ns = {0};
+        std::atomic<uint64_t> spin_budget_ns = {0};
+        std::atomic<uint64_t> avg_gap_ns = {0};
+    };
     
 private:
     // epoll 文件句柄
@@ -150,6 +264,19 @@ private:
     std::shared_mutex m_mutex;
     // socket事件上下文的容器
     std::vector<FdContext*> m_fdContexts;
+    // 阻塞在epoll_wait中的线程数, tickle只需唤醒这些线程
+    std::atomic<size_t> m_parkedThreadCount = {0};
+    // 空闲策略
+    std::atomic<uint64_t> m_maxSpinUs = {0};
+    std::atomic<uint32_t> m_pollCount = {0};
+    std::atomic<bool> m_adaptiveSpin = {true};
+    // 忙碌时轮询IO事件的间隔(微秒)和上次轮询的时间(纳秒)
+    std::atomic<uint64_t> m_busyPollUs = {1000};
+    std::atomic<uint64_t> m_lastBusyPollNs = {0};
+    // 保护m_idleCounters
+    std::mutex m_idleMutex;
+    // 各工作线程的空闲统计
+    std::map<int, std::shared_ptr<IdleCounters>> m_idleCounters;
 };
 
 }
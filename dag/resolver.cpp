@@ -0,0 +1,871 @@
+#include "resolver.h"
+#include <algorithm>
+#include <errno.h>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <string.h>
+#include <arpa/inet.h>
+#include <atomic>
+#include <sys/stat.h>
+#include "logger.h"
+#include "socket.h"
+#include "utils/util.h"
+
+namespace dag {
+
+static Logger::ptr g_logger = DAG_LOG_NAME("system");
+
+namespace {
+
+const uint16_t TYPE_A = 1;
+const uint16_t TYPE_CNAME = 5;
+const uint16_t TYPE_SOA = 6;
+const uint16_t TYPE_AAAA = 28;
+const uint16_t CLASS_IN = 1;
+// 不使用EDNS时UDP应答的最大长度
+const size_t MAX_UDP_RESPONSE = 512;
+// 应答与查询不对应(id、问题不同), 继续等待
+const int RESPONSE_MISMATCH = -1;
+
+std::string ToLower(const std::string& s) {
+    std::string rt(s);
+    std::transform(rt.begin(), rt.end(), rt.begin(), [](unsigned char c) { return tolower(c); });
+    return rt;
+}
+
+uint16_t Read16(const uint8_t* p) {
+    return (uint16_t)(p[0] << 8 | p[1]);
+}
+
+uint32_t Read32(const uint8_t* p) {
+    return (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+}
+
+void Write16(std::string& out, uint16_t v) {
+    out.push_back((char)(v >> 8));
+    out.push_back((char)(v & 0xff));
+}
+
+/**
+ * @brief 生成查询报文, 名字不合法时返回false
+ */
+bool BuildQuery(std::string& out, uint16_t id, const std::string& fqdn, uint16_t qtype) {
+    Write16(out, id);
+    // RD
+    Write16(out, 0x0100);
+    Write16(out, 1);
+    Write16(out, 0);
+    Write16(out, 0);
+    Write16(out, 0);
+    if(fqdn.size() > 253) {
+        return false;
+    }
+    size_t begin = 0;
+    while(begin < fqdn.size()) {
+        size_t end = fqdn.find('.', begin);
+        if(end == std::string::npos) {
+            end = fqdn.size();
+        }
+        size_t len = end - begin;
+        if(len == 0 || len > 63) {
+            return false;
+        }
+        out.push_back((char)len);
+        out.append(fqdn, begin, len);
+        begin = end + 1;
+    }
+    out.push_back('\0');
+    Write16(out, qtype);
+    Write16(out, CLASS_IN);
+    return true;
+}
+
+/**
+ * @brief 读取(可能压缩的)名字, 转为小写、不带末尾的点
+ * @param[in, out] pos 读取位置, 返回时指向名字之后
+ */
+bool ReadName(const uint8_t* msg, size_t len, size_t& pos, std::string& name) {
+    name.clear();
+    size_t cur = pos;
+    bool jumped = false;
+    for(int jumps = 0; jumps < 32;) {
+        if(cur >= len) {
+            return false;
+        }
+        uint8_t c = msg[cur];
+        if(c == 0) {
+            if(!jumped) {
+                pos = cur + 1;
+            }
+            return true;
+        }
+        if((c & 0xc0) == 0xc0) {
+            if(cur + 1 >= len) {
+                return false;
+            }
+            if(!jumped) {
+                pos = cur + 2;
+            }
+            jumped = true;
+            cur = ((c & 0x3f) << 8) | msg[cur + 1];
+            ++jumps;
+            continue;
+        }
+        if((c & 0xc0) || cur + 1 + c > len) {
+            return false;
+        }
+        if(!name.empty()) {
+            name.push_back('.');
+        }
+        for(size_t i = 0; i < c; ++i) {
+            name.push_back((char)tolower(msg[cur + 1 + i]));
+        }
+        if(name.size() > 255) {
+            return false;
+        }
+        cur += 1 + c;
+    }
+    return false;
+}
+
+/**
+ * @brief 应答中的一条资源记录
+ */
+struct RR {
+    std::string name;
+    uint16_t type;
+    uint16_t klass;
+    uint32_t ttl;
+    size_t rdata;
+    uint16_t rdlen;
+};
+
+bool ReadRR(const uint8_t* msg, size_t len, size_t& pos, RR& rr) {
+    if(!ReadName(msg, len, pos, rr.name) || pos + 10 > len) {
+        return false;
+    }
+    rr.type = Read16(msg + pos);
+    rr.klass = Read16(msg + pos + 2);
+    rr.ttl = Read32(msg + pos + 4);
+    // 最高位为1的TTL按0处理
+    if(rr.ttl & 0x80000000u) {
+        rr.ttl = 0;
+    }
+    rr.rdlen = Read16(msg + pos + 8);
+    rr.rdata = pos + 10;
+    pos = rr.rdata + rr.rdlen;
+    return pos <= len;
+}
+
+/**
+ * @brief 从authority段的SOA取否定缓存时间: min(SOA的TTL, SOA的minimum)
+ */
+uint32_t NegativeTtl(const uint8_t* msg, size_t len, size_t pos, uint16_t nscount, uint32_t def) {
+    for(uint16_t i = 0; i < nscount; ++i) {
+        RR rr;
+        if(!ReadRR(msg, len, pos, rr)) {
+            break;
+        }
+        if(rr.type != TYPE_SOA) {
+            continue;
+        }
+        size_t p = rr.rdata;
+        std::string skip;
+        if(!ReadName(msg, len, p, skip) || !ReadName(msg, len, p, skip) || p + 20 > len) {
+            break;
+        }
+        return std::min(rr.ttl, Read32(msg + p + 16));
+    }
+    return def;
+}
+
+/**
+ * @brief 解析应答
+ * @return RESPONSE_MISMATCH或Resolver::Status
+ */
+int ParseResponse(const uint8_t* msg, size_t len, uint16_t id, const std::string& fqdn, uint16_t qtype
+                  ,uint32_t negative_ttl, std::vector<Resolver::Record>& result, uint32_t& ttl) {
+    if(len < 12 || Read16(msg) != id || !(msg[2] & 0x80)) {
+        return RESPONSE_MISMATCH;
+    }
+    uint8_t rcode = msg[3] & 0x0f;
+    uint16_t qdcount = Read16(msg + 4);
+    uint16_t ancount = Read16(msg + 6);
+    uint16_t nscount = Read16(msg + 8);
+    size_t pos = 12;
+    std::string qname;
+    if(qdcount != 1 || !ReadName(msg, len, pos, qname) || pos + 4 > len
+            || qname != fqdn || Read16(msg + pos) != qtype) {
+        return RESPONSE_MISMATCH;
+    }
+    pos += 4;
+
+    // NXDOMAIN
+    if(rcode == 3) {
+        size_t ns_pos = pos;
+        for(uint16_t i = 0; i < ancount; ++i) {
+            RR rr;
+            if(!ReadRR(msg, len, ns_pos, rr)) {
+                ttl = negative_ttl;
+                return Resolver::NOT_FOUND;
+            }
+        }
+        ttl = NegativeTtl(msg, len, ns_pos, nscount, negative_ttl);
+        return Resolver::NOT_FOUND;
+    }
+    if(rcode != 0) {
+        return Resolver::SERVER_FAIL;
+    }
+
+    std::vector<RR> answers;
+    for(uint16_t i = 0; i < ancount; ++i) {
+        RR rr;
+        if(!ReadRR(msg, len, pos, rr)) {
+            return Resolver::SERVER_FAIL;
+        }
+        if(rr.klass == CLASS_IN) {
+            answers.push_back(std::move(rr));
+        }
+    }
+
+    // 沿CNAME链找到最终的名字, 结果的TTL取链上的最小值
+    std::string target = fqdn;
+    uint32_t min_ttl = ~0u;
+    for(int depth = 0; depth < 16; ++depth) {
+        auto it = std::find_if(answers.begin(), answers.end(), [&target](const RR& rr) {
+            return rr.type == TYPE_CNAME && rr.name == target;
+        });
+        if(it == answers.end()) {
+            break;
+        }
+        size_t p = it->rdata;
+        if(!ReadName(msg, len, p, target)) {
+            return Resolver::SERVER_FAIL;
+        }
+        min_ttl = std::min(min_ttl, it->ttl);
+    }
+
+    size_t rdlen = qtype == TYPE_A ? sizeof(in_addr) : sizeof(in6_addr);
+    for(auto& rr : answers) {
+        if(rr.type != qtype || rr.name != target || rr.rdlen != rdlen) {
+            continue;
+        }
+        Resolver::Record record;
+        if(qtype == TYPE_A) {
+            record.family = AF_INET;
+            memcpy(&record.v4, msg + rr.rdata, rdlen);
+        } else {
+            record.family = AF_INET6;
+            memcpy(&record.v6, msg + rr.rdata, rdlen);
+        }
+        if(std::find(result.begin(), result.end(), record) == result.end()) {
+            result.push_back(record);
+        }
+        min_ttl = std::min(min_ttl, rr.ttl);
+    }
+    if(result.empty()) {
+        // NODATA
+        ttl = NegativeTtl(msg, len, pos, nscount, negative_ttl);
+        return Resolver::NOT_FOUND;
+    }
+    ttl = min_ttl;
+    return Resolver::OK;
+}
+
+uint16_t RandomId() {
+    static thread_local std::mt19937 s_rng(std::random_device{}() ^ getThreadId());
+    return (uint16_t)s_rng();
+}
+
+}
+
+bool Resolver::Record::operator==(const Record& rhs) const {
+    if(family != rhs.family) {
+        return false;
+    }
+    return family == AF_INET ? v4.s_addr == rhs.v4.s_addr
+                             : memcmp(&v6, &rhs.v6, sizeof(v6)) == 0;
+}
+
+std::string Resolver::Record::toString() const {
+    char buf[INET6_ADDRSTRLEN] = {0};
+    inet_ntop(family, family == AF_INET ? (const void*)&v4 : (const void*)&v6, buf, sizeof(buf));
+    return buf;
+}
+
+bool Resolver::ParseResolvConf(const std::string& path, Config& config) {
+    std::ifstream ifs(path);
+    if(!ifs) {
+        return false;
+    }
+    bool has_nameserver = false;
+    std::string line;
+    while(std::getline(ifs, line)) {
+        size_t comment = line.find_first_of("#;");
+        if(comment != std::string::npos) {
+            line.resize(comment);
+        }
+        std::istringstream ss(line);
+        std::string key;
+        if(!(ss >> key)) {
+            continue;
+        }
+        if(key == "nameserver") {
+            std::string ip;
+            if(!(ss >> ip)) {
+                continue;
+            }
+            IPAddress::ptr addr = IPAddress::Create(ip.c_str(), 53);
+            if(!addr) {
+                #if DEBUG
+                DAG_LOG_DEBUG(g_logger) << "ParseResolvConf " << path << " invalid nameserver " << ip;
+                #endif
+                continue;
+            }
+            if(!has_nameserver) {
+                config.nameservers.clear();
+                has_nameserver = true;
+            }
+            config.nameservers.push_back(addr);
+        } else if(key == "search" || key == "domain") {
+            // 后出现的search/domain覆盖前面的
+            config.search.clear();
+            std::string domain;
+            while(ss >> domain) {
+                domain = ToLower(domain);
+                while(!domain.empty() && domain.back() == '.') {
+                    domain.pop_back();
+                }
+                if(!domain.empty()) {
+                    config.search.push_back(domain);
+                }
+            }
+        } else if(key == "options") {
+            std::string opt;
+            while(ss >> opt) {
+                size_t colon = opt.find(':');
+                if(colon == std::string::npos) {
+                    continue;
+                }
+                std::string name = opt.substr(0, colon);
+                int value = atoi(opt.c_str() + colon + 1);
+                // 上限与glibc相同
+                if(name == "ndots") {
+                    config.ndots = std::min(std::max(value, 0), 15);
+                } else if(name == "timeout") {
+                    config.timeout_ms = std::min(std::max(value, 1), 30) * 1000;
+                } else if(name == "attempts") {
+                    config.attempts = std::min(std::max(value, 1), 5);
+                }
+            }
+        }
+    }
+    return true;
+}
+
+bool Resolver::NsswitchFilesDnsOnly(const std::string& path) {
+    std::ifstream ifs(path);
+    std::string line;
+    while(ifs && std::getline(ifs, line)) {
+        size_t comment = line.find('#');
+        if(comment != std::string::npos) {
+            line.resize(comment);
+        }
+        std::istringstream ss(line);
+        std::string key;
+        if(!(ss >> key) || key != "hosts:") {
+            continue;
+        }
+        // [NOTFOUND=return]这样的动作不是来源
+        bool action = false;
+        std::string source;
+        while(ss >> source) {
+            if(!action && source[0] == '[') {
+                action = true;
+            }
+            if(action) {
+                action = source.back() != ']';
+                continue;
+            }
+            if(source != "files" && source != "dns") {
+                return false;
+            }
+        }
+        return true;
+    }
+    return true;
+}
+
+// -1表示还没有读取nsswitch.conf
+static std::atomic<int> s_lookup_enabled{-1};
+
+bool Resolver::IsLookupEnabled() {
+    int enabled = s_lookup_enabled.load(std::memory_order_relaxed);
+    if(enabled < 0) {
+        int expected = -1;
+        s_lookup_enabled.compare_exchange_strong(expected, NsswitchFilesDnsOnly("/etc/nsswitch.conf") ? 1 : 0);
+        enabled = s_lookup_enabled.load(std::memory_order_relaxed);
+    }
+    return enabled;
+}
+
+void Resolver::SetLookupEnabled(bool flag) {
+    s_lookup_enabled = flag ? 1 : 0;
+}
+
+Resolver::FileStamp Resolver::FileStamp::Get(const std::string& path) {
+    FileStamp stamp;
+    struct stat st;
+    if(stat(path.c_str(), &st) == 0) {
+        stamp.exists = true;
+        stamp.mtime_ns = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+        stamp.size = st.st_size;
+        stamp.ino = st.st_ino;
+    }
+    return stamp;
+}
+
+bool Resolver::FileStamp::operator==(const FileStamp& rhs) const {
+    return exists == rhs.exists && mtime_ns == rhs.mtime_ns && size == rhs.size && ino == rhs.ino;
+}
+
+Resolver::Resolver() {
+    loadResolvConf("/etc/resolv.conf");
+    loadHosts("/etc/hosts");
+}
+
+Resolver::Resolver(const Config& config)
+    : m_config(config) {
+}
+
+void Resolver::setConfig(const Config& config) {
+    std::lock_guard<SpinLock> lock(m_mutex);
+    m_config = config;
+    m_cache.clear();
+    m_resolvConfPath.clear();
+}
+
+Resolver::Config Resolver::getConfig() {
+    std::lock_guard<SpinLock> lock(m_mutex);
+    return m_config;
+}
+
+bool Resolver::loadResolvConf(const std::string& path) {
+    // 先取标记再读文件, 读的过程中被修改时下次检查还能发现
+    FileStamp stamp = FileStamp::Get(path);
+    Config config = getConfig();
+    Config defaults;
+    config.nameservers.clear();
+    config.search.clear();
+    config.ndots = defaults.ndots;
+    config.timeout_ms = defaults.timeout_ms;
+    config.attempts = defaults.attempts;
+    bool rt = ParseResolvConf(path, config);
+    // 与glibc相同, 没有配置服务器时使用本机
+    if(config.nameservers.empty()) {
+        config.nameservers.push_back(IPv4Address::Create("127.0.0.1", 53));
+    }
+    std::lock_guard<SpinLock> lock(m_mutex);
+    m_config = config;
+    m_cache.clear();
+    m_resolvConfPath = path;
+    m_resolvConfStamp = stamp;
+    return rt;
+}
+
+bool Resolver::loadHosts(const std::string& path) {
+    FileStamp stamp = FileStamp::Get(path);
+    std::ifstream ifs(path);
+    if(!ifs) {
+        return false;
+    }
+    std::unordered_map<std::string, std::vector<Record>> hosts;
+    std::string line;
+    while(std::getline(ifs, line)) {
+        size_t comment = line.find('#');
+        if(comment != std::string::npos) {
+            line.resize(comment);
+        }
+        std::istringstream ss(line);
+        std::string ip;
+        if(!(ss >> ip)) {
+            continue;
+        }
+        Record record;
+        if(inet_pton(AF_INET, ip.c_str(), &record.v4) == 1) {
+            record.family = AF_INET;
+        } else if(inet_pton(AF_INET6, ip.c_str(), &record.v6) == 1) {
+            record.family = AF_INET6;
+        } else {
+            continue;
+        }
+        std::string name;
+        while(ss >> name) {
+            name = ToLower(name);
+            while(!name.empty() && name.back() == '.') {
+                name.pop_back();
+            }
+            auto& records = hosts[name];
+            if(std::find(records.begin(), records.end(), record) == records.end()) {
+                records.push_back(record);
+            }
+        }
+    }
+    std::lock_guard<SpinLock> lock(m_mutex);
+    m_hosts.swap(hosts);
+    m_hostsPath = path;
+    m_hostsStamp = stamp;
+    return true;
+}
+
+void Resolver::checkReload() {
+    std::string resolv_conf;
+    std::string hosts;
+    FileStamp resolv_conf_stamp;
+    FileStamp hosts_stamp;
+    {
+        uint64_t now = getElapseMs();
+        std::lock_guard<SpinLock> lock(m_mutex);
+        if(!m_config.reload_interval_ms || now < m_nextCheckMs
+                || (m_resolvConfPath.empty() && m_hostsPath.empty())) {
+            return;
+        }
+        m_nextCheckMs = now + m_config.reload_interval_ms;
+        resolv_conf = m_resolvConfPath;
+        resolv_conf_stamp = m_resolvConfStamp;
+        hosts = m_hostsPath;
+        hosts_stamp = m_hostsStamp;
+    }
+    if(!resolv_conf.empty() && !(FileStamp::Get(resolv_conf) == resolv_conf_stamp)) {
+        #if DEBUG
+        DAG_LOG_DEBUG(g_logger) << "Resolver reload " << resolv_conf;
+        #endif
+        loadResolvConf(resolv_conf);
+    }
+    if(!hosts.empty()) {
+        FileStamp stamp = FileStamp::Get(hosts);
+        if(!(stamp == hosts_stamp)) {
+            #if DEBUG
+            DAG_LOG_DEBUG(g_logger) << "Resolver reload " << hosts;
+            #endif
+            if(!loadHosts(hosts)) {
+                // 文件被删除, 与getaddrinfo一样不再有hosts条目
+                std::lock_guard<SpinLock> lock(m_mutex);
+                m_hosts.clear();
+                m_hostsStamp = stamp;
+            }
+        }
+    }
+}
+
+Resolver::Status Resolver::resolve(const std::string& name, int family, std::vector<Record>& result) {
+    checkReload();
+    switch(family) {
+        case AF_INET:
+            return resolveType(name, TYPE_A, result);
+        case AF_INET6:
+            return resolveType(name, TYPE_AAAA, result);
+        case AF_UNSPEC:
+            {
+                Status v4 = resolveType(name, TYPE_A, result);
+                Status v6 = resolveType(name, TYPE_AAAA, result);
+                if(v4 == OK || v6 == OK) {
+                    return OK;
+                }
+                return v4 == NOT_FOUND ? v6 : v4;
+            }
+        default:
+            return NOT_FOUND;
+    }
+}
+
+Resolver::Status Resolver::resolveType(const std::string& name, uint16_t qtype, std::vector<Record>& result) {
+    // 数字地址
+    Record record;
+    if(inet_pton(AF_INET, name.c_str(), &record.v4) == 1) {
+        record.family = AF_INET;
+    } else if(inet_pton(AF_INET6, name.c_str(), &record.v6) == 1) {
+        record.family = AF_INET6;
+    } else {
+        record.family = AF_UNSPEC;
+    }
+    if(record.family != AF_UNSPEC) {
+        if(record.family != (qtype == TYPE_A ? AF_INET : AF_INET6)) {
+            return NOT_FOUND;
+        }
+        result.push_back(record);
+        return OK;
+    }
+
+    std::string lower = ToLower(name);
+    bool absolute = !lower.empty() && lower.back() == '.';
+    while(!lower.empty() && lower.back() == '.') {
+        lower.pop_back();
+    }
+    if(lower.empty()) {
+        return NOT_FOUND;
+    }
+
+    std::vector<std::string> candidates;
+    {
+        std::lock_guard<SpinLock> lock(m_mutex);
+        auto it = m_hosts.find(lower);
+        if(it != m_hosts.end()) {
+            int family = qtype == TYPE_A ? AF_INET : AF_INET6;
+            size_t size = result.size();
+            for(auto& i : it->second) {
+                if(i.family == family) {
+                    result.push_back(i);
+                }
+            }
+            if(result.size() > size) {
+                ++m_stats.hosts_hits;
+                return OK;
+            }
+        }
+
+        if(absolute) {
+            candidates.push_back(lower);
+        } else {
+            int dots = std::count(lower.begin(), lower.end(), '.');
+            if(dots >= m_config.ndots) {
+                candidates.push_back(lower);
+            }
+            for(auto& i : m_config.search) {
+                candidates.push_back(lower + "." + i);
+            }
+            if(dots < m_config.ndots) {
+                candidates.push_back(lower);
+            }
+        }
+    }
+
+    // 全部不存在时为NOT_FOUND, 否则返回第一个错误
+    Status error = NOT_FOUND;
+    for(auto& fqdn : candidates) {
+        Status status = queryCached(fqdn, qtype, result);
+        if(status == OK || status == NO_SERVER) {
+            return status;
+        }
+        if(error == NOT_FOUND) {
+            error = status;
+        }
+    }
+    return error;
+}
+
+Resolver::Status Resolver::queryCached(const std::string& fqdn, uint16_t qtype, std::vector<Record>& result) {
+    std::string key = fqdn + "/" + std::to_string(qtype);
+    std::unique_lock<SpinLock> lock(m_mutex);
+    auto it = m_cache.find(key);
+    if(it != m_cache.end()) {
+        if(it->second.expire_ms > getElapseMs()) {
+            ++m_stats.cache_hits;
+            if(it->second.status != OK) {
+                ++m_stats.negative_hits;
+            }
+            result.insert(result.end(), it->second.records.begin(), it->second.records.end());
+            return it->second.status;
+        }
+        m_cache.erase(it);
+    }
+
+    auto inflight = m_inflight.find(key);
+    if(inflight != m_inflight.end()) {
+        std::shared_ptr<Pending> pending = inflight->second;
+        ++m_stats.coalesced;
+        while(!pending->done) {
+            pending->waiters.wait(lock);
+            lock.lock();
+        }
+        result.insert(result.end(), pending->records.begin(), pending->records.end());
+        return pending->status;
+    }
+
+    std::shared_ptr<Pending> pending = std::make_shared<Pending>();
+    m_inflight[key] = pending;
+    Config config = m_config;
+    lock.unlock();
+
+    std::vector<Record> records;
+    uint32_t ttl = 0;
+    Status status = query(config, fqdn, qtype, records, ttl);
+
+    lock.lock();
+    ttl = std::min(ttl, config.max_ttl);
+    if((status == OK || status == NOT_FOUND) && ttl > 0) {
+        uint64_t now = getElapseMs();
+        if(m_cache.size() >= config.max_entries) {
+            evict(now);
+        }
+        Entry& entry = m_cache[key];
+        entry.status = status;
+        entry.records = records;
+        entry.expire_ms = now + ttl * 1000ull;
+    }
+    pending->done = true;
+    pending->status = status;
+    pending->records = records;
+    m_inflight.erase(key);
+    pending->waiters.notifyAll();
+    lock.unlock();
+
+    result.insert(result.end(), records.begin(), records.end());
+    return status;
+}
+
+void Resolver::evict(uint64_t now) {
+    for(auto it = m_cache.begin(); it != m_cache.end();) {
+        if(it->second.expire_ms <= now) {
+            it = m_cache.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    // 都没过期时丢掉一部分
+    while(!m_cache.empty() && m_cache.size() >= m_config.max_entries) {
+        m_cache.erase(m_cache.begin());
+    }
+}
+
+Resolver::Status Resolver::query(const Config& config, const std::string& fqdn, uint16_t qtype
+                                 ,std::vector<Record>& result, uint32_t& ttl) {
+    if(config.nameservers.empty()) {
+        return NO_SERVER;
+    }
+    Status error = TIMEOUT;
+    for(int attempt = 0; attempt < std::max(config.attempts, 1); ++attempt) {
+        for(auto& server : config.nameservers) {
+            Status status = queryOne(server, config.timeout_ms, fqdn, qtype, result, ttl);
+            if(status == OK || status == NOT_FOUND) {
+                return status;
+            }
+            error = status;
+        }
+    }
+    return error;
+}
+
+Resolver::Status Resolver::queryOne(const Address::ptr& server, uint64_t timeout_ms, const std::string& fqdn
+                                    ,uint16_t qtype, std::vector<Record>& result, uint32_t& ttl) {
+    uint32_t negative_ttl;
+    {
+        std::lock_guard<SpinLock> lock(m_mutex);
+        ++m_stats.queries;
+        negative_ttl = m_config.negative_ttl;
+    }
+
+    uint16_t id = RandomId();
+    std::string request;
+    if(!BuildQuery(request, id, fqdn, qtype)) {
+        ttl = negative_ttl;
+        return NOT_FOUND;
+    }
+    // 每次查询用新的socket, 源端口随机; connect后内核丢弃其他来源的报文
+    Socket::ptr sock = Socket::CreateUDP(server);
+    if(!sock->connect(server)) {
+        return SERVER_FAIL;
+    }
+    if(sock->send(request.data(), request.size()) != (int)request.size()) {
+        #if DEBUG
+        DAG_LOG_DEBUG(g_logger) << "Resolver send to " << *server << " errno=" << errno
+            << " errstr=" << strerror(errno);
+        #endif
+        return SERVER_FAIL;
+    }
+
+    uint64_t deadline = getElapseMs() + timeout_ms;
+    uint8_t buf[MAX_UDP_RESPONSE];
+    while(true) {
+        uint64_t now = getElapseMs();
+        if(now >= deadline) {
+            break;
+        }
+        sock->setRecvTimeout(deadline - now);
+        int n = sock->recv(buf, sizeof(buf));
+        if(n < 0) {
+            if(errno == ETIMEDOUT || errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            // 服务器端口不可达等
+            #if DEBUG
+            DAG_LOG_DEBUG(g_logger) << "Resolver recv from " << *server << " errno=" << errno
+                << " errstr=" << strerror(errno);
+            #endif
+            return SERVER_FAIL;
+        }
+        std::vector<Record> records;
+        int rt = ParseResponse(buf, n, id, fqdn, qtype, negative_ttl, records, ttl);
+        if(rt == RESPONSE_MISMATCH) {
+            continue;
+        }
+        if(rt == OK) {
+            result.insert(result.end(), records.begin(), records.end());
+        }
+        return (Status)rt;
+    }
+    std::lock_guard<SpinLock> lock(m_mutex);
+    ++m_stats.timeouts;
+    return TIMEOUT;
+}
+
+Resolver::Status Resolver::lookup(std::vector<Address::ptr>& result, const std::string& name
+                                  ,int family, uint16_t port) {
+    std::vector<Record> records;
+    Status status = resolve(name, family, records);
+    for(auto& i : records) {
+        Address::ptr addr = ToAddress(i, port);
+        if(addr) {
+            result.push_back(addr);
+        }
+    }
+    return status;
+}
+
+void Resolver::clearCache() {
+    std::lock_guard<SpinLock> lock(m_mutex);
+    m_cache.clear();
+}
+
+Resolver::Stats Resolver::getStats() {
+    std::lock_guard<SpinLock> lock(m_mutex);
+    Stats stats = m_stats;
+    stats.cache_size = m_cache.size();
+    return stats;
+}
+
+Address::ptr Resolver::ToAddress(const Record& record, uint16_t port) {
+    if(record.family == AF_INET) {
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr = record.v4;
+        return Address::Create((const sockaddr*)&addr, sizeof(addr));
+    }
+    sockaddr_in6 addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin6_family = AF_INET6;
+    addr.sin6_port = htons(port);
+    addr.sin6_addr = record.v6;
+    return Address::Create((const sockaddr*)&addr, sizeof(addr));
+}
+
+const char* Resolver::StatusToString(Status status) {
+    switch(status) {
+#define XX(name) \
+        case name: \
+            return #name;
+        XX(OK);
+        XX(NOT_FOUND);
+        XX(TIMEOUT);
+        XX(SERVER_FAIL);
+        XX(NO_SERVER);
+#undef XX
+        default:
+            return "UNKNOWN";
+    }
+}
+
+}
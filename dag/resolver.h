@@ -0,0 +1,289 @@
+#ifndef __DAG_RESOLVER_H__
+#define __DAG_RESOLVER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <netinet/in.h>
+#include "address.h"
+#include "fiber_mutex.h"
+#include "utils/mutex.h"
+#include "utils/singleton.h"
+
+namespace dag {
+
+/**
+ * @brief 协程化的DNS解析器
+ * @details getaddrinfo在调用它的协程中同步阻塞整个工作线程, 最长可达解析超时; 这里用hook过的UDP Socket
+ *          直接向resolv.conf中的DNS服务器发送A/AAAA查询, 等待应答时只挂起当前协程。
+ *          解析顺序: 数字地址 -> hosts文件 -> 缓存 -> DNS查询(按search/ndots展开名字, 依次尝试每个服务器);
+ *          缓存遵守应答的TTL, 域名不存在(NXDOMAIN)或没有该类型记录时按SOA的最小TTL做否定缓存;
+ *          同一名字同一类型同时只发一个查询, 其他请求者挂起等待它的结果。
+ *          不在协程中调用时退化为阻塞线程的查询, 行为相同
+ * @attention 不支持TC截断后改用TCP重查, 截断的应答只使用其中已有的记录
+ */
+class Resolver {
+public:
+    typedef std::shared_ptr<Resolver> ptr;
+
+    /**
+     * @brief 解析配置, 默认值与resolv.conf一致
+     */
+    struct Config {
+        // DNS服务器, 端口一般为53
+        std::vector<Address::ptr> nameservers;
+        // search域
+        std::vector<std::string> search;
+        // 名字中的点数不少于ndots时先按绝对名字查询, 否则先尝试search域
+        int ndots = 1;
+        // 每次查询等待应答的超时(毫秒)
+        uint64_t timeout_ms = 5000;
+        // 所有服务器轮流尝试的轮数
+        int attempts = 2;
+        // 应答中没有SOA时否定缓存的时间(秒)
+        uint32_t negative_ttl = 30;
+        // 缓存时间的上限(秒), 0为不缓存
+        uint32_t max_ttl = 86400;
+        // 缓存的条目数上限
+        size_t max_entries = 10000;
+        // 检查resolv.conf和hosts文件是否修改的间隔(毫秒), 0为不检查
+        uint64_t reload_interval_ms = 5000;
+    };
+
+    /**
+     * @brief 解析结果
+     */
+    enum Status {
+        OK = 0,
+        // 名字不存在, 或没有该类型的记录
+        NOT_FOUND = 1,
+        // 所有服务器都没有应答
+        TIMEOUT = 2,
+        // 服务器拒绝、出错或应答格式错误
+        SERVER_FAIL = 3,
+        // 没有配置DNS服务器
+        NO_SERVER = 4
+    };
+
+    /**
+     * @brief 一条地址记录
+     */
+    struct Record {
+        // AF_INET或AF_INET6
+        int family = AF_INET;
+        union {
+            in_addr v4;
+            in6_addr v6;
+        };
+
+        Record() : v6() {}
+        bool operator==(const Record& rhs) const;
+        std::string toString() const;
+    };
+
+    /**
+     * @brief 统计
+     */
+    struct Stats {
+        // 发往服务器的查询数(含重试)
+        uint64_t queries = 0;
+        // 命中缓存的次数, 其中否定缓存的次数
+        uint64_t cache_hits = 0;
+        uint64_t negative_hits = 0;
+        // 命中hosts文件的次数
+        uint64_t hosts_hits = 0;
+        // 等待其他协程进行中的同名查询的次数
+        uint64_t coalesced = 0;
+        // 等待应答超时的次数
+        uint64_t timeouts = 0;
+        // 当前缓存条目数
+        size_t cache_size = 0;
+    };
+
+    /**
+     * @brief 解析resolv.conf格式的文件
+     * @details 支持nameserver、search、domain以及options中的ndots、timeout、attempts
+     * @param[in] path 文件路径
+     * @param[out] config 解析结果, 文件中出现的项覆盖原有的值
+     * @return 文件是否可读
+     */
+    static bool ParseResolvConf(const std::string& path, Config& config);
+
+    /**
+     * @brief nsswitch.conf中hosts的来源是否只有files和dns
+     * @details 只有这时Resolver的结果才与getaddrinfo一致; mdns、myhostname、resolve等来源Resolver无法替代
+     * @return 文件不可读或没有hosts行时按glibc的默认值(dns files)返回true
+     */
+    static bool NsswitchFilesDnsOnly(const std::string& path);
+
+    /**
+     * @brief Address::Lookup在IO协程中是否改用ResolverMgr解析
+     * @details 默认在/etc/nsswitch.conf的hosts只有files和dns时开启, 否则使用getaddrinfo
+     */
+    static bool IsLookupEnabled();
+
+    /**
+     * @brief 强制开启/关闭Address::Lookup改用ResolverMgr
+     */
+    static void SetLookupEnabled(bool flag);
+
+    /**
+     * @brief 使用/etc/resolv.conf和/etc/hosts构造, 文件修改后自动重新加载
+     */
+    Resolver();
+
+    /**
+     * @brief 使用指定配置构造, 不读取hosts文件
+     */
+    explicit Resolver(const Config& config);
+
+    /**
+     * @brief 替换配置, 同时清空缓存; 之后不再跟踪resolv.conf的修改
+     */
+    void setConfig(const Config& config);
+
+    Config getConfig();
+
+    /**
+     * @brief 加载resolv.conf格式的文件, 替换服务器、search域和options, 同时清空缓存
+     * @details 其余配置保持不变; 文件不可读或没有服务器时与glibc相同使用本机;
+     *          之后每隔reload_interval_ms检查一次文件, 修改后重新加载
+     * @return 文件是否可读
+     */
+    bool loadResolvConf(const std::string& path);
+
+    /**
+     * @brief 加载hosts格式的文件, 替换原有的hosts条目
+     * @details 之后每隔reload_interval_ms检查一次文件, 修改后重新加载
+     * @return 文件是否可读
+     */
+    bool loadHosts(const std::string& path);
+
+    /**
+     * @brief 解析名字
+     * @param[in] name 域名或数字地址
+     * @param[in] family AF_INET查A记录, AF_INET6查AAAA记录, AF_UNSPEC两者都查(先A后AAAA)
+     * @param[out] result 追加解析到的记录
+     * @return 解析结果, AF_UNSPEC时任一类型成功即为OK
+     */
+    Status resolve(const std::string& name, int family, std::vector<Record>& result);
+
+    /**
+     * @brief 解析名字并生成地址
+     * @param[out] result 追加解析到的地址
+     * @param[in] name 域名或数字地址
+     * @param[in] family AF_INET, AF_INET6, AF_UNSPEC
+     * @param[in] port 地址的端口号
+     * @return 解析结果
+     */
+    Status lookup(std::vector<Address::ptr>& result, const std::string& name
+                  ,int family = AF_INET, uint16_t port = 0);
+
+    /**
+     * @brief 清空缓存
+     */
+    void clearCache();
+
+    Stats getStats();
+
+    /**
+     * @brief 记录转为地址
+     */
+    static Address::ptr ToAddress(const Record& record, uint16_t port = 0);
+
+    static const char* StatusToString(Status status);
+
+private:
+    /**
+     * @brief 缓存条目
+     */
+    struct Entry {
+        Status status = NOT_FOUND;
+        std::vector<Record> records;
+        // 过期时刻, getElapseMs()
+        uint64_t expire_ms = 0;
+    };
+
+    /**
+     * @brief 进行中的查询, 等待者在waiters上挂起
+     */
+    struct Pending {
+        bool done = false;
+        Status status = NOT_FOUND;
+        std::vector<Record> records;
+        FiberWaitQueue waiters;
+    };
+
+    /**
+     * @brief 文件的修改标记, 修改时间、大小或inode任一变化都视为修改
+     */
+    struct FileStamp {
+        bool exists = false;
+        int64_t mtime_ns = 0;
+        int64_t size = 0;
+        uint64_t ino = 0;
+
+        static FileStamp Get(const std::string& path);
+        bool operator==(const FileStamp& rhs) const;
+    };
+
+    /**
+     * @brief 到了检查间隔时重新stat跟踪的文件, 修改过的重新加载
+     */
+    void checkReload();
+
+    /**
+     * @brief 解析一种类型: 数字地址、hosts、按search展开的名字
+     */
+    Status resolveType(const std::string& name, uint16_t qtype, std::vector<Record>& result);
+
+    /**
+     * @brief 查询一个完整的名字, 先查缓存, 合并进行中的相同查询
+     */
+    Status queryCached(const std::string& fqdn, uint16_t qtype, std::vector<Record>& result);
+
+    /**
+     * @brief 依次向各个服务器发送查询
+     * @param[out] ttl 结果的缓存时间(秒)
+     */
+    Status query(const Config& config, const std::string& fqdn, uint16_t qtype
+                 ,std::vector<Record>& result, uint32_t& ttl);
+
+    /**
+     * @brief 向一个服务器发送查询并等待应答
+     */
+    Status queryOne(const Address::ptr& server, uint64_t timeout_ms, const std::string& fqdn
+                    ,uint16_t qtype, std::vector<Record>& result, uint32_t& ttl);
+
+    /**
+     * @brief 腾出缓存空间, 调用方持有m_mutex
+     */
+    void evict(uint64_t now);
+
+private:
+    SpinLock m_mutex;
+    Config m_config;
+    // 名字(小写) -> hosts中的记录
+    std::unordered_map<std::string, std::vector<Record>> m_hosts;
+    // "名字/类型" -> 缓存
+    std::unordered_map<std::string, Entry> m_cache;
+    std::unordered_map<std::string, std::shared_ptr<Pending>> m_inflight;
+    Stats m_stats;
+    // 跟踪修改的resolv.conf和hosts文件, 为空表示不跟踪
+    std::string m_resolvConfPath;
+    FileStamp m_resolvConfStamp;
+    std::string m_hostsPath;
+    FileStamp m_hostsStamp;
+    // 下次检查文件的时刻, getElapseMs()
+    uint64_t m_nextCheckMs = 0;
+};
+
+using ResolverMgr = Singleton<Resolver>;
+
+}
+
+#endif
@@ -0,0 +1,151 @@
+#include "rpc_client.h"
+#include "logger.h"
+#include <assert.h>
+#include <sys/socket.h>
+
+namespace dag {
+namespace rpc {
+
+static dag::Logger::ptr g_logger = DAG_LOG_NAME("system");
+
+RpcClient::RpcClient(dag::IOManager* iom)
+    :m_iom(iom) {
+}
+
+RpcClient::~RpcClient() {
+    #if DEBUG
+    DAG_LOG_DEBUG(g_logger) << "~RpcClient pending=" << m_calls.size();
+    #endif
+}
+
+bool RpcClient::connect(Address::ptr addr, uint64_t timeout_ms) {
+    Socket::ptr sock = Socket::CreateTCP(addr);
+    if(!sock->connect(addr, timeout_ms)) {
+        DAG_LOG_ERROR(g_logger) << "rpc connect " << *addr << " fail";
+        return false;
+    }
+    m_session.reset(new RpcSession(sock));
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = false;
+    }
+    m_connected = true;
+    m_iom->schedulerLock(std::bind(&RpcClient::recvLoop, shared_from_this()));
+    return true;
+}
+
+void RpcClient::recvLoop() {
+    while(true) {
+        RpcMessage::ptr msg = m_session->recvMessage();
+        if(!msg) {
+            break;
+        }
+        if(msg->getType() != RpcMessage::RESPONSE) {
+            DAG_LOG_ERROR(g_logger) << "unexpected " << msg->toString();
+            continue;
+        }
+        if(!wakeup(msg->getId(), msg->getStatus(), &msg->getBodyRef())) {
+            // 调用已经超时, 迟到的响应直接丢弃
+            #if DEBUG
+            DAG_LOG_DEBUG(g_logger) << "drop late response " << msg->toString();
+            #endif
+        }
+    }
+    m_connected = false;
+    m_session->close();
+    failAll(RpcStatus::CONNECTION_CLOSED);
+}
+
+RpcStatus RpcClient::call(const std::string& method, const std::string& request
+                          ,std::string& response, uint64_t timeout_ms) {
+    assert(Scheduler::GetThis());
+    CallContext::ptr ctx(new CallContext);
+    ctx->fiber = Fiber::GetThis();
+    ctx->scheduler = Scheduler::GetThis();
+
+    RpcMessage::ptr req(new RpcMessage(RpcMessage::REQUEST));
+    req->setMethod(method);
+    req->setBody(request);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_closed) {
+            return RpcStatus::CONNECTION_CLOSED;
+        }
+        uint32_t id = ++m_sn;
+        req->setId(id);
+        m_calls[id] = ctx;
+        if(timeout_ms) {
+            std::weak_ptr<RpcClient> weak_self(shared_from_this());
+            ctx->timer = m_iom->addConditionTimer(timeout_ms, [weak_self, id]() {
+                auto self = weak_self.lock();
+                if(self) {
+                    self->wakeup(id, RpcStatus::TIMEOUT, nullptr);
+                }
+            }, ctx);
+        }
+    }
+
+    if(m_session->sendMessage(req) < 0) {
+        wakeup(req->getId(), RpcStatus::CONNECTION_CLOSED, nullptr);
+    }
+    // 无论被谁唤醒(响应/超时/连接关闭), 都恰好被调度一次
+    Fiber::GetThis()->yield();
+
+    response.swap(ctx->response);
+    return ctx->status;
+}
+
+bool RpcClient::wakeup(uint32_t id, RpcStatus status, std::string* response) {
+    CallContext::ptr ctx;
+    std::shared_ptr<Timer> timer;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_calls.find(id);
+        if(it == m_calls.end()) {
+            return false;
+        }
+        ctx = it->second;
+        timer = ctx->timer;
+        m_calls.erase(it);
+    }
+    if(timer && status != RpcStatus::TIMEOUT) {
+        timer->cancel();
+    }
+    ctx->status = status;
+    if(response) {
+        ctx->response.swap(*response);
+    }
+    Fiber::ptr fiber;
+    fiber.swap(ctx->fiber);
+    ctx->scheduler->schedulerLock(fiber);
+    return true;
+}
+
+void RpcClient::failAll(RpcStatus status) {
+    std::vector<uint32_t> ids;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_closed = true;
+        for(auto& i : m_calls) {
+            ids.push_back(i.first);
+        }
+    }
+    for(auto id : ids) {
+        wakeup(id, status, nullptr);
+    }
+}
+
+void RpcClient::close() {
+    if(m_session && m_connected) {
+        // 只shutdown不close: 接收协程读到EOF后在自己的协程里关闭socket并清理调用
+        ::shutdown(m_session->getSocket()->getSocket(), SHUT_RDWR);
+    }
+}
+
+size_t RpcClient::getPendingCount() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_calls.size();
+}
+
+}
+}
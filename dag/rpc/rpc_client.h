@@ -0,0 +1,119 @@
+#ifndef __DAG_RPC_CLIENT_H__
+#define __DAG_RPC_CLIENT_H__
+
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include "ioscheduler.h"
+#include "rpc_session.h"
+
+namespace dag {
+namespace rpc {
+
+/**
+ * @brief RPC客户端
+ * @details 一个客户端对应一条连接, 多个协程可以同时在这条连接上发起调用:
+ *          每个调用分配一个请求id后挂起当前协程(不阻塞线程),
+ *          由后台的接收协程按id把响应交给对应的调用并重新调度它;
+ *          设置了超时的调用在TimerManager上注册定时器, 先到者(响应/超时)唤醒调用方
+ * @attention 必须在IOManager的协程中使用, 用完需要调用close()结束接收协程
+ */
+class RpcClient : public std::enable_shared_from_this<RpcClient> {
+public:
+    using ptr = std::shared_ptr<RpcClient>;
+
+    /**
+     * @brief 构造函数
+     * @param[in] iom 运行接收协程和超时定时器的调度器
+     */
+    RpcClient(dag::IOManager* iom = dag::IOManager::GetThis());
+
+    ~RpcClient();
+
+    /**
+     * @brief 连接服务器并启动接收协程
+     * @param[in] addr 服务器地址
+     * @param[in] timeout_ms 连接超时时间(毫秒)
+     */
+    bool connect(Address::ptr addr, uint64_t timeout_ms = -1);
+
+    /**
+     * @brief 发起调用, 挂起当前协程直到收到响应或超时
+     * @param[in] method 方法名
+     * @param[in] request 请求体
+     * @param[out] response 响应体
+     * @param[in] timeout_ms 超时时间(毫秒), 0表示不设超时
+     */
+    RpcStatus call(const std::string& method, const std::string& request
+                   ,std::string& response, uint64_t timeout_ms = 0);
+
+    /**
+     * @brief 关闭连接, 所有未完成的调用返回RpcStatus::CONNECTION_CLOSED
+     */
+    void close();
+
+    /**
+     * @brief 连接是否可用
+     */
+    bool isConnected() const { return m_connected;}
+
+    /**
+     * @brief 正在等待响应的调用数
+     */
+    size_t getPendingCount();
+
+private:
+    /**
+     * @brief 一个等待中的调用
+     */
+    struct CallContext {
+        using ptr = std::shared_ptr<CallContext>;
+        /// 发起调用的协程
+        Fiber::ptr fiber;
+        /// 发起调用的调度器
+        Scheduler* scheduler = nullptr;
+        /// 超时定时器
+        std::shared_ptr<Timer> timer;
+        /// 调用结果
+        RpcStatus status = RpcStatus::OK;
+        /// 响应体
+        std::string response;
+    };
+
+    /**
+     * @brief 接收协程, 连接断开后让所有等待中的调用失败
+     */
+    void recvLoop();
+
+    /**
+     * @brief 结束id对应的调用并唤醒调用方
+     * @return 调用已经结束(被响应/超时/关闭抢先)时返回false
+     */
+    bool wakeup(uint32_t id, RpcStatus status, std::string* response);
+
+    /**
+     * @brief 让所有等待中的调用以status结束, 此后的调用直接失败
+     */
+    void failAll(RpcStatus status);
+
+private:
+    /// 调度器
+    dag::IOManager* m_iom;
+    /// 连接
+    RpcSession::ptr m_session;
+    /// 连接是否可用
+    std::atomic<bool> m_connected{false};
+    /// 保护m_calls/m_sn/m_closed
+    std::mutex m_mutex;
+    /// 等待响应的调用
+    std::unordered_map<uint32_t, CallContext::ptr> m_calls;
+    /// 请求id生成器
+    uint32_t m_sn = 0;
+    /// 是否已经关闭
+    bool m_closed = true;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,115 @@
+#include "rpc_protocol.h"
+#include <sstream>
+
+namespace dag {
+namespace rpc {
+
+const char* RpcStatusToString(RpcStatus s) {
+    switch(s) {
+#define XX(name) \
+        case RpcStatus::name: \
+            return #name;
+        XX(OK);
+        XX(METHOD_NOT_FOUND);
+        XX(HANDLER_ERROR);
+        XX(TIMEOUT);
+        XX(CONNECTION_CLOSED);
+        XX(BAD_FRAME);
+#undef XX
+        default:
+            return "UNKNOWN";
+    }
+}
+
+/**
+ * @brief 计算varint编码后的字节数
+ */
+static size_t VarintSize(uint64_t v) {
+    size_t n = 1;
+    while(v >= 0x80) {
+        v >>= 7;
+        ++n;
+    }
+    return n;
+}
+
+void RpcMessage::encode(ByteArray::ptr ba) const {
+    uint32_t length = VarintSize(m_method.size()) + m_method.size() + m_body.size();
+    ba->writeFuint8(MAGIC);
+    ba->writeFuint8(VERSION);
+    ba->writeFuint8(m_type);
+    ba->writeFuint8(0);
+    ba->writeFuint32(m_id);
+    ba->writeFuint32((uint32_t)m_status);
+    ba->writeFuint32(length);
+    ba->writeStringVint(m_method);
+    ba->write(m_body.c_str(), m_body.size());
+}
+
+RpcMessage::ptr RpcMessage::Decode(ByteArray::ptr ba, bool& err) {
+    err = false;
+    if(ba->getReadSize() < HEADER_SIZE) {
+        return nullptr;
+    }
+    size_t pos = ba->getPosition();
+    uint8_t magic = ba->readFuint8();
+    uint8_t version = ba->readFuint8();
+    uint8_t type = ba->readFuint8();
+    ba->readFuint8();
+    uint32_t id = ba->readFuint32();
+    uint32_t status = ba->readFuint32();
+    uint32_t length = ba->readFuint32();
+    if(magic != MAGIC || version != VERSION
+            || (type != REQUEST && type != RESPONSE)
+            || length > MAX_PAYLOAD_SIZE) {
+        ba->setPosition(pos);
+        err = true;
+        return nullptr;
+    }
+    if(ba->getReadSize() < length) {
+        ba->setPosition(pos);
+        return nullptr;
+    }
+
+    // 方法名长度(varint), 逐字节读取防止畸形数据越过payload边界
+    uint64_t mlen = 0;
+    size_t used = 0;
+    bool done = false;
+    while(used < length && used < 10 && !done) {
+        uint8_t b = ba->readFuint8();
+        mlen |= ((uint64_t)(b & 0x7f)) << (7 * used);
+        done = b < 0x80;
+        ++used;
+    }
+    if(!done || mlen > length - used) {
+        ba->setPosition(pos);
+        err = true;
+        return nullptr;
+    }
+
+    RpcMessage::ptr msg(new RpcMessage((Type)type, id));
+    msg->m_status = (RpcStatus)status;
+    msg->m_method.resize(mlen);
+    if(mlen) {
+        ba->read(&msg->m_method[0], mlen);
+    }
+    msg->m_body.resize(length - used - mlen);
+    if(!msg->m_body.empty()) {
+        ba->read(&msg->m_body[0], msg->m_body.size());
+    }
+    return msg;
+}
+
+std::string RpcMessage::toString() const {
+    std::stringstream ss;
+    ss << "[RpcMessage type=" << (m_type == REQUEST ? "REQUEST" : "RESPONSE")
+       << " id=" << m_id
+       << " status=" << RpcStatusToString(m_status)
+       << " method=" << m_method
+       << " body_size=" << m_body.size()
+       << "]";
+    return ss.str();
+}
+
+}
+}
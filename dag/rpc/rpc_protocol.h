@@ -0,0 +1,111 @@
+#ifndef __DAG_RPC_PROTOCOL_H__
+#define __DAG_RPC_PROTOCOL_H__
+
+#include <memory>
+#include <string>
+#include "bytearray.h"
+
+namespace dag {
+namespace rpc {
+
+/**
+ * @brief RPC调用结果
+ */
+enum class RpcStatus : uint32_t {
+    /// 成功
+    OK                = 0,
+    /// 服务端没有注册该方法
+    METHOD_NOT_FOUND  = 1,
+    /// 服务端处理函数返回失败
+    HANDLER_ERROR     = 2,
+    /// 调用超时
+    TIMEOUT           = 3,
+    /// 连接已关闭或发送失败
+    CONNECTION_CLOSED = 4,
+    /// 收到非法的帧
+    BAD_FRAME         = 5,
+};
+
+/**
+ * @brief 返回RpcStatus对应的描述
+ */
+const char* RpcStatusToString(RpcStatus s);
+
+/**
+ * @brief RPC消息(一帧)
+ * @details 帧格式(网络字节序):
+ *  +-------+---------+------+----------+------+--------+--------+----------------------------+
+ *  | magic | version | type | reserved |  id  | status | length | payload(length字节)        |
+ *  |  1B   |   1B    |  1B  |    1B    |  4B  |   4B   |   4B   | method(varint串) + body    |
+ *  +-------+---------+------+----------+------+--------+--------+----------------------------+
+ *  同一个连接上的多个调用通过id区分, 响应可以乱序返回
+ */
+class RpcMessage {
+public:
+    using ptr = std::shared_ptr<RpcMessage>;
+
+    /**
+     * @brief 消息类型
+     */
+    enum Type : uint8_t {
+        REQUEST  = 1,
+        RESPONSE = 2,
+    };
+
+    /// 魔数
+    static const uint8_t MAGIC = 0xda;
+    /// 协议版本
+    static const uint8_t VERSION = 1;
+    /// 固定头部长度
+    static const size_t HEADER_SIZE = 16;
+    /// payload最大长度
+    static const uint32_t MAX_PAYLOAD_SIZE = 64 * 1024 * 1024;
+
+    RpcMessage(Type type = REQUEST, uint32_t id = 0)
+        :m_type(type), m_id(id) {}
+
+    Type getType() const { return m_type;}
+    uint32_t getId() const { return m_id;}
+    RpcStatus getStatus() const { return m_status;}
+    const std::string& getMethod() const { return m_method;}
+    const std::string& getBody() const { return m_body;}
+    std::string& getBodyRef() { return m_body;}
+
+    void setType(Type v) { m_type = v;}
+    void setId(uint32_t v) { m_id = v;}
+    void setStatus(RpcStatus v) { m_status = v;}
+    void setMethod(const std::string& v) { m_method = v;}
+    void setBody(const std::string& v) { m_body = v;}
+
+    /**
+     * @brief 将完整的帧追加写入ba的当前位置
+     */
+    void encode(ByteArray::ptr ba) const;
+
+    /**
+     * @brief 从ba的当前位置解码一帧
+     * @param[in] ba 数据
+     * @param[out] err 非法帧时置为true
+     * @return 成功返回消息并前移ba的位置; 数据不足一帧或出错返回nullptr且不移动位置
+     */
+    static RpcMessage::ptr Decode(ByteArray::ptr ba, bool& err);
+
+    std::string toString() const;
+
+private:
+    /// 消息类型
+    Type m_type;
+    /// 请求id
+    uint32_t m_id;
+    /// 调用结果(仅响应有效)
+    RpcStatus m_status = RpcStatus::OK;
+    /// 方法名(仅请求有效)
+    std::string m_method;
+    /// 序列化后的参数/返回值
+    std::string m_body;
+};
+
+}
+}
+
+#endif
@@ -0,0 +1,67 @@
+#include "rpc_server.h"
+#include "logger.h"
+
+namespace dag {
+namespace rpc {
+
+static dag::Logger::ptr g_logger = DAG_LOG_NAME("system");
+
+RpcServer::RpcServer(dag::IOManager* worker
+               ,dag::IOManager* io_worker
+               ,dag::IOManager* accept_worker)
+    :TcpServer(worker, io_worker, accept_worker) {
+    m_type = "rpc";
+}
+
+void RpcServer::registerMethod(const std::string& name, Handler handler) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_methods[name] = handler;
+}
+
+void RpcServer::unregisterMethod(const std::string& name) {
+    std::unique_lock<std::shared_mutex> lock(m_mutex);
+    m_methods.erase(name);
+}
+
+void RpcServer::handleClient(Socket::ptr client) {
+    #if DEBUG
+    DAG_LOG_DEBUG(g_logger) << "handleClient " << *client;
+    #endif
+    RpcSession::ptr session(new RpcSession(client));
+    while(true) {
+        RpcMessage::ptr msg = session->recvMessage();
+        if(!msg) {
+            break;
+        }
+        if(msg->getType() != RpcMessage::REQUEST) {
+            DAG_LOG_ERROR(g_logger) << "unexpected " << msg->toString()
+                                    << " from " << *client;
+            continue;
+        }
+        m_worker->schedulerLock(std::bind(&RpcServer::handleRequest
+                    ,std::static_pointer_cast<RpcServer>(shared_from_this())
+                    ,session, msg));
+    }
+    session->close();
+}
+
+void RpcServer::handleRequest(RpcSession::ptr session, RpcMessage::ptr req) {
+    RpcMessage::ptr rsp(new RpcMessage(RpcMessage::RESPONSE, req->getId()));
+    Handler handler;
+    {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        auto it = m_methods.find(req->getMethod());
+        if(it != m_methods.end()) {
+            handler = it->second;
+        }
+    }
+    if(!handler) {
+        rsp->setStatus(RpcStatus::METHOD_NOT_FOUND);
+    } else if(!handler(req->getBody(), rsp->getBodyRef())) {
+        rsp->setStatus(RpcStatus::HANDLER_ERROR);
+    }
+    session->sendMessage(rsp);
+}
+
+}
+}
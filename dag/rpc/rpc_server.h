@@ -0,0 +1,69 @@
+#ifndef __DAG_RPC_SERVER_H__
+#define __DAG_RPC_SERVER_H__
+
+#include <functional>
+#include <shared_mutex>
+#include <unordered_map>
+#include "tcp_server.h"
+#include "rpc_session.h"
+
+namespace dag {
+namespace rpc {
+
+/**
+ * @brief RPC服务器
+ * @details 每个连接由一个协程循环收帧, 每个请求作为独立任务调度到worker上执行,
+ *          因此同一连接上的慢请求不会阻塞后面的请求, 响应按完成顺序乱序返回
+ */
+class RpcServer : public TcpServer {
+public:
+    using ptr = std::shared_ptr<RpcServer>;
+
+    /**
+     * @brief 方法处理函数
+     * @param[in] request 请求体
+     * @param[out] response 响应体
+     * @return 返回true表示处理成功, 否则调用方收到RpcStatus::HANDLER_ERROR
+     */
+    using Handler = std::function<bool(const std::string& request, std::string& response)>;
+
+    /**
+     * @brief 构造函数
+     * @param[in] worker 执行方法处理函数的调度器
+     * @param[in] io_worker 处理连接的调度器
+     * @param[in] accept_worker 接收连接的调度器
+     */
+    RpcServer(dag::IOManager* worker = dag::IOManager::GetThis()
+              ,dag::IOManager* io_worker = dag::IOManager::GetThis()
+              ,dag::IOManager* accept_worker = dag::IOManager::GetThis());
+
+    /**
+     * @brief 注册方法, 同名方法会被覆盖
+     */
+    void registerMethod(const std::string& name, Handler handler);
+
+    /**
+     * @brief 删除方法
+     */
+    void unregisterMethod(const std::string& name);
+
+protected:
+    virtual void handleClient(Socket::ptr client) override;
+
+private:
+    /**
+     * @brief 执行一个请求并发送响应
+     */
+    void handleRequest(RpcSession::ptr session, RpcMessage::ptr req);
+
+private:
+    /// 读写锁
+    std::shared_mutex m_mutex;
+    /// 方法分发表
+    std::unordered_map<std::string, Handler> m_methods;
+};
+
+}
+}
+
+#endif
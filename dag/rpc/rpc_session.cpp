@@ -0,0 +1,87 @@
+#include "rpc_session.h"
+#include "logger.h"
+
+namespace dag {
+namespace rpc {
+
+static dag::Logger::ptr g_logger = DAG_LOG_NAME("system");
+
+/// 每次从socket读取的字节数
+static const size_t READ_BUFFER_SIZE = 16 * 1024;
+/// 发送缓冲的节点大小
+static const size_t WRITE_BUFFER_SIZE = 16 * 1024;
+
+// 帧由m_sendBuf发送, BufferedStream不需要写缓冲
+RpcSession::RpcSession(Socket::ptr sock, bool owner)
+    : BufferedStream(std::make_shared<SocketStream>(sock, owner), READ_BUFFER_SIZE, 0)
+    , m_sockStream(std::static_pointer_cast<SocketStream>(getStream()))
+    , m_sendBuf(new ByteArray(WRITE_BUFFER_SIZE))
+{
+
+}
+
+RpcMessage::ptr RpcSession::recvMessage() {
+    const ByteArray::ptr& buf = getReadBuffer();
+    while(true) {
+        bool err = false;
+        RpcMessage::ptr msg = RpcMessage::Decode(buf, err);
+        if(msg) {
+            return msg;
+        }
+        if(err) {
+            m_badFrame = true;
+            DAG_LOG_ERROR(g_logger) << "recv bad rpc frame from " << getRemoteAddressString();
+            return nullptr;
+        }
+        if(fill() <= 0) {
+            return nullptr;
+        }
+    }
+}
+
+int RpcSession::sendMessage(RpcMessage::ptr msg) {
+    ByteArray::ptr buf;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_writeError) {
+            return -1;
+        }
+        msg->encode(m_sendBuf);
+        if(m_writing) {
+            // 正在写的协程会把这一帧一起发出去
+            return 0;
+        }
+        m_writing = true;
+        buf.swap(m_sendBuf);
+        m_sendBuf.reset(new ByteArray(WRITE_BUFFER_SIZE));
+    }
+
+    int rt = 0;
+    while(true) {
+        buf->setPosition(0);
+        if(m_sockStream->writeFixSize(buf, buf->getSize()) <= 0) {
+            rt = -1;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(rt < 0) {
+            m_writeError = true;
+            m_writing = false;
+            break;
+        }
+        if(m_sendBuf->getSize() == 0) {
+            m_writing = false;
+            break;
+        }
+        buf->clear();
+        buf.swap(m_sendBuf);
+    }
+    if(rt < 0) {
+        // 唤醒阻塞在读上的协程, 让等待中的调用尽快失败
+        close();
+    }
+    return rt;
+}
+
+}
+}
@@ -0,0 +1,76 @@
+#ifndef __DAG_RPC_SESSION_H__
+#define __DAG_RPC_SESSION_H__
+
+#include <mutex>
+#include "stream/buffered_stream.h"
+#include "stream/socket_stream.h"
+#include "rpc_protocol.h"
+
+namespace dag {
+namespace rpc {
+
+/**
+ * @brief RPC连接, 负责帧的收发
+ * @details 接收: 建立在BufferedStream之上, 直接在读缓冲中解帧, 一次读取可以解出多帧;
+ *          发送: 可被多个协程/线程并发调用, 帧先编码进发送缓冲,
+ *          当前没有协程在写时由调用者负责把缓冲一次性writev出去,
+ *          写的过程中其他调用者追加的帧由同一个写者在下一轮一起发送;
+ *          BufferedStream只用于接收, 不对外公开, 否则write/flush会绕过m_sendBuf和m_mutex与sendMessage交错
+ */
+class RpcSession : protected BufferedStream {
+public:
+    using ptr = std::shared_ptr<RpcSession>;
+
+    /// 关闭连接, 唤醒阻塞在recvMessage上的协程
+    using BufferedStream::close;
+
+    /**
+     * @brief 构造函数
+     * @param[in] sock 已连接的socket
+     * @param[in] owner 是否托管sock
+     */
+    RpcSession(Socket::ptr sock, bool owner = true);
+
+    /**
+     * @brief 接收一帧
+     * @return 成功返回消息, 连接关闭/出错/收到非法帧返回nullptr
+     */
+    RpcMessage::ptr recvMessage();
+
+    /**
+     * @brief 发送一帧(线程安全)
+     * @return >=0 成功(帧已发出或已交给正在写的协程), <0 连接出错
+     */
+    int sendMessage(RpcMessage::ptr msg);
+
+    /**
+     * @brief 最近一次recvMessage()失败是否因为收到了非法帧
+     */
+    bool isBadFrame() const { return m_badFrame;}
+
+    /**
+     * @brief 返回连接的socket
+     */
+    Socket::ptr getSocket() const { return m_sockStream->getSocket();}
+
+    std::string getRemoteAddressString() { return m_sockStream->getRemoteAddressString();}
+
+private:
+    /// 被装饰的socket流, 发送时直接写
+    SocketStream::ptr m_sockStream;
+    /// 是否收到非法帧
+    bool m_badFrame = false;
+    /// 保护发送缓冲
+    std::mutex m_mutex;
+    /// 等待发送的帧
+    ByteArray::ptr m_sendBuf;
+    /// 是否有协程正在写
+    bool m_writing = false;
+    /// 写出错后不再发送
+    bool m_writeError = false;
+};
+
+}
+}
+
+#endif
@@ -1,5 +1,7 @@
 #include <iostream>
 #include <assert.h>
+#include <algorithm>
+#include <thread>
 
 
 #include "scheduler.h"
@@ -12,6 +14,11 @@ namespace dag{
 static Logger::ptr g_logger = DAG_LOG_ROOT();
 
 static thread_local Scheduler* t_scheduler = nullptr;
+// 当前工作线程是否被弹性线程池选中退出
+static thread_local bool t_retiring = false;
+
+// trySchedule无锁投递队列的容量
+static const size_t INJECT_QUEUE_CAPACITY = 8192;
 
 Scheduler* Scheduler::GetThis()
 {
@@ -24,8 +31,9 @@ void Scheduler::SetThis()
 }
 
 Scheduler::Scheduler(size_t threads, bool use_caller, const std::string &name)
-    : m_useCaller(use_caller)
-    , m_name(name)
+    : m_name(name)
+    , m_injectQueue(INJECT_QUEUE_CAPACITY)
+    , m_useCaller(use_caller)
 {
 	assert(threads>0 && Scheduler::GetThis()==nullptr);
 
@@ -60,6 +68,7 @@ Scheduler::~Scheduler()
 	{
         t_scheduler = nullptr;
     }
+	delete m_watchdog.load();
 }
 
 void Scheduler::start()
@@ -71,13 +80,342 @@ void Scheduler::start()
 		return;
 	}
 
-	assert(m_threads.empty());
-	m_threads.resize(m_threadCount);
+	assert(m_threads.empty() && !m_started);
+	m_started = true;
+
+	// use_caller的主线程不绑定
+	m_workerCpus.assign(m_threadIds.size(), std::vector<int>());
+	m_workerNodes.assign(m_threadIds.size(), -1);
+
+	// 持有m_mutex直到全部线程创建完毕, 工作线程在run()里要等m_threadIds填好才能找到自己的CPU集合
 	for(size_t i=0;i<m_threadCount;i++)
 	{
-		m_threads[i].reset(new Thread(std::bind(&Scheduler::run, this), m_name + "_" + std::to_string(i)));
-		m_threadIds.push_back(m_threads[i]->getId());
+		spawnWorker();
+	}
+
+	if(m_elastic && !m_elasticThread)
+	{
+		m_elasticThread.reset(new Thread(std::bind(&Scheduler::elasticLoop, this), m_name + "_elastic"));
+	}
+}
+
+void Scheduler::spawnWorker()
+{
+	// 计算工作线程的CPU集合
+	size_t i = m_nextWorker++;
+	std::vector<int> cpus;
+	if(m_affinity)
+	{
+		if(m_cpuPerWorker)
+		{
+			cpus.push_back(m_affinityCpus[i % m_affinityCpus.size()]);
+		}
+		else
+		{
+			cpus = m_affinityCpus;
+		}
+	}
+	int node = -1;
+	for(int cpu : cpus)
+	{
+		int n = getCpuNumaNode(cpu);
+		node = (node == -1 || node == n) ? n : -2;
+	}
+	m_workerCpus.push_back(cpus);
+	m_workerNodes.push_back(node < 0 ? -1 : node);
+
+	std::shared_ptr<Thread> thread(new Thread(std::bind(&Scheduler::run, this), m_name + "_" + std::to_string(i)));
+	m_threads.push_back(thread);
+	m_threadIds.push_back(thread->getId());
+}
+
+void Scheduler::setElastic(const ElasticPolicy& policy)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	m_elasticPolicy = policy;
+	m_elasticPolicy.min_threads = std::max<size_t>(m_elasticPolicy.min_threads, 1);
+	m_elasticPolicy.max_threads = std::max(m_elasticPolicy.max_threads, m_elasticPolicy.min_threads);
+	m_elasticPolicy.interval_ms = std::max<uint64_t>(m_elasticPolicy.interval_ms, 1);
+	m_elastic = true;
+	// start()之前设置时由start()创建扩缩容线程
+	if(m_started && !m_stopping && !m_elasticThread)
+	{
+		m_elasticThread.reset(new Thread(std::bind(&Scheduler::elasticLoop, this), m_name + "_elastic"));
+	}
+}
+
+Scheduler::ElasticPolicy Scheduler::getElasticPolicy()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_elasticPolicy;
+}
+
+Scheduler::ElasticStats Scheduler::getElasticStats()
+{
+	ElasticStats stats;
+	std::lock_guard<std::mutex> lock(m_mutex);
+	stats.workers = m_threadIds.size();
+	stats.scale_ups = m_scaleUps;
+	stats.scale_downs = m_scaleDowns;
+	for(size_t i = 0; i < WAIT_BUCKETS; ++i)
+	{
+		stats.wait_buckets[i] = m_waitBuckets[i].load(std::memory_order_relaxed);
+	}
+	stats.events.assign(m_scaleEvents.begin(), m_scaleEvents.end());
+	return stats;
+}
+
+void Scheduler::recordQueueWait(uint64_t wait_us)
+{
+	size_t bucket = wait_us ? 64 - __builtin_clzll(wait_us) : 0;
+	m_waitBuckets[std::min(bucket, WAIT_BUCKETS - 1)].fetch_add(1, std::memory_order_relaxed);
+	uint64_t max = m_recentMaxWaitUs.load(std::memory_order_relaxed);
+	while(wait_us > max && !m_recentMaxWaitUs.compare_exchange_weak(max, wait_us, std::memory_order_relaxed))
+	{
+	}
+}
+
+void Scheduler::recordScale(size_t from, size_t to, const std::string& reason)
+{
+	ScaleEvent event;
+	event.time_ms = getElapseMs();
+	event.from = from;
+	event.to = to;
+	event.reason = reason;
+	m_scaleEvents.push_back(event);
+	if(m_scaleEvents.size() > MAX_SCALE_EVENTS)
+	{
+		m_scaleEvents.pop_front();
+	}
+	#if DEBUG
+	DAG_LOG_INFO(g_logger) << m_name << " workers " << from << " -> " << to << ": " << reason;
+	#endif
+}
+
+bool Scheduler::retiring() const
+{
+	return t_retiring;
+}
+
+bool Scheduler::tryRetire(int thread_id)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	// 绑定在本线程上的共享栈协程只能在本线程恢复
+	if(m_stopping || thread_id == m_rootThread || m_retireRequests == 0
+		|| m_threadIds.size() <= m_elasticPolicy.min_threads || Fiber::GetPinnedFiberCount() > 0)
+	{
+		return false;
+	}
+	m_retireRequests--;
+	size_t from = m_threadIds.size();
+	for(size_t i = 0; i < m_threadIds.size(); ++i)
+	{
+		if(m_threadIds[i] == thread_id)
+		{
+			m_threadIds.erase(m_threadIds.begin() + i);
+			m_workerCpus.erase(m_workerCpus.begin() + i);
+			m_workerNodes.erase(m_workerNodes.begin() + i);
+			break;
+		}
+	}
+	for(auto it = m_threads.begin(); it != m_threads.end(); ++it)
+	{
+		if((*it)->getId() == thread_id)
+		{
+			m_retiredThreads.push_back(*it);
+			m_threads.erase(it);
+			break;
+		}
+	}
+	m_threadCount--;
+
+	// 指定给本线程的排队任务改为任意线程执行
+	for(auto& queue : m_tasks)
+	{
+		for(auto& t : queue)
+		{
+			if(t.thread == thread_id)
+			{
+				t.thread = -1;
+			}
+		}
+	}
+	for(auto& queue : m_deadlineTasks)
+	{
+		for(auto& t : queue)
+		{
+			if(t.second.thread == thread_id)
+			{
+				t.second.thread = -1;
+			}
+		}
+	}
+	m_scaleDowns++;
+	recordScale(from, m_threadIds.size(), "idle for " + std::to_string(m_elasticPolicy.cooldown_ms) + "ms");
+	return true;
+}
+
+void Scheduler::elasticLoop()
+{
+	// 饱和、有空闲线程分别从什么时候开始, 0表示当前不是
+	uint64_t saturated_since = 0;
+	uint64_t idle_since = 0;
+	std::vector<std::shared_ptr<Thread>> retired;
+	while(true)
+	{
+		ElasticPolicy policy;
+		size_t workers;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if(m_stopping)
+			{
+				break;
+			}
+			policy = m_elasticPolicy;
+			workers = m_threadIds.size();
+			retired.swap(m_retiredThreads);
+		}
+		for(auto& i : retired)
+		{
+			i->join();
+		}
+		retired.clear();
+
+		uint64_t now = getElapseMs();
+		uint64_t max_wait = m_recentMaxWaitUs.exchange(0, std::memory_order_relaxed);
+		size_t pending = m_pendingTaskCount + m_injectQueue.size();
+		std::string reason;
+		if(workers < policy.min_threads)
+		{
+			reason = "below min_threads " + std::to_string(policy.min_threads);
+		}
+		else if(max_wait >= policy.max_queue_wait_us)
+		{
+			reason = "queue wait " + std::to_string(max_wait) + "us";
+		}
+		else if(m_activeThreadCount >= workers && pending > 0)
+		{
+			reason = "all " + std::to_string(workers) + " workers busy, " + std::to_string(pending) + " pending";
+		}
+
+		if(!reason.empty())
+		{
+			idle_since = 0;
+			m_retireRequests = 0;
+			if(!saturated_since)
+			{
+				saturated_since = now;
+			}
+			if((now - saturated_since >= policy.scale_up_ms || workers < policy.min_threads)
+				&& workers < policy.max_threads)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				if(!m_stopping)
+				{
+					m_threadCount++;
+					spawnWorker();
+					m_scaleUps++;
+					recordScale(workers, m_threadIds.size(), reason);
+				}
+				// 下一个线程要再饱和scale_up_ms才增加
+				saturated_since = now;
+			}
+		}
+		else
+		{
+			saturated_since = 0;
+			if(m_idleThreadCount > 0 && workers > policy.min_threads)
+			{
+				if(!idle_since)
+				{
+					idle_since = now;
+				}
+				else if(now - idle_since >= policy.cooldown_ms)
+				{
+					// 唤醒一个阻塞在idle中的线程, 它回到run()后取走退出请求
+					m_retireRequests = 1;
+					tickle();
+					idle_since = now;
+				}
+			}
+			else
+			{
+				idle_since = 0;
+			}
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(policy.interval_ms));
+	}
+}
+
+void Scheduler::setCpuAffinity(const std::vector<int>& cpus, bool one_per_worker)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	assert(m_threads.empty());
+	// 默认只用进程允许的CPU, 绑到cpuset以外的核会失败
+	m_affinityCpus = cpus.empty() ? getAllowedCpus() : cpus;
+	m_cpuPerWorker = one_per_worker;
+	m_affinity = true;
+}
+
+void Scheduler::setWatchdog(uint64_t threshold_ms)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(m_watchdog)
+	{
+		m_watchdog.load()->setThreshold(threshold_ms);
+	}
+	else if(threshold_ms)
+	{
+		m_watchdog = new Watchdog(m_name, threshold_ms);
+	}
+}
+
+std::map<int, Watchdog::Stats> Scheduler::getWatchdogStats()
+{
+	Watchdog* watchdog = m_watchdog;
+	return watchdog ? watchdog->getStats() : std::map<int, Watchdog::Stats>();
+}
+
+size_t Scheduler::getWorkerCount()
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_threadIds.size();
+}
+
+int Scheduler::getWorkerThreadId(size_t idx)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return idx < m_threadIds.size() ? m_threadIds[idx] : -1;
+}
+
+int Scheduler::getWorkerCpu(size_t idx)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	if(idx >= m_workerCpus.size() || m_workerCpus[idx].size() != 1)
+	{
+		return -1;
+	}
+	return m_workerCpus[idx][0];
+}
+
+int Scheduler::getWorkerNode(size_t idx)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return idx < m_workerNodes.size() ? m_workerNodes[idx] : -1;
+}
+
+std::vector<int> Scheduler::getWorkerThreadIdsOnNode(int node)
+{
+	std::lock_guard<std::mutex> lock(m_mutex);
+	std::vector<int> ids;
+	for(size_t i = 0; i < m_workerNodes.size() && i < m_threadIds.size(); ++i)
+	{
+		if(m_workerNodes[i] == node)
+		{
+			ids.push_back(m_threadIds[i]);
+		}
 	}
+	return ids;
 }
 
 void Scheduler::run()
@@ -94,38 +432,56 @@ void Scheduler::run()
 	// 运行在新创建的线程 -> 需要创建主协程
 	if(thread_id != m_rootThread)
 	{
+		// 先绑核再创建协程, 让协程栈在本地NUMA节点上首次分配
+		std::vector<int> cpus;
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			for(size_t i = 0; i < m_threadIds.size() && i < m_workerCpus.size(); ++i)
+			{
+				if(m_threadIds[i] == thread_id)
+				{
+					cpus = m_workerCpus[i];
+					break;
+				}
+			}
+		}
+		if(!cpus.empty() && !setThreadAffinity(cpus))
+		{
+			// 线程照常运行, 只是没有绑核, getWorkerCpu等仍返回配置的CPU, 不论是否DEBUG都要报告
+			std::string list;
+			for(int cpu : cpus)
+			{
+				list += (list.empty() ? "" : ",") + std::to_string(cpu);
+			}
+			DAG_LOG_ERROR(g_logger) << m_name << " set affinity failed thread=" << thread_id << " cpus=" << list;
+		}
 		Fiber::GetThis();
 	}
 
 	std::shared_ptr<Fiber> idle_fiber = std::make_shared<Fiber>(std::bind(&Scheduler::idle, this));
 	SchedulerTask task;
+	// 本线程登记的看门狗
+	Watchdog* watchdog = nullptr;
 	
 	while(true)
 	{
 		task.reset();
 		bool tickle_me = false;
+		pollWhileBusy();
 
 		{
 			std::lock_guard<std::mutex> lock(m_mutex);
-			auto it = m_tasks.begin();
-			// 1 遍历任务队列
-			while(it!=m_tasks.end())
+			// 1 按优先级遍历任务队列, 2 取出任务
+			if(takeTask(thread_id, task, tickle_me))
 			{
-				if(it->thread!=-1&&it->thread!=thread_id)
-				{
-					it++;
-					tickle_me = true;
-					continue;
-				}
-
-				// 2 取出任务
-				assert(it->fiber||it->cb);
-				task = *it;
-				m_tasks.erase(it); 
 				m_activeThreadCount++;
-				break;
-			}	
-			tickle_me = tickle_me || (it != m_tasks.end());
+				// 还有任务时才唤醒其他线程, 否则每取一个任务都会白白唤醒一个阻塞在epoll_wait的线程
+				tickle_me = tickle_me || m_pendingTaskCount > 0 || !m_injectQueue.empty();
+			}
+		}
+		if(task.enqueue_us)
+		{
+			recordQueueWait(getElapseUs() - task.enqueue_us);
 		}
 
 		if(tickle_me)
@@ -133,6 +489,12 @@ void Scheduler::run()
 			tickle();
 		}
 
+		if((task.fiber || task.cb) && watchdog != m_watchdog.load(std::memory_order_relaxed))
+		{
+			watchdog = m_watchdog;
+			watchdog->attach();
+		}
+
 		// 3 执行任务
 		if(task.fiber)
 		{
@@ -140,7 +502,9 @@ void Scheduler::run()
 				std::lock_guard<std::mutex> lock(task.fiber->m_mutex);
 				if(task.fiber->getState()!=Fiber::TERM)
 				{
-					task.fiber->resume();	
+					Watchdog::OnResume(task.fiber.get());
+					task.fiber->resume();
+					Watchdog::OnSuspend();
 				}
 			}
 			m_activeThreadCount--;
@@ -148,10 +512,16 @@ void Scheduler::run()
 		}
 		else if(task.cb)
 		{
-			std::shared_ptr<Fiber> cb_fiber = std::make_shared<Fiber>(task.cb);
+			std::shared_ptr<Fiber> cb_fiber = std::make_shared<Fiber>(task.cb, Fiber::GetStackClassSize(task.stack_class)
+				, true, task.stack_class == Fiber::STACK_SHARED);
+			cb_fiber->setPriority(task.priority);
+			cb_fiber->setDeadline(task.deadline_ms);
+			cb_fiber->setSite(task.site);
 			{
 				std::lock_guard<std::mutex> lock(cb_fiber->m_mutex);
-				cb_fiber->resume();			
+				Watchdog::OnResume(cb_fiber.get());
+				cb_fiber->resume();
+				Watchdog::OnSuspend();
 			}
 			m_activeThreadCount--;
 			task.reset();	
@@ -162,9 +532,30 @@ void Scheduler::run()
 			// 系统关闭 -> idle协程将从死循环跳出并结束 -> 此时的idle协程状态为TERM -> 再次进入将跳出循环并退出run()
             if (idle_fiber->getState() == Fiber::TERM) 
             {
+				if(watchdog)
+				{
+					watchdog->detach();
+				}
                 break;
             }
+			// 弹性模式下被选中退出: idle协程看到retiring()后结束, 本线程不再取任务
+			if(m_retireRequests > 0 && tryRetire(thread_id))
+			{
+				t_retiring = true;
+				idle_fiber->resume();
+				if(watchdog)
+				{
+					watchdog->detach();
+				}
+				break;
+			}
 			m_idleThreadCount++;
+			// 先登记为空闲再检查无锁队列, 与trySchedule先入队再检查空闲线程配对, 避免漏掉唤醒
+			if(!m_injectQueue.empty())
+			{
+				m_idleThreadCount--;
+				continue;
+			}
 			idle_fiber->resume();
 			m_idleThreadCount--;
 		}
@@ -214,6 +605,22 @@ void Scheduler::stop()
 	{
 		i->join();
 	}
+
+	// 扩缩容线程看到m_stopping后退出, 不会再创建线程
+	std::shared_ptr<Thread> elastic;
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		elastic.swap(m_elasticThread);
+		thrs.swap(m_retiredThreads);
+	}
+	if(elastic)
+	{
+		elastic->join();
+	}
+	for(auto &i : thrs)
+	{
+		i->join();
+	}
     #if DEBUG
     DAG_LOG_DEBUG(g_logger) << this << " stopped";
     #endif
@@ -229,7 +636,7 @@ void Scheduler::idle()
     #if DEBUG
     DAG_LOG_INFO(g_logger) << "idle";
     #endif
-	while(!stopping())
+	while(!stopping() && !retiring())
 	{
 		Fiber::GetThis()->yield();
 	}
@@ -238,7 +645,201 @@ void Scheduler::idle()
 bool Scheduler::stopping() 
 {
     std::lock_guard<std::mutex> lock(m_mutex);
-    return m_stopping && m_tasks.empty() && m_activeThreadCount == 0;
+    return m_stopping && m_pendingTaskCount == 0 && m_injectQueue.empty() && m_activeThreadCount == 0;
+}
+
+void Scheduler::pushTask(SchedulerTask&& task)
+{
+	if(task.priority < 0 || task.priority >= Fiber::PRIORITY_COUNT)
+	{
+		task.priority = Fiber::PRIORITY_NORMAL;
+	}
+	// 指定的线程已经缩容退出时改为任意线程执行, 与tryRetire改写排队任务一致
+	if(task.thread != -1 && std::find(m_threadIds.begin(), m_threadIds.end(), task.thread) == m_threadIds.end())
+	{
+		task.thread = -1;
+	}
+	int p = task.priority;
+	if(m_agingMs[p] > 0 && !task.enqueue_ms)
+	{
+		task.enqueue_ms = getElapseMs();
+	}
+	if(m_elastic && !task.enqueue_us)
+	{
+		task.enqueue_us = getElapseUs();
+	}
+	if(task.deadline_ms)
+	{
+		uint64_t deadline = task.deadline_ms;
+		m_deadlineTasks[p].emplace(deadline, std::move(task));
+	}
+	else
+	{
+		m_tasks[p].push_back(std::move(task));
+	}
+	m_pendingTaskCount++;
+}
+
+void Scheduler::dropExpiredTasks(uint64_t now)
+{
+	for(auto& queue : m_deadlineTasks)
+	{
+		for(auto it = queue.begin(); it != queue.end() && it->first <= now;)
+		{
+			if(it->second.fiber)
+			{
+				++it;
+				continue;
+			}
+			it = queue.erase(it);
+			m_pendingTaskCount--;
+			m_expiredTaskCount++;
+		}
+	}
+}
+
+bool Scheduler::takeTask(int thread_id, SchedulerTask& task, bool& skipped)
+{
+	// 无锁投递队列中的任务都是普通优先级, 转入加锁的普通队列排在已有任务之后, 同样参与老化
+	SchedulerTask injected;
+	while(m_injectQueue.tryPop(injected))
+	{
+		pushTask(std::move(injected));
+		injected.reset();
+	}
+
+	uint64_t now = 0;
+	for(auto& queue : m_deadlineTasks)
+	{
+		if(!queue.empty())
+		{
+			now = getElapseMs();
+			dropExpiredTasks(now);
+			break;
+		}
+	}
+
+	// 队列中第一个本线程可以执行的任务
+	auto runnable = [thread_id, &skipped](const SchedulerTask& t)
+	{
+		if(t.thread != -1 && t.thread != thread_id)
+		{
+			skipped = true;
+			return false;
+		}
+		return true;
+	};
+	auto find = [&runnable](std::deque<SchedulerTask>& queue)
+	{
+		auto it = queue.begin();
+		while(it != queue.end() && !runnable(*it))
+		{
+			++it;
+		}
+		return it;
+	};
+	auto findDeadline = [&runnable](DeadlineQueue& queue)
+	{
+		auto it = queue.begin();
+		while(it != queue.end() && !runnable(it->second))
+		{
+			++it;
+		}
+		return it;
+	};
+	// 从p优先级中取出任务: 先按截止时间, 再按先后; aging不为0时只取等待超过aging毫秒的
+	auto takeFrom = [&](int p, uint64_t aging)
+	{
+		auto overdue = [&](const SchedulerTask& t)
+		{
+			if(!aging)
+			{
+				return true;
+			}
+			if(!t.enqueue_ms)
+			{
+				return false;
+			}
+			now = now ? now : getElapseMs();
+			return now - t.enqueue_ms >= aging;
+		};
+		auto dit = findDeadline(m_deadlineTasks[p]);
+		if(dit != m_deadlineTasks[p].end() && overdue(dit->second))
+		{
+			assert(dit->second.fiber || dit->second.cb);
+			task = std::move(dit->second);
+			m_deadlineTasks[p].erase(dit);
+			m_pendingTaskCount--;
+			return true;
+		}
+		auto it = find(m_tasks[p]);
+		if(it != m_tasks[p].end() && overdue(*it))
+		{
+			assert(it->fiber || it->cb);
+			task = std::move(*it);
+			m_tasks[p].erase(it);
+			m_pendingTaskCount--;
+			return true;
+		}
+		return false;
+	};
+	auto empty = [this](int p)
+	{
+		return m_tasks[p].empty() && m_deadlineTasks[p].empty();
+	};
+
+	// 老化: 有更高优先级的任务在等时, 等待超过老化时间的低优先级任务先执行, 但不连续选中
+	if(!m_lastAged)
+	{
+		bool higher_waiting = !empty(Fiber::PRIORITY_HIGH);
+		for(int p = Fiber::PRIORITY_HIGH + 1; p < Fiber::PRIORITY_COUNT; ++p)
+		{
+			uint64_t aging = m_agingMs[p];
+			if(higher_waiting && aging > 0 && !empty(p) && takeFrom(p, aging))
+			{
+				m_lastAged = true;
+				return true;
+			}
+			higher_waiting = higher_waiting || !empty(p);
+		}
+	}
+
+	m_lastAged = false;
+	for(int p = Fiber::PRIORITY_HIGH; p < Fiber::PRIORITY_COUNT; ++p)
+	{
+		if(takeFrom(p, 0))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void Scheduler::setAgingMs(Fiber::Priority priority, uint64_t ms)
+{
+	if(priority > Fiber::PRIORITY_HIGH && priority < Fiber::PRIORITY_COUNT)
+	{
+		m_agingMs[priority] = ms;
+	}
+}
+
+uint64_t Scheduler::getAgingMs(Fiber::Priority priority) const
+{
+	if(priority < 0 || priority >= Fiber::PRIORITY_COUNT)
+	{
+		return 0;
+	}
+	return m_agingMs[priority];
+}
+
+size_t Scheduler::getPendingTaskCount(Fiber::Priority priority)
+{
+	if(priority < 0 || priority >= Fiber::PRIORITY_COUNT)
+	{
+		return 0;
+	}
+	std::lock_guard<std::mutex> lock(m_mutex);
+	return m_tasks[priority].size() + m_deadlineTasks[priority].size();
 }
 
 
@@ -1,12 +1,20 @@
 #ifndef _SCHEDULER_H_
 #define _SCHEDULER_H_
     
+#include <algorithm>
+#include <deque>
 #include <functional>
+#include <iterator>
+#include <map>
+#include <string>
 #include <vector>
 #include <atomic>
 
 #include "fiber.h"
 #include "thread.h"
+#include "watchdog.h"
+#include "utils/mpmc_queue.h"
+#include "utils/util.h"
 
 
 namespace dag{
@@ -56,21 +64,37 @@ public:
     * @brief 添加调度任务
     * @tparam FiberOrCb 调度任务类型，可以是协程对象或函数指针
     * @param[] fc协程对象或指针
-    * @param[] thread 指定运行该任务的线程号，-1表示任意线程
+    * @param[] thread 指定运行该任务的线程号，-1表示任意线程; 该线程已经退出(弹性模式缩容)时按-1处理
+    * @param[] stack_class 回调任务所用协程的栈大小档位, 对协程对象无效;
+    *                      STACK_SHARED的回调任务运行在共享栈上, 第一次运行后只在同一个线程上恢复
+    * @param[] priority 回调任务的优先级, 运行回调的协程继承该优先级; 协程对象使用自身的优先级
+    * @param[] deadline_ms 回调任务的截止时间(getElapseMs()的毫秒数), 0表示没有; 运行回调的协程继承该截止时间,
+    *                      到期时还没开始执行的回调任务被丢弃并计入getExpiredTaskCount(); 协程对象使用自身的截止时间
+    * @param[] site 回调任务的调用点名称, 开启StackProfiler时按它而不是回调的类型统计, 须为字符串字面量等静态存储期的字符串;
+    *               协程对象用Fiber::setSite设置
     */
     template <class FiberOrCb>
-    void schedulerLock(FiberOrCb fc, int thread = -1)
+    void schedulerLock(FiberOrCb fc, int thread = -1, Fiber::StackClass stack_class = Fiber::STACK_DEFAULT
+                       ,Fiber::Priority priority = Fiber::PRIORITY_NORMAL, uint64_t deadline_ms = 0
+                       ,const char* site = nullptr)
     {
         bool need_tickle;
         {
             std::lock_guard<std::mutex> lock(m_mutex);
             // empty -> all thread is idle -> need to be waken up
-            need_tickle = m_tasks.empty();
+            need_tickle = m_pendingTaskCount == 0;
 
             SchedulerTask task(fc,thread);
+            task.stack_class = stack_class;
+            if (task.cb)
+            {
+                task.priority = priority;
+                task.deadline_ms = deadline_ms;
+                task.site = site;
+            }
             if (task.fiber || task.cb)
             {
-                m_tasks.push_back(task);
+                pushTask(std::move(task));
             }
         }
 
@@ -80,6 +104,251 @@ public:
         }
     }
 
+    /**
+    * @brief 批量添加调度任务
+    * @details 所有任务在同一个临界区内入队, 之后只唤醒min(任务数, 空闲线程数)个线程,
+    *          提交N个任务的系统调用次数与N无关
+    * @tparam InputIterator 指向std::shared_ptr<Fiber>或std::function<void()>的迭代器
+    * @param[] begin 起始迭代器, 元素被移入任务队列, 调用后为空
+    * @param[] end 结束迭代器
+    * @param[] thread 指定运行这些任务的线程号，-1表示任意线程
+    * @param[] priority 回调任务的优先级, 协程对象使用自身的优先级
+    * @return 实际入队的任务数(空元素被忽略)
+    */
+    template <class InputIterator>
+    size_t scheduleBatch(InputIterator begin, InputIterator end, int thread = -1
+                         ,Fiber::Priority priority = Fiber::PRIORITY_NORMAL)
+    {
+        size_t count = 0;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (; begin != end; ++begin)
+            {
+                SchedulerTask task(&*begin, thread);
+                if (task.cb)
+                {
+                    task.priority = priority;
+                }
+                if (task.fiber || task.cb)
+                {
+                    pushTask(std::move(task));
+                    ++count;
+                }
+            }
+        }
+
+        size_t wake = std::min(count, m_idleThreadCount.load());
+        for (size_t i = 0; i < wake; ++i)
+        {
+            tickle();
+        }
+        return count;
+    }
+
+    /**
+    * @brief 批量添加调度任务
+    * @param[] tasks 存放std::shared_ptr<Fiber>或std::function<void()>的容器, 元素被移入任务队列
+    * @param[] thread 指定运行这些任务的线程号，-1表示任意线程
+    * @param[] priority 回调任务的优先级, 协程对象使用自身的优先级
+    * @return 实际入队的任务数
+    */
+    template <class Container>
+    size_t scheduleBatch(Container& tasks, int thread = -1, Fiber::Priority priority = Fiber::PRIORITY_NORMAL)
+    {
+        return scheduleBatch(std::begin(tasks), std::end(tasks), thread, priority);
+    }
+
+    /**
+    * @brief 无锁地提交调度任务, 不等待, 供非工作线程(如消息消费线程)跨线程投递使用
+    * @details 任务进入有界MPMC环形队列, 可由任意工作线程取出执行, 不能指定线程;
+    *          工作线程取任务时把无锁队列中的任务转入加锁的普通队列, 与其他普通优先级任务按先后执行并参与老化
+    * @param[] fc 协程对象或函数
+    * @return 队列已满时返回false, 任务未提交, 调用方自行决定丢弃、重试或改用schedulerLock
+    */
+    template <class FiberOrCb>
+    bool trySchedule(FiberOrCb fc)
+    {
+        SchedulerTask task(fc, -1);
+        if (!task.fiber && !task.cb)
+        {
+            return false;
+        }
+        if (task.thread != -1 || task.priority != Fiber::PRIORITY_NORMAL || task.deadline_ms)
+        {
+            // 绑定了线程的共享栈协程或非普通优先级、有截止时间的协程, 无锁队列不能表达, 改走加锁队列
+            schedulerLock(task.fiber);
+            return true;
+        }
+        if (m_elastic)
+        {
+            task.enqueue_us = getElapseUs();
+        }
+        // 老化从提交时算起, 而不是转入加锁队列时
+        if (m_agingMs[Fiber::PRIORITY_NORMAL] > 0)
+        {
+            task.enqueue_ms = getElapseMs();
+        }
+        if (!m_injectQueue.tryPush(std::move(task)))
+        {
+            return false;
+        }
+        // 与run()中先增加空闲线程数再检查队列配对, 两边至少有一方能看到对方
+        if (hasIdleThreads())
+        {
+            tickle();
+        }
+        return true;
+    }
+
+    /**
+     * @brief 无锁投递队列中的任务数(近似值)
+    */
+    size_t getInjectQueueSize() const {return m_injectQueue.size();}
+
+    /**
+     * @brief 无锁投递队列容量
+    */
+    size_t getInjectQueueCapacity() const {return m_injectQueue.capacity();}
+
+    /**
+     * @brief 设置工作线程的CPU亲和性, 需在start()之前调用
+     * @details 线程在run()开头、创建任何协程之前完成绑定, 之后协程栈等内存由该线程首次写入,
+     *          按内核默认的本地分配策略落在线程所在的NUMA节点上; use_caller的主线程不绑定
+     * @param[in] cpus CPU编号列表, 为空表示进程允许运行的全部CPU(sched_getaffinity)
+     * @param[in] one_per_worker true: 第i个工作线程只绑定cpus[i % cpus.size()]一个核;
+     *                           false: 所有工作线程都可以在cpus中的任意核上运行
+     */
+    void setCpuAffinity(const std::vector<int>& cpus = {}, bool one_per_worker = true);
+
+    /**
+     * @brief 设置优先级的老化时间
+     * @details 队列中等待超过老化时间的任务可以先于更高优先级的任务执行, 避免被持续的高优先级负载饿死;
+     *          为了不让积压的低优先级任务反过来拖慢高优先级任务, 老化的任务不会连续被选中,
+     *          高优先级任务最多等一个老化任务; 默认普通100ms, 后台500ms, 0表示不老化; 高优先级不需要老化
+     * @param[in] priority 优先级
+     * @param[in] ms 老化时间(毫秒)
+     */
+    void setAgingMs(Fiber::Priority priority, uint64_t ms);
+
+    uint64_t getAgingMs(Fiber::Priority priority) const;
+
+    /**
+     * @brief 某个优先级队列中等待的任务数(加锁队列, 不含无锁投递队列)
+     */
+    size_t getPendingTaskCount(Fiber::Priority priority);
+
+    /**
+     * @brief 因过了截止时间而在执行前被丢弃的回调任务数
+     */
+    uint64_t getExpiredTaskCount() const {return m_expiredTaskCount;}
+
+    /**
+     * @brief 开启长时间运行协程的看门狗, start()之前或之后都可以调用
+     * @details 协程一次连续运行(从恢复到让出)超过threshold_ms时, 记录协程id和它的调用栈, 计入getWatchdogStats();
+     *          再次调用修改阈值, 0表示暂停检测
+     */
+    void setWatchdog(uint64_t threshold_ms);
+
+    /**
+     * @brief 各工作线程的看门狗统计, key为线程id, 未开启看门狗时为空
+     */
+    std::map<int, Watchdog::Stats> getWatchdogStats();
+
+    /**
+     * @brief 弹性线程池的策略
+     */
+    struct ElasticPolicy
+    {
+        // 工作线程数的下限和上限(包括use_caller的主线程)
+        size_t min_threads = 1;
+        size_t max_threads = 1;
+        // 任务排队时间超过该值(微秒)视为饱和
+        uint64_t max_queue_wait_us = 2000;
+        // 饱和(排队时间超限, 或所有线程都在执行任务且队列不空)持续该时间(毫秒)后增加一个线程
+        uint64_t scale_up_ms = 20;
+        // 有线程空闲持续该时间(毫秒)后退出一个多余的线程
+        uint64_t cooldown_ms = 2000;
+        // 扩缩容检查的间隔(毫秒)
+        uint64_t interval_ms = 5;
+    };
+
+    /**
+     * @brief 一次扩缩容决策
+     */
+    struct ScaleEvent
+    {
+        // getElapseMs()的时间
+        uint64_t time_ms = 0;
+        size_t from = 0;
+        size_t to = 0;
+        std::string reason;
+    };
+
+    /// 排队时间直方图的桶数: <1us, <2us, <4us, ..., <2^(n-2)us, 更长
+    static const size_t WAIT_BUCKETS = 24;
+
+    /**
+     * @brief 弹性线程池的统计
+     */
+    struct ElasticStats
+    {
+        // 当前工作线程数
+        size_t workers = 0;
+        // 扩容、缩容次数
+        uint64_t scale_ups = 0;
+        uint64_t scale_downs = 0;
+        // 排队时间直方图, wait_buckets[i]为排队时间在[2^(i-1), 2^i)微秒之间的任务数, 最后一个桶为更长
+        uint64_t wait_buckets[WAIT_BUCKETS] = {0};
+        // 最近的扩缩容决策, 按时间先后, 最多保留MAX_SCALE_EVENTS个
+        std::vector<ScaleEvent> events;
+    };
+
+    /**
+     * @brief 开启弹性线程池, start()之前或之后都可以调用, 再次调用修改策略
+     * @details 后台线程每interval_ms检查一次: 饱和持续scale_up_ms后增加一个工作线程, 直到max_threads;
+     *          有线程空闲持续cooldown_ms后让一个空闲线程退出, 直到min_threads;
+     *          use_caller的主线程和绑定着未结束的共享栈协程的线程不会退出, 指定给退出线程的排队任务改为任意线程执行
+     * @attention 工作线程id会随扩缩容变化, 指定线程的任务应在提交前用getWorkerThreadId取当前的id
+     */
+    void setElastic(const ElasticPolicy& policy);
+
+    ElasticPolicy getElasticPolicy();
+
+    /**
+     * @brief 弹性线程池的统计, 排队时间只在开启弹性模式后记录
+     */
+    ElasticStats getElasticStats();
+
+    /**
+     * @brief 工作线程数(包括use_caller的主线程)
+     */
+    size_t getWorkerCount();
+
+    /**
+     * @brief 第idx个工作线程的线程id, 可作为schedulerLock的thread参数
+     */
+    int getWorkerThreadId(size_t idx);
+
+    /**
+     * @brief 扩容、缩容的总次数, 变化后之前取得的工作线程id可能已失效
+     */
+    uint64_t getScaleCount() const {return m_scaleUps + m_scaleDowns;}
+
+    /**
+     * @brief 第idx个工作线程绑定的CPU, 未绑定到单个核时返回-1
+     */
+    int getWorkerCpu(size_t idx);
+
+    /**
+     * @brief 第idx个工作线程所在的NUMA节点, 未绑定或跨节点时返回-1
+     */
+    int getWorkerNode(size_t idx);
+
+    /**
+     * @brief 返回绑定在node节点上的工作线程id
+     */
+    std::vector<int> getWorkerThreadIdsOnNode(int node);
+
     /**
      * @brief 启动线程池
     */
@@ -112,12 +381,27 @@ protected:
     */
     virtual bool stopping();
 
+    /**
+    * @brief 每次取任务前调用, 供子类在任务持续不断、不进入idle时处理IO事件等
+    */
+    virtual void pollWhileBusy() {}
+
     /**
     * @brief 返回是否有空闲线程
     * @details 当调度协程进入idle时空闲线程加1,从idle协程返回时空闲线程数减1
     */
     bool hasIdleThreads() {return m_idleThreadCount > 0;}
 
+    /**
+    * @brief 返回是否有等待执行的任务, 不加锁, 供idle自旋时检查
+    */
+    bool hasPendingTasks() const {return m_pendingTaskCount > 0 || !m_injectQueue.empty();}
+
+    /**
+    * @brief 当前工作线程是否被弹性线程池选中退出, idle协程看到后应尽快返回
+    */
+    bool retiring() const;
+
 private:
     /**
      * @brief 调度任务，协程/函数二选一，可指定在那个线程上调度
@@ -127,6 +411,12 @@ private:
         std::shared_ptr<Fiber> fiber;
         std::function<void()> cb;
         int thread; //指定任务需要运行的线程id
+        Fiber::StackClass stack_class = Fiber::STACK_DEFAULT; //运行cb的协程的栈大小档位
+        Fiber::Priority priority = Fiber::PRIORITY_NORMAL; //优先级, 协程任务取协程自身的优先级
+        uint64_t enqueue_ms = 0; //入队时间, 只在该优先级开启老化时记录
+        uint64_t deadline_ms = 0; //截止时间, 协程任务取协程自身的截止时间
+        uint64_t enqueue_us = 0; //入队时间(微秒), 只在弹性模式下记录, 用于排队时间统计
+        const char* site = nullptr; //回调任务的调用点名称, 交给运行它的协程供StackProfiler统计
 
         SchedulerTask()
         {
@@ -135,16 +425,21 @@ private:
             thread = -1;
         }
 
+        // 共享栈协程未指定线程时发往它绑定的线程
         SchedulerTask(std::shared_ptr<Fiber> f,int thr)
         {
             fiber = f;
-            thread = thr;
+            thread = (thr == -1 && fiber) ? fiber->getPinnedThread() : thr;
+            priority = fiber ? fiber->getPriority() : Fiber::PRIORITY_NORMAL;
+            deadline_ms = fiber ? fiber->getDeadline() : 0;
         }
 
         SchedulerTask(std::shared_ptr<Fiber>* f,int thr)
         {
             fiber.swap(*f);
-            thread = thr;
+            thread = (thr == -1 && fiber) ? fiber->getPinnedThread() : thr;
+            priority = fiber ? fiber->getPriority() : Fiber::PRIORITY_NORMAL;
+            deadline_ms = fiber ? fiber->getDeadline() : 0;
         }
 
         SchedulerTask(std::function<void()> f,int thr)
@@ -164,9 +459,63 @@ private:
             fiber = nullptr;
             cb = nullptr;
             thread = -1;
+            stack_class = Fiber::STACK_DEFAULT;
+            priority = Fiber::PRIORITY_NORMAL;
+            enqueue_ms = 0;
+            deadline_ms = 0;
+            enqueue_us = 0;
+            site = nullptr;
         }
     };
 
+    // 有截止时间的任务按截止时间排序, 截止时间相同的保持先后顺序
+    using DeadlineQueue = std::multimap<uint64_t, SchedulerTask>;
+
+    /**
+     * @brief 丢弃已过截止时间、还没开始执行的回调任务, 调用方持有m_mutex
+     * @details 协程任务不丢弃: 丢掉会让挂起的协程永远无法恢复, 它们照常按截止时间最先执行,
+     *          由hook的IO返回ETIMEDOUT尽快结束
+     */
+    void dropExpiredTasks(uint64_t now);
+
+    /**
+     * @brief 任务放入对应优先级的队列, 调用方持有m_mutex
+     */
+    void pushTask(SchedulerTask&& task);
+
+    /**
+     * @brief 按优先级、截止时间和老化规则取出一个本线程可以执行的任务, 调用方持有m_mutex
+     * @details 同一优先级内有截止时间的任务按截止时间先后(EDF)先于没有截止时间的任务
+     * @param[out] skipped 是否跳过了指定给其他线程的任务
+     * @return 是否取到任务
+     */
+    bool takeTask(int thread_id, SchedulerTask& task, bool& skipped);
+
+    /**
+     * @brief 创建一个工作线程, 调用方持有m_mutex
+     */
+    void spawnWorker();
+
+    /**
+     * @brief 弹性模式下当前空闲的工作线程尝试退出, 成功时已从工作线程列表中移除
+     */
+    bool tryRetire(int thread_id);
+
+    /**
+     * @brief 弹性线程池的扩缩容检查, 在后台线程中运行
+     */
+    void elasticLoop();
+
+    /**
+     * @brief 记录排队时间
+     */
+    void recordQueueWait(uint64_t wait_us);
+
+    /**
+     * @brief 记录一次扩缩容决策, 调用方持有m_mutex
+     */
+    void recordScale(size_t from, size_t to, const std::string& reason);
+
 private:
     // 协程调度器名称
     std::string m_name;
@@ -174,16 +523,57 @@ private:
     std::mutex m_mutex;
     // 线程池
     std::vector<std::shared_ptr<Thread>> m_threads;
-    // 任务队列
-    std::vector<SchedulerTask> m_tasks;
+    // 每个优先级一个任务队列, 从队头取任务, 用deque避免vector头部erase逐个搬移元素
+    std::deque<SchedulerTask> m_tasks[Fiber::PRIORITY_COUNT];
+    // 每个优先级中有截止时间的任务
+    DeadlineQueue m_deadlineTasks[Fiber::PRIORITY_COUNT];
+    // 过期丢弃的任务数
+    std::atomic<uint64_t> m_expiredTaskCount = {0};
+    // m_tasks中的任务数, 无锁读取
+    std::atomic<size_t> m_pendingTaskCount = {0};
+    // 各优先级的老化时间(毫秒), 0表示不老化
+    std::atomic<uint64_t> m_agingMs[Fiber::PRIORITY_COUNT] = {{0}, {100}, {500}};
+    // 上一个取出的任务是否因老化而被提前, 老化任务不连续选中
+    bool m_lastAged = false;
+    // 跨线程无锁投递队列, trySchedule写入
+    MpmcQueue<SchedulerTask> m_injectQueue;
     // 存储工作线程的线程id
     std::vector<int> m_threadIds;
     // 需要额外创建的线程数
     size_t m_threadCount = 0;
+    // 亲和性设置的CPU列表
+    std::vector<int> m_affinityCpus;
+    // 是否设置了亲和性
+    bool m_affinity = false;
+    // 是否每个工作线程只绑定一个核
+    bool m_cpuPerWorker = true;
+    // 与m_threadIds一一对应: 每个工作线程允许运行的CPU集合, 为空表示不绑定
+    std::vector<std::vector<int>> m_workerCpus;
+    // 与m_threadIds一一对应: 每个工作线程所在的NUMA节点, -1表示未知
+    std::vector<int> m_workerNodes;
     // 活跃线程数
     std::atomic<size_t> m_activeThreadCount = {0};
     // 空闲线程数
     std::atomic<size_t> m_idleThreadCount = {0};
+    // 弹性线程池
+    static const size_t MAX_SCALE_EVENTS = 64;
+    std::atomic<bool> m_elastic = {false};
+    ElasticPolicy m_elasticPolicy;
+    std::shared_ptr<Thread> m_elasticThread;
+    // 退出的工作线程, 等待join
+    std::vector<std::shared_ptr<Thread>> m_retiredThreads;
+    // 待退出的线程数, 空闲线程取走后退出
+    std::atomic<size_t> m_retireRequests = {0};
+    // 下一个工作线程的序号, 用于线程名和CPU分配
+    size_t m_nextWorker = 0;
+    std::atomic<uint64_t> m_scaleUps = {0};
+    std::atomic<uint64_t> m_scaleDowns = {0};
+    std::atomic<uint64_t> m_waitBuckets[WAIT_BUCKETS] = {};
+    // 上一次扩缩容检查以来的最大排队时间(微秒)
+    std::atomic<uint64_t> m_recentMaxWaitUs = {0};
+    std::deque<ScaleEvent> m_scaleEvents;
+    // 看门狗, setWatchdog时创建, 工作线程在执行下一个任务前发现并登记, 随调度器析构
+    std::atomic<Watchdog*> m_watchdog = {nullptr};
 
     // 主线程是否用工作线程
     bool m_useCaller;
@@ -191,6 +581,8 @@ private:
     std::shared_ptr<Fiber> m_schedulerFiber;
     // 如果是 -> 记录主线程的线程id
     int m_rootThread = -1;
+    // 是否已经start()
+    bool m_started = false;
     // 是否正在关闭
     bool m_stopping = false;
 };
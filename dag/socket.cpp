@@ -5,18 +5,150 @@
 #include "logger.h"
 #include "hook.h"
 #include <cerrno>
+#include <deque>
+#include <linux/errqueue.h>
+#include <mutex>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <ostream>
 #include <string>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <string.h>
 
 
 namespace dag {
 static dag::Logger::ptr g_logger = DAG_LOG_NAME("system");
 
+struct Socket::ZeroCopyCtx : public std::enable_shared_from_this<ZeroCopyCtx> {
+    /**
+     * @brief 一次还没有完成的零拷贝发送
+     */
+    struct Pending {
+        // 内核给这次发送的序号, 每次成功的MSG_ZEROCOPY发送加一
+        uint32_t id;
+        size_t bytes;
+        std::shared_ptr<void> pin;
+    };
+
+    /**
+     * @brief 读空错误队列, 按完成通知释放钉住的缓冲区
+     * @details 由IOManager的错误事件处理函数调用, 也在关闭socket前调用一次
+     */
+    void reap(int fd);
+
+    /**
+     * @brief 处理一个完成通知, 确认序号在[lo, hi]之间的发送
+     */
+    void complete(uint32_t lo, uint32_t hi, bool copied);
+
+    /**
+     * @brief socket关闭时还有发送没有完成, 接管fd延后关闭
+     * @details 关闭后就读不到完成通知, 内核仍在引用的内存会被释放改写, 所以先shutdown让对端收到已发出的数据和FIN,
+     *          fd和状态由自身持有, 等全部完成通知到达(或连接异常时内核丢弃发送队列)后再关闭fd、释放缓冲区
+     * @return 没有未完成的发送时返回false, 由调用方直接关闭fd
+     */
+    bool closeLater(int fd);
+
+    /**
+     * @brief 延后关闭时, 所有发送都已完成就关闭fd
+     */
+    void tryClose();
+
+    mutable std::mutex mutex;
+    bool enabled = false;
+    size_t threshold = DEFAULT_ZEROCOPY_THRESHOLD;
+    uint32_t next_id = 0;
+    std::deque<Pending> pending;
+    ZeroCopyStats stats;
+    // 延后关闭的fd, 关闭后为-1
+    int closing_fd = -1;
+    // 延后关闭期间持有自身, 关闭fd时释放
+    std::shared_ptr<ZeroCopyCtx> self;
+};
+
+void Socket::ZeroCopyCtx::reap(int fd) {
+    while(true) {
+        char control[128];
+        msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof(control);
+        // 不经过hook, 队列空时直接返回而不是挂起
+        if(recvmsg_f(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            break;
+        }
+        for(cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+            if(!(cmsg->cmsg_level == SOL_IP && cmsg->cmsg_type == IP_RECVERR)
+                    && !(cmsg->cmsg_level == SOL_IPV6 && cmsg->cmsg_type == IPV6_RECVERR)) {
+                continue;
+            }
+            sock_extended_err err;
+            memcpy(&err, CMSG_DATA(cmsg), sizeof(err));
+            if(err.ee_origin != SO_EE_ORIGIN_ZEROCOPY || err.ee_errno != 0) {
+                continue;
+            }
+            complete(err.ee_info, err.ee_data, err.ee_code & SO_EE_CODE_ZEROCOPY_COPIED);
+        }
+    }
+}
 
+void Socket::ZeroCopyCtx::complete(uint32_t lo, uint32_t hi, bool copied) {
+    // 先移出再释放, 缓冲区不在锁内析构
+    std::vector<Pending> done;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ++stats.notifications;
+        for(auto it = pending.begin(); it != pending.end();) {
+            // 无符号减法, 序号回绕时同样成立
+            if(it->id - lo <= hi - lo) {
+                (copied ? stats.deferred_copy_bytes : stats.zerocopy_bytes) += it->bytes;
+                stats.pending_bytes -= it->bytes;
+                --stats.pending_sends;
+                done.push_back(std::move(*it));
+                it = pending.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+}
+
+bool Socket::ZeroCopyCtx::closeLater(int fd) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(pending.empty()) {
+            return false;
+        }
+        #if DEBUG
+        DAG_LOG_DEBUG(g_logger) << "close zerocopy sock=" << fd << " pending_sends=" << pending.size()
+            << ", close after completions";
+        #endif
+        enabled = false;
+        closing_fd = fd;
+        self = shared_from_this();
+    }
+    // 唤醒阻塞在该socket上的收发, 已经进入发送队列的数据照常发出
+    ::shutdown(fd, SHUT_RDWR);
+    // 加锁前后到达的通知可能已经处理完了
+    tryClose();
+    return true;
+}
+
+void Socket::ZeroCopyCtx::tryClose() {
+    int fd = -1;
+    std::shared_ptr<ZeroCopyCtx> holder;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(closing_fd == -1 || !pending.empty()) {
+            return;
+        }
+        std::swap(fd, closing_fd);
+        holder.swap(self);
+    }
+    ::close(fd);
+}
 
 Socket::ptr Socket::CreateTCP(dag::Address::ptr address) {
     Socket::ptr sock(new Socket(address->getFamily(), TCP, 0));
@@ -41,6 +173,30 @@ Socket::ptr Socket::CreateUDPSocket(){
     return sock;
 }
 
+Socket::ptr Socket::CreateTCPSocket6() {
+    Socket::ptr sock(new Socket(Socket::IPv6, Socket::TCP, 0));
+    return sock;
+}
+
+Socket::ptr Socket::CreateUDPSocket6() {
+    Socket::ptr sock(new Socket(Socket::IPv6, Socket::UDP, 0));
+    sock->newSock();
+    sock->m_isConnected = true;
+    return sock;
+}
+
+Socket::ptr Socket::CreateUnixTCPSocket() {
+    Socket::ptr sock(new Socket(Socket::UNIX, Socket::TCP, 0));
+    return sock;
+}
+
+Socket::ptr Socket::CreateUnixUDPSocket() {
+    Socket::ptr sock(new Socket(Socket::UNIX, Socket::UDP, 0));
+    sock->newSock();
+    sock->m_isConnected = true;
+    return sock;
+}
+
 
 Socket::Socket(int family, int type, int protocol) 
     :m_sock(-1)
@@ -157,6 +313,23 @@ bool Socket::bind(const Address::ptr addr) {
         return false;
     }
 
+    // 进程退出后留下的socket文件会让bind失败; 连不上说明已经没有进程在监听, 可以删掉
+    UnixAddress::ptr uaddr = std::dynamic_pointer_cast<UnixAddress>(addr);
+    if(uaddr && !uaddr->isAbstract() && !uaddr->getPath().empty()) {
+        struct stat st;
+        if(lstat(uaddr->getPath().c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+            Socket probe(AF_UNIX, m_type, 0);
+            if(probe.connect(uaddr)) {
+                #if DEBUG
+                DAG_LOG_ERROR(g_logger) << "bind unix path " << uaddr->getPath() << " in use";
+                #endif
+                errno = EADDRINUSE;
+                return false;
+            }
+            unlink(uaddr->getPath().c_str());
+        }
+    }
+
     if(::bind(m_sock, addr->getAddr(), addr->getAddrLen())) {
         #if DEBUG
         DAG_LOG_ERROR(g_logger) << "bind erro errorno=" << errno
@@ -236,6 +409,14 @@ bool Socket::close() {
         return true;
     }
     m_isConnected = false;
+    if(m_zeroCopy) {
+        // 还有发送在等完成通知时, fd交给零拷贝状态延后关闭
+        m_zeroCopy->reap(m_sock);
+        if(m_sock != -1 && m_zeroCopy->closeLater(m_sock)) {
+            m_sock = -1;
+        }
+        m_zeroCopy.reset();
+    }
     if(m_sock != -1) {
         ::close(m_sock);
         m_sock = -1;
@@ -262,6 +443,108 @@ int Socket::send(const iovec* buffers, size_t length, int flags) {
     return -1;
 }
 
+bool Socket::setZeroCopy(bool on, size_t threshold) {
+    if(!on) {
+        if(m_zeroCopy) {
+            std::lock_guard<std::mutex> lock(m_zeroCopy->mutex);
+            m_zeroCopy->enabled = false;
+        }
+        return true;
+    }
+    if(!m_zeroCopy) {
+        IOManager* iom = IOManager::GetThis();
+        int val = 1;
+        if(!iom || !isValid() || !setOption(SOL_SOCKET, SO_ZEROCOPY, val)) {
+            return false;
+        }
+        std::shared_ptr<ZeroCopyCtx> ctx = std::make_shared<ZeroCopyCtx>();
+        std::weak_ptr<ZeroCopyCtx> weak_ctx(ctx);
+        int fd = m_sock;
+        if(iom->setErrorHandler(fd, [weak_ctx, fd]() {
+                    if(std::shared_ptr<ZeroCopyCtx> ctx = weak_ctx.lock()) {
+                        ctx->reap(fd);
+                        ctx->tryClose();
+                    }
+                })) {
+            return false;
+        }
+        m_zeroCopy = ctx;
+    }
+    std::lock_guard<std::mutex> lock(m_zeroCopy->mutex);
+    m_zeroCopy->enabled = true;
+    m_zeroCopy->threshold = threshold;
+    return true;
+}
+
+bool Socket::isZeroCopy() const {
+    if(!m_zeroCopy) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_zeroCopy->mutex);
+    return m_zeroCopy->enabled;
+}
+
+size_t Socket::getZeroCopyThreshold() const {
+    if(!m_zeroCopy) {
+        return DEFAULT_ZEROCOPY_THRESHOLD;
+    }
+    std::lock_guard<std::mutex> lock(m_zeroCopy->mutex);
+    return m_zeroCopy->threshold;
+}
+
+int Socket::sendZeroCopy(const iovec* buffers, size_t length, std::shared_ptr<void> pin, int flags) {
+    if(!isConnected()) {
+        return -1;
+    }
+    std::shared_ptr<ZeroCopyCtx> ctx = m_zeroCopy;
+    size_t total = 0;
+    for(size_t i = 0; i < length; ++i) {
+        total += buffers[i].iov_len;
+    }
+    bool zerocopy = false;
+    if(ctx) {
+        std::lock_guard<std::mutex> lock(ctx->mutex);
+        zerocopy = ctx->enabled && total >= ctx->threshold;
+    }
+
+    msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = (iovec*)buffers;
+    msg.msg_iovlen = length;
+    int rt = -1;
+    if(zerocopy) {
+        rt = ::sendmsg(m_sock, &msg, flags | MSG_ZEROCOPY);
+        if(rt > 0) {
+            std::lock_guard<std::mutex> lock(ctx->mutex);
+            ctx->pending.push_back({ctx->next_id++, (size_t)rt, std::move(pin)});
+            ++ctx->stats.pending_sends;
+            ctx->stats.pending_bytes += rt;
+            return rt;
+        }
+        // 未完成通知占满了socket的optmem, 这次退回拷贝
+        if(!(rt == -1 && errno == ENOBUFS)) {
+            return rt;
+        }
+        #if DEBUG
+        DAG_LOG_DEBUG(g_logger) << "sendmsg MSG_ZEROCOPY sock=" << m_sock << " ENOBUFS, fallback to copy";
+        #endif
+    }
+    rt = ::sendmsg(m_sock, &msg, flags);
+    if(rt > 0 && ctx) {
+        std::lock_guard<std::mutex> lock(ctx->mutex);
+        ctx->stats.copied_bytes += rt;
+    }
+    return rt;
+}
+
+Socket::ZeroCopyStats Socket::getZeroCopyStats() const {
+    if(!m_zeroCopy) {
+        return ZeroCopyStats();
+    }
+    std::lock_guard<std::mutex> lock(m_zeroCopy->mutex);
+    return m_zeroCopy->stats;
+}
+
 int Socket::sendTo(const void* buffer, size_t length, const Address::ptr to, int flags) {
     if(isConnected()) {
         return ::sendto(m_sock, buffer, length, flags, to->getAddr(), to->getAddrLen());
@@ -322,6 +605,53 @@ int Socket::recvFrom(iovec* buffer, size_t length, Address::ptr from, int flags)
     return -1;
 }
 
+int Socket::recvFromMany(mmsghdr* msgs, size_t count, int flags) {
+    if(isConnected()) {
+        return ::recvmmsg(m_sock, msgs, count, flags, nullptr);
+    }
+    return -1;
+}
+
+int Socket::sendToMany(mmsghdr* msgs, size_t count, int flags) {
+    if(!isConnected()) {
+        return -1;
+    }
+    size_t sent = 0;
+    while(sent < count) {
+        int rt = ::sendmmsg(m_sock, msgs + sent, count - sent, flags);
+        if(rt <= 0) {
+            #if DEBUG
+            DAG_LOG_DEBUG(g_logger) << "sendmmsg sock=" << m_sock << " sent=" << sent
+                << " errno=" << errno << " errstr=" << strerror(errno);
+            #endif
+            return sent ? (int)sent : -1;
+        }
+        sent += rt;
+    }
+    return sent;
+}
+
+bool Socket::setUdpSegment(uint16_t segment_size) {
+    int val = segment_size;
+    return setOption(SOL_UDP, UDP_SEGMENT, val);
+}
+
+bool Socket::setUdpGro(bool on) {
+    int val = on;
+    return setOption(SOL_UDP, UDP_GRO, val);
+}
+
+int Socket::GetUdpGroSegment(const msghdr& msg) {
+    for(cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR((msghdr*)&msg, cmsg)) {
+        if(cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO) {
+            int size = 0;
+            memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+            return size;
+        }
+    }
+    return 0;
+}
+
 Address::ptr Socket::getRemoteAddress() {
     if(m_remoteAddress) {
         return m_remoteAddress;
@@ -332,6 +662,12 @@ Address::ptr Socket::getRemoteAddress() {
         case AF_INET:
             result.reset(new IPv4Address());
             break;
+        case AF_INET6:
+            result.reset(new IPv6Address());
+            break;
+        case AF_UNIX:
+            result.reset(new UnixAddress());
+            break;
         default:
             result.reset(new UnknownAddress(m_family));
             break;
@@ -344,7 +680,10 @@ Address::ptr Socket::getRemoteAddress() {
         #endif
         return Address::ptr(new UnknownAddress(m_family));
     }
-    //doCodeing AF_UNIX
+    if(m_family == AF_UNIX) {
+        // Unix地址的长度不固定, 对端未绑定时只有sun_family
+        std::static_pointer_cast<UnixAddress>(result)->setAddrLen(addrlen);
+    }
     m_remoteAddress = result;
     return m_remoteAddress;
 }
@@ -359,6 +698,12 @@ Address::ptr Socket::getLocalAddress() {
         case AF_INET:
             result.reset(new IPv4Address());
             break;
+        case AF_INET6:
+            result.reset(new IPv6Address());
+            break;
+        case AF_UNIX:
+            result.reset(new UnixAddress());
+            break;
         default:
             result.reset(new UnknownAddress(m_family));
             break;
@@ -371,7 +716,9 @@ Address::ptr Socket::getLocalAddress() {
         #endif
         return Address::ptr(new UnknownAddress(m_family));
     }
-    //doCodeing AF_UNIX
+    if(m_family == AF_UNIX) {
+        std::static_pointer_cast<UnixAddress>(result)->setAddrLen(addrlen);
+    }
     m_localAddress = result;
     return m_localAddress;
 }
@@ -430,7 +777,7 @@ bool Socket::cancelAll(){
 void Socket::initSock() {
     int val = 1;
     setOption(SOL_SOCKET, SO_REUSEADDR, val);
-    if(m_type == SOCK_STREAM) {
+    if(m_type == SOCK_STREAM && m_family != AF_UNIX) {
         setOption(IPPROTO_TCP, TCP_NODELAY, val);
     }
 }
@@ -51,11 +51,35 @@ public:
     static Socket::ptr CreateTCPSocket();
 
     /**
-    * @brief 创建一个IPv4的TCP Socket
+    * @brief 创建一个IPv4的UDP Socket
     * @return Socket::ptr 成功返回Socket智能指针，失败返回nullptr
     */
     static Socket::ptr CreateUDPSocket();
 
+    /**
+    * @brief 创建一个IPv6的TCP Socket
+    * @return Socket::ptr 成功返回Socket智能指针，失败返回nullptr
+    */
+    static Socket::ptr CreateTCPSocket6();
+
+    /**
+    * @brief 创建一个IPv6的UDP Socket
+    * @return Socket::ptr 成功返回Socket智能指针，失败返回nullptr
+    */
+    static Socket::ptr CreateUDPSocket6();
+
+    /**
+    * @brief 创建一个Unix域的流式Socket
+    * @return Socket::ptr 成功返回Socket智能指针，失败返回nullptr
+    */
+    static Socket::ptr CreateUnixTCPSocket();
+
+    /**
+    * @brief 创建一个Unix域的数据报Socket
+    * @return Socket::ptr 成功返回Socket智能指针，失败返回nullptr
+    */
+    static Socket::ptr CreateUnixUDPSocket();
+
     /**
     * @brief Socket构造函数
     * @param[in] family 地址簇
@@ -150,6 +174,7 @@ public:
 
     /**
      * @brief 绑定地址
+     * @details Unix域文件路径已存在且没有进程在监听时, 先删除残留的socket文件再绑定
      * @param[in] addr 要绑定的本地地址
      * @return bool 是否成功
      */
@@ -196,6 +221,67 @@ public:
     int send(const iovec* buffers, size_t length, int flags = 0);
 
 
+    /// 默认的零拷贝阈值, 一次发送小于它时直接拷贝, 钉住页面和处理完成通知的开销比拷贝还大
+    static const size_t DEFAULT_ZEROCOPY_THRESHOLD = 10240;
+
+    /**
+     * @brief 零拷贝发送的统计
+     */
+    struct ZeroCopyStats {
+        // 以MSG_ZEROCOPY发出、内核确认没有拷贝的字节数
+        uint64_t zerocopy_bytes = 0;
+        // 以MSG_ZEROCOPY发出、但内核退回了拷贝的字节数(如回环、网卡不支持分散聚集)
+        uint64_t deferred_copy_bytes = 0;
+        // 小于阈值或通知缓冲不足时直接拷贝发送的字节数
+        uint64_t copied_bytes = 0;
+        // 收到的完成通知个数, 一个通知可以确认连续的多次发送
+        uint64_t notifications = 0;
+        // 还在等待完成通知的发送次数和字节数
+        uint64_t pending_sends = 0;
+        uint64_t pending_bytes = 0;
+    };
+
+    /**
+     * @brief 开启/关闭零拷贝发送 (SO_ZEROCOPY)
+     * @details 开启后sendZeroCopy对不小于threshold的发送带上MSG_ZEROCOPY, 内核直接引用用户内存而不拷贝;
+     *          完成通知经错误队列送达, 由当前IOManager的错误事件处理, 收到后才释放发送时钉住的缓冲区;
+     *          关闭后新的发送都拷贝, 已经发出的仍等完成通知;
+     *          close()时还有发送未完成则先shutdown, fd和钉住的缓冲区保留到完成通知全部到达后再释放,
+     *          因此对端一直不读时fd会一直占用, 需要及时释放的调用方可先等getZeroCopyStats().pending_sends为0
+     * @attention 需在IOManager的协程中调用; 同一socket不要在多个协程中并发sendZeroCopy
+     * @param[in] on 是否开启
+     * @param[in] threshold 零拷贝的最小发送字节数
+     * @return bool 内核或socket类型不支持时返回false
+     */
+    bool setZeroCopy(bool on, size_t threshold = DEFAULT_ZEROCOPY_THRESHOLD);
+
+    /**
+     * @brief 是否开启了零拷贝发送
+     */
+    bool isZeroCopy() const;
+
+    /**
+     * @brief 零拷贝的最小发送字节数
+     */
+    size_t getZeroCopyThreshold() const;
+
+    /**
+     * @brief 零拷贝发送多个数据块 (用于TCP/UDP)
+     * @details 没有开启零拷贝或总长度小于阈值时等同于send(buffers, length, flags);
+     *          否则以MSG_ZEROCOPY发送, 并持有pin直到内核的完成通知到达, 在此之前buffers指向的内存不能被释放或改写
+     * @param[in] buffers iovec结构体数组
+     * @param[in] length 数组长度
+     * @param[in] pin 保证buffers有效的句柄, 如ByteArray::pin()的返回值或持有数据的智能指针
+     * @param[in] flags 标志位 (默认为0)
+     * @return int >0 发送的字节数, =0 连接关闭, <0 出错
+     */
+    int sendZeroCopy(const iovec* buffers, size_t length, std::shared_ptr<void> pin, int flags = 0);
+
+    /**
+     * @brief 返回零拷贝发送的统计
+     */
+    ZeroCopyStats getZeroCopyStats() const;
+
     /**
      * @brief 发送数据到指定地址 (用于UDP)
      * @param[in] buffer 数据缓冲区
@@ -254,6 +340,54 @@ public:
      */
     int recvFrom(iovec* buffer, size_t length, Address::ptr from, int flags = 0);
 
+    /**
+     * @brief 批量接收数据报 (recvmmsg, 用于UDP)
+     * @details 没有数据时挂起协程直到可读或超时, 然后一次系统调用取走已到达的最多count个数据报;
+     *          每个msgs[i].msg_hdr要预先设置好缓冲区, 需要源地址时设置msg_name/msg_namelen,
+     *          开启GRO时还要提供UDP_GRO_CONTROL_LEN字节的msg_control; 返回后msgs[i].msg_len为数据报长度
+     * @param[in, out] msgs mmsghdr数组
+     * @param[in] count 数组长度
+     * @param[in] flags 标志位 (默认为0)
+     * @return int >0 接收的数据报个数, <0 出错
+     */
+    int recvFromMany(mmsghdr* msgs, size_t count, int flags = 0);
+
+    /**
+     * @brief 批量发送数据报 (sendmmsg, 用于UDP)
+     * @details 发送缓冲区满时挂起协程; 一次系统调用没有全部发出时继续发送剩下的, 直到全部发出或出错;
+     *          msg_name为空时发往connect的地址
+     * @param[in, out] msgs mmsghdr数组, 返回后msgs[i].msg_len为发出的字节数
+     * @param[in] count 数组长度
+     * @param[in] flags 标志位 (默认为0)
+     * @return int 发出的数据报个数, 一个也没有发出就出错时返回-1
+     */
+    int sendToMany(mmsghdr* msgs, size_t count, int flags = 0);
+
+    /**
+     * @brief 设置UDP GSO的分段大小 (UDP_SEGMENT)
+     * @details 设置后每次发送中超过segment_size的数据由内核(或网卡)切成多个segment_size大小的数据报,
+     *          一次系统调用、一次协议栈处理就能发出一批数据报; 0为关闭
+     * @return bool 内核不支持时返回false
+     */
+    bool setUdpSegment(uint16_t segment_size);
+
+    /**
+     * @brief 开启/关闭UDP GRO (UDP_GRO)
+     * @details 开启后内核可以把同一来源的连续数据报合并后一次交付, 控制消息中带有原来的分段大小,
+     *          用GetUdpGroSegment取出后按该大小切分
+     * @return bool 内核不支持时返回false
+     */
+    bool setUdpGro(bool on);
+
+    /**
+     * @brief 取出接收到的消息中的GRO分段大小
+     * @return int 分段大小, 0表示没有合并
+     */
+    static int GetUdpGroSegment(const msghdr& msg);
+
+    /// 接收GRO分段大小需要的msg_control长度
+    static constexpr size_t UDP_GRO_CONTROL_LEN = CMSG_SPACE(sizeof(int));
+
      /**
      * @brief 获取远端地址
      * @return Address::ptr 地址对象智能指针
@@ -366,10 +500,15 @@ private:
      * @return bool 是否初始化成功
      */
     bool init(int sock);
+
+    /**
+     * @brief 零拷贝发送的状态, 由socket和IOManager的错误事件处理函数共享
+     */
+    struct ZeroCopyCtx;
 protected:
     /// @brief 套接字句柄(文件描述符)
     int m_sock;
-    /// @brief 地址簇(AF_INET, AF_UNIX)
+    /// @brief 地址簇(AF_INET, AF_INET6, AF_UNIX)
     int m_family;
     /// @brief 套接字类型(SOCK_STREAM, SOCK_DGRAM)
     int m_type;
@@ -382,6 +521,8 @@ protected:
     Address::ptr m_localAddress;
     /// @brief 远端地址信息对象
     Address::ptr m_remoteAddress;
+    /// @brief 零拷贝发送的状态, 没有开启过时为空
+    std::shared_ptr<ZeroCopyCtx> m_zeroCopy;
 };
 
 std::ostream& operator<<(std::ostream& os, const Socket& sock);
@@ -0,0 +1,132 @@
+#include "stack_profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <cxxabi.h>
+#include <map>
+#include <mutex>
+#include <utility>
+#include <sstream>
+#include <stdlib.h>
+#include <string.h>
+
+namespace dag {
+
+static const uint8_t PAINT_BYTE = 0xDA;
+static const uint64_t PAINT_WORD = 0xDADADADADADADADAull;
+
+static std::atomic<bool> s_enabled{false};
+static std::mutex s_mutex;
+// 以type_info地址或调用点名称的地址为key, 同一类型在进程内只有一个type_info对象;
+// 同名的调用点在不同编译单元中地址可能不同, GetStats时按名字合并
+static std::map<std::pair<const std::type_info*, const char*>, StackProfiler::SiteStats> s_sites;
+
+static std::string Demangle(const std::type_info* type) {
+    if(!type) {
+        return "<unknown>";
+    }
+    int status = 0;
+    char* name = abi::__cxa_demangle(type->name(), nullptr, nullptr, &status);
+    std::string rt = (status == 0 && name) ? name : type->name();
+    free(name);
+    return rt;
+}
+
+void StackProfiler::SetEnabled(bool enabled) {
+    s_enabled = enabled;
+}
+
+bool StackProfiler::IsEnabled() {
+    return s_enabled.load(std::memory_order_relaxed);
+}
+
+void StackProfiler::Paint(void* stack, size_t size) {
+    memset(stack, PAINT_BYTE, size);
+}
+
+size_t StackProfiler::Measure(const void* stack, size_t size) {
+    const uint64_t* p = (const uint64_t*)stack;
+    size_t words = size / sizeof(uint64_t);
+    size_t i = 0;
+    while(i < words && p[i] == PAINT_WORD) {
+        ++i;
+    }
+    return size - i * sizeof(uint64_t);
+}
+
+size_t StackProfiler::BucketOf(size_t used) {
+    size_t bucket = 0;
+    size_t limit = 1024;
+    while(bucket < BUCKET_COUNT - 1 && used > limit) {
+        ++bucket;
+        limit <<= 1;
+    }
+    return bucket;
+}
+
+void StackProfiler::Record(const std::type_info* type, const char* site, size_t stack_size, size_t used) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    SiteStats& stats = s_sites[std::make_pair(site ? nullptr : type, site)];
+    ++stats.count;
+    stats.max_used = std::max(stats.max_used, used);
+    stats.total_used += used;
+    stats.stack_size = stack_size;
+    ++stats.buckets[BucketOf(used)];
+}
+
+std::vector<StackProfiler::SiteStats> StackProfiler::GetStats() {
+    std::map<std::string, SiteStats> merged;
+    {
+        std::lock_guard<std::mutex> lock(s_mutex);
+        for(auto& i : s_sites) {
+            std::string name = i.first.second ? i.first.second : Demangle(i.first.first);
+            SiteStats& stats = merged[name];
+            stats.site = name;
+            stats.count += i.second.count;
+            stats.max_used = std::max(stats.max_used, i.second.max_used);
+            stats.total_used += i.second.total_used;
+            stats.stack_size = i.second.stack_size;
+            for(size_t b = 0; b < BUCKET_COUNT; ++b) {
+                stats.buckets[b] += i.second.buckets[b];
+            }
+        }
+    }
+    std::vector<SiteStats> rt;
+    for(auto& i : merged) {
+        rt.push_back(i.second);
+    }
+    std::sort(rt.begin(), rt.end(), [](const SiteStats& a, const SiteStats& b) {
+        return a.max_used > b.max_used;
+    });
+    return rt;
+}
+
+std::string StackProfiler::Dump() {
+    std::stringstream ss;
+    for(auto& i : GetStats()) {
+        ss << i.site << "\n"
+           << "    count=" << i.count
+           << " max=" << i.max_used
+           << " avg=" << (i.count ? i.total_used / i.count : 0)
+           << " stack=" << i.stack_size
+           << " hist:";
+        for(size_t b = 0; b < BUCKET_COUNT; ++b) {
+            if(!i.buckets[b]) {
+                continue;
+            }
+            if(b == BUCKET_COUNT - 1) {
+                ss << " >" << (1 << (b - 1)) << "K=" << i.buckets[b];
+            } else {
+                ss << " <=" << (1 << b) << "K=" << i.buckets[b];
+            }
+        }
+        ss << "\n";
+    }
+    return ss.str();
+}
+
+void StackProfiler::Reset() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_sites.clear();
+}
+
+}
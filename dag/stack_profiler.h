@@ -0,0 +1,88 @@
+#ifndef __DAG_STACK_PROFILER_H__
+#define __DAG_STACK_PROFILER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+namespace dag {
+
+/**
+ * @brief 协程栈使用量统计
+ * @details 开启后新建或reset的协程会先用特征值填满整个栈, 协程入口函数返回时从栈底向上扫描,
+ *          第一个被改写的位置即为使用高水位; 按入口函数的类型(每个lambda表达式各不相同)
+ *          分调用点汇总成直方图, 据此为调度任务选择Fiber::StackClass;
+ *          std::bind绑定同一签名的不同函数时类型相同, 需要区分的用schedulerLock的site参数或Fiber::setSite命名调用点
+ * @attention 填充会触碰整个栈的所有页, 增加常驻内存和创建开销, 只用于剖析, 不要在生产环境常开
+ */
+class StackProfiler {
+public:
+    /// 直方图桶数: <=1KB, <=2KB, ..., <=1MB, >1MB
+    static const size_t BUCKET_COUNT = 12;
+
+    /**
+     * @brief 一个调用点的统计
+     */
+    struct SiteStats {
+        // 调用点, 指定的调用点名称或入口函数类型反解后的名字
+        std::string site;
+        // 结束的协程数
+        uint64_t count = 0;
+        // 最大使用量
+        size_t max_used = 0;
+        // 使用量之和, 用于计算平均值
+        uint64_t total_used = 0;
+        // 最近一次的栈大小
+        size_t stack_size = 0;
+        // buckets[i]: 使用量在(2^(i-1), 2^i] KB之间的协程数, 最后一个桶为大于1MB
+        uint64_t buckets[BUCKET_COUNT] = {0};
+    };
+
+    static void SetEnabled(bool enabled);
+
+    static bool IsEnabled();
+
+    /**
+     * @brief 用特征值填充栈
+     */
+    static void Paint(void* stack, size_t size);
+
+    /**
+     * @brief 测量已填充的栈的使用高水位(字节)
+     * @param[in] stack 栈的起始(低)地址, 栈从高地址向低地址增长
+     */
+    static size_t Measure(const void* stack, size_t size);
+
+    /**
+     * @brief 记录一次协程结束时的使用量
+     * @param[in] type 入口函数类型, 与site都为空时记为"<unknown>"
+     * @param[in] site 调用点名称, 不为空时代替type作为调用点
+     */
+    static void Record(const std::type_info* type, const char* site, size_t stack_size, size_t used);
+
+    /**
+     * @brief 各调用点的统计, 按最大使用量降序
+     */
+    static std::vector<SiteStats> GetStats();
+
+    /**
+     * @brief 文本格式的统计报告
+     */
+    static std::string Dump();
+
+    /**
+     * @brief 清空统计
+     */
+    static void Reset();
+
+    /**
+     * @brief 使用量对应的直方图桶
+     */
+    static size_t BucketOf(size_t used);
+};
+
+}
+
+#endif
@@ -0,0 +1,265 @@
+#include "buffered_stream.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+namespace dag {
+
+BufferedStream::BufferedStream(Stream::ptr stream, size_t read_buffer_size
+                               ,size_t write_buffer_size)
+    : m_stream(stream)
+    , m_readBuf(new ByteArray(read_buffer_size))
+    , m_writeBuf(new ByteArray(write_buffer_size))
+    , m_readBufferSize(read_buffer_size)
+    , m_writeBufferSize(write_buffer_size)
+{
+
+}
+
+BufferedStream::~BufferedStream() {
+    if(m_writeBuf->getSize()) {
+        flush();
+    }
+}
+
+int BufferedStream::fill() {
+    size_t pos = m_readBuf->getPosition();
+    if(pos == m_readBuf->getSize()) {
+        // 数据已全部消费 -> 复用第一个内存块
+        m_readBuf->clear();
+        pos = 0;
+    } else if(pos >= m_readBuf->getBaseSize()) {
+        // 前面的内存块已经消费完 -> 把剩余数据挪到头部，避免缓冲无限增长
+        std::string rest = m_readBuf->toString();
+        m_readBuf->clear();
+        m_readBuf->writeStringWithoutLength(rest);
+        pos = 0;
+    }
+
+    m_readBuf->setPosition(m_readBuf->getSize());
+    int rt = m_stream->read(m_readBuf, m_readBufferSize);
+    m_readBuf->setPosition(pos);
+    return rt;
+}
+
+void BufferedStream::consume(void* buffer, size_t len) {
+    m_readBuf->read(buffer, len);
+}
+
+int64_t BufferedStream::find(const std::string& delim, size_t offset) const {
+    size_t readable = m_readBuf->getReadSize();
+    size_t dlen = delim.size();
+    if(dlen == 0 || readable < dlen || offset >= readable) {
+        return -1;
+    }
+
+    std::vector<iovec> iovs;
+    m_readBuf->getReadBuffers(iovs, readable);
+
+    size_t base = 0;
+    for(auto& iov : iovs) {
+        const char* data = (const char*)iov.iov_base;
+        size_t len = iov.iov_len;
+        size_t start = offset > base ? offset - base : 0;
+
+        while(start < len) {
+            // glibc的memchr按字长/SIMD批量比较，比逐字节扫描快得多
+            const char* hit = (const char*)memchr(data + start, delim[0], len - start);
+            if(!hit) {
+                break;
+            }
+            size_t idx = hit - data;
+            size_t logical = base + idx;
+            if(logical + dlen > readable) {
+                return -1;
+            }
+            if(dlen == 1) {
+                return logical;
+            }
+            if(idx + dlen <= len) {
+                if(memcmp(hit, delim.c_str(), dlen) == 0) {
+                    return logical;
+                }
+            } else {
+                // 分隔符跨越了内存块边界
+                std::string tmp(dlen, '\0');
+                m_readBuf->read(&tmp[0], dlen, m_readBuf->getPosition() + logical);
+                if(tmp == delim) {
+                    return logical;
+                }
+            }
+            start = idx + 1;
+        }
+        base += len;
+    }
+    return -1;
+}
+
+int BufferedStream::read(void* buffer, size_t length) {
+    if(length == 0) {
+        return 0;
+    }
+    size_t buffered = m_readBuf->getReadSize();
+    if(buffered == 0) {
+        // 大块读取直接交给底层流，省去一次拷贝
+        if(length >= m_readBufferSize) {
+            return m_stream->read(buffer, length);
+        }
+        int rt = fill();
+        if(rt <= 0) {
+            return rt;
+        }
+        buffered = m_readBuf->getReadSize();
+    }
+    size_t n = std::min(length, buffered);
+    consume(buffer, n);
+    return n;
+}
+
+int BufferedStream::read(ByteArray::ptr ba, size_t length) {
+    if(length == 0) {
+        return 0;
+    }
+    size_t buffered = m_readBuf->getReadSize();
+    if(buffered == 0) {
+        if(length >= m_readBufferSize) {
+            return m_stream->read(ba, length);
+        }
+        int rt = fill();
+        if(rt <= 0) {
+            return rt;
+        }
+        buffered = m_readBuf->getReadSize();
+    }
+    size_t n = std::min(length, buffered);
+    std::vector<iovec> iovs;
+    m_readBuf->getReadBuffers(iovs, n);
+    for(auto& iov : iovs) {
+        ba->write(iov.iov_base, iov.iov_len);
+    }
+    m_readBuf->setPosition(m_readBuf->getPosition() + n);
+    return n;
+}
+
+int BufferedStream::peek(void* buffer, size_t length) {
+    while(m_readBuf->getReadSize() < length) {
+        int rt = fill();
+        if(rt <= 0) {
+            if(m_readBuf->getReadSize() == 0) {
+                return rt;
+            }
+            break;
+        }
+    }
+    size_t n = std::min(length, m_readBuf->getReadSize());
+    m_readBuf->read(buffer, n, m_readBuf->getPosition());
+    return n;
+}
+
+int BufferedStream::readUntil(std::string& out, const std::string& delim, size_t max_size) {
+    if(delim.empty()) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    size_t scanned = 0;
+    while(true) {
+        int64_t pos = find(delim, scanned);
+        if(pos >= 0) {
+            size_t n = pos + delim.size();
+            if(n > max_size) {
+                errno = EMSGSIZE;
+                return -1;
+            }
+            out.resize(n);
+            consume(&out[0], n);
+            return n;
+        }
+
+        size_t readable = m_readBuf->getReadSize();
+        if(readable >= max_size) {
+            errno = EMSGSIZE;
+            return -1;
+        }
+        // 已扫描过的部分不再重复扫描，但要留出分隔符跨越新旧数据的余量
+        scanned = readable >= delim.size() ? readable - delim.size() + 1 : 0;
+
+        int rt = fill();
+        if(rt <= 0) {
+            return rt;
+        }
+    }
+}
+
+int BufferedStream::readLine(std::string& line, size_t max_size) {
+    int rt = readUntil(line, "\n", max_size);
+    if(rt > 0) {
+        line.pop_back();
+        if(!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+    }
+    return rt;
+}
+
+int BufferedStream::write(const void* buffer, size_t length) {
+    if(length == 0) {
+        return 0;
+    }
+    // 写缓冲为空且数据足够大 -> 直接写出，不必先拷贝到缓冲
+    if(m_writeBuf->getSize() == 0 && length >= m_writeBufferSize) {
+        return m_stream->writeFixSize(buffer, length);
+    }
+    m_writeBuf->write(buffer, length);
+    if(m_writeBuf->getSize() >= m_writeBufferSize) {
+        int rt = flush();
+        if(rt <= 0) {
+            return rt;
+        }
+    }
+    return length;
+}
+
+int BufferedStream::write(ByteArray::ptr ba, size_t length) {
+    length = std::min(length, ba->getReadSize());
+    if(length == 0) {
+        return 0;
+    }
+    // 同上, 写缓冲为空且数据足够大时直接写出
+    if(m_writeBuf->getSize() == 0 && length >= m_writeBufferSize) {
+        return m_stream->writeFixSize(ba, length);
+    }
+    std::vector<iovec> iovs;
+    ba->getReadBuffers(iovs, length);
+    for(auto& iov : iovs) {
+        m_writeBuf->write(iov.iov_base, iov.iov_len);
+    }
+    ba->setPosition(ba->getPosition() + length);
+    if(m_writeBuf->getSize() >= m_writeBufferSize) {
+        int rt = flush();
+        if(rt <= 0) {
+            return rt;
+        }
+    }
+    return length;
+}
+
+int BufferedStream::flush() {
+    size_t size = m_writeBuf->getSize();
+    if(size == 0) {
+        return 0;
+    }
+    // 缓冲中的所有内存块通过一次聚集写发出
+    m_writeBuf->setPosition(0);
+    int rt = m_stream->writeFixSize(m_writeBuf, size);
+    m_writeBuf->clear();
+    return rt;
+}
+
+void BufferedStream::close() {
+    flush();
+    m_stream->close();
+}
+
+}
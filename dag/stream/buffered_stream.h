@@ -0,0 +1,151 @@
+#ifndef __DAG_BUFFERED_STREAM_H__
+#define __DAG_BUFFERED_STREAM_H__
+
+#include <string>
+#include "stream.h"
+#include "bytearray.h"
+
+namespace dag {
+
+/**
+ * @brief 带缓冲的流装饰器
+ * @details 在任意Stream之上增加读缓冲和写缓冲:
+ *          读方向一次尽量多地从底层读取数据，提供peek/readLine/readUntil，
+ *          避免解析文本协议时每个字节一次recv;
+ *          写方向把小块写入合并到写缓冲中，flush时通过一次聚集写(writev/sendmsg)发出
+ */
+class BufferedStream : public Stream {
+public:
+    using ptr = std::shared_ptr<BufferedStream>;
+
+    /**
+     * @brief 构造函数
+     * @param[in] stream 被装饰的底层流
+     * @param[in] read_buffer_size 每次从底层读取的最大字节数
+     * @param[in] write_buffer_size 写缓冲的上限，超过后自动flush; 为0时不缓冲, 写入直接交给底层流
+     */
+    BufferedStream(Stream::ptr stream, size_t read_buffer_size = 4096
+                   ,size_t write_buffer_size = 4096);
+
+    /**
+     * @brief 析构函数，会尝试flush未发送的数据
+     */
+    ~BufferedStream();
+
+    /**
+     * @brief 读取数据，优先从读缓冲中取
+     * @return
+     *      @retval >0 返回实际读取到的数据长度
+     *      @retval =0 底层流被关闭
+     *      @retval <0 底层流错误
+     */
+    virtual int read(void* buffer, size_t length) override;
+
+    /**
+     * @brief 读取数据到ByteArray，优先从读缓冲中取
+     */
+    virtual int read(ByteArray::ptr ba, size_t length) override;
+
+    /**
+     * @brief 写入数据到写缓冲，缓冲满后自动flush
+     * @return 成功返回length, 失败返回flush的错误值
+     */
+    virtual int write(const void* buffer, size_t length) override;
+
+    /**
+     * @brief 将ba中从当前位置开始的length字节写入写缓冲
+     */
+    virtual int write(ByteArray::ptr ba, size_t length) override;
+
+    /**
+     * @brief flush后关闭底层流
+     */
+    virtual void close() override;
+
+    /**
+     * @brief 查看数据但不消费
+     * @details 读缓冲不足length时会从底层流补充，直到凑够length或遇到EOF/错误
+     * @return 拷贝到buffer中的字节数, 没有任何数据时返回底层流的返回值(0或<0)
+     */
+    int peek(void* buffer, size_t length);
+
+    /**
+     * @brief 读取直到遇到分隔符delim(包含delim)
+     * @param[out] out 读取到的数据,包含分隔符
+     * @param[in] delim 分隔符, 不能为空
+     * @param[in] max_size 最多读取的字节数, 超过仍未找到分隔符则失败
+     * @return
+     *      @retval >0 out的长度
+     *      @retval =0 在找到分隔符前底层流被关闭
+     *      @retval <0 底层流错误, 或超过max_size(errno=EMSGSIZE)
+     */
+    int readUntil(std::string& out, const std::string& delim, size_t max_size = 64 * 1024);
+
+    /**
+     * @brief 读取一行, 去掉结尾的"\n"或"\r\n"
+     * @return 同readUntil, 返回值为包含行尾的原始长度
+     */
+    int readLine(std::string& line, size_t max_size = 64 * 1024);
+
+    /**
+     * @brief 将写缓冲中的数据一次性写入底层流
+     * @return >=0 写出的字节数, <0 出错
+     */
+    int flush();
+
+    /**
+     * @brief 返回读缓冲中还未消费的字节数
+     */
+    size_t getReadBufferedSize() const { return m_readBuf->getReadSize();}
+
+    /**
+     * @brief 返回写缓冲中还未flush的字节数
+     */
+    size_t getWriteBufferedSize() const { return m_writeBuf->getSize();}
+
+    /**
+     * @brief 返回被装饰的底层流
+     */
+    Stream::ptr getStream() const { return m_stream;}
+
+protected:
+    /**
+     * @brief 从底层流读取一次数据追加到读缓冲末尾
+     * @details 读位置之前已消费的内存块会被回收, 读位置不变
+     * @return 底层流read的返回值
+     */
+    int fill();
+
+    /**
+     * @brief 返回读缓冲, 派生类可以直接在上面解析协议, 通过移动读位置消费数据
+     */
+    const ByteArray::ptr& getReadBuffer() const { return m_readBuf;}
+
+private:
+    /**
+     * @brief 在读缓冲中从offset开始查找delim
+     * @return 找到返回delim起始的偏移(相对读位置), 否则返回-1
+     */
+    int64_t find(const std::string& delim, size_t offset) const;
+
+    /**
+     * @brief 消费读缓冲中的len字节到buffer中
+     */
+    void consume(void* buffer, size_t len);
+
+private:
+    /// 底层流
+    Stream::ptr m_stream;
+    /// 读缓冲，position为读位置，size为已缓冲数据的末尾
+    ByteArray::ptr m_readBuf;
+    /// 写缓冲
+    ByteArray::ptr m_writeBuf;
+    /// 每次从底层读取的字节数
+    size_t m_readBufferSize;
+    /// 写缓冲上限
+    size_t m_writeBufferSize;
+};
+
+}
+
+#endif
@@ -53,8 +53,15 @@ int SocketStream::write(ByteArray::ptr ba, size_t length) {
         return -1;
     }
     std::vector<iovec> iovs;
-    ba->getReadBuffers(iovs, length);
-    int rt = m_socket->send(&iovs[0], iovs.size());
+    uint64_t size = ba->getReadBuffers(iovs, length);
+    int rt = 0;
+    if(m_socket->isZeroCopy()) {
+        // 钉住内存块, 调用方在完成通知到达前clear()或释放ba都是安全的; 小于阈值时直接拷贝, 不用钉住
+        std::shared_ptr<void> pin = size >= m_socket->getZeroCopyThreshold() ? ba->pin() : nullptr;
+        rt = m_socket->sendZeroCopy(&iovs[0], iovs.size(), pin);
+    } else {
+        rt = m_socket->send(&iovs[0], iovs.size());
+    }
     if(rt > 0) {
         ba->setPosition(ba->getPosition() + rt);
     }
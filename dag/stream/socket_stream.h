@@ -49,6 +49,8 @@ public:
 
     /**
      * @brief 写入数据
+     * @details socket开启了零拷贝(Socket::setZeroCopy)且length不小于阈值时以MSG_ZEROCOPY发送,
+     *          并钉住ba的内存块直到内核确认发送完成
      * @param[in] ba 待发送数据的ByteArray
      * @param[in] length 待发送数据的内存长度
      * @return
@@ -0,0 +1,309 @@
+#include "socket_stream_pool.h"
+#include "hook.h"
+#include "logger.h"
+#include "utils/util.h"
+#include <algorithm>
+#include <errno.h>
+
+namespace dag {
+
+static dag::Logger::ptr g_logger = DAG_LOG_NAME("system");
+
+SocketStreamPool::SocketStreamPool(dag::IOManager* iom
+                                   ,size_t max_active
+                                   ,size_t min_idle
+                                   ,size_t max_idle
+                                   ,uint64_t idle_timeout_ms
+                                   ,uint64_t check_interval_ms
+                                   ,uint64_t connect_timeout_ms)
+    :m_iom(iom)
+    ,m_maxActive(max_active)
+    ,m_minIdle(min_idle)
+    ,m_maxIdle(max_idle)
+    ,m_idleTimeout(idle_timeout_ms)
+    ,m_checkInterval(check_interval_ms)
+    ,m_connectTimeout(connect_timeout_ms) {
+}
+
+SocketStreamPool::~SocketStreamPool() {
+    for(auto& i : m_buckets) {
+        for(auto& c : i.second.idle) {
+            c.sock->close();
+        }
+    }
+}
+
+void SocketStreamPool::start() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(m_timer) {
+        return;
+    }
+    m_stop = false;
+    std::weak_ptr<SocketStreamPool> weak_self(shared_from_this());
+    m_timer = m_iom->addTimer(m_checkInterval, [weak_self]() {
+        auto self = weak_self.lock();
+        if(self) {
+            self->check();
+        }
+    }, true);
+}
+
+void SocketStreamPool::stop() {
+    std::vector<Socket::ptr> socks;
+    std::vector<Waiter::ptr> waiters;
+    std::shared_ptr<Timer> timer;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+        timer.swap(m_timer);
+        for(auto& i : m_buckets) {
+            for(auto& c : i.second.idle) {
+                socks.push_back(c.sock);
+            }
+            i.second.idle.clear();
+            waiters.insert(waiters.end(), i.second.waiters.begin(), i.second.waiters.end());
+            i.second.waiters.clear();
+        }
+    }
+    if(timer) {
+        timer->cancel();
+    }
+    for(auto& s : socks) {
+        s->close();
+    }
+    for(auto& w : waiters) {
+        Wakeup(w);
+    }
+}
+
+SocketStream::ptr SocketStreamPool::get(Address::ptr addr, uint64_t timeout_ms) {
+    std::string key = addr->toString();
+    std::vector<Socket::ptr> dead;
+    Socket::ptr sock;
+    Waiter::ptr waiter;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_stop) {
+            return nullptr;
+        }
+        Bucket& b = m_buckets[key];
+        if(!b.addr) {
+            b.addr = addr;
+        }
+        // LIFO: 优先取最近归还的连接
+        while(!b.idle.empty()) {
+            Socket::ptr s = b.idle.back().sock;
+            b.idle.pop_back();
+            if(IsAlive(s)) {
+                sock = s;
+                break;
+            }
+            dead.push_back(s);
+        }
+        if(sock || b.active < m_maxActive) {
+            ++b.active;
+        } else {
+            waiter.reset(new Waiter);
+            waiter->fiber = Fiber::GetThis();
+            waiter->scheduler = Scheduler::GetThis();
+            b.waiters.push_back(waiter);
+            if(timeout_ms != (uint64_t)-1) {
+                std::weak_ptr<SocketStreamPool> weak_self(shared_from_this());
+                waiter->timer = m_iom->addConditionTimer(timeout_ms, [weak_self, key, waiter]() {
+                    auto self = weak_self.lock();
+                    if(self) {
+                        self->onWaitTimeout(key, waiter);
+                    }
+                }, waiter);
+            }
+        }
+    }
+    for(auto& s : dead) {
+        s->close();
+    }
+    m_evicted += dead.size();
+
+    if(waiter) {
+        Fiber::GetThis()->yield();
+        if(!waiter->granted) {
+            return nullptr;
+        }
+        sock = waiter->sock;
+    }
+    if(sock) {
+        ++m_reused;
+        return wrap(key, sock);
+    }
+
+    sock = connect(addr);
+    if(!sock) {
+        release(key, nullptr, false);
+        return nullptr;
+    }
+    return wrap(key, sock);
+}
+
+Socket::ptr SocketStreamPool::connect(Address::ptr addr) {
+    Socket::ptr sock = Socket::CreateTCP(addr);
+    if(!sock->connect(addr, m_connectTimeout)) {
+        DAG_LOG_ERROR(g_logger) << "pool connect " << *addr << " fail";
+        return nullptr;
+    }
+    ++m_created;
+    return sock;
+}
+
+SocketStream::ptr SocketStreamPool::wrap(const std::string& key, Socket::ptr sock) {
+    std::weak_ptr<SocketStreamPool> weak_self(shared_from_this());
+    return SocketStream::ptr(new SocketStream(sock, false), [weak_self, key, sock](SocketStream* ss) {
+        auto self = weak_self.lock();
+        if(self) {
+            self->release(key, sock, sock->isConnected());
+        } else {
+            sock->close();
+        }
+        delete ss;
+    });
+}
+
+void SocketStreamPool::release(const std::string& key, Socket::ptr sock, bool ok) {
+    Waiter::ptr waiter;
+    bool close_sock = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Bucket& b = m_buckets[key];
+        close_sock = sock && (!ok || m_stop);
+        if(!b.waiters.empty()) {
+            // 直接转交给等待者, 连接名额不变; 连接不可用时等待者自己新建
+            waiter = b.waiters.front();
+            b.waiters.pop_front();
+            waiter->granted = true;
+            if(sock && !close_sock) {
+                waiter->sock = sock;
+            }
+        } else {
+            --b.active;
+            if(sock && !close_sock) {
+                if(b.idle.size() < m_maxIdle) {
+                    b.idle.push_back({sock, getElapseMs()});
+                } else {
+                    close_sock = true;
+                    ++m_evicted;
+                }
+            }
+        }
+    }
+    if(close_sock) {
+        sock->close();
+    }
+    if(waiter) {
+        Wakeup(waiter);
+    }
+}
+
+void SocketStreamPool::onWaitTimeout(const std::string& key, Waiter::ptr waiter) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_buckets.find(key);
+        if(it == m_buckets.end()) {
+            return;
+        }
+        auto& waiters = it->second.waiters;
+        auto wit = std::find(waiters.begin(), waiters.end(), waiter);
+        if(wit == waiters.end()) {
+            // 已经拿到连接
+            return;
+        }
+        waiters.erase(wit);
+    }
+    ++m_waitTimeouts;
+    Wakeup(waiter);
+}
+
+void SocketStreamPool::Wakeup(Waiter::ptr waiter) {
+    if(waiter->timer) {
+        waiter->timer->cancel();
+    }
+    Fiber::ptr fiber;
+    fiber.swap(waiter->fiber);
+    waiter->scheduler->schedulerLock(fiber);
+}
+
+void SocketStreamPool::check() {
+    uint64_t now = getElapseMs();
+    std::vector<Socket::ptr> evict;
+    std::vector<std::pair<std::string, Address::ptr> > refills;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if(m_stop) {
+            return;
+        }
+        for(auto& i : m_buckets) {
+            Bucket& b = i.second;
+            // 剔除已经失效的连接
+            std::vector<IdleConn> alive;
+            alive.reserve(b.idle.size());
+            for(auto& c : b.idle) {
+                if(IsAlive(c.sock)) {
+                    alive.push_back(c);
+                } else {
+                    evict.push_back(c.sock);
+                }
+            }
+            // 从最久未用的一端回收空闲过久的连接, 保留min_idle条
+            size_t n = 0;
+            while(alive.size() - n > m_minIdle
+                    && now - alive[n].lastUsed >= m_idleTimeout) {
+                evict.push_back(alive[n].sock);
+                ++n;
+            }
+            b.idle.assign(alive.begin() + n, alive.end());
+
+            // 补足min_idle, 正在建立的连接计入active
+            size_t total = b.idle.size() + b.active;
+            size_t need = m_minIdle > b.idle.size() ? m_minIdle - b.idle.size() : 0;
+            need = std::min(need, m_maxActive > total ? m_maxActive - total : 0);
+            for(size_t k = 0; k < need; ++k) {
+                ++b.active;
+                refills.push_back(std::make_pair(i.first, b.addr));
+            }
+        }
+    }
+    for(auto& s : evict) {
+        s->close();
+    }
+    m_evicted += evict.size();
+    for(auto& r : refills) {
+        m_iom->schedulerLock(std::bind(&SocketStreamPool::refill, shared_from_this()
+                                       ,r.first, r.second));
+    }
+}
+
+void SocketStreamPool::refill(const std::string& key, Address::ptr addr) {
+    Socket::ptr sock = connect(addr);
+    release(key, sock, sock != nullptr);
+}
+
+bool SocketStreamPool::IsAlive(Socket::ptr sock) {
+    if(!sock->isConnected()) {
+        return false;
+    }
+    // 绕过hook直接做非阻塞探测: EAGAIN表示连接正常且没有多余数据
+    char c;
+    int rt = recv_f(sock->getSocket(), &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    return rt < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+}
+
+size_t SocketStreamPool::getIdleCount(Address::ptr addr) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_buckets.find(addr->toString());
+    return it == m_buckets.end() ? 0 : it->second.idle.size();
+}
+
+size_t SocketStreamPool::getActiveCount(Address::ptr addr) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_buckets.find(addr->toString());
+    return it == m_buckets.end() ? 0 : it->second.active;
+}
+
+}
@@ -0,0 +1,187 @@
+#ifndef __DAG_SOCKET_STREAM_POOL_H__
+#define __DAG_SOCKET_STREAM_POOL_H__
+
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+#include "ioscheduler.h"
+#include "socket_stream.h"
+
+namespace dag {
+
+/**
+ * @brief 客户端SocketStream连接池(按目标地址分组)
+ * @details get()优先复用最近归还的空闲连接(LIFO, 刚用过的连接缓存更热、也最不可能被对端超时关闭),
+ *          没有空闲连接且未达到上限时新建连接, 达到上限时挂起当前协程等待其他连接归还;
+ *          返回的SocketStream析构时自动归还, 使用中出错的连接应先close()再释放, 池会直接丢弃它;
+ *          start()后在IOManager上注册周期定时器: 检查空闲连接是否存活、回收空闲过久的连接、补足min_idle
+ * @attention get()必须在IOManager的协程中调用
+ */
+class SocketStreamPool : public std::enable_shared_from_this<SocketStreamPool> {
+public:
+    using ptr = std::shared_ptr<SocketStreamPool>;
+
+    /**
+     * @brief 构造函数
+     * @param[in] iom 运行定时器和补充连接的调度器
+     * @param[in] max_active 每个地址的最大连接数(使用中+空闲)
+     * @param[in] min_idle 每个地址至少保持的空闲连接数
+     * @param[in] max_idle 每个地址最多保持的空闲连接数
+     * @param[in] idle_timeout_ms 空闲超过该时间的连接会被回收(min_idle以内的除外)
+     * @param[in] check_interval_ms 后台检查周期
+     * @param[in] connect_timeout_ms 建立连接的超时时间
+     */
+    SocketStreamPool(dag::IOManager* iom = dag::IOManager::GetThis()
+                     ,size_t max_active = 64
+                     ,size_t min_idle = 0
+                     ,size_t max_idle = 16
+                     ,uint64_t idle_timeout_ms = 60 * 1000
+                     ,uint64_t check_interval_ms = 5 * 1000
+                     ,uint64_t connect_timeout_ms = 3 * 1000);
+
+    ~SocketStreamPool();
+
+    /**
+     * @brief 启动后台检查定时器
+     */
+    void start();
+
+    /**
+     * @brief 停止后台检查并关闭所有空闲连接, 等待中的get()返回nullptr
+     */
+    void stop();
+
+    /**
+     * @brief 获取一条到addr的连接
+     * @param[in] addr 目标地址
+     * @param[in] timeout_ms 连接数达到上限时最多等待的时间(毫秒)
+     * @return 成功返回连接, 析构时自动归还; 连接失败/等待超时/已停止返回nullptr
+     */
+    SocketStream::ptr get(Address::ptr addr, uint64_t timeout_ms = -1);
+
+    /**
+     * @brief 立刻执行一次后台检查
+     */
+    void check();
+
+    /// 空闲连接数
+    size_t getIdleCount(Address::ptr addr);
+    /// 使用中(含正在建立)的连接数
+    size_t getActiveCount(Address::ptr addr);
+    /// 新建的连接数
+    uint64_t getCreatedCount() const { return m_created;}
+    /// 复用的连接数
+    uint64_t getReusedCount() const { return m_reused;}
+    /// 因为失效/空闲过久/超出max_idle被关闭的连接数
+    uint64_t getEvictedCount() const { return m_evicted;}
+    /// 等待超时的get()次数
+    uint64_t getWaitTimeoutCount() const { return m_waitTimeouts;}
+
+private:
+    /**
+     * @brief 空闲连接
+     */
+    struct IdleConn {
+        Socket::ptr sock;
+        /// 归还时间
+        uint64_t lastUsed;
+    };
+
+    /**
+     * @brief 等待连接的协程
+     */
+    struct Waiter {
+        using ptr = std::shared_ptr<Waiter>;
+        Fiber::ptr fiber;
+        Scheduler* scheduler = nullptr;
+        std::shared_ptr<Timer> timer;
+        /// 转交过来的连接
+        Socket::ptr sock;
+        /// 是否获得了一个连接名额(sock为空时需要自己新建连接)
+        bool granted = false;
+    };
+
+    /**
+     * @brief 同一个地址的连接
+     */
+    struct Bucket {
+        Address::ptr addr;
+        /// 空闲连接, 末尾是最近归还的
+        std::vector<IdleConn> idle;
+        /// 使用中(含正在建立)的连接数
+        size_t active = 0;
+        /// 等待队列
+        std::list<Waiter::ptr> waiters;
+    };
+
+    /**
+     * @brief 新建连接
+     */
+    Socket::ptr connect(Address::ptr addr);
+
+    /**
+     * @brief 包装成SocketStream, 析构时归还给连接池
+     */
+    SocketStream::ptr wrap(const std::string& key, Socket::ptr sock);
+
+    /**
+     * @brief 归还连接
+     * @param[in] ok 连接是否还能复用
+     */
+    void release(const std::string& key, Socket::ptr sock, bool ok);
+
+    /**
+     * @brief 等待超时
+     */
+    void onWaitTimeout(const std::string& key, Waiter::ptr waiter);
+
+    /**
+     * @brief 把结果交给等待者并唤醒它
+     */
+    static void Wakeup(Waiter::ptr waiter);
+
+    /**
+     * @brief 后台补充一条空闲连接
+     */
+    void refill(const std::string& key, Address::ptr addr);
+
+    /**
+     * @brief 不阻塞地检查空闲连接是否存活(对端关闭或收到了多余数据都视为失效)
+     */
+    static bool IsAlive(Socket::ptr sock);
+
+private:
+    /// 调度器
+    dag::IOManager* m_iom;
+    /// 每个地址的最大连接数
+    size_t m_maxActive;
+    /// 每个地址的最小空闲连接数
+    size_t m_minIdle;
+    /// 每个地址的最大空闲连接数
+    size_t m_maxIdle;
+    /// 空闲回收时间
+    uint64_t m_idleTimeout;
+    /// 检查周期
+    uint64_t m_checkInterval;
+    /// 连接超时时间
+    uint64_t m_connectTimeout;
+    /// 保护m_buckets
+    std::mutex m_mutex;
+    /// 地址 -> 连接
+    std::unordered_map<std::string, Bucket> m_buckets;
+    /// 后台检查定时器
+    std::shared_ptr<Timer> m_timer;
+    /// 是否已经停止
+    bool m_stop = false;
+
+    std::atomic<uint64_t> m_created{0};
+    std::atomic<uint64_t> m_reused{0};
+    std::atomic<uint64_t> m_evicted{0};
+    std::atomic<uint64_t> m_waitTimeouts{0};
+};
+
+}
+
+#endif
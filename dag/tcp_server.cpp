@@ -43,7 +43,7 @@ bool TcpServer::bind(const std::vector<Address::ptr>& addrs
     // 遍历每一个地址并尝试绑定监听
     for(auto& addr : addrs) {
         // 创建一个socket套接字
-        Socket::ptr sock = Socket::CreateTCPSocket();
+        Socket::ptr sock = Socket::CreateTCP(addr);
         // 尝试绑定地址
         if(!sock->bind(addr)) {
             #if DEBUG
@@ -82,13 +82,41 @@ bool TcpServer::bind(const std::vector<Address::ptr>& addrs
     return true;
 }
 
+void TcpServer::setNumaNode(int node) {
+    std::lock_guard<std::mutex> lock(m_nodeMutex);
+    m_numaNode = node;
+    m_nodeThreads.clear();
+    if(node >= 0) {
+        m_nodeScaleCount = m_ioWorker->getScaleCount();
+        m_nodeThreads = m_ioWorker->getWorkerThreadIdsOnNode(node);
+    }
+}
+
+int TcpServer::nextNodeThread() {
+    if(m_numaNode < 0) {
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(m_nodeMutex);
+    // 弹性模式下线程id随扩缩容变化, 重新查询; 退出线程的id即使用到也会被调度器按-1处理
+    uint64_t scale_count = m_ioWorker->getScaleCount();
+    if(scale_count != m_nodeScaleCount) {
+        m_nodeScaleCount = scale_count;
+        m_nodeThreads = m_ioWorker->getWorkerThreadIdsOnNode(m_numaNode);
+    }
+    if(m_nodeThreads.empty()) {
+        return -1;
+    }
+    return m_nodeThreads[m_nextThread++ % m_nodeThreads.size()];
+}
+
 void TcpServer::startAccept(Socket::ptr sock) {
     while(!m_isStop) {
         Socket::ptr client = sock->accept();
         if(client) {
             client->setRecvTimeout(m_recvTimeout);
             m_ioWorker->schedulerLock(std::bind(&TcpServer::handleClient,
-                        shared_from_this(),client));
+                        shared_from_this(),client), nextNodeThread(), m_stackClass
+                        , Fiber::PRIORITY_NORMAL, 0, "TcpServer::handleClient");
         } else {
             #if DEBUG
             DAG_LOG_ERROR(g_logger) << "accept errno=" << errno
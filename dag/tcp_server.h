@@ -5,7 +5,9 @@
 #include "utils/noncopyable.h"
 #include "address.h"
 #include "socket.h"
+#include <atomic>
 #include <memory>
+#include <mutex>
 
 
 namespace  dag {
@@ -80,6 +82,30 @@ public:
     */
     bool isStop() const { return m_isStop;};
 
+    /**
+    * @brief 把新连接只分派给io_worker中位于node节点上的工作线程(轮询)
+    * @details 通常传getNicNumaNode(网卡名), 让处理连接的线程与网卡在同一节点;
+    *          只决定连接处理协程首次运行的线程, 协程在IO等待后被唤醒时仍可能换到其他线程;
+    *          io_worker在该节点上没有绑核的工作线程时不做限制; 需在start()之前调用;
+    *          io_worker扩缩容后重新查询该节点上的工作线程
+    * @param[in] node NUMA节点, -1表示不限制
+    */
+    void setNumaNode(int node);
+
+    /**
+    * @brief 返回连接分派的NUMA节点, -1表示不限制
+    */
+    int getNumaNode() const { return m_numaNode;}
+
+    /**
+    * @brief 设置连接处理协程的栈大小档位
+    * @details 大量空闲长连接时可选较小的档位节省内存, 档位可先用StackProfiler统计handleClient(调用点TcpServer::handleClient)的栈使用量来确定;
+    *          STACK_SHARED让连接协程运行在共享栈上, 空闲连接只占实际用到的栈, 每次切换多一次栈拷贝
+    */
+    void setStackClass(Fiber::StackClass stack_class) { m_stackClass = stack_class;}
+
+    Fiber::StackClass getStackClass() const { return m_stackClass;}
+
     virtual std::string toString(const std::string& prefix = "");
 
     std::vector<Socket::ptr> getSocks() const { return m_socks;}
@@ -95,6 +121,11 @@ protected:
     */
     virtual void startAccept(Socket::ptr sock);
 
+    /**
+    * @brief 新连接分派到的工作线程, 未设置NUMA节点或节点上没有工作线程时返回-1
+    */
+    int nextNodeThread();
+
 protected:
     // 监听Socket数组
     std::vector<Socket::ptr> m_socks;
@@ -111,6 +142,17 @@ protected:
     std::string m_type = "tcp";
     // 服务是否停止
     bool m_isStop;
+    // 连接分派的NUMA节点
+    int m_numaNode = -1;
+    // m_ioWorker中位于m_numaNode上的工作线程id, 多个accept协程共用, m_nodeMutex保护
+    std::mutex m_nodeMutex;
+    std::vector<int> m_nodeThreads;
+    // 查询m_nodeThreads时m_ioWorker的扩缩容次数
+    uint64_t m_nodeScaleCount = 0;
+    // 轮询分派的下标
+    std::atomic<size_t> m_nextThread{0};
+    // 连接处理协程的栈大小档位
+    Fiber::StackClass m_stackClass = Fiber::STACK_DEFAULT;
 };
 
 
@@ -24,7 +24,7 @@ public:
     {
         std::unique_lock<std::mutex> lock(mtx);
         cv.wait(lock,[&](){
-            return count == 0;
+            return count > 0;
         });
         count--;
     }
@@ -0,0 +1,147 @@
+#ifndef _DAG_MPMC_QUEUE_H_
+#define _DAG_MPMC_QUEUE_H_
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include "noncopyable.h"
+
+namespace dag {
+
+/**
+ * @brief 有界无锁多生产者多消费者环形队列(Dmitry Vyukov的算法)
+ * @details 每个槽位带一个序号: 序号等于入队位置表示可写, 等于入队位置+1表示可读,
+ *          生产者/消费者各自CAS推进入队/出队位置, 之后只访问自己抢到的槽位;
+ *          满或空时立即返回false, 不阻塞
+ * @tparam T 元素类型, 需要可默认构造和移动
+ */
+template <class T>
+class MpmcQueue : public NonCopyable {
+public:
+    /**
+     * @brief 构造函数
+     * @param[in] capacity 容量, 必须是2的幂且不小于2
+     */
+    explicit MpmcQueue(size_t capacity)
+        : m_mask(capacity - 1)
+        , m_cells(new Cell[capacity]) {
+        assert(capacity >= 2 && (capacity & (capacity - 1)) == 0);
+        for(size_t i = 0; i < capacity; ++i) {
+            m_cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        m_enqueuePos.store(0, std::memory_order_relaxed);
+        m_dequeuePos.store(0, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief 入队
+     * @return 队列满时返回false, v保持不变
+     */
+    template <class U>
+    bool tryPush(U&& v) {
+        Cell* cell;
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        while(true) {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if(diff == 0) {
+                if(m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(diff < 0) {
+                // 槽位上一轮的数据还没被取走
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::forward<U>(v);
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 出队
+     * @return 队列空时返回false
+     */
+    bool tryPop(T& v) {
+        Cell* cell;
+        size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+        while(true) {
+            cell = &m_cells[pos & m_mask];
+            size_t seq = cell->sequence.load(std::memory_order_acquire);
+            intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if(diff == 0) {
+                if(m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(diff < 0) {
+                return false;
+            } else {
+                pos = m_dequeuePos.load(std::memory_order_relaxed);
+            }
+        }
+        v = std::move(cell->data);
+        // 把槽位里残留的对象清掉, 避免延长其持有资源的生命周期
+        cell->data = T();
+        cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief 近似元素个数, 并发修改时只作参考
+     */
+    size_t size() const {
+        size_t enq = m_enqueuePos.load(std::memory_order_acquire);
+        size_t deq = m_dequeuePos.load(std::memory_order_acquire);
+        return enq > deq ? enq - deq : 0;
+    }
+
+    /**
+     * @brief 队头槽位是否已经写好可以出队, 并发修改时只作参考
+     * @details 与size()不同, 入队方已占位但还没写完数据的槽位不算
+     */
+    bool canPop() const {
+        size_t pos = m_dequeuePos.load(std::memory_order_acquire);
+        return m_cells[pos & m_mask].sequence.load(std::memory_order_acquire) == pos + 1;
+    }
+
+    /**
+     * @brief 队尾槽位是否已经空出可以入队, 并发修改时只作参考
+     */
+    bool canPush() const {
+        size_t pos = m_enqueuePos.load(std::memory_order_acquire);
+        return m_cells[pos & m_mask].sequence.load(std::memory_order_acquire) == pos;
+    }
+
+    /**
+     * @brief 是否为空, 并发修改时只作参考
+     */
+    bool empty() const { return size() == 0;}
+
+    /**
+     * @brief 容量
+     */
+    size_t capacity() const { return m_mask + 1;}
+
+private:
+    struct Cell {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    /// 入队/出队位置分别独占缓存行, 避免生产者和消费者互相伪共享
+    static const size_t CACHELINE = 64;
+    const size_t m_mask;
+    std::unique_ptr<Cell[]> m_cells;
+    alignas(CACHELINE) std::atomic<size_t> m_enqueuePos;
+    alignas(CACHELINE) std::atomic<size_t> m_dequeuePos;
+};
+
+};
+
+#endif
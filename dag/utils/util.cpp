@@ -1,4 +1,10 @@
 #include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#include <algorithm>
+#include <fstream>
+#include <cstring>
 #include <sys/syscall.h>
 #include <sys/time.h>
 #include <execinfo.h>
@@ -20,6 +26,12 @@ uint64_t getElapseMs()
     return std::chrono::duration_cast<std::chrono::milliseconds>(now).count();
 }
 
+uint64_t getElapseUs()
+{
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+    return std::chrono::duration_cast<std::chrono::microseconds>(now).count();
+}
+
 uint32_t getThreadId() {
     return syscall(SYS_gettid);
 }
@@ -49,16 +61,20 @@ uint64_t getCurrentTime() {
 void backtrace(std::vector<std::string> &bt, int size, int skip) {
     void **array = (void **) ::malloc(sizeof(void *) * size);
     int s = ::backtrace(array, size);
+    backtrace(bt, array, s, skip);
+    ::free(array);
+}
 
-    char **strings = ::backtrace_symbols(array, size);
+void backtrace(std::vector<std::string> &bt, void *const *frames, int size, int skip) {
+    char **strings = ::backtrace_symbols(frames, size);
     if (strings == nullptr) {
         std::cerr << "backtrace_symbols error" << std::endl;
+        return;
     }
 
-    for (int i = skip; i < s; ++i) {
+    for (int i = skip; i < size; ++i) {
         bt.emplace_back(strings[i]);
     }
-    ::free(array);
     ::free(strings);
 }
 
@@ -72,4 +88,68 @@ std::string backtraceToString(int size, int skip, const std::string &prefix) {
     }
     return ss.str();
 }
+std::vector<int> getAllowedCpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int i = 0; i < CPU_SETSIZE; ++i) {
+            if (CPU_ISSET(i, &set)) {
+                cpus.push_back(i);
+            }
+        }
+    }
+    if (cpus.empty()) {
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        for (long i = 0; i < std::max(n, 1L); ++i) {
+            cpus.push_back((int)i);
+        }
+    }
+    return cpus;
+}
+
+int getCpuCount() {
+    return (int)getAllowedCpus().size();
+}
+
+int getCpuNumaNode(int cpu) {
+    // /sys/devices/system/cpu/cpuN/下有一个nodeK的链接指向所属节点
+    std::string path = "/sys/devices/system/cpu/cpu" + std::to_string(cpu);
+    DIR* dir = opendir(path.c_str());
+    if (!dir) {
+        return 0;
+    }
+    int node = 0;
+    while (struct dirent* ent = readdir(dir)) {
+        if (strncmp(ent->d_name, "node", 4) == 0 && isdigit(ent->d_name[4])) {
+            node = atoi(ent->d_name + 4);
+            break;
+        }
+    }
+    closedir(dir);
+    return node;
+}
+
+int getNicNumaNode(const std::string &ifname) {
+    std::ifstream ifs("/sys/class/net/" + ifname + "/device/numa_node");
+    int node = -1;
+    if (!(ifs >> node)) {
+        return -1;
+    }
+    return node;
+}
+
+bool setThreadAffinity(const std::vector<int> &cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+    if (CPU_COUNT(&set) == 0) {
+        return false;
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+}
 };
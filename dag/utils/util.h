@@ -15,6 +15,12 @@ namespace dag {
     */
 uint64_t getElapseMs();
 
+/**
+    * @brief 与getElapseMs相同的时钟, 单位微秒
+    * @return 时间
+    */
+uint64_t getElapseUs();
+
 
 /**
     * @brief 获得当前线程的线程 id
@@ -54,6 +60,15 @@ uint64_t getCurrentTime();
     */
 void backtrace(std::vector<std::string> &bt, int size, int skip);
 
+/**
+    * @brief 符号化已经抓取的栈帧, 如在信号处理函数中用::backtrace抓取的其他线程的栈
+    * @param bt 保存栈信息
+    * @param frames 栈帧地址
+    * @param size 栈帧数
+    * @param skip 忽略前 skip 层信息
+    */
+void backtrace(std::vector<std::string> &bt, void *const *frames, int size, int skip);
+
 /**
     * @brief 将程序调用栈格式化为字符串
     * @param size 栈深度
@@ -112,6 +127,39 @@ std::string base64encode(const void* data, size_t len);
     */
 std::string sha1sum(const void *data, size_t len);
 
+/**
+    * @brief 获取当前线程允许运行的CPU编号, 受taskset、cgroup cpuset等限制
+    * @return 按编号升序, sched_getaffinity失败时返回全部在线CPU
+    */
+std::vector<int> getAllowedCpus();
+
+/**
+    * @brief 获取当前线程允许运行的CPU个数
+    * @return CPU个数, 至少为1
+    */
+int getCpuCount();
+
+/**
+    * @brief 获取CPU所在的NUMA节点
+    * @param cpu CPU编号
+    * @return 节点编号, 系统没有NUMA信息时返回0
+    */
+int getCpuNumaNode(int cpu);
+
+/**
+    * @brief 获取网卡所在的NUMA节点
+    * @param ifname 网卡名, 如eth0
+    * @return 节点编号, 虚拟网卡或未知时返回-1
+    */
+int getNicNumaNode(const std::string &ifname);
+
+/**
+    * @brief 把当前线程绑定到指定的CPU集合
+    * @param cpus CPU编号列表
+    * @return 是否成功
+    */
+bool setThreadAffinity(const std::vector<int> &cpus);
+
 
 };
 
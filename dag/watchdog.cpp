@@ -0,0 +1,228 @@
+#include "watchdog.h"
+#include <algorithm>
+#include <chrono>
+#include <errno.h>
+#include <execinfo.h>
+#include <signal.h>
+#include <sstream>
+#include <string.h>
+#include <thread>
+#include <time.h>
+#include "fiber.h"
+#include "logger.h"
+#include "scheduler.h"
+#include "utils/util.h"
+
+namespace dag {
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+// 抓栈用的信号, 默认动作是忽略, 误发也没有副作用
+static const int CAPTURE_SIGNAL = SIGURG;
+// 抓栈最多等待的时间
+static const int CAPTURE_WAIT_MS = 100;
+
+static std::atomic<uint64_t> s_time_slice_ms{10};
+// 当前时间片的起点, 0表示当前协程不是由调度器恢复的
+static thread_local uint64_t t_slice_start = 0;
+// 安装信号处理函数之前的处理方式, 不是本模块请求的信号转交给它
+static struct sigaction s_old_action;
+static std::once_flag s_install_once;
+
+thread_local Watchdog::Slot* Watchdog::t_slot = nullptr;
+
+/**
+ * @brief 粗粒度单调时钟(毫秒), 精度为一个时钟节拍
+ */
+static uint64_t CoarseNowMs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return ts.tv_sec * 1000ull + ts.tv_nsec / 1000000;
+}
+
+bool maybe_yield() {
+    uint64_t start = t_slice_start;
+    if(!start || CoarseNowMs() - start < s_time_slice_ms.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    Scheduler* scheduler = Scheduler::GetThis();
+    Fiber* fiber = Fiber::GetThisRaw();
+    if(!scheduler || !fiber || !fiber->isRunInScheduler()) {
+        return false;
+    }
+    if(Watchdog::t_slot) {
+        Watchdog::t_slot->yields.fetch_add(1, std::memory_order_relaxed);
+    }
+    // 先入队再让出: 其他工作线程取到后要等本线程的resume返回、释放协程锁才能恢复它
+    scheduler->schedulerLock(fiber->shared_from_this());
+    fiber->yield();
+    return true;
+}
+
+void set_time_slice_ms(uint64_t ms) {
+    s_time_slice_ms = ms;
+}
+
+uint64_t get_time_slice_ms() {
+    return s_time_slice_ms;
+}
+
+void Watchdog::OnResume(Fiber* fiber) {
+    uint64_t now = CoarseNowMs();
+    t_slice_start = now;
+    if(Slot* slot = t_slot) {
+        slot->fiber_id.store(fiber->getId(), std::memory_order_relaxed);
+        slot->start_ms.store(now, std::memory_order_release);
+    }
+}
+
+void Watchdog::OnSuspend() {
+    t_slice_start = 0;
+    Slot* slot = t_slot;
+    if(!slot) {
+        return;
+    }
+    uint64_t start = slot->start_ms.exchange(0, std::memory_order_relaxed);
+    uint64_t run = start ? CoarseNowMs() - start : 0;
+    // 只有本线程写max_run_ms
+    if(run > slot->max_run_ms.load(std::memory_order_relaxed)) {
+        slot->max_run_ms.store(run, std::memory_order_relaxed);
+    }
+}
+
+void Watchdog::SignalHandler(int sig) {
+    int saved_errno = errno;
+    Slot* slot = t_slot;
+    if(slot && slot->capture.exchange(false, std::memory_order_acq_rel)) {
+        int n = ::backtrace(slot->frames, MAX_FRAMES);
+        slot->frame_count.store(n, std::memory_order_release);
+    } else if(!(s_old_action.sa_flags & SA_SIGINFO)
+              && s_old_action.sa_handler != SIG_DFL && s_old_action.sa_handler != SIG_IGN) {
+        s_old_action.sa_handler(sig);
+    }
+    errno = saved_errno;
+}
+
+Watchdog::Watchdog(const std::string& name, uint64_t threshold_ms)
+    : m_name(name)
+    , m_thresholdMs(threshold_ms) {
+    std::call_once(s_install_once, []() {
+        // ::backtrace第一次调用时会加载libgcc并分配内存, 不能发生在信号处理函数里, 先预热
+        void* frame;
+        ::backtrace(&frame, 1);
+        struct sigaction sa;
+        memset(&sa, 0, sizeof(sa));
+        sa.sa_handler = &Watchdog::SignalHandler;
+        sa.sa_flags = SA_RESTART;
+        sigemptyset(&sa.sa_mask);
+        sigaction(CAPTURE_SIGNAL, &sa, &s_old_action);
+    });
+    m_thread.reset(new Thread(std::bind(&Watchdog::run, this), m_name + "_watchdog"));
+}
+
+Watchdog::~Watchdog() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cond.notify_all();
+    m_thread->join();
+}
+
+void Watchdog::attach() {
+    std::shared_ptr<Slot> slot = std::make_shared<Slot>();
+    slot->tid = getThreadId();
+    slot->thread = pthread_self();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_slots.push_back(slot);
+    t_slot = slot.get();
+}
+
+void Watchdog::detach() {
+    // 持锁修改, 看门狗线程检查时不会向已退出的线程发信号
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if(t_slot) {
+        t_slot->attached = false;
+        t_slot->start_ms = 0;
+        t_slot = nullptr;
+    }
+}
+
+std::map<int, Watchdog::Stats> Watchdog::getStats() {
+    uint64_t now = CoarseNowMs();
+    std::map<int, Stats> rt;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for(auto& slot : m_slots) {
+        Stats& stats = rt[slot->tid];
+        uint64_t start = slot->start_ms;
+        stats.long_runs = slot->long_runs;
+        stats.max_run_ms = slot->max_run_ms;
+        stats.current_run_ms = start && now > start ? now - start : 0;
+        stats.yields = slot->yields;
+    }
+    return rt;
+}
+
+void Watchdog::run() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while(!m_stopping) {
+        // 检查间隔取阈值的1/4, 报告最多晚于阈值25%
+        uint64_t interval = std::max<uint64_t>(1, std::min<uint64_t>(m_thresholdMs / 4, 100));
+        m_cond.wait_for(lock, std::chrono::milliseconds(interval));
+        uint64_t threshold = m_thresholdMs;
+        if(m_stopping || threshold == 0) {
+            continue;
+        }
+        uint64_t now = CoarseNowMs();
+        for(auto& slot : m_slots) {
+            if(slot->attached) {
+                check(slot, now, threshold);
+            }
+        }
+    }
+}
+
+void Watchdog::check(const std::shared_ptr<Slot>& slot, uint64_t now, uint64_t threshold) {
+    uint64_t start = slot->start_ms.load(std::memory_order_acquire);
+    if(!start || now < start + threshold || slot->reported_ms == start) {
+        return;
+    }
+    slot->reported_ms = start;
+    slot->long_runs.fetch_add(1, std::memory_order_relaxed);
+    uint64_t fiber_id = slot->fiber_id.load(std::memory_order_relaxed);
+
+    // 让工作线程在信号处理函数里抓取自己的栈帧
+    int frames = -1;
+    slot->frame_count.store(-1, std::memory_order_relaxed);
+    slot->capture.store(true, std::memory_order_release);
+    if(pthread_kill(slot->thread, CAPTURE_SIGNAL) == 0) {
+        for(int i = 0; i < CAPTURE_WAIT_MS && (frames = slot->frame_count.load(std::memory_order_acquire)) < 0; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+    if(frames < 0 && !slot->capture.exchange(false)) {
+        // 处理函数已经取走请求, 正在抓栈, 等它写完再复用缓冲区
+        while((frames = slot->frame_count.load(std::memory_order_acquire)) < 0) {
+            std::this_thread::yield();
+        }
+    }
+
+    std::stringstream ss;
+    ss << m_name << " watchdog: fiber " << fiber_id << " on thread " << slot->tid
+       << " has been running for " << now - start << "ms (threshold " << threshold << "ms)";
+    if(slot->start_ms.load(std::memory_order_acquire) != start) {
+        ss << ", finished before the backtrace was taken";
+    } else if(frames > 0) {
+        // 跳过信号处理函数和内核的信号返回跳板
+        std::vector<std::string> bt;
+        backtrace(bt, slot->frames, frames, 2);
+        for(auto& i : bt) {
+            ss << std::endl << "    " << i;
+        }
+    } else {
+        ss << ", backtrace unavailable";
+    }
+    DAG_LOG_ERROR(g_logger) << ss.str();
+}
+
+}
@@ -0,0 +1,163 @@
+#ifndef __DAG_WATCHDOG_H__
+#define __DAG_WATCHDOG_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <vector>
+#include "thread.h"
+
+namespace dag {
+
+class Fiber;
+
+/**
+ * @brief 协作式抢占点
+ * @details 调度器恢复协程时记下时间片的起点, 本函数只读一次粗粒度时钟(CLOCK_MONOTONIC_COARSE, vDSO中只读内存, 不进内核)
+ *          与起点比较; 超过时间片时把当前协程重新放回调度队列(保持原有的优先级、截止时间和线程绑定)并让出,
+ *          让同一工作线程上排队的任务和IO事件有机会执行。供长时间的计算循环在每轮迭代中调用;
+ *          不在调度器运行的协程中调用时什么也不做
+ * @return 是否让出过
+ */
+bool maybe_yield();
+
+/**
+ * @brief 设置maybe_yield的时间片(毫秒), 默认10ms, 0表示每次调用都让出
+ * @attention 粗粒度时钟的精度为一个时钟节拍(通常1~4ms), 小于该精度的时间片会被放大到节拍
+ */
+void set_time_slice_ms(uint64_t ms);
+
+uint64_t get_time_slice_ms();
+
+/**
+ * @brief 长时间运行协程的看门狗
+ * @details 每个工作线程登记一个槽位, 调度器在恢复协程前后记录正在运行的协程id和起始时间;
+ *          后台线程定期检查各槽位, 同一次运行超过阈值时计数, 并用SIGURG打断该工作线程,
+ *          在信号处理函数里抓取原始栈帧, 回到看门狗线程用dag::backtrace符号化后记录错误日志;
+ *          每次运行只报告一次
+ * @attention 捕获栈帧的信号处理函数以SA_RESTART安装, 被打断的阻塞系统调用会自动重启
+ */
+class Watchdog {
+public:
+    /**
+     * @brief 单个工作线程的统计
+     */
+    struct Stats {
+        // 检测到的超时运行次数
+        uint64_t long_runs = 0;
+        // 观察到的最长一次连续运行(毫秒)
+        uint64_t max_run_ms = 0;
+        // 当前任务已连续运行的时间(毫秒), 空闲时为0
+        uint64_t current_run_ms = 0;
+        // maybe_yield让出的次数
+        uint64_t yields = 0;
+    };
+
+    /**
+     * @brief 创建并启动看门狗线程
+     * @param[in] name 所属调度器的名称, 用于线程名和日志
+     * @param[in] threshold_ms 协程连续运行超过该时间(毫秒)视为卡住
+     */
+    Watchdog(const std::string& name, uint64_t threshold_ms);
+
+    /**
+     * @brief 停止看门狗线程
+     */
+    ~Watchdog();
+
+    /**
+     * @brief 当前线程登记为受监控的工作线程, 在工作线程的run()开头调用
+     */
+    void attach();
+
+    /**
+     * @brief 当前线程取消登记, 在工作线程的run()退出前调用, 统计保留
+     */
+    void detach();
+
+    /**
+     * @brief 修改阈值(毫秒), 0表示暂停检测
+     */
+    void setThreshold(uint64_t ms) {m_thresholdMs = ms;}
+
+    uint64_t getThreshold() const {return m_thresholdMs;}
+
+    /**
+     * @brief 各工作线程的统计, key为线程id
+     */
+    std::map<int, Stats> getStats();
+
+    /**
+     * @brief 调度器恢复协程之前调用, 开始新的时间片
+     */
+    static void OnResume(Fiber* fiber);
+
+    /**
+     * @brief 协程让出或结束、回到调度器之后调用
+     */
+    static void OnSuspend();
+
+    Watchdog(const Watchdog&) = delete;
+    Watchdog& operator=(const Watchdog&) = delete;
+
+private:
+    /// 抓取的最大栈帧数
+    static const int MAX_FRAMES = 64;
+
+    /**
+     * @brief 工作线程的槽位, 工作线程写运行状态, 看门狗线程读
+     */
+    struct Slot {
+        int tid = -1;
+        // 工作线程是否仍在运行, 退出后保留统计但不再检查, 由m_mutex保护
+        bool attached = true;
+        pthread_t thread;
+        // 当前运行的起始时间(粗粒度毫秒), 0表示没有在运行任务
+        std::atomic<uint64_t> start_ms = {0};
+        std::atomic<uint64_t> fiber_id = {0};
+        // 已经报告过的运行的起始时间, 避免同一次运行重复报告
+        uint64_t reported_ms = 0;
+        std::atomic<uint64_t> long_runs = {0};
+        std::atomic<uint64_t> max_run_ms = {0};
+        std::atomic<uint64_t> yields = {0};
+        // 看门狗请求抓栈, 信号处理函数取走后置false
+        std::atomic<bool> capture = {false};
+        // 抓到的栈帧数, -1表示还没抓到
+        std::atomic<int> frame_count = {-1};
+        void* frames[MAX_FRAMES];
+    };
+
+    void run();
+
+    /**
+     * @brief 检查一个槽位, 超时时计数、抓栈并记录日志
+     */
+    void check(const std::shared_ptr<Slot>& slot, uint64_t now, uint64_t threshold);
+
+    static void SignalHandler(int sig);
+
+    friend bool maybe_yield();
+
+private:
+    // 当前线程登记的槽位, 信号处理函数通过它找到抓栈的缓冲区
+    static thread_local Slot* t_slot;
+
+    std::string m_name;
+    std::atomic<uint64_t> m_thresholdMs;
+    std::mutex m_mutex;
+    std::condition_variable m_cond;
+    bool m_stopping = false;
+    // 已登记的工作线程
+    std::vector<std::shared_ptr<Slot>> m_slots;
+    std::unique_ptr<Thread> m_thread;
+};
+
+}
+
+#endif
@@ -0,0 +1,146 @@
+#include "address.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "socket.h"
+#include "utils/asserts.h"
+#include <string.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+static void WaitFor(std::atomic<int>& v, int n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void test_ipv6() {
+    IPv6Address::ptr addr = IPv6Address::Create("fe80::1:2", 8080);
+    DAG_ASSERT(addr && addr->toString() == "[fe80::1:2]:8080");
+    DAG_ASSERT(addr->getPort() == 8080 && addr->getFamily() == AF_INET6);
+    DAG_ASSERT(!IPv6Address::Create("1.2.3.4"));
+    DAG_ASSERT(IPv6Address().toString() == "[::]:0");
+
+    DAG_ASSERT(addr->subnetMask(64)->toString() == "[ffff:ffff:ffff:ffff::]:0");
+    DAG_ASSERT(addr->subnetMask(70)->toString() == "[ffff:ffff:ffff:ffff:fc00::]:0");
+    DAG_ASSERT(addr->subnetMask(128)->toString() == "[ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff]:0");
+    DAG_ASSERT(addr->networdAddress(64)->toString() == "[fe80::]:8080");
+    DAG_ASSERT(addr->networdAddress(128)->toString() == "[fe80::1:2]:8080");
+    DAG_ASSERT(addr->broadcastAddress(112)->toString() == "[fe80::1:ffff]:8080");
+    DAG_ASSERT(!addr->subnetMask(129));
+
+    // 通用的创建接口能识别IPv6
+    IPAddress::ptr ip = IPAddress::Create("::1", 53);
+    DAG_ASSERT(ip && std::dynamic_pointer_cast<IPv6Address>(ip) && ip->toString() == "[::1]:53");
+    Address::ptr copy = Address::Create(addr->getAddr(), addr->getAddrLen());
+    DAG_ASSERT(copy && *copy == *addr);
+
+    std::vector<Address::ptr> result;
+    DAG_ASSERT(Address::Lookup(result, "[::1]:443", AF_INET6));
+    DAG_ASSERT(result[0]->toString() == "[::1]:443");
+
+    std::multimap<std::string, std::pair<Address::ptr, uint32_t>> ifaces;
+    Address::GetInterfaceAddresses(ifaces, AF_INET6);
+    for(auto& i : ifaces) {
+        DAG_ASSERT(i.second.first->getFamily() == AF_INET6 && i.second.second <= 128);
+        DAG_LOG_INFO(g_logger) << i.first << " " << *i.second.first << "/" << i.second.second;
+    }
+    std::vector<std::pair<Address::ptr, uint32_t>> any;
+    DAG_ASSERT(Address::GetInterfaceAddresses(any, "*", AF_UNSPEC) && any.size() == 2);
+    DAG_LOG_INFO(g_logger) << "test_ipv6 ok";
+}
+
+void test_unix_address() {
+    UnixAddress::ptr path(new UnixAddress("/tmp/dag.sock"));
+    DAG_ASSERT(path->getPath() == "/tmp/dag.sock" && !path->isAbstract());
+    DAG_ASSERT(path->toString() == "/tmp/dag.sock");
+    DAG_ASSERT(path->getAddrLen() == offsetof(sockaddr_un, sun_path) + 14);
+
+    UnixAddress::ptr abstract = UnixAddress::CreateAbstract("dag.abstract");
+    DAG_ASSERT(abstract->isAbstract() && abstract->toString() == "@dag.abstract");
+    DAG_ASSERT(abstract->getPath() == std::string("\0dag.abstract", 13));
+    DAG_ASSERT(abstract->getAddrLen() == offsetof(sockaddr_un, sun_path) + 13);
+    DAG_ASSERT(!UnixAddress::CreateAbstract(std::string(200, 'x')));
+
+    // 长度决定抽象地址的名字, 复制时保留
+    Address::ptr copy = Address::Create(abstract->getAddr(), abstract->getAddrLen());
+    DAG_ASSERT(copy && *copy == *abstract && copy->toString() == "@dag.abstract");
+    DAG_LOG_INFO(g_logger) << "test_unix_address ok";
+}
+
+/**
+ * @brief 在IOManager中对addr做一次回显, 返回是否成功
+ */
+static bool Echo(Address::ptr addr) {
+    IOManager iom(2, false, "address_echo");
+    std::atomic<int> done{0};
+    std::atomic<bool> ok{false};
+    Socket::ptr server = Socket::CreateTCP(addr);
+    if(!server->bind(addr) || !server->listen()) {
+        return false;
+    }
+    Address::ptr bound = server->getLocalAddress();
+    iom.schedulerLock([&]() {
+        Socket::ptr client = server->accept();
+        if(client) {
+            char buf[64];
+            int n = client->recv(buf, sizeof(buf));
+            if(n > 0) {
+                client->send(buf, n);
+            }
+        }
+        ++done;
+    });
+    iom.schedulerLock([&]() {
+        Socket::ptr sock = Socket::CreateTCP(bound);
+        if(sock->connect(bound, 1000)) {
+            char buf[64] = {0};
+            ok = sock->send("ping", 4) == 4 && sock->recv(buf, sizeof(buf)) == 4 && memcmp(buf, "ping", 4) == 0
+                && sock->getRemoteAddress()->toString() == bound->toString();
+        }
+        ++done;
+    });
+    WaitFor(done, 2);
+    DAG_LOG_INFO(g_logger) << "echo over " << *bound << " ok=" << ok;
+    return ok;
+}
+
+void test_echo() {
+    DAG_ASSERT(Echo(IPv4Address::Create("127.0.0.1", 0)));
+    // 沙箱可能没有IPv6回环
+    IPv6Address::ptr v6 = IPv6Address::Create("::1", 0);
+    Socket::ptr probe = Socket::CreateTCP(v6);
+    if(probe->bind(v6)) {
+        probe->close();
+        DAG_ASSERT(Echo(v6));
+    }
+
+    const char* path = "/tmp/dag_test_address.sock";
+    unlink(path);
+    DAG_ASSERT(Echo(UnixAddress::ptr(new UnixAddress(path))));
+    // 上次留下的socket文件, 没有进程监听时可以重新绑定
+    struct stat st;
+    DAG_ASSERT(lstat(path, &st) == 0 && S_ISSOCK(st.st_mode));
+    DAG_ASSERT(Echo(UnixAddress::ptr(new UnixAddress(path))));
+    // 有进程监听时不能抢占
+    Socket::ptr listening = Socket::CreateUnixTCPSocket();
+    DAG_ASSERT(listening->bind(UnixAddress::ptr(new UnixAddress(path))) && listening->listen());
+    Socket::ptr second = Socket::CreateUnixTCPSocket();
+    DAG_ASSERT(!second->bind(UnixAddress::ptr(new UnixAddress(path))));
+    listening->close();
+    unlink(path);
+
+    DAG_ASSERT(Echo(UnixAddress::CreateAbstract("dag_test_address")));
+    DAG_LOG_INFO(g_logger) << "test_echo ok";
+}
+
+int main(int argc, char** argv) {
+    test_ipv6();
+    test_unix_address();
+    test_echo();
+    return 0;
+}
@@ -0,0 +1,79 @@
+#include "ioscheduler.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include "utils/util.h"
+#include <sched.h>
+#include <unistd.h>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+void test_one_per_worker() {
+    int cpu = getAllowedCpus().back();
+    IOManager iom(2, false, "affinity", {cpu});
+    DAG_ASSERT(iom.getWorkerCount() == 2);
+    int node = getCpuNumaNode(cpu);
+    for(size_t i = 0; i < iom.getWorkerCount(); ++i) {
+        DAG_ASSERT(iom.getWorkerCpu(i) == cpu);
+        DAG_ASSERT(iom.getWorkerNode(i) == node);
+    }
+    std::vector<int> ids = iom.getWorkerThreadIdsOnNode(node);
+    DAG_ASSERT(ids.size() == 2);
+
+    // 指定线程运行的任务应当跑在绑定的核上, 且亲和性只有这一个核
+    std::atomic<int> done{0};
+    for(int id : ids) {
+        iom.schedulerLock([&done, id, cpu]() {
+            DAG_ASSERT((int)getThreadId() == id);
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            DAG_ASSERT(sched_getaffinity(0, sizeof(set), &set) == 0);
+            DAG_ASSERT(CPU_COUNT(&set) == 1 && CPU_ISSET(cpu, &set));
+            DAG_ASSERT(sched_getcpu() == cpu);
+            ++done;
+        }, id);
+    }
+    while(done < 2) {
+        usleep(1000);
+    }
+    DAG_ASSERT(iom.getWorkerThreadIdsOnNode(node + 1).empty());
+    DAG_LOG_INFO(g_logger) << "test_one_per_worker ok cpu=" << cpu << " node=" << node;
+}
+
+void test_shared_set() {
+    IOManager iom(2, false, "affinity_all", {}, false);
+    for(size_t i = 0; i < iom.getWorkerCount(); ++i) {
+        // 可在所有核上运行时不算绑定到单个核
+        DAG_ASSERT(getCpuCount() == 1 || iom.getWorkerCpu(i) == -1);
+    }
+    DAG_LOG_INFO(g_logger) << "test_shared_set ok";
+}
+
+void test_default_cpus() {
+    // 默认的CPU列表取自进程的亲和性, 不会绑到cpuset以外的核
+    std::vector<int> allowed = getAllowedCpus();
+    DAG_ASSERT((int)allowed.size() == getCpuCount());
+    IOManager iom(2, false, "affinity_default", {});
+    for(size_t i = 0; i < iom.getWorkerCount(); ++i) {
+        DAG_ASSERT(iom.getWorkerCpu(i) == allowed[i % allowed.size()]);
+    }
+    DAG_LOG_INFO(g_logger) << "test_default_cpus ok cpus=" << allowed.size();
+}
+
+void test_no_affinity() {
+    IOManager iom(1, false, "plain");
+    DAG_ASSERT(iom.getWorkerCpu(0) == -1);
+    DAG_ASSERT(iom.getWorkerNode(0) == -1);
+    DAG_ASSERT(iom.getWorkerThreadIdsOnNode(0).empty());
+    DAG_LOG_INFO(g_logger) << "test_no_affinity ok";
+}
+
+int main(int argc, char** argv) {
+    test_one_per_worker();
+    test_shared_set();
+    test_default_cpus();
+    test_no_affinity();
+    DAG_LOG_INFO(g_logger) << "eth0 numa node=" << getNicNumaNode("eth0");
+    return 0;
+}
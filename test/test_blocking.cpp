@@ -0,0 +1,216 @@
+#include "blocking.h"
+#include "hook.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include "utils/util.h"
+#include <fcntl.h>
+#include <stdexcept>
+#include <string.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+static void WaitFor(std::atomic<int>& v, int n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void test_offload() {
+    // 唯一的工作线程上8个协程各做一次50ms的阻塞调用, 同时执行, 工作线程不被阻塞
+    IOManager iom(1, false, "blocking");
+    const int count = 8;
+    std::atomic<int> done{0};
+    std::atomic<int> bad{0};
+    uint64_t start = getElapseMs();
+    for(int i = 0; i < count; ++i) {
+        iom.schedulerLock([&, i]() {
+            int rt = blocking([i]() {
+                // 池线程没有开启hook, 这里真正阻塞线程
+                usleep(50 * 1000);
+                return i * 10;
+            });
+            if(rt != i * 10) {
+                ++bad;
+            }
+            ++done;
+        });
+    }
+    std::atomic<uint64_t> short_ran{0};
+    iom.schedulerLock([&]() {
+        short_ran = getElapseMs();
+    });
+    WaitFor(done, count);
+    uint64_t elapsed = getElapseMs() - start;
+    DAG_ASSERT(bad == 0);
+    DAG_ASSERT(elapsed < 300);
+    DAG_ASSERT(short_ran && short_ran - start < 40);
+    BlockingPool::Stats stats = BlockingPoolMgr::GetInstance()->getStats();
+    DAG_ASSERT(stats.calls >= (uint64_t)count);
+    DAG_ASSERT(stats.max_running >= 2);
+    DAG_LOG_INFO(g_logger) << "test_offload ok elapsed=" << elapsed << "ms threads=" << stats.threads;
+}
+
+void test_errno_and_exception() {
+    IOManager iom(1, false, "blocking_err");
+    std::atomic<int> done{0};
+    iom.schedulerLock([&]() {
+        errno = 0;
+        int fd = blocking([]() { return ::open("/nonexistent/dag_blocking", O_RDONLY); });
+        DAG_ASSERT(fd == -1 && errno == ENOENT);
+
+        bool caught = false;
+        try {
+            blocking([]() { throw std::runtime_error("boom"); });
+        } catch(const std::runtime_error& e) {
+            caught = strcmp(e.what(), "boom") == 0;
+        }
+        DAG_ASSERT(caught);
+
+        std::string s = blocking([]() { return std::string(1000, 'x'); });
+        DAG_ASSERT(s.size() == 1000);
+        ++done;
+    });
+    WaitFor(done, 1);
+
+    // 不在调度器的协程中直接执行
+    uint64_t inline_calls = BlockingPoolMgr::GetInstance()->getStats().inline_calls;
+    DAG_ASSERT(blocking([]() { return 7; }) == 7);
+    DAG_ASSERT(BlockingPoolMgr::GetInstance()->getStats().inline_calls == inline_calls + 1);
+    DAG_LOG_INFO(g_logger) << "test_errno_and_exception ok";
+}
+
+void test_bounded() {
+    BlockingPool pool(2, "bounded");
+    IOManager iom(1, false, "blocking_bound");
+    const int count = 6;
+    std::atomic<int> done{0};
+    uint64_t start = getElapseMs();
+    for(int i = 0; i < count; ++i) {
+        iom.schedulerLock([&]() {
+            pool.call([]() { usleep(30 * 1000); });
+            ++done;
+        });
+    }
+    WaitFor(done, count);
+    uint64_t elapsed = getElapseMs() - start;
+    BlockingPool::Stats stats = pool.getStats();
+    // 最多同时执行2个, 6个调用至少3轮
+    DAG_ASSERT(stats.threads == 2 && stats.max_running == 2);
+    DAG_ASSERT(elapsed >= 85);
+    DAG_ASSERT(stats.calls == (uint64_t)count && stats.queued == 0 && stats.running == 0);
+    uint64_t runs = 0;
+    uint64_t queued_long = 0;
+    for(size_t i = 0; i < BlockingPool::LATENCY_BUCKETS; ++i) {
+        runs += stats.run_buckets[i];
+        // 排队超过16ms
+        queued_long += i > 14 ? stats.wait_buckets[i] : 0;
+    }
+    DAG_ASSERT(runs == (uint64_t)count);
+    DAG_ASSERT(queued_long >= 2);
+    DAG_LOG_INFO(g_logger) << "test_bounded ok elapsed=" << elapsed << "ms";
+}
+
+void test_file_offload() {
+    char path[] = "/tmp/dag_blocking_XXXXXX";
+    int tmp = mkstemp(path);
+    DAG_ASSERT(tmp >= 0);
+    ::close(tmp);
+
+    IOManager iom(1, false, "blocking_file");
+    set_file_io_offload(true);
+    std::atomic<int> done{0};
+    uint64_t before = BlockingPoolMgr::GetInstance()->getStats().calls;
+    iom.schedulerLock([&]() {
+        int fd = ::open(path, O_RDWR);
+        DAG_ASSERT(fd >= 0);
+        DAG_ASSERT(write(fd, "hello", 5) == 5);
+        DAG_ASSERT(fsync(fd) == 0);
+        DAG_ASSERT(lseek(fd, 0, SEEK_SET) == 0);
+        char buf[16] = {0};
+        DAG_ASSERT(read(fd, buf, sizeof(buf)) == 5 && memcmp(buf, "hello", 5) == 0);
+        close(fd);
+
+        // 管道不是普通文件, 不经过阻塞调用池
+        int p[2];
+        DAG_ASSERT(pipe(p) == 0);
+        DAG_ASSERT(write(p[1], "x", 1) == 1);
+        DAG_ASSERT(read(p[0], buf, 1) == 1);
+        close(p[0]);
+        close(p[1]);
+        ++done;
+    });
+    WaitFor(done, 1);
+    set_file_io_offload(false);
+    // write, fsync, read
+    DAG_ASSERT(BlockingPoolMgr::GetInstance()->getStats().calls == before + 3);
+    unlink(path);
+    DAG_LOG_INFO(g_logger) << "test_file_offload ok";
+}
+
+void test_shared_stack() {
+    char path[] = "/tmp/dag_blocking_XXXXXX";
+    int tmp = mkstemp(path);
+    DAG_ASSERT(tmp >= 0);
+    DAG_ASSERT(::write(tmp, "shared", 6) == 6);
+    ::close(tmp);
+
+    // 共享栈协程的阻塞调用和读文件期间, 同一线程上的其他共享栈协程不断换入换出共享栈
+    IOManager iom(1, false, "blocking_shared");
+    set_file_io_offload(true);
+    const int count = 8;
+    std::atomic<int> done{0};
+    std::atomic<int> bad{0};
+    uint64_t inline_calls = BlockingPoolMgr::GetInstance()->getStats().inline_calls;
+    iom.schedulerLock([&]() {
+        char buf[64];
+        memset(buf, 'z', sizeof(buf));
+        int rt = blocking([&buf]() {
+            usleep(20 * 1000);
+            return buf[0] == 'z' ? 42 : -1;
+        });
+        int fd = ::open(path, O_RDONLY);
+        ssize_t n = read(fd, buf, sizeof(buf));
+        close(fd);
+        if(rt != 42 || n != 6 || memcmp(buf, "shared", 6) != 0 || buf[6] != 'z') {
+            ++bad;
+        }
+        ++done;
+    }, -1, Fiber::STACK_SHARED);
+    for(int f = 0; f < count; ++f) {
+        iom.schedulerLock([&, f]() {
+            char buf[512];
+            memset(buf, f, sizeof(buf));
+            for(int i = 0; i < 10; ++i) {
+                usleep(1000);
+                for(size_t j = 0; j < sizeof(buf); ++j) {
+                    if(buf[j] != (char)f) {
+                        ++bad;
+                        break;
+                    }
+                }
+            }
+            ++done;
+        }, -1, Fiber::STACK_SHARED);
+    }
+    WaitFor(done, count + 1);
+    set_file_io_offload(false);
+    DAG_ASSERT(bad == 0);
+    // 共享栈协程的调用在当前线程执行
+    DAG_ASSERT(BlockingPoolMgr::GetInstance()->getStats().inline_calls == inline_calls + 1);
+    unlink(path);
+    DAG_LOG_INFO(g_logger) << "test_shared_stack ok";
+}
+
+int main(int argc, char** argv) {
+    test_offload();
+    test_errno_and_exception();
+    test_bounded();
+    test_file_offload();
+    test_shared_stack();
+    return 0;
+}
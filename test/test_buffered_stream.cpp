@@ -0,0 +1,140 @@
+#include "stream/buffered_stream.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+static dag::Logger::ptr g_logger = DAG_LOG_ROOT();
+
+/**
+ * @brief 内存流: 每次read最多返回chunk字节，用来模拟数据分多次到达的socket
+ */
+class MemoryStream : public dag::Stream {
+public:
+    using ptr = std::shared_ptr<MemoryStream>;
+
+    MemoryStream(const std::string& data, size_t chunk)
+        : m_data(data), m_chunk(chunk) {}
+
+    int read(void* buffer, size_t length) override {
+        ++m_reads;
+        size_t n = std::min({length, m_chunk, m_data.size() - m_offset});
+        memcpy(buffer, m_data.c_str() + m_offset, n);
+        m_offset += n;
+        return n;
+    }
+
+    int read(dag::ByteArray::ptr ba, size_t length) override {
+        ++m_reads;
+        size_t n = std::min({length, m_chunk, m_data.size() - m_offset});
+        ba->write(m_data.c_str() + m_offset, n);
+        m_offset += n;
+        return n;
+    }
+
+    int write(const void* buffer, size_t length) override {
+        ++m_writes;
+        m_out.append((const char*)buffer, length);
+        return length;
+    }
+
+    int write(dag::ByteArray::ptr ba, size_t length) override {
+        ++m_writes;
+        std::vector<iovec> iovs;
+        ba->getReadBuffers(iovs, length);
+        for(auto& iov : iovs) {
+            m_out.append((const char*)iov.iov_base, iov.iov_len);
+        }
+        ba->setPosition(ba->getPosition() + length);
+        return length;
+    }
+
+    void close() override {}
+
+    std::string m_data;
+    size_t m_chunk;
+    size_t m_offset = 0;
+    int m_reads = 0;
+    int m_writes = 0;
+    std::string m_out;
+};
+
+void test_read_line() {
+    MemoryStream::ptr ms(new MemoryStream("GET / HTTP/1.1\r\nHost: a\r\n\r\nbody-tail", 3));
+    // 读缓冲每块只有4字节，分隔符会跨越内存块边界
+    dag::BufferedStream::ptr bs(new dag::BufferedStream(ms, 4));
+
+    std::string line;
+    DAG_ASSERT(bs->readLine(line) == 16);
+    DAG_ASSERT(line == "GET / HTTP/1.1");
+    DAG_ASSERT(bs->readLine(line) > 0);
+    DAG_ASSERT(line == "Host: a");
+    DAG_ASSERT(bs->readLine(line) == 2);
+    DAG_ASSERT(line.empty());
+
+    char buf[4] = {0};
+    DAG_ASSERT(bs->peek(buf, 4) == 4);
+    DAG_ASSERT(memcmp(buf, "body", 4) == 0);
+
+    std::string out;
+    DAG_ASSERT(bs->readUntil(out, "-t") == 6);
+    DAG_ASSERT(out == "body-t");
+
+    // 找不到分隔符直到EOF
+    DAG_ASSERT(bs->readUntil(out, "\n") == 0);
+    char rest[8];
+    DAG_ASSERT(bs->read(rest, sizeof(rest)) == 3);
+    DAG_ASSERT(memcmp(rest, "ail", 3) == 0);
+    DAG_ASSERT(bs->read(rest, sizeof(rest)) == 0);
+    DAG_LOG_INFO(g_logger) << "test_read_line ok, underlying reads=" << ms->m_reads;
+}
+
+void test_read_until_limit() {
+    std::string data(1000, 'x');
+    MemoryStream::ptr ms(new MemoryStream(data + "\n", 64));
+    dag::BufferedStream::ptr bs(new dag::BufferedStream(ms, 128));
+    std::string out;
+    DAG_ASSERT(bs->readUntil(out, "\n", 100) < 0);
+    DAG_ASSERT(errno == EMSGSIZE);
+    DAG_LOG_INFO(g_logger) << "test_read_until_limit ok";
+}
+
+void test_write_coalesce() {
+    MemoryStream::ptr ms(new MemoryStream("", 1));
+    dag::BufferedStream::ptr bs(new dag::BufferedStream(ms, 4096, 1024));
+    std::string expect;
+    for(int i = 0; i < 100; ++i) {
+        std::string s = "line " + std::to_string(i) + "\n";
+        expect += s;
+        DAG_ASSERT(bs->write(s.c_str(), s.size()) == (int)s.size());
+    }
+    DAG_ASSERT(bs->flush() > 0);
+    DAG_ASSERT(ms->m_out == expect);
+    DAG_LOG_INFO(g_logger) << "test_write_coalesce ok, 100 writes -> "
+                           << ms->m_writes << " underlying writes";
+    DAG_ASSERT(ms->m_writes < 10);
+}
+
+void test_unbuffered_write() {
+    // 写缓冲为0时每次写入直接交给底层流
+    MemoryStream::ptr ms(new MemoryStream("", 1));
+    dag::BufferedStream::ptr bs(new dag::BufferedStream(ms, 4096, 0));
+    DAG_ASSERT(bs->write("abc", 3) == 3);
+    dag::ByteArray::ptr ba(new dag::ByteArray(2));
+    ba->write("defgh", 5);
+    ba->setPosition(1);
+    DAG_ASSERT(bs->write(ba, 10) == 4);
+    DAG_ASSERT(ba->getReadSize() == 0);
+    DAG_ASSERT(bs->getWriteBufferedSize() == 0);
+    DAG_ASSERT(ms->m_writes == 2 && ms->m_out == "abcefgh");
+    DAG_LOG_INFO(g_logger) << "test_unbuffered_write ok";
+}
+
+int main() {
+    test_read_line();
+    test_read_until_limit();
+    test_write_coalesce();
+    test_unbuffered_write();
+    return 0;
+}
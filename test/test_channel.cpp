@@ -0,0 +1,316 @@
+#include "channel.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include "utils/util.h"
+#include <thread>
+#include <unistd.h>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+static void WaitFor(std::atomic<int>& v, int n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void test_try() {
+    Channel<int> ch(4);
+    DAG_ASSERT(ch.capacity() == 4);
+    for(int i = 0; i < 4; ++i) {
+        DAG_ASSERT(ch.trySend(i));
+    }
+    DAG_ASSERT(!ch.trySend(4));
+    DAG_ASSERT(ch.size() == 4);
+    int v = -1;
+    for(int i = 0; i < 4; ++i) {
+        DAG_ASSERT(ch.tryRecv(v) && v == i);
+    }
+    DAG_ASSERT(!ch.tryRecv(v));
+
+    // 容量不是2的幂时也严格按指定值限制
+    Channel<int> odd(5);
+    DAG_ASSERT(odd.capacity() == 5);
+    for(int i = 0; i < 5; ++i) {
+        DAG_ASSERT(odd.trySend(i));
+    }
+    DAG_ASSERT(!odd.trySend(5) && !odd.readyForSend());
+    DAG_ASSERT(odd.tryRecv(v) && v == 0 && odd.readyForSend());
+    DAG_ASSERT(odd.trySend(5) && !odd.trySend(6));
+    Channel<int> one(1);
+    DAG_ASSERT(one.capacity() == 1 && one.trySend(1) && !one.trySend(2));
+
+    Channel<std::string> unbounded;
+    DAG_ASSERT(unbounded.capacity() == Channel<std::string>::UNBOUNDED);
+    for(int i = 0; i < 10000; ++i) {
+        DAG_ASSERT(unbounded.trySend(std::to_string(i)));
+    }
+    std::string s;
+    DAG_ASSERT(unbounded.tryRecv(s) && s == "0");
+    DAG_ASSERT(unbounded.size() == 9999);
+
+    // 关闭后不能发送, 剩余元素仍可接收
+    unbounded.close();
+    DAG_ASSERT(!unbounded.send(std::string("x")));
+    int n = 0;
+    while(unbounded.recv(s)) {
+        ++n;
+    }
+    DAG_ASSERT(n == 9999);
+    DAG_LOG_INFO(g_logger) << "test_try ok";
+}
+
+void test_pipeline() {
+    // 生产者/消费者协程多于工作线程, 容量很小, 收发频繁挂起
+    IOManager iom(2, false, "chan");
+    Channel<int>::ptr ch = std::make_shared<Channel<int>>(2);
+    const int producers = 4;
+    const int consumers = 3;
+    const int per = 5000;
+    std::atomic<int> produced{0};
+    std::atomic<int> consumed{0};
+    std::atomic<int64_t> sum{0};
+    for(int p = 0; p < producers; ++p) {
+        iom.schedulerLock([&, p]() {
+            for(int i = 1; i <= per; ++i) {
+                DAG_ASSERT(ch->send(i));
+            }
+            if(++produced == producers) {
+                ch->close();
+            }
+        });
+    }
+    for(int c = 0; c < consumers; ++c) {
+        iom.schedulerLock([&]() {
+            int v;
+            while(ch->recv(v)) {
+                sum += v;
+            }
+            ++consumed;
+        });
+    }
+    WaitFor(consumed, consumers);
+    DAG_ASSERT(sum == (int64_t)producers * per * (per + 1) / 2);
+    DAG_LOG_INFO(g_logger) << "test_pipeline ok";
+}
+
+void test_does_not_block_thread() {
+    // 单工作线程: 接收方挂起时, 同线程的发送方协程仍能运行
+    IOManager iom(1, false, "chan1");
+    Channel<int>::ptr ch = std::make_shared<Channel<int>>(1);
+    std::atomic<int> got{0};
+    iom.schedulerLock([&]() {
+        int v;
+        DAG_ASSERT(ch->recv(v) && v == 42);
+        ++got;
+    });
+    iom.schedulerLock([&]() {
+        usleep(10 * 1000);
+        ch->send(42);
+    });
+    WaitFor(got, 1);
+    DAG_LOG_INFO(g_logger) << "test_does_not_block_thread ok";
+}
+
+void test_timeout() {
+    IOManager iom(1, false, "chan_timeout");
+    Channel<int>::ptr ch = std::make_shared<Channel<int>>(2);
+    std::atomic<int> done{0};
+    iom.schedulerLock([&]() {
+        int v;
+        uint64_t start = getElapseMs();
+        DAG_ASSERT(!ch->recv(v, 30));
+        DAG_ASSERT(getElapseMs() - start >= 25);
+        DAG_ASSERT(ch->trySend(1) && ch->trySend(2));
+        DAG_ASSERT(!ch->send(3, 20));
+        ++done;
+    });
+    WaitFor(done, 1);
+
+    // 线程中等待
+    int v;
+    DAG_ASSERT(ch->recv(v) && v == 1);
+    uint64_t start = getElapseMs();
+    DAG_ASSERT(ch->recv(v) && v == 2);
+    DAG_ASSERT(!ch->recv(v, 20));
+    DAG_ASSERT(getElapseMs() - start >= 15);
+
+    // 接收方反复被唤醒却抢不到元素, 超时仍从第一次等待算起
+    std::atomic<bool> stop{false};
+    iom.schedulerLock([&]() {
+        int v;
+        uint64_t start = getElapseMs();
+        DAG_ASSERT(!ch->recv(v, 50));
+        DAG_ASSERT(getElapseMs() - start < 150);
+        stop = true;
+        ++done;
+    });
+    iom.schedulerLock([&]() {
+        for(int i = 0; i < 50 && !stop; ++i) {
+            usleep(10 * 1000);
+            int x;
+            DAG_ASSERT(ch->trySend(i) && ch->tryRecv(x));
+        }
+        ++done;
+    });
+    WaitFor(done, 3);
+    DAG_LOG_INFO(g_logger) << "test_timeout ok";
+}
+
+void test_select() {
+    IOManager iom(2, false, "select");
+    Channel<int>::ptr a = std::make_shared<Channel<int>>(4);
+    Channel<std::string>::ptr b = std::make_shared<Channel<std::string>>();
+    Channel<int>::ptr out = std::make_shared<Channel<int>>(2);
+    std::atomic<int> done{0};
+    std::atomic<int> from_a{0};
+    std::atomic<int> from_b{0};
+    std::atomic<int> timeouts{0};
+
+    iom.schedulerLock([&]() {
+        int av = 0;
+        std::string bv;
+        bool a_open = true;
+        bool b_open = true;
+        while(a_open || b_open) {
+            Selector sel;
+            int ia = a_open ? sel.recv(a, av) : -2;
+            int ib = b_open ? sel.recv(b, bv) : -2;
+            int i = sel.select(50);
+            if(i == Selector::TIMEOUT) {
+                ++timeouts;
+            } else if(i == ia) {
+                if(sel.isOk(i)) {
+                    ++from_a;
+                } else {
+                    a_open = false;
+                }
+            } else if(i == ib) {
+                if(sel.isOk(i)) {
+                    ++from_b;
+                } else {
+                    b_open = false;
+                }
+            }
+        }
+        ++done;
+    });
+    iom.schedulerLock([&]() {
+        for(int i = 0; i < 100; ++i) {
+            a->send(i);
+        }
+        a->close();
+    });
+    iom.schedulerLock([&]() {
+        for(int i = 0; i < 100; ++i) {
+            b->send(std::to_string(i));
+        }
+        // 让select至少超时一次
+        usleep(80 * 1000);
+        b->close();
+    });
+    WaitFor(done, 1);
+    DAG_ASSERT(from_a == 100 && from_b == 100);
+    DAG_ASSERT(timeouts >= 1);
+
+    // 发送分支: 满时等待, 被接收后完成
+    iom.schedulerLock([&]() {
+        DAG_ASSERT(out->trySend(1) && out->trySend(2));
+        Selector sel;
+        int is = sel.send(out, 3);
+        DAG_ASSERT(sel.select(0) == Selector::TIMEOUT);
+        DAG_ASSERT(sel.select() == is && sel.isOk(is));
+        ++done;
+    });
+    iom.schedulerLock([&]() {
+        usleep(10 * 1000);
+        int v;
+        DAG_ASSERT(out->recv(v) && v == 1);
+    });
+    WaitFor(done, 2);
+    DAG_LOG_INFO(g_logger) << "test_select ok timeouts=" << timeouts;
+}
+
+void test_select_many_waiters() {
+    // 多个协程同时select同一组通道, 每个元素只被一个协程收到, 不会有协程漏掉唤醒
+    IOManager iom(2, false, "select_many");
+    Channel<int>::ptr a = std::make_shared<Channel<int>>(2);
+    Channel<int>::ptr b = std::make_shared<Channel<int>>(2);
+    const int total = 4000;
+    std::atomic<int> received{0};
+    std::atomic<int> done{0};
+    for(int f = 0; f < 8; ++f) {
+        iom.schedulerLock([&]() {
+            int av;
+            int bv;
+            bool a_open = true;
+            bool b_open = true;
+            while(a_open || b_open) {
+                Selector sel;
+                int ia = a_open ? sel.recv(a, av) : -2;
+                if(b_open) {
+                    sel.recv(b, bv);
+                }
+                int i = sel.select();
+                if(sel.isOk(i)) {
+                    ++received;
+                } else if(i == ia) {
+                    a_open = false;
+                } else {
+                    b_open = false;
+                }
+            }
+            ++done;
+        });
+    }
+    iom.schedulerLock([&]() {
+        for(int i = 0; i < total / 2; ++i) {
+            a->send(i);
+        }
+        a->close();
+    });
+    iom.schedulerLock([&]() {
+        for(int i = 0; i < total / 2; ++i) {
+            b->send(i);
+        }
+        b->close();
+    });
+    WaitFor(done, 8);
+    DAG_ASSERT(received == total);
+    DAG_LOG_INFO(g_logger) << "test_select_many_waiters ok";
+}
+
+void test_timer_channel() {
+    IOManager iom(1, false, "timer_chan");
+    Channel<int>::ptr never = std::make_shared<Channel<int>>(2);
+    std::atomic<int> done{0};
+    iom.schedulerLock([&]() {
+        Channel<uint64_t>::ptr timer = NewTimerChannel(30);
+        uint64_t start = getElapseMs();
+        int v;
+        uint64_t fired_at = 0;
+        Selector sel;
+        sel.recv(never, v);
+        int it = sel.recv(timer, fired_at);
+        DAG_ASSERT(sel.select() == it && sel.isOk(it));
+        DAG_ASSERT(fired_at >= start + 25);
+        // 定时器通道只发送一次, 之后关闭
+        DAG_ASSERT(!timer->recv(fired_at));
+        ++done;
+    });
+    WaitFor(done, 1);
+    DAG_LOG_INFO(g_logger) << "test_timer_channel ok";
+}
+
+int main(int argc, char** argv) {
+    test_try();
+    test_pipeline();
+    test_does_not_block_thread();
+    test_timeout();
+    test_select();
+    test_select_many_waiters();
+    test_timer_channel();
+    return 0;
+}
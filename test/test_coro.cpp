@@ -0,0 +1,255 @@
+#include "coro/io.h"
+#include "coro/task.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include "utils/util.h"
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdexcept>
+#include <string.h>
+#include <thread>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+static Task<int> Add(int a, int b) {
+    co_await CoYield();
+    co_return a + b;
+}
+
+static Task<int> Sum(int n) {
+    int sum = 0;
+    for(int i = 1; i <= n; ++i) {
+        sum = co_await Add(sum, i);
+    }
+    co_return sum;
+}
+
+static Task<void> Throw() {
+    co_await CoYield();
+    throw std::runtime_error("boom");
+}
+
+static Task<std::string> Catch() {
+    try {
+        co_await Throw();
+    } catch(const std::exception& e) {
+        co_return e.what();
+    }
+    co_return "";
+}
+
+void test_task() {
+    IOManager iom(2, false, "coro");
+    DAG_ASSERT(BlockOn(Sum(100), &iom) == 5050);
+    DAG_ASSERT(BlockOn(Catch(), &iom) == "boom");
+    bool thrown = false;
+    try {
+        BlockOn(Throw(), &iom);
+    } catch(const std::runtime_error&) {
+        thrown = true;
+    }
+    DAG_ASSERT(thrown);
+    DAG_LOG_INFO(g_logger) << "test_task ok";
+}
+
+static Task<uint64_t> Sleep(uint64_t ms) {
+    uint64_t start = getElapseMs();
+    co_await SleepFor(ms);
+    co_return getElapseMs() - start;
+}
+
+static Task<void> SleepMany(int n, std::atomic<int>& done) {
+    co_await SleepFor(20);
+    if(++done == n) {
+        co_return;
+    }
+}
+
+void test_sleep() {
+    IOManager iom(1, false, "coro_sleep");
+    DAG_ASSERT(BlockOn(Sleep(30), &iom) >= 25);
+
+    // 大量挂起中的协程只占协程帧, 不占协程栈
+    const int n = 10000;
+    std::atomic<int> done{0};
+    for(int i = 0; i < n; ++i) {
+        CoSpawn(SleepMany(n, done), &iom);
+    }
+    while(done < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    DAG_LOG_INFO(g_logger) << "test_sleep ok";
+}
+
+static Task<void> Echo(int fd) {
+    char buf[256];
+    while(true) {
+        ssize_t n = co_await AsyncRead(fd, buf, sizeof(buf));
+        if(n <= 0) {
+            break;
+        }
+        size_t off = 0;
+        while(off < (size_t)n) {
+            ssize_t w = co_await AsyncWrite(fd, buf + off, n - off);
+            DAG_ASSERT(w > 0);
+            off += w;
+        }
+    }
+    CoClose(fd);
+}
+
+static Task<std::string> Request(int fd, std::string msg) {
+    DAG_ASSERT(co_await AsyncWrite(fd, msg.data(), msg.size()) == (ssize_t)msg.size());
+    std::string reply;
+    char buf[256];
+    while(reply.size() < msg.size()) {
+        ssize_t n = co_await AsyncRead(fd, buf, sizeof(buf));
+        if(n <= 0) {
+            break;
+        }
+        reply.append(buf, n);
+    }
+    co_return reply;
+}
+
+void test_socketpair_echo() {
+    IOManager iom(2, false, "coro_echo");
+    int fds[2];
+    DAG_ASSERT(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+    CoSpawn(Echo(fds[1]), &iom);
+    for(int i = 0; i < 100; ++i) {
+        std::string msg = "hello " + std::to_string(i);
+        DAG_ASSERT(BlockOn(Request(fds[0], msg), &iom) == msg);
+    }
+    close(fds[0]);
+    DAG_LOG_INFO(g_logger) << "test_socketpair_echo ok";
+}
+
+static Task<int> ReadTimeout(int fd) {
+    char c;
+    ssize_t n = co_await AsyncRead(fd, &c, 1, 30);
+    co_return n == -1 ? errno : 0;
+}
+
+void test_timeout() {
+    IOManager iom(1, false, "coro_timeout");
+    int fds[2];
+    DAG_ASSERT(socketpair(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0, fds) == 0);
+    uint64_t start = getElapseMs();
+    DAG_ASSERT(BlockOn(ReadTimeout(fds[0]), &iom) == ETIMEDOUT);
+    DAG_ASSERT(getElapseMs() - start >= 25);
+    // 超时之后同一个fd还能继续等待
+    DAG_ASSERT(write(fds[1], "x", 1) == 1);
+    DAG_ASSERT(BlockOn(ReadTimeout(fds[0]), &iom) == 0);
+    close(fds[0]);
+    close(fds[1]);
+    DAG_LOG_INFO(g_logger) << "test_timeout ok";
+}
+
+static Task<int> Wait(int fd) {
+    co_return co_await WaitEvent(fd, IOManager::READ, 30);
+}
+
+void test_wait_error() {
+    IOManager iom(1, false, "coro_wait_error");
+    // 普通文件不能加入epoll, 等待立即失败而不是当作就绪
+    int fd = open("/dev/null", O_RDONLY);
+    DAG_ASSERT(fd >= 0);
+    DAG_ASSERT(BlockOn(Wait(fd), &iom) == EINVAL);
+    close(fd);
+    DAG_LOG_INFO(g_logger) << "test_wait_error ok";
+}
+
+static Task<void> AcceptLoop(int listen_fd, int count) {
+    for(int i = 0; i < count; ++i) {
+        int client = co_await AsyncAccept(listen_fd);
+        DAG_ASSERT(client >= 0);
+        CoSpawn(Echo(client));
+    }
+}
+
+static Task<std::string> Connect(sockaddr_in addr, std::string msg) {
+    int fd = CoSocket(AF_INET, SOCK_STREAM);
+    int rt = co_await AsyncConnect(fd, (sockaddr*)&addr, sizeof(addr), 1000);
+    DAG_ASSERT(rt == 0);
+    std::string reply = co_await Request(fd, msg);
+    CoClose(fd);
+    co_return reply;
+}
+
+void test_tcp() {
+    IOManager iom(2, false, "coro_tcp");
+    int listen_fd = CoSocket(AF_INET, SOCK_STREAM);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = 0;
+    DAG_ASSERT(bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) == 0);
+    DAG_ASSERT(listen(listen_fd, 128) == 0);
+    socklen_t len = sizeof(addr);
+    DAG_ASSERT(getsockname(listen_fd, (sockaddr*)&addr, &len) == 0);
+
+    CoSpawn(AcceptLoop(listen_fd, 10), &iom);
+    for(int i = 0; i < 10; ++i) {
+        std::string msg = "tcp " + std::to_string(i);
+        DAG_ASSERT(BlockOn(Connect(addr, msg), &iom) == msg);
+    }
+    close(listen_fd);
+    DAG_LOG_INFO(g_logger) << "test_tcp ok";
+}
+
+void test_mixed_with_fiber() {
+    // 有栈协程用hook的socket/connect/read/write, 无栈协程用AsyncAccept/AsyncRead/AsyncWrite,
+    // 跑在同一个单线程IOManager上互相通信
+    IOManager iom(1, false, "coro_mixed");
+    int listen_fd = CoSocket(AF_INET, SOCK_STREAM);
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    DAG_ASSERT(bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) == 0);
+    DAG_ASSERT(listen(listen_fd, 128) == 0);
+    socklen_t len = sizeof(addr);
+    DAG_ASSERT(getsockname(listen_fd, (sockaddr*)&addr, &len) == 0);
+    CoSpawn(AcceptLoop(listen_fd, 1), &iom);
+
+    std::atomic<int> done{0};
+    iom.schedulerLock([addr, &done]() {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        DAG_ASSERT(connect(fd, (const sockaddr*)&addr, sizeof(addr)) == 0);
+        char buf[16];
+        for(int i = 0; i < 50; ++i) {
+            DAG_ASSERT(write(fd, "ping", 4) == 4);
+            size_t got = 0;
+            while(got < 4) {
+                ssize_t n = read(fd, buf + got, sizeof(buf) - got);
+                DAG_ASSERT(n > 0);
+                got += n;
+            }
+            DAG_ASSERT(memcmp(buf, "ping", 4) == 0);
+        }
+        close(fd);
+        ++done;
+    });
+    while(done < 1) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    close(listen_fd);
+    DAG_LOG_INFO(g_logger) << "test_mixed_with_fiber ok";
+}
+
+int main(int argc, char** argv) {
+    test_task();
+    test_sleep();
+    test_socketpair_echo();
+    test_timeout();
+    test_wait_error();
+    test_tcp();
+    test_mixed_with_fiber();
+    return 0;
+}
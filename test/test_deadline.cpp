@@ -0,0 +1,149 @@
+#include "fd_manager.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include "utils/util.h"
+#include <mutex>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+static void WaitFor(std::atomic<int>& v, int n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/**
+ * @brief 占住唯一的工作线程, 直到release为true
+ */
+static void Block(IOManager& iom, std::atomic<bool>& release) {
+    std::atomic<int> blocked{0};
+    iom.schedulerLock([&]() {
+        ++blocked;
+        while(!release) {
+            std::this_thread::yield();
+        }
+    });
+    WaitFor(blocked, 1);
+}
+
+void test_edf_order() {
+    IOManager iom(1, false, "edf");
+    std::atomic<bool> release{false};
+    Block(iom, release);
+
+    std::mutex mutex;
+    std::vector<int> order;
+    std::atomic<int> done{0};
+    uint64_t now = getElapseMs();
+    // 没有截止时间的排在最后, 其余按截止时间先后
+    const int offsets[] = {0, 3000, 1000, 2000};
+    for(int offset : offsets) {
+        uint64_t deadline = offset ? now + offset : 0;
+        iom.schedulerLock([&, offset, deadline]() {
+            DAG_ASSERT(Fiber::GetThis()->getDeadline() == deadline);
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(offset);
+            ++done;
+        }, -1, Fiber::STACK_DEFAULT, Fiber::PRIORITY_NORMAL, deadline);
+    }
+    DAG_ASSERT(iom.getPendingTaskCount(Fiber::PRIORITY_NORMAL) == 4);
+    release = true;
+    WaitFor(done, 4);
+    DAG_ASSERT(order == std::vector<int>({1000, 2000, 3000, 0}));
+    DAG_LOG_INFO(g_logger) << "test_edf_order ok";
+}
+
+void test_drop_expired() {
+    IOManager iom(1, false, "expire");
+    std::atomic<bool> release{false};
+    Block(iom, release);
+
+    std::atomic<int> ran_expired{0};
+    std::atomic<int> ran_live{0};
+    uint64_t now = getElapseMs();
+    iom.schedulerLock([&]() { ++ran_expired; }
+                      ,-1, Fiber::STACK_DEFAULT, Fiber::PRIORITY_NORMAL, now + 10);
+    iom.schedulerLock([&]() { ++ran_live; }
+                      ,-1, Fiber::STACK_DEFAULT, Fiber::PRIORITY_NORMAL, now + 10000);
+    usleep(30 * 1000);
+    release = true;
+    WaitFor(ran_live, 1);
+    DAG_ASSERT(ran_expired == 0);
+    DAG_ASSERT(iom.getExpiredTaskCount() == 1);
+    DAG_LOG_INFO(g_logger) << "test_drop_expired ok";
+}
+
+void test_io_timeout() {
+    IOManager iom(1, false, "deadline_io");
+    int sv[2];
+    DAG_ASSERT(socketpair(AF_UNIX, SOCK_STREAM, 0, sv) == 0);
+    std::atomic<int> done{0};
+    iom.schedulerLock([&]() {
+        // socketpair不经过hook, 登记后hook的read才会挂起协程
+        FdMgr::GetInstance()->get(sv[0], true);
+        char buf[16];
+        uint64_t start = getElapseMs();
+        Fiber::GetThis()->setDeadline(start + 50);
+        // 没有数据, 最多等到截止时间
+        ssize_t n = read(sv[0], buf, sizeof(buf));
+        uint64_t elapsed = getElapseMs() - start;
+        DAG_ASSERT(n == -1 && errno == ETIMEDOUT);
+        DAG_ASSERT(elapsed >= 45 && elapsed < 500);
+        DAG_ASSERT(Fiber::GetThis()->isDeadlineExpired());
+
+        // 过期后即使有数据也立即失败
+        write(sv[1], "x", 1);
+        n = read(sv[0], buf, sizeof(buf));
+        DAG_ASSERT(n == -1 && errno == ETIMEDOUT);
+        n = send(sv[0], "y", 1, 0);
+        DAG_ASSERT(n == -1 && errno == ETIMEDOUT);
+
+        // 去掉截止时间后恢复正常
+        Fiber::GetThis()->setDeadline(0);
+        n = read(sv[0], buf, sizeof(buf));
+        DAG_ASSERT(n == 1 && buf[0] == 'x');
+        ++done;
+    });
+    WaitFor(done, 1);
+    close(sv[0]);
+    close(sv[1]);
+    DAG_LOG_INFO(g_logger) << "test_io_timeout ok";
+}
+
+void test_expired_fiber_runs() {
+    // 过期的协程任务不会被丢弃, 恢复后由IO返回ETIMEDOUT结束
+    IOManager iom(1, false, "expire_fiber");
+    std::atomic<int> parked{0};
+    std::atomic<int> done{0};
+    Fiber::ptr fiber;
+    iom.schedulerLock([&]() {
+        fiber = Fiber::GetThis();
+        fiber->setDeadline(getElapseMs() + 10);
+        ++parked;
+        Fiber::GetThis()->yield();
+        DAG_ASSERT(Fiber::GetThis()->isDeadlineExpired());
+        ++done;
+    });
+    WaitFor(parked, 1);
+    usleep(30 * 1000);
+    iom.schedulerLock(fiber);
+    fiber.reset();
+    WaitFor(done, 1);
+    DAG_ASSERT(iom.getExpiredTaskCount() == 0);
+    DAG_LOG_INFO(g_logger) << "test_expired_fiber_runs ok";
+}
+
+int main(int argc, char** argv) {
+    test_edf_order();
+    test_drop_expired();
+    test_io_timeout();
+    test_expired_fiber_runs();
+    return 0;
+}
@@ -0,0 +1,195 @@
+#include "hook.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include "utils/util.h"
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+static void WaitFor(std::atomic<int>& v, int n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/**
+ * @brief 等待工作线程数变为n, 超时返回false
+ */
+static bool WaitWorkers(Scheduler& s, size_t n, uint64_t timeout_ms) {
+    uint64_t start = getElapseMs();
+    while(s.getWorkerCount() != n) {
+        if(getElapseMs() - start > timeout_ms) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+/**
+ * @brief 阻塞整个工作线程ms毫秒, 模拟没有被hook的阻塞调用
+ */
+static void BlockThread(uint64_t ms) {
+    set_hook_enable(false);
+    usleep(ms * 1000);
+    set_hook_enable(true);
+}
+
+static Scheduler::ElasticPolicy Policy(size_t min_threads, size_t max_threads) {
+    Scheduler::ElasticPolicy policy;
+    policy.min_threads = min_threads;
+    policy.max_threads = max_threads;
+    policy.max_queue_wait_us = 5000;
+    policy.scale_up_ms = 10;
+    policy.cooldown_ms = 100;
+    return policy;
+}
+
+void test_grow_and_shrink() {
+    IOManager iom(1, false, "elastic");
+    iom.setElastic(Policy(1, 4));
+    const int count = 16;
+    std::atomic<int> done{0};
+    uint64_t start = getElapseMs();
+    for(int i = 0; i < count; ++i) {
+        iom.schedulerLock([&]() {
+            BlockThread(50);
+            ++done;
+        });
+    }
+    size_t peak = 1;
+    std::set<int> seen;
+    while(done < count) {
+        peak = std::max(peak, iom.getWorkerCount());
+        for(size_t i = 0; i < iom.getWorkerCount(); ++i) {
+            seen.insert(iom.getWorkerThreadId(i));
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+    uint64_t elapsed = getElapseMs() - start;
+    // 一个线程需要800ms
+    DAG_ASSERT(peak > 1 && peak <= 4);
+    DAG_ASSERT(elapsed < 600);
+
+    // 负载消失后逐个退出, 回到下限
+    DAG_ASSERT(WaitWorkers(iom, 1, 3000));
+    Scheduler::ElasticStats stats = iom.getElasticStats();
+    DAG_ASSERT(stats.workers == 1);
+    DAG_ASSERT(stats.scale_ups == peak - 1);
+    DAG_ASSERT(stats.scale_downs == peak - 1);
+    DAG_ASSERT(stats.events.size() == 2 * (peak - 1));
+    DAG_ASSERT(stats.events.front().from == 1 && stats.events.front().to == 2);
+    DAG_ASSERT(stats.events.back().to == 1);
+    uint64_t waited = 0;
+    uint64_t slow = 0;
+    for(size_t i = 0; i < Scheduler::WAIT_BUCKETS; ++i) {
+        waited += stats.wait_buckets[i];
+        // 排队超过8ms的任务
+        slow += i > 13 ? stats.wait_buckets[i] : 0;
+    }
+    DAG_ASSERT(waited >= count);
+    DAG_ASSERT(slow > 0);
+
+    // 缩容后仍能正常调度, 包括指定线程的任务
+    std::atomic<int> after{0};
+    for(int i = 0; i < 10; ++i) {
+        iom.schedulerLock([&]() { ++after; }, iom.getWorkerThreadId(0));
+    }
+    WaitFor(after, 10);
+
+    // 指定给已退出线程的任务按任意线程执行
+    seen.erase(-1);
+    seen.erase(iom.getWorkerThreadId(0));
+    DAG_ASSERT(!seen.empty());
+    iom.schedulerLock([&]() { ++after; }, *seen.begin());
+    WaitFor(after, 11);
+    for(auto& e : stats.events) {
+        DAG_LOG_INFO(g_logger) << "scale " << e.from << " -> " << e.to << ": " << e.reason;
+    }
+    DAG_LOG_INFO(g_logger) << "test_grow_and_shrink ok peak=" << peak << " elapsed=" << elapsed << "ms";
+}
+
+void test_min_threads() {
+    IOManager iom(1, false, "elastic_min");
+    // 下限高于当前线程数时不等饱和直接补齐
+    iom.setElastic(Policy(3, 4));
+    DAG_ASSERT(WaitWorkers(iom, 3, 1000));
+    usleep(300 * 1000);
+    DAG_ASSERT(iom.getWorkerCount() == 3);
+    DAG_ASSERT(iom.getElasticStats().scale_downs == 0);
+    DAG_LOG_INFO(g_logger) << "test_min_threads ok";
+}
+
+void test_pinned_not_retired() {
+    // 共享栈协程挂起在扩容出来的线程上, 这些线程要等协程结束才能退出
+    IOManager iom(1, false, "elastic_pin");
+    iom.setElastic(Policy(1, 3));
+    std::atomic<int> blocked{0};
+    for(int i = 0; i < 6; ++i) {
+        iom.schedulerLock([&]() {
+            BlockThread(50);
+            ++blocked;
+        });
+    }
+    const int count = 30;
+    std::mutex mutex;
+    std::vector<Fiber::ptr> parked;
+    std::atomic<int> started{0};
+    std::atomic<int> done{0};
+    std::atomic<int> bad{0};
+    for(int i = 0; i < count; ++i) {
+        iom.schedulerLock([&]() {
+            uint32_t tid = getThreadId();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                parked.push_back(Fiber::GetThis());
+            }
+            ++started;
+            Fiber::GetThis()->yield();
+            if(getThreadId() != tid) {
+                ++bad;
+            }
+            ++done;
+        }, -1, Fiber::STACK_SHARED);
+    }
+    WaitFor(blocked, 6);
+    WaitFor(started, count);
+    size_t workers = iom.getWorkerCount();
+    DAG_ASSERT(workers > 1);
+    // 几个冷却期过去, 绑定了协程的线程都还在
+    usleep(500 * 1000);
+    std::set<int> pinned;
+    for(auto& i : parked) {
+        pinned.insert(i->getPinnedThread());
+    }
+    std::set<int> alive;
+    for(size_t i = 0; i < iom.getWorkerCount(); ++i) {
+        alive.insert(iom.getWorkerThreadId(i));
+    }
+    for(int tid : pinned) {
+        DAG_ASSERT(alive.count(tid) == 1);
+    }
+    for(auto& i : parked) {
+        iom.schedulerLock(i);
+    }
+    parked.clear();
+    WaitFor(done, count);
+    DAG_ASSERT(bad == 0);
+    // 协程结束后多余的线程可以退出
+    DAG_ASSERT(WaitWorkers(iom, 1, 3000));
+    DAG_LOG_INFO(g_logger) << "test_pinned_not_retired ok workers=" << workers << " pinned=" << pinned.size();
+}
+
+int main(int argc, char** argv) {
+    test_grow_and_shrink();
+    test_min_threads();
+    test_pinned_not_retired();
+    return 0;
+}
@@ -0,0 +1,140 @@
+#include "fiber_local.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include <thread>
+#include <unistd.h>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+static void WaitFor(std::atomic<int>& v, int n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+static std::atomic<int> s_live{0};
+
+struct Tracked {
+    Tracked() { ++s_live;}
+    ~Tracked() { --s_live;}
+    int value = 0;
+};
+
+static FiberLocal<std::string> s_trace_id;
+static FiberLocal<int> s_tenant(-1);
+
+void test_isolation() {
+    // 单工作线程上多个协程交替运行, thread_local会互相覆盖, FiberLocal不会
+    IOManager iom(1, false, "local");
+    std::atomic<int> done{0};
+    std::atomic<bool> mismatch{false};
+    for(int f = 0; f < 10; ++f) {
+        iom.schedulerLock([&, f]() {
+            DAG_ASSERT(!s_trace_id.has());
+            DAG_ASSERT(*s_tenant == -1);
+            s_trace_id = "trace-" + std::to_string(f);
+            s_tenant = f;
+            for(int i = 0; i < 5; ++i) {
+                // 让出, 其他协程在同一线程上改写自己的值
+                usleep(1000);
+                if(*s_trace_id != "trace-" + std::to_string(f) || *s_tenant != f) {
+                    mismatch = true;
+                }
+            }
+            ++done;
+        });
+    }
+    WaitFor(done, 10);
+    DAG_ASSERT(!mismatch);
+    DAG_LOG_INFO(g_logger) << "test_isolation ok";
+}
+
+void test_lifetime() {
+    IOManager iom(2, false, "local_life");
+    FiberLocal<Tracked> local;
+    std::atomic<int> done{0};
+    for(int f = 0; f < 20; ++f) {
+        iom.schedulerLock([&]() {
+            local->value = 1;
+            DAG_ASSERT(local.has());
+            ++done;
+        });
+    }
+    WaitFor(done, 20);
+    // 协程结束时销毁, 等最后一个协程的MainFunc收尾
+    for(int i = 0; i < 100 && s_live != 0; ++i) {
+        usleep(1000);
+    }
+    DAG_ASSERT(s_live == 0);
+
+    // reset()立即销毁, 再次访问重新构造
+    iom.schedulerLock([&]() {
+        local->value = 5;
+        local.reset();
+        DAG_ASSERT(!local.has() && s_live == 0);
+        DAG_ASSERT(local->value == 0 && s_live == 1);
+        ++done;
+    });
+    WaitFor(done, 21);
+    DAG_LOG_INFO(g_logger) << "test_lifetime ok";
+}
+
+void test_fiber_reset() {
+    FiberLocal<Tracked> local;
+    Fiber::GetThis();
+    Fiber::ptr fiber = std::make_shared<Fiber>([&local]() {
+        local->value = 7;
+    }, 0, false);
+    fiber->resume();
+    DAG_ASSERT(fiber->getState() == Fiber::TERM);
+    DAG_ASSERT(s_live == 0);
+
+    // 协程让出期间值保留, 结束时销毁; reset复用后看到的是全新的局部变量
+    Fiber::ptr held = std::make_shared<Fiber>([&local]() {
+        local->value = 8;
+        Fiber::GetThis()->yield();
+    }, 0, false);
+    held->resume();
+    DAG_ASSERT(s_live == 1);
+    held->resume();
+    DAG_ASSERT(held->getState() == Fiber::TERM && s_live == 0);
+    held->reset([&local]() {
+        DAG_ASSERT(!local.has());
+    });
+    held->resume();
+    held.reset();
+    DAG_ASSERT(s_live == 0);
+    DAG_LOG_INFO(g_logger) << "test_fiber_reset ok";
+}
+
+void test_thread_fallback() {
+    // 不在协程中时, 值挂在线程主协程上, 线程之间相互独立
+    FiberLocal<int> local(3);
+    local = 10;
+    std::thread t([&local]() {
+        DAG_ASSERT(*local == 3);
+        local = 20;
+    });
+    t.join();
+    DAG_ASSERT(*local == 10);
+
+    // 已销毁的FiberLocal留下的旧值不会被复用同一下标的新FiberLocal读到
+    {
+        FiberLocal<int> old;
+        old = 42;
+    }
+    FiberLocal<int> reused;
+    DAG_ASSERT(!reused.has() && *reused == 0);
+    DAG_LOG_INFO(g_logger) << "test_thread_fallback ok";
+}
+
+int main(int argc, char** argv) {
+    test_isolation();
+    test_lifetime();
+    test_fiber_reset();
+    test_thread_fallback();
+    return 0;
+}
@@ -0,0 +1,219 @@
+#include "fiber_mutex.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include <shared_mutex>
+#include <thread>
+#include <unistd.h>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+static void WaitFor(std::atomic<int>& v, int n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+void test_mutex_counter() {
+    IOManager iom(2, false, "mutex");
+    FiberMutex mutex;
+    int counter = 0;
+    std::atomic<int> done{0};
+    for(int f = 0; f < 50; ++f) {
+        iom.schedulerLock([&, f]() {
+            for(int i = 0; i < 200; ++i) {
+                std::lock_guard<FiberMutex> lock(mutex);
+                int v = counter;
+                if(i % 50 == f % 50) {
+                    // 持锁期间让出, 制造竞争
+                    usleep(100);
+                }
+                counter = v + 1;
+            }
+            ++done;
+        });
+    }
+    WaitFor(done, 50);
+    DAG_ASSERT(counter == 50 * 200);
+    DAG_LOG_INFO(g_logger) << "test_mutex_counter ok";
+}
+
+void test_mutex_does_not_block_thread() {
+    // 只有一个工作线程: 持锁协程在hook的usleep中挂起时, 同线程的其他协程仍能运行, 等锁的协程挂起而不是阻塞线程
+    IOManager iom(1, false, "mutex1");
+    FiberMutex mutex;
+    std::atomic<int> step{0};
+    std::atomic<bool> other_ran{false};
+    iom.schedulerLock([&]() {
+        std::lock_guard<FiberMutex> lock(mutex);
+        ++step;
+        usleep(50 * 1000);
+        DAG_ASSERT(other_ran);
+    });
+    iom.schedulerLock([&]() {
+        // 等锁, 挂起
+        std::lock_guard<FiberMutex> lock(mutex);
+        ++step;
+    });
+    iom.schedulerLock([&]() {
+        other_ran = true;
+    });
+    WaitFor(step, 2);
+    DAG_LOG_INFO(g_logger) << "test_mutex_does_not_block_thread ok";
+}
+
+void test_mutex_from_thread() {
+    // 不在调度器中的线程等锁时退化为阻塞线程
+    IOManager iom(1, false, "mutex_thread");
+    FiberMutex mutex;
+    std::atomic<int> locked{0};
+    iom.schedulerLock([&]() {
+        mutex.lock();
+        ++locked;
+        usleep(20 * 1000);
+        mutex.unlock();
+    });
+    WaitFor(locked, 1);
+    DAG_ASSERT(!mutex.try_lock());
+    mutex.lock();
+    mutex.unlock();
+    DAG_LOG_INFO(g_logger) << "test_mutex_from_thread ok";
+}
+
+void test_condvar() {
+    IOManager iom(2, false, "condvar");
+    FiberMutex mutex;
+    FiberCondVar cond;
+    std::deque<int> queue;
+    const int total = 1000;
+    std::atomic<int> consumed{0};
+    std::atomic<int> sum{0};
+    for(int c = 0; c < 4; ++c) {
+        iom.schedulerLock([&]() {
+            while(true) {
+                mutex.lock();
+                cond.wait(mutex, [&]() { return !queue.empty(); });
+                int v = queue.front();
+                queue.pop_front();
+                mutex.unlock();
+                if(v < 0) {
+                    break;
+                }
+                sum += v;
+                ++consumed;
+            }
+        });
+    }
+    iom.schedulerLock([&]() {
+        for(int i = 1; i <= total; ++i) {
+            std::lock_guard<FiberMutex> lock(mutex);
+            queue.push_back(i);
+            cond.notify_one();
+        }
+        std::lock_guard<FiberMutex> lock(mutex);
+        for(int c = 0; c < 4; ++c) {
+            queue.push_back(-1);
+        }
+        cond.notify_all();
+    });
+    WaitFor(consumed, total);
+    DAG_ASSERT(sum == total * (total + 1) / 2);
+    DAG_LOG_INFO(g_logger) << "test_condvar ok";
+}
+
+void test_semaphore() {
+    IOManager iom(2, false, "sem");
+    FiberSemaphore sem(3);
+    std::atomic<int> inside{0};
+    std::atomic<int> max_inside{0};
+    std::atomic<int> done{0};
+    for(int f = 0; f < 20; ++f) {
+        iom.schedulerLock([&]() {
+            sem.wait();
+            int n = ++inside;
+            int m = max_inside;
+            while(n > m && !max_inside.compare_exchange_weak(m, n)) {
+            }
+            usleep(2000);
+            --inside;
+            sem.post();
+            ++done;
+        });
+    }
+    WaitFor(done, 20);
+    DAG_ASSERT(max_inside <= 3 && max_inside >= 1);
+    DAG_ASSERT(sem.getCount() == 3);
+    DAG_ASSERT(sem.tryWait() && sem.getCount() == 2);
+
+    // 先post后wait不会丢失
+    FiberSemaphore zero(0);
+    std::atomic<int> got{0};
+    iom.schedulerLock([&]() {
+        zero.wait();
+        ++got;
+    });
+    usleep(10 * 1000);
+    zero.post();
+    WaitFor(got, 1);
+    DAG_LOG_INFO(g_logger) << "test_semaphore ok max_inside=" << max_inside;
+}
+
+void test_rwlock() {
+    IOManager iom(2, false, "rwlock");
+    FiberRWLock rw;
+    std::atomic<int> readers{0};
+    std::atomic<int> writers{0};
+    std::atomic<int> max_readers{0};
+    std::atomic<bool> violated{false};
+    std::atomic<int> done{0};
+    int value = 0;
+    for(int f = 0; f < 20; ++f) {
+        bool writer = (f % 5 == 0);
+        iom.schedulerLock([&, writer]() {
+            for(int i = 0; i < 20; ++i) {
+                if(writer) {
+                    std::unique_lock<FiberRWLock> lock(rw);
+                    if(++writers != 1 || readers != 0) {
+                        violated = true;
+                    }
+                    ++value;
+                    usleep(200);
+                    --writers;
+                } else {
+                    std::shared_lock<FiberRWLock> lock(rw);
+                    int n = ++readers;
+                    if(writers != 0) {
+                        violated = true;
+                    }
+                    int m = max_readers;
+                    while(n > m && !max_readers.compare_exchange_weak(m, n)) {
+                    }
+                    usleep(200);
+                    --readers;
+                }
+            }
+            ++done;
+        });
+    }
+    WaitFor(done, 20);
+    DAG_ASSERT(!violated);
+    DAG_ASSERT(value == 4 * 20);
+    DAG_ASSERT(rw.try_lock());
+    DAG_ASSERT(!rw.try_lock_shared());
+    rw.unlock();
+    DAG_ASSERT(rw.try_lock_shared());
+    rw.unlock_shared();
+    DAG_LOG_INFO(g_logger) << "test_rwlock ok max_readers=" << max_readers;
+}
+
+int main(int argc, char** argv) {
+    test_mutex_counter();
+    test_mutex_does_not_block_thread();
+    test_mutex_from_thread();
+    test_condvar();
+    test_semaphore();
+    test_rwlock();
+    return 0;
+}
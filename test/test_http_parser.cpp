@@ -0,0 +1,167 @@
+#include "http/http_parser.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include <cstring>
+
+static dag::Logger::ptr g_logger = DAG_LOG_ROOT();
+
+using namespace dag::http;
+
+static const char s_request[] =
+    "POST /api/echo?name=dag#top HTTP/1.1\r\n"
+    "Host: 127.0.0.1:8020\r\n"
+    "Content-Length: 11\r\n"
+    "X-Multi: a\r\n"
+    "X-Multi: b\r\n"
+    "\r\n"
+    "hello world";
+
+void test_split() {
+    // 在每一个可能的位置切分成两段喂给解析器，结果都应该一致
+    size_t len = strlen(s_request);
+    for(size_t split = 0; split <= len; ++split) {
+        HttpRequestParser parser;
+        size_t n = parser.execute(s_request, split);
+        DAG_ASSERT(n == split);
+        n += parser.execute(s_request + split, len - split);
+        DAG_ASSERT(n == len);
+        DAG_ASSERT(parser.isFinished());
+        HttpRequest::ptr req = parser.getData();
+        DAG_ASSERT(req->getMethod() == HttpMethod::POST);
+        DAG_ASSERT(req->getPath() == "/api/echo");
+        DAG_ASSERT(req->getQuery() == "name=dag");
+        DAG_ASSERT(req->getFragment() == "top");
+        DAG_ASSERT(req->getHeader("host") == "127.0.0.1:8020");
+        DAG_ASSERT(req->getHeader("x-multi") == "a, b");
+        DAG_ASSERT(req->getBody() == "hello world");
+        DAG_ASSERT(!req->isClose());
+    }
+
+    // 从ByteArray解析时token跨越内存块边界
+    for(size_t node = 1; node <= 64; ++node) {
+        dag::ByteArray::ptr ba(new dag::ByteArray(node));
+        ba->write(s_request, len);
+        ba->setPosition(0);
+        HttpRequestParser parser;
+        DAG_ASSERT(parser.execute(ba) == len && parser.isFinished());
+        HttpRequest::ptr req = parser.getData();
+        DAG_ASSERT(req->getPath() == "/api/echo" && req->getQuery() == "name=dag");
+        DAG_ASSERT(req->getHeader("content-length") == "11");
+        DAG_ASSERT(req->getHeader("x-multi") == "a, b");
+        DAG_ASSERT(req->getBody() == "hello world");
+    }
+    DAG_LOG_INFO(g_logger) << "test_split ok";
+}
+
+void test_pipeline() {
+    std::string data = "GET /a HTTP/1.1\r\n\r\n"
+                       "GET /b HTTP/1.0\r\n\r\n"
+                       "GET /c HTTP/1.1\r\nConnection: close\r\n\r\n";
+    dag::ByteArray::ptr ba(new dag::ByteArray(7));
+    ba->writeStringWithoutLength(data);
+    ba->setPosition(0);
+
+    const char* paths[] = {"/a", "/b", "/c"};
+    bool closes[] = {false, true, true};
+    HttpRequestParser parser;
+    for(int i = 0; i < 3; ++i) {
+        parser.reset();
+        parser.execute(ba);
+        DAG_ASSERT(parser.isFinished());
+        DAG_ASSERT(parser.getData()->getPath() == paths[i]);
+        DAG_ASSERT(parser.getData()->isClose() == closes[i]);
+    }
+    DAG_ASSERT(ba->getReadSize() == 0);
+    DAG_LOG_INFO(g_logger) << "test_pipeline ok";
+}
+
+void test_chunked() {
+    std::string data = "PUT /upload HTTP/1.1\r\n"
+                       "Transfer-Encoding: chunked\r\n\r\n"
+                       "5;ext=1\r\nhello\r\n"
+                       "6\r\n world\r\n"
+                       "0\r\nX-Trailer: t\r\n\r\n"
+                       "GET /next HTTP/1.1\r\n\r\n";
+    HttpRequestParser parser;
+    size_t consumed = 0;
+    // 逐字节喂入
+    while(!parser.isFinished() && !parser.hasError()) {
+        consumed += parser.execute(data.c_str() + consumed, 1);
+    }
+    DAG_ASSERT(parser.isFinished());
+    DAG_ASSERT(parser.getData()->isChunked());
+    DAG_ASSERT(parser.getData()->getBody() == "hello world");
+    DAG_ASSERT(data.compare(consumed, std::string::npos, "GET /next HTTP/1.1\r\n\r\n") == 0);
+    DAG_LOG_INFO(g_logger) << "test_chunked ok";
+}
+
+void test_errors() {
+    {
+        HttpRequestParser parser;
+        const char* bad = "BREW /pot HTTP/1.1\r\n\r\n";
+        parser.execute(bad, strlen(bad));
+        DAG_ASSERT(parser.hasError());
+        DAG_ASSERT(parser.getErrorStatus() == HttpStatus::NOT_IMPLEMENTED);
+    }
+    {
+        HttpRequestParser parser;
+        const char* bad = "GET / HTTP/2.0\r\n\r\n";
+        parser.execute(bad, strlen(bad));
+        DAG_ASSERT(parser.getErrorStatus() == HttpStatus::HTTP_VERSION_NOT_SUPPORTED);
+    }
+    {
+        HttpRequestParser parser;
+        std::string big = "GET / HTTP/1.1\r\nX-Big: " + std::string(16 * 1024, 'x') + "\r\n\r\n";
+        parser.execute(big.c_str(), big.size());
+        DAG_ASSERT(parser.getErrorStatus() == HttpStatus::REQUEST_HEADER_FIELDS_TOO_LARGE);
+    }
+    {
+        HttpRequestParser parser;
+        const char* bad = "POST / HTTP/1.1\r\nContent-Length: 12abc\r\n\r\n";
+        parser.execute(bad, strlen(bad));
+        DAG_ASSERT(parser.getErrorStatus() == HttpStatus::BAD_REQUEST);
+    }
+    {
+        HttpRequestParser parser;
+        const char* bad = "POST / HTTP/1.1\r\nContent-Length: -1\r\n\r\n";
+        parser.execute(bad, strlen(bad));
+        DAG_ASSERT(parser.getErrorStatus() == HttpStatus::BAD_REQUEST);
+    }
+    // chunk大小: 带符号、0x前缀的拒绝; 过大的不能因为累加回绕而通过检查
+    const char* chunks[][2] = {
+        {"-1", "bad"},
+        {"+5", "bad"},
+        {"0x5", "bad"},
+        {"ffffffffffffffff", "large"},
+        {"10000000000000000", "large"},
+    };
+    for(auto& c : chunks) {
+        HttpRequestParser parser;
+        std::string req = std::string("POST / HTTP/1.1\r\nTransfer-Encoding: chunked\r\n\r\n")
+                          + "5\r\nhello\r\n" + c[0] + "\r\nxyz\r\n0\r\n\r\n";
+        parser.execute(req.c_str(), req.size());
+        DAG_ASSERT(parser.hasError() && !parser.isFinished());
+        DAG_ASSERT(parser.getErrorStatus() == (strcmp(c[1], "bad") == 0
+                   ? HttpStatus::BAD_REQUEST : HttpStatus::PAYLOAD_TOO_LARGE));
+    }
+    DAG_LOG_INFO(g_logger) << "test_errors ok";
+}
+
+void test_response() {
+    HttpResponse rsp(0x11, false);
+    rsp.setHeader("Content-Type", "text/plain");
+    rsp.setBody("pong");
+    std::string s = rsp.toString();
+    DAG_ASSERT(s.compare(0, 17, "HTTP/1.1 200 OK\r\n") == 0);
+    DAG_ASSERT(s.find("content-length: 4\r\n\r\npong") != std::string::npos);
+    DAG_LOG_INFO(g_logger) << "test_response ok";
+}
+
+int main() {
+    test_split();
+    test_pipeline();
+    test_chunked();
+    test_errors();
+    test_response();
+    return 0;
+}
@@ -0,0 +1,40 @@
+#include "http/http_server.h"
+#include "ioscheduler.h"
+#include "logger.h"
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+void run() {
+    http::HttpServer::ptr server(new http::HttpServer(true));
+    auto sd = server->getServletDispatch();
+    sd->addServlet("/ping", [](http::HttpRequest::ptr req
+                              ,http::HttpResponse::ptr rsp
+                              ,http::HttpSession::ptr session) {
+        rsp->setHeader("Content-Type", "text/plain");
+        rsp->setBody("pong");
+        return 0;
+    });
+    sd->addGlobServlet("/echo/*", [](http::HttpRequest::ptr req
+                              ,http::HttpResponse::ptr rsp
+                              ,http::HttpSession::ptr session) {
+        rsp->setHeader("Content-Type", "text/plain");
+        rsp->setBody(req->toString());
+        return 0;
+    });
+
+    Address::ptr addr = Address::LookupAnyIPAddress("0.0.0.0:8020");
+    while(!server->bind(addr)) {
+        sleep(2);
+    }
+    DAG_LOG_INFO(g_logger) << "http server listening on " << addr->toString()
+                           << ", try: curl http://127.0.0.1:8020/echo/hello";
+    server->start();
+}
+
+int main() {
+    IOManager iom(2);
+    iom.schedulerLock(run);
+    return 0;
+}
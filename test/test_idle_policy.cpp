@@ -0,0 +1,93 @@
+#include "ioscheduler.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include <thread>
+#include <unistd.h>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+static std::atomic<int> s_done{0};
+
+/**
+ * @brief 以gap_us的间隔逐个提交n个任务, 每个任务执行完再提交下一个
+ */
+static void Submit(IOManager& iom, int n, int gap_us) {
+    s_done = 0;
+    for(int i = 0; i < n; ++i) {
+        std::this_thread::sleep_for(std::chrono::microseconds(gap_us));
+        iom.schedulerLock([]() { ++s_done; });
+        while(s_done <= i) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+static IOManager::IdleStats Stats(IOManager& iom) {
+    auto stats = iom.getIdleStats();
+    DAG_ASSERT(stats.size() == 1);
+    return stats.begin()->second;
+}
+
+void test_default_parks(IOManager& iom) {
+    IOManager::IdlePolicy policy = iom.getIdlePolicy();
+    DAG_ASSERT(policy.max_spin_us == 0 && policy.poll_count == 0);
+    IOManager::IdleStats before = Stats(iom);
+    Submit(iom, 20, 200);
+    IOManager::IdleStats after = Stats(iom);
+    DAG_ASSERT(after.spin_hits == before.spin_hits);
+    DAG_ASSERT(after.poll_hits == before.poll_hits);
+    DAG_ASSERT(after.parks >= before.parks + 20);
+    DAG_LOG_INFO(g_logger) << "test_default_parks ok parks=" << after.parks - before.parks;
+}
+
+void test_fixed_spin(IOManager& iom) {
+    IOManager::IdlePolicy policy;
+    policy.max_spin_us = 20000;
+    policy.adaptive = false;
+    iom.setIdlePolicy(policy);
+    // 等工作线程按新策略重新进入空闲
+    iom.schedulerLock([]() {});
+    usleep(30 * 1000);
+
+    IOManager::IdleStats before = Stats(iom);
+    Submit(iom, 50, 100);
+    IOManager::IdleStats after = Stats(iom);
+    // 间隔远小于自旋上限, 大部分任务应在自旋时被发现
+    DAG_ASSERT(after.spin_hits - before.spin_hits >= 25);
+    DAG_ASSERT(after.spin_ns > before.spin_ns);
+    DAG_LOG_INFO(g_logger) << "test_fixed_spin ok spin_hits=" << after.spin_hits - before.spin_hits
+        << " parks=" << after.parks - before.parks;
+}
+
+void test_adaptive(IOManager& iom) {
+    IOManager::IdlePolicy policy;
+    policy.max_spin_us = 1000;
+    policy.poll_count = 1;
+    policy.adaptive = true;
+    iom.setIdlePolicy(policy);
+
+    // 短间隔: 预算跟随平均间隔, 不超过上限
+    Submit(iom, 100, 50);
+    IOManager::IdleStats st = Stats(iom);
+    DAG_ASSERT(st.spin_budget_ns <= 1000 * 1000);
+    DAG_LOG_INFO(g_logger) << "short gaps: budget=" << st.spin_budget_ns
+        << " avg_gap=" << st.avg_gap_ns << " spin_hits=" << st.spin_hits;
+
+    // 长间隔: 平均间隔超过上限后不再自旋
+    Submit(iom, 40, 5000);
+    st = Stats(iom);
+    DAG_ASSERT(st.avg_gap_ns > 1000 * 1000);
+    DAG_ASSERT(st.spin_budget_ns == 0);
+    DAG_LOG_INFO(g_logger) << "test_adaptive ok avg_gap=" << st.avg_gap_ns;
+}
+
+int main(int argc, char** argv) {
+    IOManager iom(1, false, "idle");
+    usleep(10 * 1000);
+    test_default_parks(iom);
+    test_fixed_spin(iom);
+    test_adaptive(iom);
+    return 0;
+}
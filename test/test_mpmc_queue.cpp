@@ -0,0 +1,125 @@
+#include "utils/mpmc_queue.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include <condition_variable>
+#include <thread>
+#include <unistd.h>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+void test_single_thread() {
+    MpmcQueue<int> q(4);
+    int v = 0;
+    DAG_ASSERT(q.empty() && !q.tryPop(v));
+    for(int i = 0; i < 4; ++i) {
+        DAG_ASSERT(q.tryPush(i));
+    }
+    // 满了之后拒绝写入
+    DAG_ASSERT(!q.tryPush(4));
+    DAG_ASSERT(q.size() == 4);
+    for(int i = 0; i < 4; ++i) {
+        DAG_ASSERT(q.tryPop(v) && v == i);
+    }
+    DAG_ASSERT(!q.tryPop(v));
+    // 绕回之后依然可用
+    for(int round = 0; round < 10; ++round) {
+        DAG_ASSERT(q.tryPush(round));
+        DAG_ASSERT(q.tryPop(v) && v == round);
+    }
+    DAG_LOG_INFO(g_logger) << "test_single_thread ok";
+}
+
+void test_multi_thread() {
+    const int producers = 4;
+    const int consumers = 4;
+    const uint64_t per = 100000;
+    MpmcQueue<uint64_t> q(1024);
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> popped{0};
+
+    std::vector<std::thread> thrs;
+    for(int p = 0; p < producers; ++p) {
+        thrs.emplace_back([&q, p, per]() {
+            for(uint64_t i = 1; i <= per; ++i) {
+                uint64_t v = p * per + i;
+                while(!q.tryPush(v)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for(int c = 0; c < consumers; ++c) {
+        thrs.emplace_back([&q, &sum, &popped, producers, per]() {
+            uint64_t v;
+            while(popped.load() < producers * per) {
+                if(q.tryPop(v)) {
+                    sum += v;
+                    ++popped;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for(auto& t : thrs) {
+        t.join();
+    }
+    // 每个值恰好被取出一次
+    uint64_t n = producers * per;
+    DAG_ASSERT(popped == n);
+    DAG_ASSERT(sum == n * (n + 1) / 2);
+    DAG_ASSERT(q.empty());
+    DAG_LOG_INFO(g_logger) << "test_multi_thread ok";
+}
+
+static std::atomic<uint64_t> s_done{0};
+
+void test_try_schedule() {
+    IOManager iom(1, false, "inject");
+    // 用未被hook的条件变量堵住唯一的工作线程, 使无锁队列只进不出
+    std::mutex mutex;
+    std::condition_variable cond;
+    bool release = false;
+    std::atomic<bool> blocked{false};
+    iom.schedulerLock([&]() {
+        std::unique_lock<std::mutex> lock(mutex);
+        blocked = true;
+        cond.wait(lock, [&release]() { return release; });
+    });
+    while(!blocked) {
+        usleep(1000);
+    }
+
+    size_t accepted = 0;
+    while(iom.trySchedule([]() { ++s_done; })) {
+        ++accepted;
+    }
+    DAG_ASSERT(accepted == iom.getInjectQueueCapacity());
+    DAG_ASSERT(iom.getInjectQueueSize() == accepted);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        release = true;
+    }
+    cond.notify_one();
+    while(s_done < accepted) {
+        usleep(1000);
+    }
+    // 消费完之后又可以提交
+    DAG_ASSERT(iom.trySchedule([]() { ++s_done; }));
+    while(s_done < accepted + 1) {
+        usleep(1000);
+    }
+    DAG_ASSERT(iom.getInjectQueueSize() == 0);
+    DAG_LOG_INFO(g_logger) << "test_try_schedule ok accepted=" << accepted;
+}
+
+int main(int argc, char** argv) {
+    test_single_thread();
+    test_multi_thread();
+    test_try_schedule();
+    return 0;
+}
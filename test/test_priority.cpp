@@ -0,0 +1,222 @@
+#include "ioscheduler.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include "utils/util.h"
+#include <mutex>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+static void WaitFor(std::atomic<int>& v, int n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/**
+ * @brief 占住唯一的工作线程, 直到release为true; 忙等而不是hook的sleep, 不让出线程
+ */
+static void Block(IOManager& iom, std::atomic<bool>& release, std::atomic<int>& blocked) {
+    iom.schedulerLock([&]() {
+        ++blocked;
+        while(!release) {
+            std::this_thread::yield();
+        }
+    });
+    WaitFor(blocked, 1);
+}
+
+void test_order() {
+    IOManager iom(1, false, "prio");
+    iom.setAgingMs(Fiber::PRIORITY_NORMAL, 0);
+    iom.setAgingMs(Fiber::PRIORITY_BACKGROUND, 0);
+    std::atomic<bool> release{false};
+    std::atomic<int> blocked{0};
+    Block(iom, release, blocked);
+
+    std::mutex mutex;
+    std::vector<int> order;
+    std::atomic<int> done{0};
+    const Fiber::Priority prios[] = {Fiber::PRIORITY_BACKGROUND, Fiber::PRIORITY_NORMAL, Fiber::PRIORITY_HIGH};
+    for(int i = 0; i < 9; ++i) {
+        Fiber::Priority p = prios[i % 3];
+        iom.schedulerLock([&, p]() {
+            // 运行回调的协程继承任务的优先级
+            DAG_ASSERT(Fiber::GetThis()->getPriority() == p);
+            std::lock_guard<std::mutex> lock(mutex);
+            order.push_back(p);
+            ++done;
+        }, -1, Fiber::STACK_DEFAULT, p);
+    }
+    DAG_ASSERT(iom.getPendingTaskCount(Fiber::PRIORITY_HIGH) == 3);
+    DAG_ASSERT(iom.getPendingTaskCount(Fiber::PRIORITY_BACKGROUND) == 3);
+    release = true;
+    WaitFor(done, 9);
+    for(int i = 0; i < 9; ++i) {
+        DAG_ASSERT(order[i] == i / 3);
+    }
+    DAG_LOG_INFO(g_logger) << "test_order ok";
+}
+
+void test_fiber_priority() {
+    // 协程被IO/定时器事件唤醒时仍按自身优先级排队
+    IOManager iom(1, false, "prio_fiber");
+    iom.setAgingMs(Fiber::PRIORITY_BACKGROUND, 0);
+    std::atomic<int> done{0};
+    std::atomic<int> high_waiting{0};
+    std::atomic<int> bulk_after_high{0};
+    std::atomic<bool> high_done{false};
+    iom.schedulerLock([&]() {
+        ++high_waiting;
+        // hook的usleep挂起协程, 由定时器重新调度
+        usleep(20 * 1000);
+        high_done = true;
+        ++done;
+    }, -1, Fiber::STACK_DEFAULT, Fiber::PRIORITY_HIGH);
+    WaitFor(high_waiting, 1);
+    // 后台任务不断重新调度自己占满线程, 每个约1ms
+    std::atomic<bool> stop{false};
+    std::function<void()> bulk;
+    bulk = [&]() {
+        uint64_t start = getElapseMs();
+        while(getElapseMs() - start < 1) {
+        }
+        if(high_done) {
+            ++bulk_after_high;
+        }
+        if(!stop) {
+            iom.schedulerLock(bulk, -1, Fiber::STACK_DEFAULT, Fiber::PRIORITY_BACKGROUND);
+        }
+    };
+    for(int i = 0; i < 50; ++i) {
+        iom.schedulerLock(bulk, -1, Fiber::STACK_DEFAULT, Fiber::PRIORITY_BACKGROUND);
+    }
+    uint64_t start = getElapseMs();
+    WaitFor(done, 1);
+    uint64_t elapsed = getElapseMs() - start;
+    stop = true;
+    // 50个后台任务排在前面也不会推迟高优先级协程太久
+    DAG_ASSERT(elapsed < 45);
+    usleep(100 * 1000);
+    DAG_LOG_INFO(g_logger) << "test_fiber_priority ok elapsed=" << elapsed << "ms";
+}
+
+/**
+ * @brief 持续的高优先级负载下, 后台任务等多久才能运行
+ */
+static uint64_t BackgroundWaitUnderHighLoad(uint64_t aging_ms, uint64_t load_ms) {
+    IOManager iom(1, false, "prio_aging");
+    iom.setAgingMs(Fiber::PRIORITY_BACKGROUND, aging_ms);
+    std::atomic<bool> stop{false};
+    std::function<void()> hot;
+    hot = [&]() {
+        uint64_t start = getElapseMs();
+        while(getElapseMs() - start < 1) {
+        }
+        if(!stop) {
+            iom.schedulerLock(hot, -1, Fiber::STACK_DEFAULT, Fiber::PRIORITY_HIGH);
+        }
+    };
+    for(int i = 0; i < 4; ++i) {
+        iom.schedulerLock(hot, -1, Fiber::STACK_DEFAULT, Fiber::PRIORITY_HIGH);
+    }
+    std::atomic<int> done{0};
+    uint64_t submit = getElapseMs();
+    std::atomic<uint64_t> ran{0};
+    iom.schedulerLock([&]() {
+        ran = getElapseMs();
+        ++done;
+    }, -1, Fiber::STACK_DEFAULT, Fiber::PRIORITY_BACKGROUND);
+    usleep(load_ms * 1000);
+    stop = true;
+    WaitFor(done, 1);
+    // 等剩下的几个高优先级任务结束, 它们引用了本函数的局部变量
+    usleep(20 * 1000);
+    return ran - submit;
+}
+
+void test_aging() {
+    uint64_t aged = BackgroundWaitUnderHighLoad(20, 200);
+    uint64_t starved = BackgroundWaitUnderHighLoad(0, 200);
+    DAG_ASSERT(aged >= 19 && aged < 100);
+    DAG_ASSERT(starved >= 190);
+    DAG_LOG_INFO(g_logger) << "test_aging ok aged=" << aged << "ms starved=" << starved << "ms";
+}
+
+void test_try_schedule() {
+    IOManager iom(1, false, "prio_try");
+    iom.setAgingMs(Fiber::PRIORITY_NORMAL, 0);
+    std::atomic<bool> release{false};
+    std::atomic<int> blocked{0};
+    Block(iom, release, blocked);
+    std::atomic<int> seq{0};
+    std::atomic<int> normal_seq{-1};
+    std::atomic<int> high_seq{-1};
+    DAG_ASSERT(iom.trySchedule(std::function<void()>([&]() { normal_seq = seq++; })));
+    // 高优先级协程经trySchedule提交时转入加锁的高优先级队列, 先于无锁队列中的普通任务
+    Fiber::ptr high = std::make_shared<Fiber>([&]() { high_seq = seq++; });
+    high->setPriority(Fiber::PRIORITY_HIGH);
+    DAG_ASSERT(iom.trySchedule(high));
+    release = true;
+    while(normal_seq < 0 || high_seq < 0) {
+        usleep(1000);
+    }
+    DAG_ASSERT(high_seq == 0 && normal_seq == 1);
+    DAG_LOG_INFO(g_logger) << "test_try_schedule ok";
+}
+
+/**
+ * @brief 持续的priority负载下, 经trySchedule提交的任务等多久才能运行
+ */
+static uint64_t InjectWaitUnderLoad(Fiber::Priority priority, uint64_t load_ms) {
+    IOManager iom(1, false, "prio_inject");
+    iom.setAgingMs(Fiber::PRIORITY_NORMAL, 20);
+    std::atomic<bool> stop{false};
+    std::function<void()> hot;
+    hot = [&]() {
+        uint64_t start = getElapseMs();
+        while(getElapseMs() - start < 1) {
+        }
+        if(!stop) {
+            iom.schedulerLock(hot, -1, Fiber::STACK_DEFAULT, priority);
+        }
+    };
+    for(int i = 0; i < 4; ++i) {
+        iom.schedulerLock(hot, -1, Fiber::STACK_DEFAULT, priority);
+    }
+    std::atomic<int> done{0};
+    uint64_t submit = getElapseMs();
+    std::atomic<uint64_t> ran{0};
+    DAG_ASSERT(iom.trySchedule(std::function<void()>([&]() {
+        ran = getElapseMs();
+        ++done;
+    })));
+    usleep(load_ms * 1000);
+    stop = true;
+    WaitFor(done, 1);
+    usleep(20 * 1000);
+    return ran - submit;
+}
+
+void test_inject_fairness() {
+    // 普通优先级负载下与加锁队列中的任务按先后执行
+    uint64_t normal = InjectWaitUnderLoad(Fiber::PRIORITY_NORMAL, 200);
+    // 高优先级负载下按普通优先级老化
+    uint64_t high = InjectWaitUnderLoad(Fiber::PRIORITY_HIGH, 200);
+    DAG_ASSERT(normal < 50);
+    DAG_ASSERT(high >= 19 && high < 100);
+    DAG_LOG_INFO(g_logger) << "test_inject_fairness ok normal=" << normal << "ms high=" << high << "ms";
+}
+
+int main(int argc, char** argv) {
+    test_order();
+    test_fiber_priority();
+    test_aging();
+    test_try_schedule();
+    test_inject_fairness();
+    return 0;
+}
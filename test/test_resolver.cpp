@@ -0,0 +1,421 @@
+#include "address.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "resolver.h"
+#include "utils/asserts.h"
+#include "utils/util.h"
+#include <arpa/inet.h>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+static void WaitFor(std::atomic<int>& v, int n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/**
+ * @brief 本机的DNS桩服务器, 在独立线程中用阻塞的UDP socket应答
+ * @details a.test: A 1.2.3.4, 1.2.3.5 (TTL 1);  alias.test: CNAME a.test;  v6.test: AAAA ::1;
+ *          nx.test: NXDOMAIN, SOA minimum 60;  slow.test: 100ms后应答A 5.6.7.8;  drop.test: 不应答;
+ *          其他名字: NOERROR但没有记录
+ */
+class StubDns {
+public:
+    StubDns() {
+        m_sock = ::socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        DAG_ASSERT(::bind(m_sock, (sockaddr*)&addr, sizeof(addr)) == 0);
+        socklen_t len = sizeof(addr);
+        getsockname(m_sock, (sockaddr*)&addr, &len);
+        m_port = ntohs(addr.sin_port);
+        timeval tv{0, 50 * 1000};
+        setsockopt(m_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        m_thread = std::thread([this]() { serve(); });
+    }
+
+    ~StubDns() {
+        m_stop = true;
+        m_thread.join();
+        ::close(m_sock);
+    }
+
+    uint16_t getPort() const { return m_port;}
+
+    int count(const std::string& name) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_counts[name];
+    }
+
+private:
+    static void Put16(std::string& s, uint16_t v) {
+        s.push_back((char)(v >> 8));
+        s.push_back((char)v);
+    }
+
+    static void Put32(std::string& s, uint32_t v) {
+        Put16(s, v >> 16);
+        Put16(s, v & 0xffff);
+    }
+
+    static std::string Encode(const std::string& name) {
+        std::string rt;
+        size_t begin = 0;
+        while(begin < name.size()) {
+            size_t end = name.find('.', begin);
+            end = end == std::string::npos ? name.size() : end;
+            rt.push_back((char)(end - begin));
+            rt.append(name, begin, end - begin);
+            begin = end + 1;
+        }
+        rt.push_back('\0');
+        return rt;
+    }
+
+    /**
+     * @brief 追加一条资源记录, name为空时压缩指向问题中的名字
+     */
+    static void Answer(std::string& s, const std::string& name, uint16_t type, uint32_t ttl, const std::string& rdata) {
+        if(name.empty()) {
+            Put16(s, 0xc00c);
+        } else {
+            s += Encode(name);
+        }
+        Put16(s, type);
+        Put16(s, 1);
+        Put32(s, ttl);
+        Put16(s, rdata.size());
+        s += rdata;
+    }
+
+    static std::string V4(const char* ip) {
+        in_addr addr;
+        inet_pton(AF_INET, ip, &addr);
+        return std::string((const char*)&addr, sizeof(addr));
+    }
+
+    void serve() {
+        while(!m_stop) {
+            uint8_t buf[512];
+            sockaddr_in from;
+            socklen_t len = sizeof(from);
+            int n = ::recvfrom(m_sock, buf, sizeof(buf), 0, (sockaddr*)&from, &len);
+            if(n < 12) {
+                continue;
+            }
+            std::string name;
+            size_t pos = 12;
+            while(pos < (size_t)n && buf[pos]) {
+                if(!name.empty()) {
+                    name.push_back('.');
+                }
+                name.append((const char*)buf + pos + 1, buf[pos]);
+                pos += buf[pos] + 1;
+            }
+            uint16_t qtype = buf[pos + 1] << 8 | buf[pos + 2];
+            size_t qend = pos + 5;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                ++m_counts[name];
+            }
+            if(name == "drop.test") {
+                continue;
+            }
+            if(name == "slow.test") {
+                usleep(100 * 1000);
+            }
+
+            std::string answers;
+            int ancount = 0;
+            int nscount = 0;
+            int rcode = 0;
+            if(name == "a.test" && qtype == 1) {
+                Answer(answers, "", 1, 1, V4("1.2.3.4"));
+                Answer(answers, "", 1, 1, V4("1.2.3.5"));
+                ancount = 2;
+            } else if(name == "alias.test" && qtype == 1) {
+                Answer(answers, "", 5, 300, Encode("a.test"));
+                Answer(answers, "a.test", 1, 300, V4("1.2.3.4"));
+                ancount = 2;
+            } else if(name == "v6.test" && qtype == 28) {
+                in6_addr addr = IN6ADDR_LOOPBACK_INIT;
+                Answer(answers, "", 28, 300, std::string((const char*)&addr, sizeof(addr)));
+                ancount = 1;
+            } else if(name == "slow.test" && qtype == 1) {
+                Answer(answers, "", 1, 300, V4("5.6.7.8"));
+                ancount = 1;
+            } else if(name == "nx.test") {
+                std::string soa = Encode("ns.test") + Encode("admin.test");
+                Put32(soa, 1);
+                Put32(soa, 3600);
+                Put32(soa, 600);
+                Put32(soa, 86400);
+                Put32(soa, 60);
+                Answer(answers, "test", 6, 300, soa);
+                nscount = 1;
+                rcode = 3;
+            }
+
+            std::string resp((const char*)buf, 2);
+            Put16(resp, 0x8180 | rcode);
+            Put16(resp, 1);
+            Put16(resp, ancount);
+            Put16(resp, nscount);
+            Put16(resp, 0);
+            resp.append((const char*)buf + 12, qend - 12);
+            resp += answers;
+            ::sendto(m_sock, resp.data(), resp.size(), 0, (sockaddr*)&from, len);
+        }
+    }
+
+private:
+    int m_sock;
+    uint16_t m_port;
+    std::atomic<bool> m_stop{false};
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::map<std::string, int> m_counts;
+};
+
+static Resolver::Config StubConfig(const StubDns& stub) {
+    Resolver::Config config;
+    config.nameservers.push_back(IPv4Address::Create("127.0.0.1", stub.getPort()));
+    config.timeout_ms = 200;
+    config.attempts = 1;
+    return config;
+}
+
+void test_resolv_conf() {
+    const char* path = "/tmp/dag_resolv.conf";
+    std::ofstream ofs(path);
+    ofs << "# comment\n"
+        << "nameserver 10.0.0.53\n"
+        << "nameserver bad\n"
+        << "nameserver 10.0.0.54 ; trailing\n"
+        << "domain ignored.example\n"
+        << "search Corp.Example. example\n"
+        << "options ndots:2 timeout:3 attempts:4 rotate\n";
+    ofs.close();
+    Resolver::Config config;
+    DAG_ASSERT(Resolver::ParseResolvConf(path, config));
+    DAG_ASSERT(config.nameservers.size() == 2);
+    DAG_ASSERT(config.nameservers[0]->toString() == "10.0.0.53:53");
+    DAG_ASSERT(config.search.size() == 2 && config.search[0] == "corp.example" && config.search[1] == "example");
+    DAG_ASSERT(config.ndots == 2 && config.timeout_ms == 3000 && config.attempts == 4);
+    DAG_ASSERT(!Resolver::ParseResolvConf("/nonexistent/resolv.conf", config));
+    unlink(path);
+    DAG_LOG_INFO(g_logger) << "test_resolv_conf ok";
+}
+
+void test_hosts_and_numeric() {
+    const char* path = "/tmp/dag_hosts";
+    std::ofstream ofs(path);
+    ofs << "10.0.0.1 MyHost.local alias # comment\n"
+        << "fe80::1 myhost.local\n"
+        << "bogus line\n";
+    ofs.close();
+    Resolver::Config config;
+    Resolver resolver(config);
+    DAG_ASSERT(resolver.loadHosts(path));
+    std::vector<Resolver::Record> records;
+    DAG_ASSERT(resolver.resolve("ALIAS", AF_INET, records) == Resolver::OK);
+    DAG_ASSERT(records.size() == 1 && records[0].toString() == "10.0.0.1");
+    records.clear();
+    DAG_ASSERT(resolver.resolve("myhost.local.", AF_UNSPEC, records) == Resolver::OK);
+    DAG_ASSERT(records.size() == 2 && records[1].family == AF_INET6 && records[1].toString() == "fe80::1");
+    DAG_ASSERT(resolver.getStats().hosts_hits == 3);
+
+    // 数字地址不查询, 没有服务器也能解析
+    records.clear();
+    DAG_ASSERT(resolver.resolve("192.168.1.1", AF_INET, records) == Resolver::OK);
+    DAG_ASSERT(records.size() == 1 && records[0].toString() == "192.168.1.1");
+    DAG_ASSERT(resolver.resolve("192.168.1.1", AF_INET6, records) == Resolver::NOT_FOUND);
+    DAG_ASSERT(resolver.resolve("unknown.host", AF_INET, records) == Resolver::NO_SERVER);
+    DAG_ASSERT(resolver.getStats().queries == 0);
+    unlink(path);
+    DAG_LOG_INFO(g_logger) << "test_hosts_and_numeric ok";
+}
+
+void test_reload() {
+    const char* hosts = "/tmp/dag_reload_hosts";
+    const char* resolv_conf = "/tmp/dag_reload_resolv.conf";
+    std::ofstream(hosts) << "10.0.0.1 a.host\n";
+    std::ofstream(resolv_conf) << "nameserver 10.0.0.53\nsearch one.example\n";
+    Resolver::Config config;
+    config.reload_interval_ms = 20;
+    Resolver resolver(config);
+    DAG_ASSERT(resolver.loadHosts(hosts) && resolver.loadResolvConf(resolv_conf));
+    DAG_ASSERT(resolver.getConfig().search.size() == 1 && resolver.getConfig().search[0] == "one.example");
+    std::vector<Resolver::Record> records;
+    DAG_ASSERT(resolver.resolve("a.host", AF_INET, records) == Resolver::OK && records[0].toString() == "10.0.0.1");
+
+    // 修改后在检查间隔内仍用旧内容, 过了间隔重新加载
+    std::ofstream(hosts) << "10.0.0.22 a.host b.host\n";
+    // 本机53端口没有服务时查询立即被拒绝
+    std::ofstream(resolv_conf) << "nameserver 127.0.0.1\nsearch two.example\noptions timeout:1 attempts:1\n";
+    usleep(50 * 1000);
+    records.clear();
+    DAG_ASSERT(resolver.resolve("a.host", AF_INET, records) == Resolver::OK && records[0].toString() == "10.0.0.22");
+    Resolver::Config reloaded = resolver.getConfig();
+    DAG_ASSERT(reloaded.search.size() == 1 && reloaded.search[0] == "two.example");
+    DAG_ASSERT(reloaded.nameservers.size() == 1 && reloaded.nameservers[0]->toString() == "127.0.0.1:53");
+    DAG_ASSERT(reloaded.reload_interval_ms == 20);
+
+    // hosts被删除
+    unlink(hosts);
+    usleep(50 * 1000);
+    records.clear();
+    DAG_ASSERT(resolver.resolve("b.host", AF_INET, records) != Resolver::OK);
+    unlink(resolv_conf);
+    DAG_LOG_INFO(g_logger) << "test_reload ok";
+}
+
+void test_nsswitch() {
+    const char* path = "/tmp/dag_nsswitch.conf";
+    std::ofstream(path) << "passwd: files\nhosts: files [NOTFOUND=return] dns # comment\n";
+    DAG_ASSERT(Resolver::NsswitchFilesDnsOnly(path));
+    std::ofstream(path) << "hosts: files mdns4_minimal [ NOTFOUND=return ] dns myhostname\n";
+    DAG_ASSERT(!Resolver::NsswitchFilesDnsOnly(path));
+    unlink(path);
+    DAG_ASSERT(Resolver::NsswitchFilesDnsOnly(path));
+    DAG_LOG_INFO(g_logger) << "test_nsswitch ok";
+}
+
+void test_query_and_cache() {
+    StubDns stub;
+    Resolver resolver(StubConfig(stub));
+    IOManager iom(1, false, "resolver");
+    std::atomic<int> done{0};
+    iom.schedulerLock([&]() {
+        std::vector<Address::ptr> addrs;
+        DAG_ASSERT(resolver.lookup(addrs, "a.test", AF_INET, 80) == Resolver::OK);
+        DAG_ASSERT(addrs.size() == 2);
+        DAG_ASSERT(addrs[0]->toString() == "1.2.3.4:80" && addrs[1]->toString() == "1.2.3.5:80");
+        // TTL内命中缓存
+        addrs.clear();
+        DAG_ASSERT(resolver.lookup(addrs, "A.TEST.", AF_INET) == Resolver::OK && addrs.size() == 2);
+        DAG_ASSERT(stub.count("a.test") == 1);
+        // TTL为1秒, 过期后重新查询
+        usleep(1100 * 1000);
+        addrs.clear();
+        DAG_ASSERT(resolver.lookup(addrs, "a.test", AF_INET) == Resolver::OK && addrs.size() == 2);
+        DAG_ASSERT(stub.count("a.test") == 2);
+
+        // CNAME
+        std::vector<Resolver::Record> records;
+        DAG_ASSERT(resolver.resolve("alias.test", AF_INET, records) == Resolver::OK);
+        DAG_ASSERT(records.size() == 1 && records[0].toString() == "1.2.3.4");
+
+        // AAAA
+        records.clear();
+        DAG_ASSERT(resolver.resolve("v6.test", AF_INET6, records) == Resolver::OK);
+        DAG_ASSERT(records.size() == 1 && records[0].family == AF_INET6 && records[0].toString() == "::1");
+
+        // 否定缓存: NXDOMAIN和NODATA
+        DAG_ASSERT(resolver.resolve("nx.test", AF_INET, records) == Resolver::NOT_FOUND);
+        DAG_ASSERT(resolver.resolve("nx.test", AF_INET, records) == Resolver::NOT_FOUND);
+        DAG_ASSERT(stub.count("nx.test") == 1);
+        DAG_ASSERT(resolver.resolve("v6.test", AF_INET, records) == Resolver::NOT_FOUND);
+        DAG_ASSERT(resolver.resolve("v6.test", AF_INET, records) == Resolver::NOT_FOUND);
+        DAG_ASSERT(stub.count("v6.test") == 2);
+
+        // 超时不缓存
+        uint64_t start = getElapseMs();
+        DAG_ASSERT(resolver.resolve("drop.test", AF_INET, records) == Resolver::TIMEOUT);
+        DAG_ASSERT(getElapseMs() - start >= 190);
+        DAG_ASSERT(resolver.resolve("drop.test", AF_INET, records) == Resolver::TIMEOUT);
+        DAG_ASSERT(stub.count("drop.test") == 2);
+        ++done;
+    });
+    WaitFor(done, 1);
+    Resolver::Stats stats = resolver.getStats();
+    DAG_ASSERT(stats.cache_hits == 3 && stats.negative_hits == 2 && stats.timeouts == 2);
+    DAG_LOG_INFO(g_logger) << "test_query_and_cache ok queries=" << stats.queries
+        << " cache_size=" << stats.cache_size;
+}
+
+void test_coalesce() {
+    // 10个协程同时解析同一个慢名字: 只发一次查询, 唯一的工作线程也不被阻塞
+    StubDns stub;
+    Resolver resolver(StubConfig(stub));
+    IOManager iom(1, false, "resolver_co");
+    const int count = 10;
+    std::atomic<int> done{0};
+    std::atomic<int> bad{0};
+    std::atomic<uint64_t> other_ran{0};
+    uint64_t start = getElapseMs();
+    for(int i = 0; i < count; ++i) {
+        iom.schedulerLock([&]() {
+            std::vector<Resolver::Record> records;
+            if(resolver.resolve("slow.test", AF_INET, records) != Resolver::OK
+                    || records.size() != 1 || records[0].toString() != "5.6.7.8") {
+                ++bad;
+            }
+            ++done;
+        });
+    }
+    iom.schedulerLock([&]() { other_ran = getElapseMs(); });
+    WaitFor(done, count);
+    uint64_t elapsed = getElapseMs() - start;
+    DAG_ASSERT(bad == 0);
+    DAG_ASSERT(stub.count("slow.test") == 1);
+    DAG_ASSERT(resolver.getStats().coalesced == count - 1);
+    DAG_ASSERT(other_ran && other_ran - start < 50);
+    DAG_ASSERT(elapsed < 180);
+    DAG_LOG_INFO(g_logger) << "test_coalesce ok elapsed=" << elapsed << "ms";
+}
+
+void test_search_and_address_lookup() {
+    StubDns stub;
+    Resolver::Config config = StubConfig(stub);
+    config.search.push_back("test");
+    ResolverMgr::GetInstance()->setConfig(config);
+    IOManager iom(1, false, "resolver_lookup");
+    std::atomic<int> done{0};
+    iom.schedulerLock([&]() {
+        // 点数少于ndots, 先尝试search域
+        std::vector<Resolver::Record> records;
+        DAG_ASSERT(ResolverMgr::GetInstance()->resolve("a", AF_INET, records) == Resolver::OK);
+        DAG_ASSERT(records.size() == 2 && stub.count("a.test") == 1 && stub.count("a") == 0);
+
+        // Address::Lookup在IO协程中走Resolver
+        IPAddress::ptr addr = Address::LookupAnyIPAddress("alias.test:8080");
+        DAG_ASSERT(addr && addr->toString() == "1.2.3.4:8080");
+        DAG_ASSERT(stub.count("alias.test") == 1);
+        DAG_ASSERT(!Address::LookupAny("nx.test"));
+
+        // 关闭后走getaddrinfo, 不经过Resolver
+        bool enabled = Resolver::IsLookupEnabled();
+        Resolver::SetLookupEnabled(false);
+        uint64_t hosts_hits = ResolverMgr::GetInstance()->getStats().hosts_hits;
+        DAG_ASSERT(Address::LookupAny("localhost"));
+        DAG_ASSERT(ResolverMgr::GetInstance()->getStats().hosts_hits == hosts_hits);
+        Resolver::SetLookupEnabled(enabled);
+        ++done;
+    });
+    WaitFor(done, 1);
+    DAG_LOG_INFO(g_logger) << "test_search_and_address_lookup ok";
+}
+
+int main(int argc, char** argv) {
+    test_resolv_conf();
+    test_hosts_and_numeric();
+    test_reload();
+    test_nsswitch();
+    test_query_and_cache();
+    test_coalesce();
+    test_search_and_address_lookup();
+    return 0;
+}
@@ -0,0 +1,115 @@
+#include "rpc/rpc_server.h"
+#include "rpc/rpc_client.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include <atomic>
+#include <unistd.h>
+
+using namespace dag;
+using namespace dag::rpc;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+static const int s_fibers = 50;
+static const int s_calls = 200;
+static std::atomic<int> s_done{0};
+
+void test_codec() {
+    ByteArray::ptr ba(new ByteArray(5));
+    RpcMessage req(RpcMessage::REQUEST, 7);
+    req.setMethod("echo");
+    req.setBody(std::string(300, 'x'));
+    req.encode(ba);
+    RpcMessage rsp(RpcMessage::RESPONSE, 8);
+    rsp.setStatus(RpcStatus::HANDLER_ERROR);
+    rsp.encode(ba);
+    size_t total = ba->getSize();
+
+    // 不完整的帧不移动位置
+    ByteArray::ptr part(new ByteArray(5));
+    ba->setPosition(0);
+    std::string bytes = ba->toString();
+    part->writeStringWithoutLength(bytes.substr(0, 100));
+    part->setPosition(0);
+    bool err = false;
+    DAG_ASSERT(!RpcMessage::Decode(part, err) && !err);
+    DAG_ASSERT(part->getPosition() == 0);
+
+    ba->setPosition(0);
+    RpcMessage::ptr m1 = RpcMessage::Decode(ba, err);
+    RpcMessage::ptr m2 = RpcMessage::Decode(ba, err);
+    DAG_ASSERT(m1 && m2 && !err);
+    DAG_ASSERT(ba->getPosition() == total);
+    DAG_ASSERT(m1->getId() == 7 && m1->getMethod() == "echo" && m1->getBody() == req.getBody());
+    DAG_ASSERT(m2->getType() == RpcMessage::RESPONSE && m2->getStatus() == RpcStatus::HANDLER_ERROR);
+    DAG_ASSERT(m2->getMethod().empty() && m2->getBody().empty());
+
+    ByteArray::ptr bad(new ByteArray(5));
+    bad->writeStringWithoutLength(std::string(RpcMessage::HEADER_SIZE, '\x01'));
+    bad->setPosition(0);
+    DAG_ASSERT(!RpcMessage::Decode(bad, err) && err);
+    DAG_LOG_INFO(g_logger) << "test_codec ok";
+}
+
+void finish(RpcServer::ptr server, RpcClient::ptr client) {
+    std::string rsp;
+    // 超时: 调用方按时返回, 迟到的响应被丢弃, 连接仍然可用
+    DAG_ASSERT(client->call("sleep", "", rsp, 50) == RpcStatus::TIMEOUT);
+    DAG_ASSERT(client->call("echo", "after timeout", rsp, 1000) == RpcStatus::OK);
+    DAG_ASSERT(rsp == "after timeout");
+    DAG_ASSERT(client->call("nope", "", rsp) == RpcStatus::METHOD_NOT_FOUND);
+    DAG_ASSERT(client->call("fail", "", rsp) == RpcStatus::HANDLER_ERROR);
+    usleep(300 * 1000);
+    DAG_ASSERT(client->getPendingCount() == 0);
+
+    client->close();
+    usleep(50 * 1000);
+    DAG_ASSERT(!client->isConnected());
+    DAG_ASSERT(client->call("echo", "x", rsp) == RpcStatus::CONNECTION_CLOSED);
+    server->stop();
+    DAG_LOG_INFO(g_logger) << "test_rpc ok";
+}
+
+void run() {
+    RpcServer::ptr server(new RpcServer);
+    server->registerMethod("echo", [](const std::string& req, std::string& rsp) {
+        rsp = req;
+        return true;
+    });
+    server->registerMethod("sleep", [](const std::string& req, std::string& rsp) {
+        usleep(200 * 1000);
+        return true;
+    });
+    server->registerMethod("fail", [](const std::string& req, std::string& rsp) {
+        return false;
+    });
+    Address::ptr addr = Address::LookupAnyIPAddress("127.0.0.1:8030");
+    DAG_ASSERT(server->bind(addr));
+    server->start();
+
+    RpcClient::ptr client(new RpcClient);
+    DAG_ASSERT(client->connect(addr));
+
+    // 多个协程在同一条连接上并发调用, 响应按id对应回各自的调用
+    for(int i = 0; i < s_fibers; ++i) {
+        IOManager::GetThis()->schedulerLock([i, server, client]() {
+            for(int j = 0; j < s_calls; ++j) {
+                std::string req = std::to_string(i) + "-" + std::to_string(j);
+                std::string rsp;
+                DAG_ASSERT(client->call("echo", req, rsp, 5000) == RpcStatus::OK);
+                DAG_ASSERT(rsp == req);
+            }
+            if(++s_done == s_fibers) {
+                DAG_LOG_INFO(g_logger) << "concurrent calls ok";
+                finish(server, client);
+            }
+        });
+    }
+}
+
+int main() {
+    test_codec();
+    IOManager iom(4);
+    iom.schedulerLock(run);
+    return 0;
+}
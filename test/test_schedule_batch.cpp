@@ -0,0 +1,93 @@
+#include "ioscheduler.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include "utils/util.h"
+#include <unistd.h>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+/**
+ * @brief 统计提交线程发出的唤醒次数
+ */
+class CountingIOManager : public IOManager {
+public:
+    CountingIOManager(size_t threads, uint32_t submitter)
+        : IOManager(threads, false, "batch")
+        , m_submitter(submitter) {
+    }
+
+    int getTickles() const { return m_tickles;}
+    void resetTickles() { m_tickles = 0;}
+protected:
+    void tickle() override {
+        if(getThreadId() == m_submitter) {
+            ++m_tickles;
+        }
+        IOManager::tickle();
+    }
+private:
+    uint32_t m_submitter;
+    std::atomic<int> m_tickles{0};
+};
+
+static std::atomic<int> s_done{0};
+
+static void WaitDone(int n) {
+    while(s_done < n) {
+        usleep(1000);
+    }
+}
+
+void test_callbacks(CountingIOManager& iom) {
+    s_done = 0;
+    iom.resetTickles();
+    std::vector<std::function<void()>> cbs;
+    for(int i = 0; i < 200; ++i) {
+        cbs.push_back([]() { ++s_done; });
+    }
+    // 混入空回调, 应被忽略
+    cbs.push_back(nullptr);
+    DAG_ASSERT(iom.scheduleBatch(cbs) == 200);
+    // 元素已被移走
+    for(auto& cb : cbs) {
+        DAG_ASSERT(!cb);
+    }
+    // 两个工作线程都空闲, 最多唤醒两次
+    DAG_ASSERT(iom.getTickles() <= 2);
+    WaitDone(200);
+    DAG_LOG_INFO(g_logger) << "test_callbacks ok tickles=" << iom.getTickles();
+}
+
+void test_fibers(CountingIOManager& iom) {
+    s_done = 0;
+    iom.resetTickles();
+    std::vector<Fiber::ptr> fibers;
+    for(int i = 0; i < 3; ++i) {
+        fibers.push_back(std::make_shared<Fiber>([]() { ++s_done; }));
+    }
+    DAG_ASSERT(iom.scheduleBatch(fibers.begin(), fibers.end()) == 3);
+    DAG_ASSERT(iom.getTickles() <= 2);
+    WaitDone(3);
+    DAG_LOG_INFO(g_logger) << "test_fibers ok tickles=" << iom.getTickles();
+}
+
+void test_empty(CountingIOManager& iom) {
+    iom.resetTickles();
+    std::vector<std::function<void()>> cbs;
+    DAG_ASSERT(iom.scheduleBatch(cbs) == 0);
+    DAG_ASSERT(iom.getTickles() == 0);
+    DAG_LOG_INFO(g_logger) << "test_empty ok";
+}
+
+int main() {
+    CountingIOManager iom(2, getThreadId());
+    // 等工作线程进入idle
+    usleep(50 * 1000);
+    test_callbacks(iom);
+    usleep(50 * 1000);
+    test_fibers(iom);
+    test_empty(iom);
+    return 0;
+}
@@ -0,0 +1,189 @@
+#include "fiber.h"
+#include "fiber_mutex.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include "utils/util.h"
+#include <string.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+static void WaitFor(std::atomic<int>& v, int n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/**
+ * @brief 在栈上占用约depth KB, 在最深处让出一次, 恢复后校验每一层的内容
+ */
+static bool __attribute__((noinline)) RecurseAndYield(int depth, char tag) {
+    volatile char buf[1024];
+    memset((char*)buf, tag + depth, sizeof(buf));
+    if(depth <= 1) {
+        Fiber::GetThis()->yield();
+    } else if(!RecurseAndYield(depth - 1, tag)) {
+        return false;
+    }
+    for(size_t i = 0; i < sizeof(buf); ++i) {
+        if(buf[i] != (char)(tag + depth)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void test_interleave() {
+    // 当前线程还没有用过共享栈, 只分配一个, 每次切换都要拷贝
+    Fiber::SetSharedStackCount(1);
+    const int count = 8;
+    std::vector<Fiber::ptr> fibers;
+    std::vector<int> results(count, 0);
+    for(int f = 0; f < count; ++f) {
+        fibers.push_back(std::make_shared<Fiber>([f, &results]() {
+            int local = f * 100;
+            int* addr = &local;
+            for(int i = 0; i < 10; ++i) {
+                Fiber::GetThis()->yield();
+                // 恢复到同一地址, 栈上的值不受其他协程影响
+                DAG_ASSERT(addr == &local && local == f * 100 + i);
+                ++local;
+            }
+            results[f] = RecurseAndYield(16, (char)f) ? local : -1;
+        }, 0, false, true));
+    }
+    for(int round = 0; round < 12; ++round) {
+        for(auto& i : fibers) {
+            if(i->getState() != Fiber::TERM) {
+                i->resume();
+            }
+        }
+    }
+    for(int f = 0; f < count; ++f) {
+        DAG_ASSERT(fibers[f]->getState() == Fiber::TERM);
+        DAG_ASSERT(results[f] == f * 100 + 10);
+        DAG_ASSERT(fibers[f]->isSharedStack());
+        DAG_ASSERT(fibers[f]->getPinnedThread() == (int)getThreadId());
+        // 结束后释放保存的栈
+        DAG_ASSERT(fibers[f]->getSavedStackSize() == 0);
+    }
+    DAG_LOG_INFO(g_logger) << "test_interleave ok";
+}
+
+void test_saved_size() {
+    Fiber::ptr a = std::make_shared<Fiber>([]() {
+        Fiber::GetThis()->yield();
+    }, 0, false, true);
+    Fiber::ptr deep = std::make_shared<Fiber>([]() {
+        RecurseAndYield(32, 'd');
+    }, 0, false, true);
+    a->resume();
+    deep->resume();
+    // a的栈只在共享栈被其他协程占用时才拷走, 只有几百字节
+    DAG_ASSERT(a->getSavedStackSize() > 0 && a->getSavedStackSize() < 4096);
+    a->resume();
+    DAG_ASSERT(a->getState() == Fiber::TERM);
+    DAG_ASSERT(deep->getSavedStackSize() > 32 * 1024);
+    deep->resume();
+    DAG_ASSERT(deep->getState() == Fiber::TERM);
+    DAG_LOG_INFO(g_logger) << "test_saved_size ok";
+}
+
+void test_reset() {
+    int runs = 0;
+    Fiber::ptr f = std::make_shared<Fiber>([&runs]() {
+        ++runs;
+        Fiber::GetThis()->yield();
+        ++runs;
+    }, 0, false, true);
+    Fiber::ptr other = std::make_shared<Fiber>([]() {
+        Fiber::GetThis()->yield();
+    }, 0, false, true);
+    for(int i = 0; i < 3; ++i) {
+        f->resume();
+        other->resume();
+        f->resume();
+        DAG_ASSERT(f->getState() == Fiber::TERM);
+        other->resume();
+        f->reset([&runs]() {
+            ++runs;
+            Fiber::GetThis()->yield();
+            ++runs;
+        });
+        DAG_ASSERT(f->getPinnedThread() == -1);
+        other->reset([]() {
+            Fiber::GetThis()->yield();
+        });
+    }
+    DAG_ASSERT(runs == 6);
+    DAG_LOG_INFO(g_logger) << "test_reset ok";
+}
+
+void test_scheduler_pinned() {
+    // 共享栈协程在多个工作线程上挂起/恢复, 每次都回到第一次运行的线程
+    IOManager iom(3, false, "shared");
+    FiberMutex mutex;
+    const int count = 200;
+    std::atomic<int> done{0};
+    std::atomic<int> bad{0};
+    for(int f = 0; f < count; ++f) {
+        iom.schedulerLock([&, f]() {
+            uint32_t tid = getThreadId();
+            char buf[512];
+            memset(buf, f, sizeof(buf));
+            for(int i = 0; i < 5; ++i) {
+                usleep(1000);
+                {
+                    // 持锁期间挂起, 让等锁的协程也经过挂起/唤醒
+                    std::lock_guard<FiberMutex> lock(mutex);
+                    usleep(100);
+                }
+                if(getThreadId() != tid || buf[f % sizeof(buf)] != (char)f
+                        || !Fiber::GetThis()->isSharedStack()) {
+                    ++bad;
+                }
+            }
+            ++done;
+        }, -1, Fiber::STACK_SHARED);
+    }
+    WaitFor(done, count);
+    DAG_ASSERT(bad == 0);
+    DAG_LOG_INFO(g_logger) << "test_scheduler_pinned ok";
+}
+
+void test_try_schedule() {
+    IOManager iom(2, false, "shared_try");
+    std::atomic<int> done{0};
+    Fiber::ptr parked;
+    std::atomic<int> started{0};
+    iom.schedulerLock([&]() {
+        uint32_t tid = getThreadId();
+        parked = Fiber::GetThis();
+        ++started;
+        Fiber::GetThis()->yield();
+        DAG_ASSERT(getThreadId() == tid);
+        ++done;
+    }, -1, Fiber::STACK_SHARED);
+    WaitFor(started, 1);
+    // 等协程真正让出
+    usleep(10 * 1000);
+    DAG_ASSERT(parked->getPinnedThread() != -1);
+    DAG_ASSERT(iom.trySchedule(parked));
+    parked.reset();
+    WaitFor(done, 1);
+    DAG_LOG_INFO(g_logger) << "test_try_schedule ok";
+}
+
+int main(int argc, char** argv) {
+    Fiber::GetThis();
+    test_interleave();
+    test_saved_size();
+    test_reset();
+    test_scheduler_pinned();
+    test_try_schedule();
+    return 0;
+}
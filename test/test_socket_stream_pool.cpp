@@ -0,0 +1,166 @@
+#include "stream/socket_stream_pool.h"
+#include "tcp_server.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include <cstring>
+#include <unistd.h>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+/**
+ * @brief 回显服务器, 收到"bye"时主动关闭连接
+ */
+class EchoServer : public TcpServer {
+public:
+    using ptr = std::shared_ptr<EchoServer>;
+protected:
+    void handleClient(Socket::ptr client) override {
+        char buf[1024];
+        while(true) {
+            int n = client->recv(buf, sizeof(buf));
+            if(n <= 0) {
+                break;
+            }
+            if(n == 3 && memcmp(buf, "bye", 3) == 0) {
+                break;
+            }
+            client->send(buf, n);
+        }
+        client->close();
+    }
+};
+
+static bool Echo(SocketStream::ptr ss, const std::string& msg) {
+    if(ss->writeFixSize(msg.c_str(), msg.size()) <= 0) {
+        return false;
+    }
+    std::string rsp(msg.size(), '\0');
+    return ss->readFixSize(&rsp[0], rsp.size()) > 0 && rsp == msg;
+}
+
+void test_reuse(Address::ptr addr) {
+    SocketStreamPool::ptr pool(new SocketStreamPool(IOManager::GetThis(), 4));
+    int fd = -1;
+    {
+        SocketStream::ptr ss = pool->get(addr);
+        DAG_ASSERT(ss && Echo(ss, "hello"));
+        fd = ss->getSocket()->getSocket();
+        DAG_ASSERT(pool->getActiveCount(addr) == 1);
+    }
+    DAG_ASSERT(pool->getIdleCount(addr) == 1);
+    {
+        SocketStream::ptr ss = pool->get(addr);
+        DAG_ASSERT(ss && Echo(ss, "again"));
+        DAG_ASSERT(ss->getSocket()->getSocket() == fd);
+    }
+    DAG_ASSERT(pool->getCreatedCount() == 1);
+    DAG_ASSERT(pool->getReusedCount() == 1);
+
+    // LIFO: 最后归还的连接最先被复用
+    SocketStream::ptr a = pool->get(addr);
+    SocketStream::ptr b = pool->get(addr);
+    int fd_b = b->getSocket()->getSocket();
+    a.reset();
+    b.reset();
+    SocketStream::ptr c = pool->get(addr);
+    DAG_ASSERT(c->getSocket()->getSocket() == fd_b);
+    c.reset();
+
+    // 出错后close的连接不会被放回池中
+    {
+        SocketStream::ptr ss = pool->get(addr);
+        ss->close();
+    }
+    DAG_ASSERT(pool->getIdleCount(addr) == 1);
+    DAG_ASSERT(pool->getActiveCount(addr) == 0);
+    pool->stop();
+    DAG_LOG_INFO(g_logger) << "test_reuse ok";
+}
+
+void test_wait(Address::ptr addr) {
+    SocketStreamPool::ptr pool(new SocketStreamPool(IOManager::GetThis(), 2));
+    SocketStream::ptr a = pool->get(addr);
+    SocketStream::ptr b = pool->get(addr);
+    DAG_ASSERT(a && b);
+
+    // 达到上限: 等待超时
+    uint64_t start = getElapseMs();
+    DAG_ASSERT(!pool->get(addr, 100));
+    DAG_ASSERT(getElapseMs() - start >= 90);
+    DAG_ASSERT(pool->getWaitTimeoutCount() == 1);
+
+    // 达到上限: 其他协程归还后被唤醒并直接拿到归还的连接
+    int fd_a = a->getSocket()->getSocket();
+    IOManager::GetThis()->schedulerLock([&a]() {
+        usleep(50 * 1000);
+        a.reset();
+    });
+    SocketStream::ptr c = pool->get(addr, 1000);
+    DAG_ASSERT(c && c->getSocket()->getSocket() == fd_a);
+    DAG_ASSERT(Echo(c, "waited"));
+    DAG_ASSERT(pool->getCreatedCount() == 2);
+    c.reset();
+    b.reset();
+    pool->stop();
+    DAG_LOG_INFO(g_logger) << "test_wait ok";
+}
+
+void test_health(Address::ptr addr) {
+    SocketStreamPool::ptr pool(new SocketStreamPool(IOManager::GetThis(), 8, 2, 8, 50));
+    {
+        // 服务端关闭连接后, 空闲连接在取出时被识别并丢弃
+        SocketStream::ptr ss = pool->get(addr);
+        ss->writeFixSize("bye", 3);
+    }
+    usleep(50 * 1000);
+    {
+        SocketStream::ptr ss = pool->get(addr);
+        DAG_ASSERT(ss && Echo(ss, "fresh"));
+        DAG_ASSERT(pool->getEvictedCount() == 1);
+        DAG_ASSERT(pool->getCreatedCount() == 2);
+    }
+
+    // 空闲回收保留min_idle条, 并在后台补足min_idle
+    std::vector<SocketStream::ptr> conns;
+    for(int i = 0; i < 4; ++i) {
+        conns.push_back(pool->get(addr));
+    }
+    conns.clear();
+    DAG_ASSERT(pool->getIdleCount(addr) == 4);
+    usleep(100 * 1000);
+    pool->check();
+    DAG_ASSERT(pool->getIdleCount(addr) == 2);
+
+    {
+        SocketStream::ptr x = pool->get(addr);
+        SocketStream::ptr y = pool->get(addr);
+        DAG_ASSERT(pool->getIdleCount(addr) == 0);
+        pool->check();
+        usleep(50 * 1000);
+        DAG_ASSERT(pool->getIdleCount(addr) == 2);
+    }
+    DAG_ASSERT(pool->getIdleCount(addr) == 4);
+    pool->stop();
+    DAG_ASSERT(pool->getIdleCount(addr) == 0);
+    DAG_LOG_INFO(g_logger) << "test_health ok";
+}
+
+void run() {
+    EchoServer::ptr server(new EchoServer);
+    Address::ptr addr = Address::LookupAnyIPAddress("127.0.0.1:8032");
+    DAG_ASSERT(server->bind(addr));
+    server->start();
+
+    test_reuse(addr);
+    test_wait(addr);
+    test_health(addr);
+    server->stop();
+}
+
+int main() {
+    IOManager iom(2);
+    iom.schedulerLock(run);
+    return 0;
+}
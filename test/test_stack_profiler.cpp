@@ -0,0 +1,210 @@
+#include "fiber.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "stack_profiler.h"
+#include "utils/asserts.h"
+#include <string.h>
+#include <thread>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+static void WaitFor(std::atomic<int>& v, int n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/**
+ * @brief 在栈上占用约depth KB
+ */
+static int __attribute__((noinline)) Recurse(int depth) {
+    volatile char buf[1024];
+    memset((char*)buf, depth, sizeof(buf));
+    if(depth <= 1) {
+        return buf[0];
+    }
+    return Recurse(depth - 1) + buf[1];
+}
+
+void test_measure() {
+    const size_t size = 64 * 1024;
+    void* stack = malloc(size);
+    StackProfiler::Paint(stack, size);
+    DAG_ASSERT(StackProfiler::Measure(stack, size) == 0);
+    // 模拟从栈顶向下用掉了10000字节
+    memset((char*)stack + size - 10000, 0, 10000);
+    size_t used = StackProfiler::Measure(stack, size);
+    DAG_ASSERT(used >= 10000 && used < 10000 + 8);
+    free(stack);
+
+    DAG_ASSERT(StackProfiler::BucketOf(0) == 0);
+    DAG_ASSERT(StackProfiler::BucketOf(1024) == 0);
+    DAG_ASSERT(StackProfiler::BucketOf(1025) == 1);
+    DAG_ASSERT(StackProfiler::BucketOf(20 * 1024) == 5);
+    DAG_ASSERT(StackProfiler::BucketOf(100 * 1024 * 1024) == StackProfiler::BUCKET_COUNT - 1);
+    DAG_LOG_INFO(g_logger) << "test_measure ok";
+}
+
+void test_stack_class() {
+    DAG_ASSERT(Fiber::GetStackClassSize(Fiber::STACK_DEFAULT) == 128000);
+    DAG_ASSERT(Fiber::GetStackClassSize(Fiber::STACK_SMALL) == 32 * 1024);
+    IOManager iom(1, false, "stack_class");
+    std::atomic<int> done{0};
+    size_t sizes[Fiber::STACK_CLASS_COUNT] = {0};
+    for(int c = 0; c < Fiber::STACK_CLASS_COUNT; ++c) {
+        iom.schedulerLock([&sizes, &done, c]() {
+            sizes[c] = Fiber::GetThis()->getStackSize();
+            ++done;
+        }, -1, (Fiber::StackClass)c);
+    }
+    WaitFor(done, Fiber::STACK_CLASS_COUNT);
+    for(int c = 0; c < Fiber::STACK_CLASS_COUNT; ++c) {
+        DAG_ASSERT(sizes[c] == Fiber::GetStackClassSize((Fiber::StackClass)c));
+    }
+
+    Fiber::SetStackClassSize(Fiber::STACK_SMALL, 48 * 1024);
+    iom.schedulerLock([&sizes, &done]() {
+        sizes[0] = Fiber::GetThis()->getStackSize();
+        ++done;
+    }, -1, Fiber::STACK_SMALL);
+    WaitFor(done, Fiber::STACK_CLASS_COUNT + 1);
+    DAG_ASSERT(sizes[0] == 48 * 1024);
+    Fiber::SetStackClassSize(Fiber::STACK_SMALL, 32 * 1024);
+    DAG_LOG_INFO(g_logger) << "test_stack_class ok";
+}
+
+void test_profile_sites() {
+    StackProfiler::Reset();
+    StackProfiler::SetEnabled(true);
+    {
+        IOManager iom(2, false, "profile");
+        std::atomic<int> done{0};
+        for(int i = 0; i < 10; ++i) {
+            // 调用点1: 浅
+            iom.schedulerLock([&done]() {
+                Recurse(2);
+                ++done;
+            });
+            // 调用点2: 深, 约40KB
+            iom.schedulerLock([&done]() {
+                Recurse(40);
+                ++done;
+            });
+        }
+        WaitFor(done, 20);
+    }
+    StackProfiler::SetEnabled(false);
+
+    auto stats = StackProfiler::GetStats();
+    // 两个lambda各是一个调用点, 另有调度器的idle协程等
+    const StackProfiler::SiteStats* shallow = nullptr;
+    const StackProfiler::SiteStats* deep = nullptr;
+    for(auto& i : stats) {
+        if(i.site.find("test_profile_sites") == std::string::npos || i.count != 10) {
+            continue;
+        }
+        if(i.max_used > 40 * 1024) {
+            deep = &i;
+        } else {
+            shallow = &i;
+        }
+    }
+    DAG_ASSERT(shallow && deep);
+    DAG_ASSERT(shallow->max_used > 2 * 1024 && shallow->max_used < 32 * 1024);
+    DAG_ASSERT(deep->max_used < deep->stack_size);
+    DAG_ASSERT(deep->stack_size == 128000);
+    uint64_t total = 0;
+    for(size_t b = 0; b < StackProfiler::BUCKET_COUNT; ++b) {
+        total += deep->buckets[b];
+    }
+    DAG_ASSERT(total == 10);
+    DAG_ASSERT(deep->buckets[StackProfiler::BucketOf(deep->max_used)] > 0);
+    DAG_LOG_INFO(g_logger) << "test_profile_sites ok\n" << StackProfiler::Dump();
+}
+
+static void Shallow(std::atomic<int>* done) {
+    Recurse(2);
+    ++*done;
+}
+
+static void Deep(std::atomic<int>* done) {
+    Recurse(40);
+    ++*done;
+}
+
+void test_site_name() {
+    // 绑定同一签名不同函数的bind表达式类型相同, 不命名时合成一个调用点
+    StackProfiler::Reset();
+    StackProfiler::SetEnabled(true);
+    {
+        IOManager iom(1, false, "profile_site");
+        std::atomic<int> done{0};
+        for(int i = 0; i < 5; ++i) {
+            iom.schedulerLock(std::bind(&Shallow, &done));
+            iom.schedulerLock(std::bind(&Deep, &done));
+            iom.schedulerLock(std::bind(&Shallow, &done), -1, Fiber::STACK_DEFAULT
+                              , Fiber::PRIORITY_NORMAL, 0, "shallow");
+            iom.schedulerLock(std::bind(&Deep, &done), -1, Fiber::STACK_DEFAULT
+                              , Fiber::PRIORITY_NORMAL, 0, "deep");
+        }
+        WaitFor(done, 20);
+    }
+    StackProfiler::SetEnabled(false);
+
+    const StackProfiler::SiteStats* bound = nullptr;
+    const StackProfiler::SiteStats* shallow = nullptr;
+    const StackProfiler::SiteStats* deep = nullptr;
+    auto stats = StackProfiler::GetStats();
+    for(auto& i : stats) {
+        if(i.site == "shallow") {
+            shallow = &i;
+        } else if(i.site == "deep") {
+            deep = &i;
+        } else if(i.site.find("_Bind<void (*(std::atomic<int>*))") != std::string::npos) {
+            bound = &i;
+        }
+    }
+    DAG_ASSERT(bound && bound->count == 10 && bound->max_used > 40 * 1024);
+    DAG_ASSERT(shallow && shallow->count == 5 && shallow->max_used < 32 * 1024);
+    DAG_ASSERT(deep && deep->count == 5 && deep->max_used > 40 * 1024);
+
+    // reset清掉协程上的调用点名称
+    Fiber::GetThis();
+    Fiber::ptr fiber = std::make_shared<Fiber>([]() {}, 0, false);
+    fiber->setSite("once");
+    fiber->resume();
+    fiber->reset([]() {});
+    DAG_ASSERT(fiber->getSite() == nullptr);
+    DAG_LOG_INFO(g_logger) << "test_site_name ok";
+}
+
+void test_disabled() {
+    StackProfiler::Reset();
+    Fiber::GetThis();
+    Fiber::ptr fiber = std::make_shared<Fiber>([]() { Recurse(4); }, 0, false);
+    fiber->resume();
+    DAG_ASSERT(fiber->getStackUsed() == 0);
+    DAG_ASSERT(StackProfiler::GetStats().empty());
+
+    // reset时重新填充, 每次运行分别测量
+    StackProfiler::SetEnabled(true);
+    fiber->reset([]() { Recurse(8); });
+    fiber->resume();
+    size_t used8 = fiber->getStackUsed();
+    fiber->reset([]() { Recurse(16); });
+    fiber->resume();
+    DAG_ASSERT(used8 > 8 * 1024 && fiber->getStackUsed() > used8 + 7 * 1024);
+    StackProfiler::SetEnabled(false);
+    DAG_LOG_INFO(g_logger) << "test_disabled ok";
+}
+
+int main(int argc, char** argv) {
+    test_measure();
+    test_stack_class();
+    test_profile_sites();
+    test_site_name();
+    test_disabled();
+    return 0;
+}
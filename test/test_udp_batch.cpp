@@ -0,0 +1,242 @@
+#include "address.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "socket.h"
+#include "utils/asserts.h"
+#include "utils/util.h"
+#include <string.h>
+#include <thread>
+#include <vector>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+static void WaitFor(std::atomic<int>& v, int n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/**
+ * @brief 批量接收用的缓冲区
+ */
+struct RecvBatch {
+    static const size_t BUF_SIZE = 2048;
+
+    RecvBatch(size_t n)
+        : msgs(n), iovs(n), bufs(n * BUF_SIZE), addrs(n), controls(n * Socket::UDP_GRO_CONTROL_LEN) {
+        reset();
+    }
+
+    void reset() {
+        memset(msgs.data(), 0, msgs.size() * sizeof(mmsghdr));
+        for(size_t i = 0; i < msgs.size(); ++i) {
+            iovs[i].iov_base = &bufs[i * BUF_SIZE];
+            iovs[i].iov_len = BUF_SIZE;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = &addrs[i];
+            msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            msgs[i].msg_hdr.msg_control = &controls[i * Socket::UDP_GRO_CONTROL_LEN];
+            msgs[i].msg_hdr.msg_controllen = Socket::UDP_GRO_CONTROL_LEN;
+        }
+    }
+
+    const char* data(size_t i) const { return &bufs[i * BUF_SIZE];}
+
+    std::vector<mmsghdr> msgs;
+    std::vector<iovec> iovs;
+    std::vector<char> bufs;
+    std::vector<sockaddr_in> addrs;
+    std::vector<char> controls;
+};
+
+/**
+ * @brief 在iom中创建绑定到回环地址的UDP socket, 这样fd才会由FdMgr管理、IO时挂起协程
+ */
+static Socket::ptr Bind(IOManager& iom, Address::ptr& bound) {
+    Socket::ptr sock;
+    std::atomic<int> done{0};
+    iom.schedulerLock([&]() {
+        Address::ptr addr = IPv4Address::Create("127.0.0.1", 0);
+        sock = Socket::CreateUDP(addr);
+        DAG_ASSERT(sock->bind(addr));
+        bound = sock->getLocalAddress();
+        ++done;
+    });
+    WaitFor(done, 1);
+    return sock;
+}
+
+/**
+ * @brief 在iom中关闭socket, 让FdMgr同步删除fd上下文, 避免fd被复用时沿用旧状态
+ */
+static void Close(IOManager& iom, Socket::ptr sock) {
+    std::atomic<int> done{0};
+    iom.schedulerLock([&]() {
+        sock->close();
+        ++done;
+    });
+    WaitFor(done, 1);
+}
+
+void test_send_recv_many() {
+    IOManager iom(1, false, "udp_batch");
+    const int count = 64;
+    std::atomic<int> done{0};
+    std::atomic<int> received{0};
+    std::atomic<int> bad{0};
+    std::atomic<uint64_t> other_ran{0};
+    Address::ptr rx_addr;
+    Socket::ptr rx = Bind(iom, rx_addr);
+    Address::ptr tx_addr;
+    Socket::ptr tx = Bind(iom, tx_addr);
+
+    // 先开始接收, 没有数据时挂起而不阻塞唯一的工作线程
+    uint64_t start = getElapseMs();
+    iom.schedulerLock([&]() {
+        RecvBatch batch(16);
+        int calls = 0;
+        while(received < count) {
+            batch.reset();
+            int n = rx->recvFromMany(batch.msgs.data(), batch.msgs.size());
+            if(n <= 0) {
+                ++bad;
+                break;
+            }
+            ++calls;
+            for(int i = 0; i < n; ++i) {
+                Address::ptr from = Address::Create((sockaddr*)&batch.addrs[i], batch.msgs[i].msg_hdr.msg_namelen);
+                std::string expect = "packet " + std::to_string(received.load());
+                if(std::string(batch.data(i), batch.msgs[i].msg_len) != expect || *from != *tx_addr) {
+                    ++bad;
+                }
+                ++received;
+            }
+        }
+        DAG_LOG_INFO(g_logger) << "received " << count << " datagrams in " << calls << " recvmmsg calls";
+        ++done;
+    });
+    iom.schedulerLock([&]() {
+        other_ran = getElapseMs();
+        usleep(50 * 1000);
+        std::vector<std::string> payloads;
+        std::vector<iovec> iovs(count);
+        std::vector<mmsghdr> msgs(count);
+        memset(msgs.data(), 0, sizeof(mmsghdr) * count);
+        for(int i = 0; i < count; ++i) {
+            payloads.push_back("packet " + std::to_string(i));
+        }
+        for(int i = 0; i < count; ++i) {
+            iovs[i].iov_base = &payloads[i][0];
+            iovs[i].iov_len = payloads[i].size();
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_name = rx_addr->getAddr();
+            msgs[i].msg_hdr.msg_namelen = rx_addr->getAddrLen();
+        }
+        if(tx->sendToMany(msgs.data(), count) != count || msgs[count - 1].msg_len != payloads[count - 1].size()) {
+            ++bad;
+        }
+        ++done;
+    });
+    WaitFor(done, 2);
+    DAG_ASSERT(bad == 0 && received == count);
+    DAG_ASSERT(other_ran && other_ran - start < 30);
+
+    // 超时
+    std::atomic<int> timed_out{0};
+    iom.schedulerLock([&]() {
+        RecvBatch batch(4);
+        rx->setRecvTimeout(50);
+        uint64_t begin = getElapseMs();
+        int n = rx->recvFromMany(batch.msgs.data(), batch.msgs.size());
+        if(n == -1 && errno == ETIMEDOUT && getElapseMs() - begin >= 45) {
+            ++timed_out;
+        }
+        ++done;
+    });
+    WaitFor(done, 3);
+    DAG_ASSERT(timed_out == 1);
+    Close(iom, rx);
+    Close(iom, tx);
+    DAG_LOG_INFO(g_logger) << "test_send_recv_many ok";
+}
+
+void test_gso_gro() {
+    IOManager iom(1, false, "udp_gso");
+    Address::ptr rx_addr;
+    Socket::ptr rx = Bind(iom, rx_addr);
+    Address::ptr tx_addr;
+    Socket::ptr tx = Bind(iom, tx_addr);
+    const uint16_t segment = 100;
+    if(!tx->setUdpSegment(segment)) {
+        DAG_LOG_INFO(g_logger) << "test_gso_gro skipped: UDP_SEGMENT not supported";
+        return;
+    }
+    bool gro = rx->setUdpGro(true);
+
+    std::atomic<int> done{0};
+    std::atomic<int> bad{0};
+    iom.schedulerLock([&]() {
+        // 一次发送1000字节, 切成10个数据报
+        std::string big(1000, '\0');
+        for(size_t i = 0; i < big.size(); ++i) {
+            big[i] = 'a' + i / segment;
+        }
+        iovec iov{&big[0], big.size()};
+        mmsghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_hdr.msg_iov = &iov;
+        msg.msg_hdr.msg_iovlen = 1;
+        msg.msg_hdr.msg_name = rx_addr->getAddr();
+        msg.msg_hdr.msg_namelen = rx_addr->getAddrLen();
+        if(tx->sendToMany(&msg, 1) != 1) {
+            ++bad;
+        }
+
+        // 每段内容相同, 按GRO分段大小(没有合并时为数据报本身)切开后逐段检查
+        RecvBatch batch(16);
+        size_t segments = 0;
+        size_t coalesced = 0;
+        while(segments < 10) {
+            batch.reset();
+            int n = rx->recvFromMany(batch.msgs.data(), batch.msgs.size());
+            if(n <= 0) {
+                ++bad;
+                break;
+            }
+            for(int i = 0; i < n; ++i) {
+                size_t len = batch.msgs[i].msg_len;
+                size_t seg = Socket::GetUdpGroSegment(batch.msgs[i].msg_hdr);
+                coalesced += seg ? 1 : 0;
+                seg = seg ? seg : len;
+                for(size_t off = 0; off < len; off += seg, ++segments) {
+                    size_t size = std::min(seg, len - off);
+                    if(size != segment || batch.data(i)[off] != (char)('a' + segments)
+                            || batch.data(i)[off + size - 1] != (char)('a' + segments)) {
+                        ++bad;
+                    }
+                }
+            }
+        }
+        if(segments != 10) {
+            ++bad;
+        }
+        DAG_LOG_INFO(g_logger) << "gso: 1 send -> " << segments << " datagrams, gro=" << gro
+            << " coalesced messages=" << coalesced;
+        ++done;
+    });
+    WaitFor(done, 1);
+    DAG_ASSERT(bad == 0);
+    Close(iom, rx);
+    Close(iom, tx);
+    DAG_LOG_INFO(g_logger) << "test_gso_gro ok";
+}
+
+int main(int argc, char** argv) {
+    test_send_recv_many();
+    test_gso_gro();
+    return 0;
+}
@@ -0,0 +1,127 @@
+#include "ioscheduler.h"
+#include "logger.h"
+#include "utils/asserts.h"
+#include "utils/util.h"
+#include "watchdog.h"
+#include <thread>
+#include <unistd.h>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+static void WaitFor(std::atomic<int>& v, int n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+/**
+ * @brief 忙等ms毫秒, 不让出线程; 不内联, 看门狗日志里的调用栈应能看到它
+ */
+static void __attribute__((noinline)) SpinMs(uint64_t ms, bool preempt) {
+    uint64_t start = getElapseMs();
+    while(getElapseMs() - start < ms) {
+        if(preempt) {
+            maybe_yield();
+        }
+    }
+}
+
+static Watchdog::Stats Sum(const std::map<int, Watchdog::Stats>& stats) {
+    Watchdog::Stats sum;
+    for(auto& i : stats) {
+        sum.long_runs += i.second.long_runs;
+        sum.max_run_ms = std::max(sum.max_run_ms, i.second.max_run_ms);
+        sum.current_run_ms = std::max(sum.current_run_ms, i.second.current_run_ms);
+        sum.yields += i.second.yields;
+    }
+    return sum;
+}
+
+void test_long_run() {
+    IOManager iom(1, false, "watchdog");
+    DAG_ASSERT(iom.getWatchdogStats().empty());
+    // 在IOManager启动之后开启
+    iom.setWatchdog(50);
+    std::atomic<int> done{0};
+    std::atomic<int> started{0};
+    iom.schedulerLock([&]() {
+        ++started;
+        SpinMs(200, false);
+        ++done;
+    });
+    WaitFor(started, 1);
+    usleep(100 * 1000);
+    Watchdog::Stats running = Sum(iom.getWatchdogStats());
+    DAG_ASSERT(running.current_run_ms >= 50);
+    WaitFor(done, 1);
+    // 短任务不会被报告
+    for(int i = 0; i < 100; ++i) {
+        iom.schedulerLock([&]() { ++done; });
+    }
+    WaitFor(done, 101);
+    usleep(100 * 1000);
+    Watchdog::Stats stats = Sum(iom.getWatchdogStats());
+    DAG_ASSERT(iom.getWatchdogStats().size() == 1);
+    // 同一次运行只报告一次
+    DAG_ASSERT(stats.long_runs == 1);
+    DAG_ASSERT(stats.max_run_ms >= 190);
+    DAG_ASSERT(stats.current_run_ms == 0);
+
+    // 阈值为0时暂停检测
+    iom.setWatchdog(0);
+    iom.schedulerLock([&]() {
+        SpinMs(100, false);
+        ++done;
+    });
+    WaitFor(done, 102);
+    DAG_ASSERT(Sum(iom.getWatchdogStats()).long_runs == 1);
+    DAG_LOG_INFO(g_logger) << "test_long_run ok";
+}
+
+void test_maybe_yield() {
+    // 不在调度器的协程里什么也不做
+    DAG_ASSERT(!maybe_yield());
+
+    IOManager iom(1, false, "preempt");
+    iom.setWatchdog(10000);
+    set_time_slice_ms(5);
+    std::atomic<int> started{0};
+    std::atomic<int> done{0};
+    std::atomic<uint64_t> spin_end{0};
+    std::atomic<uint64_t> short_ran{0};
+    iom.schedulerLock([&]() {
+        Fiber::GetThis()->setPriority(Fiber::PRIORITY_BACKGROUND);
+        ++started;
+        SpinMs(200, true);
+        // 重新调度后仍保持原有的优先级
+        DAG_ASSERT(Fiber::GetThis()->getPriority() == Fiber::PRIORITY_BACKGROUND);
+        spin_end = getElapseMs();
+        ++done;
+    });
+    WaitFor(started, 1);
+    uint64_t submit = getElapseMs();
+    // 唯一的工作线程被计算循环占着, 短任务靠它主动让出才能运行
+    iom.schedulerLock([&]() {
+        short_ran = getElapseMs();
+        ++done;
+    });
+    WaitFor(done, 2);
+    DAG_ASSERT(short_ran < spin_end);
+    DAG_ASSERT(short_ran - submit < 50);
+    Watchdog::Stats stats = Sum(iom.getWatchdogStats());
+    DAG_ASSERT(stats.yields >= 5);
+    DAG_ASSERT(stats.long_runs == 0);
+    // 让出后时间片重新计算, 每段连续运行都不超过时间片太多
+    DAG_ASSERT(stats.max_run_ms < 50);
+    set_time_slice_ms(10);
+    DAG_LOG_INFO(g_logger) << "test_maybe_yield ok yields=" << stats.yields
+                           << " short task waited " << short_ran - submit << "ms";
+}
+
+int main(int argc, char** argv) {
+    test_long_run();
+    test_maybe_yield();
+    return 0;
+}
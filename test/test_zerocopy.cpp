@@ -0,0 +1,285 @@
+#include "address.h"
+#include "bytearray.h"
+#include "ioscheduler.h"
+#include "logger.h"
+#include "socket.h"
+#include "stream/socket_stream.h"
+#include "utils/asserts.h"
+#include <fcntl.h>
+#include <string.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace dag;
+
+static Logger::ptr g_logger = DAG_LOG_ROOT();
+
+static void WaitFor(std::atomic<int>& v, int n) {
+    while(v < n) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+static char Pattern(size_t i) {
+    return (char)(i * 7 % 251);
+}
+
+static bool CheckPattern(const std::vector<iovec>& iovs, size_t offset) {
+    for(auto& iov : iovs) {
+        for(size_t i = 0; i < iov.iov_len; ++i, ++offset) {
+            if(((char*)iov.iov_base)[i] != Pattern(offset)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+void test_bytearray_pin() {
+    ByteArray::ptr ba(new ByteArray(64));
+    std::string data(200, '\0');
+    for(size_t i = 0; i < data.size(); ++i) {
+        data[i] = Pattern(i);
+    }
+    ba->write(&data[0], data.size());
+    ba->setPosition(0);
+    std::vector<iovec> iovs;
+    DAG_ASSERT(ba->getReadBuffers(iovs, data.size()) == data.size() && iovs.size() == 4);
+
+    // clear后内存块交给句柄, 新写入的数据不会覆盖它们
+    std::shared_ptr<void> pin = ba->pin();
+    DAG_ASSERT(ba->pin() == pin);
+    ba->clear();
+    std::string other(200, 'z');
+    ba->write(&other[0], other.size());
+    DAG_ASSERT(CheckPattern(iovs, 0));
+    ba->setPosition(0);
+    DAG_ASSERT(ba->toString() == other);
+    DAG_ASSERT(ba->pin() != pin);
+
+    // 析构也一样
+    std::vector<iovec> iovs2;
+    ByteArray::ptr ba2(new ByteArray(64));
+    ba2->write(&data[0], data.size());
+    ba2->setPosition(0);
+    ba2->getReadBuffers(iovs2, data.size());
+    std::shared_ptr<void> pin2 = ba2->pin();
+    ba2.reset();
+    DAG_ASSERT(CheckPattern(iovs2, 0));
+    DAG_LOG_INFO(g_logger) << "test_bytearray_pin ok";
+}
+
+void test_zerocopy_send() {
+    IOManager iom(2, false, "zerocopy");
+    const size_t total = 4 << 20;
+    const size_t small = 1000;
+    std::atomic<int> done{0};
+    std::atomic<int> bad{0};
+    std::atomic<bool> supported{true};
+    Address::ptr bound;
+    Socket::ptr server;
+    iom.schedulerLock([&]() {
+        Address::ptr addr = IPv4Address::Create("127.0.0.1", 0);
+        server = Socket::CreateTCP(addr);
+        DAG_ASSERT(server->bind(addr) && server->listen());
+        bound = server->getLocalAddress();
+        ++done;
+    });
+    WaitFor(done, 1);
+
+    // 接收方逐字节校验
+    iom.schedulerLock([&]() {
+        Socket::ptr client = server->accept();
+        std::vector<char> buf(64 * 1024);
+        size_t received = 0;
+        while(received < total + small) {
+            int n = client ? client->recv(&buf[0], buf.size()) : -1;
+            if(n <= 0) {
+                break;
+            }
+            for(int i = 0; i < n; ++i, ++received) {
+                size_t offset = received < total ? received : received - total;
+                if(buf[i] != Pattern(offset)) {
+                    ++bad;
+                    break;
+                }
+            }
+        }
+        if(received != total + small) {
+            ++bad;
+        }
+        ++done;
+    });
+
+    Socket::ZeroCopyStats stats;
+    iom.schedulerLock([&]() {
+        Socket::ptr sock = Socket::CreateTCP(bound);
+        DAG_ASSERT(sock->connect(bound, 1000));
+        if(!sock->setZeroCopy(true)) {
+            supported = false;
+            sock->close();
+            ++done;
+            return;
+        }
+        DAG_ASSERT(sock->isZeroCopy() && sock->getZeroCopyThreshold() == Socket::DEFAULT_ZEROCOPY_THRESHOLD);
+        SocketStream stream(sock, false);
+        ByteArray::ptr ba(new ByteArray);
+        std::string data(total, '\0');
+        for(size_t i = 0; i < total; ++i) {
+            data[i] = Pattern(i);
+        }
+        ba->write(&data[0], data.size());
+        ba->setPosition(0);
+        if(stream.writeFixSize(ba, total) != (int)total) {
+            ++bad;
+        }
+        // 不等完成通知就复用ByteArray, 已发出的内存块由句柄保留
+        ba->clear();
+        ba->write(&data[0], small);
+        ba->setPosition(0);
+        if(stream.writeFixSize(ba, small) != (int)small) {
+            ++bad;
+        }
+        ba->clear();
+        std::string garbage(total, 'x');
+        ba->write(&garbage[0], garbage.size());
+
+        // 完成通知由IOManager的错误事件处理, 这里只等待
+        for(int i = 0; i < 2000 && sock->getZeroCopyStats().pending_sends; ++i) {
+            usleep(1000);
+        }
+        stats = sock->getZeroCopyStats();
+        sock->close();
+        ++done;
+    });
+    WaitFor(done, 2);
+    if(!supported) {
+        server->close();
+        DAG_LOG_INFO(g_logger) << "test_zerocopy_send skipped: SO_ZEROCOPY not supported";
+        return;
+    }
+    WaitFor(done, 3);
+    DAG_LOG_INFO(g_logger) << "zerocopy=" << stats.zerocopy_bytes << " deferred_copy=" << stats.deferred_copy_bytes
+        << " copied=" << stats.copied_bytes << " notifications=" << stats.notifications;
+    DAG_ASSERT(bad == 0);
+    DAG_ASSERT(stats.pending_sends == 0 && stats.pending_bytes == 0 && stats.notifications > 0);
+    DAG_ASSERT(stats.zerocopy_bytes + stats.deferred_copy_bytes == total);
+    DAG_ASSERT(stats.copied_bytes == small);
+    std::atomic<int> closed{0};
+    iom.schedulerLock([&]() {
+        server->close();
+        ++closed;
+    });
+    WaitFor(closed, 1);
+    DAG_LOG_INFO(g_logger) << "test_zerocopy_send ok";
+}
+
+void test_close_in_flight() {
+    IOManager iom(1, false, "zerocopy_close");
+    const size_t total = 256 * 1024;
+    std::atomic<int> done{0};
+    std::atomic<int> bad{0};
+    std::atomic<bool> supported{true};
+    Address::ptr bound;
+    Socket::ptr server;
+    iom.schedulerLock([&]() {
+        Address::ptr addr = IPv4Address::Create("127.0.0.1", 0);
+        server = Socket::CreateTCP(addr);
+        // 接收窗口很小, 接收方不读时大部分数据留在发送方的发送队列里
+        server->setOption(SOL_SOCKET, SO_RCVBUF, 4096);
+        DAG_ASSERT(server->bind(addr) && server->listen());
+        bound = server->getLocalAddress();
+        ++done;
+    });
+    WaitFor(done, 1);
+
+    // 发送方关闭之后才开始读, 读到EOF为止
+    iom.schedulerLock([&]() {
+        Socket::ptr client = server->accept();
+        usleep(100 * 1000);
+        std::vector<char> buf(64 * 1024);
+        size_t received = 0;
+        while(client) {
+            int n = client->recv(&buf[0], buf.size());
+            if(n <= 0) {
+                break;
+            }
+            for(int i = 0; i < n; ++i, ++received) {
+                if(buf[i] != Pattern(received)) {
+                    ++bad;
+                    break;
+                }
+            }
+        }
+        if(received != total) {
+            ++bad;
+        }
+        if(client) {
+            client->close();
+        }
+        ++done;
+    });
+
+    int fd = -1;
+    iom.schedulerLock([&]() {
+        Socket::ptr sock = Socket::CreateTCP(bound);
+        sock->setOption(SOL_SOCKET, SO_SNDBUF, 1 << 20);
+        DAG_ASSERT(sock->connect(bound, 1000));
+        if(!sock->setZeroCopy(true)) {
+            supported = false;
+            sock->close();
+            ++done;
+            return;
+        }
+        fd = sock->getSocket();
+        SocketStream stream(sock, false);
+        ByteArray::ptr ba(new ByteArray);
+        std::string data(total, '\0');
+        for(size_t i = 0; i < total; ++i) {
+            data[i] = Pattern(i);
+        }
+        ba->write(&data[0], data.size());
+        ba->setPosition(0);
+        if(stream.writeFixSize(ba, total) != (int)total) {
+            ++bad;
+        }
+        DAG_ASSERT(sock->getZeroCopyStats().pending_sends > 0);
+        // 不等完成通知就关闭并释放ByteArray, 再申请同样大小的内存写满垃圾
+        sock->close();
+        ba.reset();
+        ByteArray::ptr garbage(new ByteArray);
+        std::string x(total, 'x');
+        garbage->write(&x[0], x.size());
+        ++done;
+    });
+    WaitFor(done, 2);
+    if(!supported) {
+        iom.schedulerLock([&]() {
+            server->close();
+            ++done;
+        });
+        WaitFor(done, 3);
+        DAG_LOG_INFO(g_logger) << "test_close_in_flight skipped: SO_ZEROCOPY not supported";
+        return;
+    }
+    WaitFor(done, 3);
+    DAG_ASSERT(bad == 0);
+    // 完成通知全部到达后fd才被关闭
+    for(int i = 0; i < 1000 && fcntl(fd, F_GETFD) != -1; ++i) {
+        usleep(1000);
+    }
+    DAG_ASSERT(fcntl(fd, F_GETFD) == -1);
+    iom.schedulerLock([&]() {
+        server->close();
+        ++done;
+    });
+    WaitFor(done, 4);
+    DAG_LOG_INFO(g_logger) << "test_close_in_flight ok";
+}
+
+int main(int argc, char** argv) {
+    test_bytearray_pin();
+    test_zerocopy_send();
+    test_close_in_flight();
+    return 0;
+}